@@ -0,0 +1,24 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "../test/test.h"
+#include <time.h>
+
+/*
+ * Each benchmark is a program of its own, which is built like a test (see 'test/test.h') but with
+ * optimizations enabled (see the 'benchmark' target of the makefile). The timings are written to
+ * the standard output. To compare two revisions, run the benchmark against the sources of each of
+ * them ('git checkout <revision> -- src').
+ */
+
+/**
+ * Returns the time of a monotonic clock.
+ * @return The time in milliseconds.
+ */
+static inline double benchmark_now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1e3 + time.tv_nsec / 1e6;
+}
+
+#endif
@@ -0,0 +1,87 @@
+#include "benchmark.h"
+
+// the number of elements of the nested structure
+#define DUMP_ELEMENTS 20000
+// the number of bytes of the large string
+#define DUMP_STRING_SIZE (10 << 20)
+// the number of repetitions, of which the fastest one is reported
+#define DUMP_REPETITIONS 5
+
+// builds a list of vectors, each of which holds a sorted map of a map, a boolean and a symbol
+static BowlValue benchmark_nested(BowlStack stack) {
+    static const char *const words[] = { "alpha", "gr\xc3\xb6\xc3\x9f" "e", "\xe6\x97\xa5\xe6\x9c\xac", "\xf0\x9f\x98\x80x", "plain ascii text", "" };
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+
+    for (u64 i = 0; i < DUMP_ELEMENTS; ++i) {
+        frame.registers[1] = TEST_VALUE(bowl_map(&frame, 3));
+
+        for (u64 j = 0; j < 3; ++j) {
+            const char *const word = words[(i + j) % 6];
+            frame.registers[2] = TEST_VALUE(bowl_string_utf8(&frame, (u8 *) word, strlen(word)));
+            const BowlValue number = TEST_VALUE(bowl_number(&frame, (double) (i * 3 + j) * (j == 1 ? 0.5 : 1.0)));
+            frame.registers[1] = TEST_VALUE(bowl_map_put(&frame, frame.registers[1], frame.registers[2], number));
+        }
+
+        frame.registers[2] = TEST_VALUE(bowl_sorted_map(&frame));
+        const BowlValue key = TEST_VALUE(bowl_number(&frame, (double) i));
+        frame.registers[2] = TEST_VALUE(bowl_sorted_map_put(&frame, frame.registers[2], key, frame.registers[1]));
+        frame.registers[1] = TEST_VALUE(bowl_vector(&frame, NULL, 3));
+        frame.registers[1]->vector.elements[0] = frame.registers[2];
+        frame.registers[2] = TEST_VALUE(bowl_boolean(&frame, i % 2 == 0));
+        frame.registers[1]->vector.elements[1] = frame.registers[2];
+        frame.registers[2] = TEST_VALUE(bowl_symbol_utf8(&frame, (u8 *) "sym-\xce\xbb", 6));
+        frame.registers[1]->vector.elements[2] = frame.registers[2];
+        frame.registers[0] = TEST_VALUE(bowl_list(&frame, frame.registers[1], frame.registers[0]));
+    }
+
+    return frame.registers[0];
+}
+
+// dumps a value into '/dev/null' and shows it in a buffer, reporting the fastest of each
+static void benchmark_dump(const char *name, BowlValue value) {
+    FILE *const null = fopen("/dev/null", "w");
+    TEST_ASSERT(null != NULL);
+
+    double dump = 1e12, show = 1e12;
+    u64 size = 0;
+
+    for (u64 i = 0; i < DUMP_REPETITIONS; ++i) {
+        const double start = benchmark_now();
+        bowl_value_dump(null, value);
+        fflush(null);
+        const double middle = benchmark_now();
+
+        char *buffer;
+        bowl_value_show(value, &buffer, &size);
+        const double end = benchmark_now();
+        free(buffer);
+
+        dump = MIN(dump, middle - start);
+        show = MIN(show, end - middle);
+    }
+
+    fclose(null);
+    printf("%s (%" PRIu64 " bytes): dump %8.2f ms, show %8.2f ms\n", name, size, dump, show);
+}
+
+int main(void) {
+    BowlValue roots[3];
+    BowlStackFrame frame;
+    test_frame(&frame, roots);
+
+    frame.registers[0] = benchmark_nested(&frame);
+    benchmark_dump("nested", frame.registers[0]);
+
+    u8 *const bytes = malloc(DUMP_STRING_SIZE);
+    TEST_ASSERT(bytes != NULL);
+
+    for (u64 i = 0; i < DUMP_STRING_SIZE; ++i) {
+        bytes[i] = (u8) "abcdefgh ij\n"[i % 12];
+    }
+
+    frame.registers[0] = TEST_VALUE(bowl_string_utf8(&frame, bytes, DUMP_STRING_SIZE));
+    free(bytes);
+    benchmark_dump("10 MB string", frame.registers[0]);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,59 @@
+#include "benchmark.h"
+
+// the number of numbers which are shown at once
+#define NUMBER_COUNT 1000000
+
+static void benchmark_format(BowlStack stack, const char *name, u64 kind) {
+    stack->registers[0] = TEST_VALUE(bowl_vector(stack, NULL, NUMBER_COUNT));
+    srand(11);
+
+    for (u64 i = 0; i < NUMBER_COUNT; ++i) {
+        double number;
+
+        switch (kind) {
+            case 0:
+                number = rand() % 100000;
+                break;
+            case 1:
+                number = -(double) rand();
+                break;
+            case 2:
+                number = (rand() % 1000000) / 100.0;
+                break;
+            default:
+                number = rand() / (double) (1 + rand()) * 1e-3;
+                break;
+        }
+
+        const BowlValue value = TEST_VALUE(bowl_number(stack, number));
+        stack->registers[0]->vector.elements[i] = value;
+    }
+
+    double best = INFINITY;
+    u64 length = 0;
+
+    // the best of five runs
+    for (u64 i = 0; i < 5; ++i) {
+        char *bytes;
+        const double start = benchmark_now();
+        bowl_value_show(stack->registers[0], &bytes, &length);
+        best = MIN(best, benchmark_now() - start);
+        free(bytes);
+    }
+
+    printf("format %-9s %9llu bytes %6.1f ms (%5.1f ns per number)\n", name, (unsigned long long) length, best, best * 1e6 / NUMBER_COUNT);
+    stack->registers[0] = NULL;
+}
+
+int main(void) {
+    BowlValue roots[3];
+    BowlStackFrame frame;
+    test_frame(&frame, roots);
+
+    benchmark_format(&frame, "integers", 0);
+    benchmark_format(&frame, "negatives", 1);
+    benchmark_format(&frame, "cents", 2);
+    benchmark_format(&frame, "fractions", 3);
+
+    return EXIT_SUCCESS;
+}
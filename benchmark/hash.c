@@ -0,0 +1,47 @@
+#include "benchmark.h"
+
+#define HASH_ITERATIONS 2000000
+
+// hashes the codepoints of a symbol of the given length, once directly and once as a value (whose
+// cached hash is cleared every time)
+static void benchmark_hash(BowlStack stack, u64 length) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+    u8 name[64];
+
+    for (u64 i = 0; i < length; ++i) {
+        name[i] = (u8) ('a' + i % 26);
+    }
+
+    frame.registers[0] = TEST_VALUE(bowl_symbol_utf8(&frame, name, length));
+
+    u64 sum = 0;
+    const double start = benchmark_now();
+
+    for (u64 i = 0; i < HASH_ITERATIONS; ++i) {
+        name[0] = (u8) i;
+        sum += hash_bytes(name, length, hash_seed());
+    }
+
+    const double middle = benchmark_now();
+
+    for (u64 i = 0; i < HASH_ITERATIONS; ++i) {
+        frame.registers[0]->hash = 0;
+        sum += bowl_value_hash(frame.registers[0]);
+    }
+
+    const double end = benchmark_now();
+
+    printf("hash %2" PRIu64 " characters: bytes %6.2f ns, symbol %6.2f ns (%" PRIu64 ")\n", length, (middle - start) * 1e6 / HASH_ITERATIONS, (end - middle) * 1e6 / HASH_ITERATIONS, sum & 1);
+}
+
+int main(void) {
+    BowlValue roots[3];
+    BowlStackFrame frame;
+    test_frame(&frame, roots);
+
+    benchmark_hash(&frame, 4);
+    benchmark_hash(&frame, 12);
+    benchmark_hash(&frame, 40);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,77 @@
+#include "benchmark.h"
+#include "../src/core/json.h"
+
+// the size of the document in bytes
+#define JSON_SIZE (40 * 1000 * 1000)
+
+static const char *const json_words[] = {
+    "alpha", "beta", "gamma", "d\xc3\xa9lta", "\xc3\xa9psilon", "zeta", "\xce\xb7ta", "theta",
+    "\xe6\x9d\xb1\xe4\xba\xac", "emoji\xf0\x9f\x98\x80", "quote\\\"d", "back\\\\slash", "new\\nline"
+};
+
+static const char *json_word(void) {
+    return json_words[rand() % (sizeof(json_words) / sizeof(json_words[0]))];
+}
+
+static double json_random(double minimum, double maximum) {
+    return minimum + (maximum - minimum) * rand() / RAND_MAX;
+}
+
+// writes an array of records with mixed strings, numbers, nested objects and arrays
+static u64 json_document(char *document) {
+    u64 size = 0;
+    document[size++] = '[';
+
+    for (u64 i = 0; size < JSON_SIZE - 4096; ++i) {
+        size += sprintf(&document[size], "%s{\"id\": %" PRIu64 ", \"user\": {\"name\": \"%s%d\", \"followers\": %d, \"verified\": %s}, \"text\": \"", i == 0 ? "" : ",\n", i, json_word(), rand() % 100000, rand() % 10000000, rand() % 10 == 0 ? "true" : "false");
+
+        for (int j = 0, words = 3 + rand() % 28; j < words; ++j) {
+            size += sprintf(&document[size], "%s%s", j == 0 ? "" : " ", json_word());
+        }
+
+        size += sprintf(&document[size], "\", \"score\": %.17g, \"ratio\": %.17g, \"tags\": [", json_random(0, 1000), json_random(-1, 1));
+
+        for (int j = 0, tags = rand() % 6; j < tags; ++j) {
+            size += sprintf(&document[size], "%s\"%s\"", j == 0 ? "" : ", ", json_word());
+        }
+
+        if (rand() % 10 < 7) {
+            size += sprintf(&document[size], "], \"geo\": null");
+        } else {
+            size += sprintf(&document[size], "], \"geo\": {\"lat\": %.17g, \"lon\": %.17g}", json_random(-90, 90), json_random(-180, 180));
+        }
+
+        size += sprintf(&document[size], ", \"created\": %d}", 1600000000 + rand() % 100000000);
+    }
+
+    document[size++] = ']';
+    return size;
+}
+
+int main(void) {
+    BowlValue roots[3];
+    BowlStackFrame frame;
+    test_frame(&frame, roots);
+
+    char *const document = malloc(JSON_SIZE);
+    TEST_ASSERT(document != NULL);
+
+    srand(5);
+    const u64 size = json_document(document);
+
+    const double start = benchmark_now();
+    frame.registers[0] = TEST_VALUE(bowl_json_parse(&frame, (const u8 *) document, size));
+    const double parsed = benchmark_now();
+
+    u8 *bytes;
+    u64 length;
+    TEST_ASSERT(bowl_json_emit(&frame, frame.registers[0], &bytes, &length) == NULL);
+    const double emitted = benchmark_now();
+
+    printf("json %.1f MB: parse %5.0f ms (%3.0f MB/s), emit %5.0f ms (%3.0f MB/s)\n", size / 1e6, parsed - start, size / (parsed - start) / 1e3, emitted - parsed, length / (emitted - parsed) / 1e3);
+
+    free(bytes);
+    free(document);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,77 @@
+#include "benchmark.h"
+
+// creates the list '0 1 2 ... count - 1' (plus an offset) from its end
+static BowlResult benchmark_list(BowlStack stack, u64 count, u64 offset) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+
+    for (u64 i = count; i > 0; --i) {
+        frame.registers[0] = TEST_VALUE(bowl_number(&frame, (double) (i - 1 + offset)));
+        frame.registers[1] = TEST_VALUE(bowl_list(&frame, frame.registers[0], frame.registers[1]));
+    }
+
+    return (BowlResult) { .failure = false, .value = frame.registers[1] };
+}
+
+// creates a list which is nested 'depth' levels deep in its heads
+static BowlResult benchmark_nested(BowlStack stack, u64 depth) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+
+    for (u64 i = 0; i < depth; ++i) {
+        frame.registers[0] = TEST_VALUE(bowl_list(&frame, frame.registers[0], NULL));
+    }
+
+    return (BowlResult) { .failure = false, .value = frame.registers[0] };
+}
+
+static void benchmark_flat(BowlStack stack, u64 count) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+
+    frame.registers[0] = TEST_VALUE(benchmark_list(&frame, count, 0));
+    frame.registers[1] = TEST_VALUE(benchmark_list(&frame, count, 0));
+
+    const double start = benchmark_now();
+    const u64 hash = bowl_value_hash(frame.registers[0]);
+    const double hashed = benchmark_now();
+    const bool equal = bowl_value_equals(frame.registers[0], frame.registers[1]);
+    const double compared = benchmark_now();
+
+    TEST_ASSERT(equal && hash == bowl_value_hash(frame.registers[1]));
+
+    frame.registers[2] = TEST_VALUE(bowl_map(&frame, 0));
+    frame.registers[2] = TEST_VALUE(bowl_map_put(&frame, frame.registers[2], frame.registers[0], frame.registers[0]));
+    frame.registers[0] = TEST_VALUE(benchmark_list(&frame, count, 0));
+
+    const double before = benchmark_now();
+    const bool found = bowl_map_get_or_else(frame.registers[2], frame.registers[0], NULL) != NULL;
+    const double after = benchmark_now();
+
+    TEST_ASSERT(found);
+    printf("list %7" PRIu64 " elements: hash %8.3f ms, equals %8.3f ms, map lookup %8.3f ms\n", count, hashed - start, compared - hashed, after - before);
+}
+
+static void benchmark_deep(BowlStack stack, u64 depth) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+
+    frame.registers[0] = TEST_VALUE(benchmark_nested(&frame, depth));
+    frame.registers[1] = TEST_VALUE(benchmark_nested(&frame, depth));
+
+    const double start = benchmark_now();
+    const bool equal = bowl_value_equals(frame.registers[0], frame.registers[1]);
+    const u64 hash = bowl_value_hash(frame.registers[0]);
+    const double end = benchmark_now();
+
+    TEST_ASSERT(equal && hash == bowl_value_hash(frame.registers[1]));
+    printf("list %7" PRIu64 " levels deep: equals and hash %8.3f ms\n", depth, end - start);
+}
+
+int main(void) {
+    BowlValue roots[3];
+    BowlStackFrame frame;
+    test_frame(&frame, roots);
+
+    benchmark_flat(&frame, 1000);
+    benchmark_flat(&frame, 1000000);
+    benchmark_deep(&frame, 1000000);
+
+    return EXIT_SUCCESS;
+}
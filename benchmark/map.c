@@ -0,0 +1,43 @@
+#include "benchmark.h"
+
+// puts and looks up the keys 'word:0', 'word:1', ... (including the allocation of the keys)
+static void benchmark_map(BowlStack stack, u64 count) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+    char name[32];
+
+    frame.registers[0] = TEST_VALUE(bowl_map(&frame, 0));
+
+    const double start = benchmark_now();
+
+    for (u64 i = 0; i < count; ++i) {
+        const int length = sprintf(name, "word:%" PRIu64, i);
+        frame.registers[1] = TEST_VALUE(bowl_symbol_utf8(&frame, (u8 *) name, length));
+        frame.registers[2] = TEST_VALUE(bowl_number(&frame, (double) i));
+        frame.registers[0] = TEST_VALUE(bowl_map_put(&frame, frame.registers[0], frame.registers[1], frame.registers[2]));
+    }
+
+    const double middle = benchmark_now();
+    u64 found = 0;
+
+    for (u64 i = 0; i < count; ++i) {
+        const int length = sprintf(name, "word:%" PRIu64, i);
+        frame.registers[1] = TEST_VALUE(bowl_symbol_utf8(&frame, (u8 *) name, length));
+        found += bowl_map_get_or_else(frame.registers[0], frame.registers[1], NULL) != NULL;
+    }
+
+    const double end = benchmark_now();
+
+    TEST_ASSERT(found == count && frame.registers[0]->map.length == count);
+    printf("map %8" PRIu64 " keys: put %6.2f us/op, get %6.2f us/op\n", count, (middle - start) * 1e3 / count, (end - middle) * 1e3 / count);
+}
+
+int main(void) {
+    BowlValue roots[3];
+    BowlStackFrame frame;
+    test_frame(&frame, roots);
+
+    benchmark_map(&frame, 30000);
+    benchmark_map(&frame, 1000000);
+
+    return EXIT_SUCCESS;
+}
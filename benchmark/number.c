@@ -0,0 +1,62 @@
+#include "benchmark.h"
+#include "../src/syntax/scanner.h"
+
+// the number of number literals in the program (about 11 MB)
+#define NUMBER_COUNT 1000000
+
+int main(void) {
+    BowlValue roots[3];
+    BowlStackFrame frame;
+    test_frame(&frame, roots);
+
+    char *const program = malloc(NUMBER_COUNT * 32);
+    u64 size = 0;
+
+    TEST_ASSERT(program != NULL);
+    srand(7);
+
+    // integers, fixed fractions, full precision and scientific notation in turn
+    for (u64 i = 0; i < NUMBER_COUNT; ++i) {
+        switch (i % 4) {
+            case 0:
+                size += sprintf(&program[size], "%d ", rand() % 100000);
+                break;
+            case 1:
+                size += sprintf(&program[size], "%.6f ", (rand() % 2000000) / 1000.0 - 1000);
+                break;
+            case 2:
+                size += sprintf(&program[size], "%.17g ", rand() / 3.0);
+                break;
+            default:
+                size += sprintf(&program[size], "%.3e ", rand() * 1e-9);
+                break;
+        }
+    }
+
+    double scanned = INFINITY;
+    double tokenized = INFINITY;
+    double sum = 0;
+
+    // the best of five runs each
+    for (u64 i = 0; i < 5; ++i) {
+        double start = benchmark_now();
+        BowlScanner scanner = scanner_from_utf8((u8 *) program, size);
+
+        while (scanner_has_next(&scanner)) {
+            scanner_next(&scanner);
+            sum += scanner.token.number.value;
+        }
+
+        scanned = MIN(scanned, benchmark_now() - start);
+
+        start = benchmark_now();
+        frame.registers[0] = TEST_VALUE(bowl_tokens_utf8(&frame, (u8 *) program, size));
+        tokenized = MIN(tokenized, benchmark_now() - start);
+        frame.registers[0] = NULL;
+    }
+
+    printf("number %.1f MB: scanner %5.1f ns per number (%4.0f MB/s), bowl_tokens_utf8 %4.0f MB/s (%g)\n", size / 1e6, scanned * 1e6 / NUMBER_COUNT, size / scanned / 1e3, size / tokenized / 1e3, sum);
+    free(program);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,41 @@
+#include "benchmark.h"
+
+// the number of times the line of the program is repeated (about 17 MB)
+#define TOKENS_LINES 200000
+
+int main(void) {
+    BowlValue roots[3];
+    BowlStackFrame frame;
+    test_frame(&frame, roots);
+
+    char *const program = malloc(TOKENS_LINES * 128);
+    u64 size = 0;
+
+    TEST_ASSERT(program != NULL);
+
+    for (u64 i = 0; i < TOKENS_LINES; ++i) {
+        size += sprintf(&program[size], "list:push swap \"a string literal with some text\" number:add\n    dup 1 2.5 \"\xc3\xa9t\xc3\xa9\" true ");
+    }
+
+    double decoded = INFINITY;
+    double direct = INFINITY;
+
+    // the best of five runs each (the token lists are released in between)
+    for (u64 i = 0; i < 5; ++i) {
+        double start = benchmark_now();
+        frame.registers[0] = TEST_VALUE(bowl_string_utf8(&frame, (u8 *) program, size));
+        frame.registers[1] = TEST_VALUE(bowl_tokens(&frame, frame.registers[0]));
+        decoded = MIN(decoded, benchmark_now() - start);
+        frame.registers[0] = frame.registers[1] = NULL;
+
+        start = benchmark_now();
+        frame.registers[1] = TEST_VALUE(bowl_tokens_utf8(&frame, (u8 *) program, size));
+        direct = MIN(direct, benchmark_now() - start);
+        frame.registers[1] = NULL;
+    }
+
+    printf("tokens %.1f MB: bowl_string_utf8 and bowl_tokens %4.0f MB/s, bowl_tokens_utf8 %4.0f MB/s\n", size / 1e6, size / decoded / 1e3, size / direct / 1e3);
+    free(program);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,44 @@
+#include "benchmark.h"
+
+// the size of each text in bytes
+#define UTF8_SIZE (1 << 20)
+
+// creates a string from 1 MiB of a repeated UTF-8 encoded text (the best of 15 runs)
+static void benchmark_utf8(BowlStack stack, const char *name, const char *unit) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+    const u64 unit_size = strlen(unit);
+    u8 *const bytes = malloc(UTF8_SIZE);
+    u64 size = 0;
+
+    TEST_ASSERT(bytes != NULL);
+
+    while (size + unit_size <= UTF8_SIZE) {
+        memcpy(&bytes[size], unit, unit_size);
+        size += unit_size;
+    }
+
+    double best = INFINITY;
+
+    for (u64 i = 0; i < 15; ++i) {
+        const double start = benchmark_now();
+        frame.registers[0] = TEST_VALUE(bowl_string_utf8(&frame, bytes, size));
+        best = MIN(best, benchmark_now() - start);
+    }
+
+    printf("utf8 %-8s %7.0f MB/s\n", name, size / best / 1e3);
+    free(bytes);
+}
+
+int main(void) {
+    BowlValue roots[3];
+    BowlStackFrame frame;
+    test_frame(&frame, roots);
+
+    benchmark_utf8(&frame, "ascii", "(define (square x) (* x x)) ; a comment\n");
+    benchmark_utf8(&frame, "latin1", "Größenänderung für Straße, ça va? ");
+    benchmark_utf8(&frame, "cyrillic", "Съешь же ещё этих мягких французских булок. ");
+    benchmark_utf8(&frame, "cjk", "日本語のテキストと漢字、中文字符。");
+    benchmark_utf8(&frame, "emoji", "ok 😀 fine 🎉 ");
+
+    return EXIT_SUCCESS;
+}
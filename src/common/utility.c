@@ -1,7 +1,122 @@
 #include "utility.h"
 
-bool is_integer(double value) {
-    return (double) ((u64) value) == value;
+// the secrets of 'wyhash'
+static const u64 hash_secret[4] = {
+    0xA0761D6478BD642Full, 0xE7037ED1A0B428DBull, 0x8EBC6AF09C88C6E3ull, 0x589965CC75374CC3ull
+};
+
+static inline void hash_multiply(u64 *a, u64 *b) {
+    // computes the full 128-bit product of both words
+    #if defined(__SIZEOF_INT128__)
+        const __uint128_t product = (__uint128_t) *a * *b;
+        *a = (u64) product;
+        *b = (u64) (product >> 64);
+    #else
+        const u64 a_high = *a >> 32, a_low = (u32) *a;
+        const u64 b_high = *b >> 32, b_low = (u32) *b;
+        const u64 high = a_high * b_high, middle1 = a_high * b_low, middle2 = a_low * b_high, low = a_low * b_low;
+        const u64 carry = ((low >> 32) + (u32) middle1 + (u32) middle2) >> 32;
+        *a = low + (middle1 << 32) + (middle2 << 32);
+        *b = high + (middle1 >> 32) + (middle2 >> 32) + carry;
+    #endif
+}
+
+static inline u64 hash_mix(u64 a, u64 b) {
+    hash_multiply(&a, &b);
+    return a ^ b;
+}
+
+static inline u64 hash_read8(const u8 *bytes) {
+    u64 word;
+    memcpy(&word, bytes, sizeof(word));
+    return word;
+}
+
+static inline u64 hash_read4(const u8 *bytes) {
+    u32 word;
+    memcpy(&word, bytes, sizeof(word));
+    return word;
+}
+
+static inline u64 hash_read3(const u8 *bytes, u64 length) {
+    return ((u64) bytes[0] << 16) | ((u64) bytes[length >> 1] << 8) | bytes[length - 1];
+}
+
+// the seed of all hash functions (zero until it is chosen)
+static u64 hash_seed_value = 0;
+
+u64 hash_seed(void) {
+    if (hash_seed_value == 0) {
+        // the address of the variable differs between processes due to address space layout randomization
+        u64 entropy = (u64) time(NULL) ^ ((u64) clock() << 32) ^ (u64) &hash_seed_value;
+        hash_seed_value = hash_mix(entropy ^ hash_secret[0], hash_secret[1]) | 1;
+    }
+
+    return hash_seed_value;
+}
+
+bool hash_seed_restore(u64 seed) {
+    if (hash_seed_value == 0) {
+        hash_seed_value = seed;
+    }
+
+    return hash_seed_value == seed;
+}
+
+u64 hash_bytes(const void *bytes, u64 length, u64 seed) {
+    const u8 *data = bytes;
+    u64 a;
+    u64 b;
+
+    seed ^= hash_mix(seed ^ hash_secret[0], hash_secret[1]);
+
+    if (length <= 16) {
+        if (length >= 4) {
+            a = (hash_read4(data) << 32) | hash_read4(data + ((length >> 3) << 2));
+            b = (hash_read4(data + length - 4) << 32) | hash_read4(data + length - 4 - ((length >> 3) << 2));
+        } else if (length > 0) {
+            a = hash_read3(data, length);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        u64 remaining = length;
+
+        if (remaining > 48) {
+            u64 see1 = seed;
+            u64 see2 = seed;
+
+            do {
+                seed = hash_mix(hash_read8(data) ^ hash_secret[1], hash_read8(data + 8) ^ seed);
+                see1 = hash_mix(hash_read8(data + 16) ^ hash_secret[2], hash_read8(data + 24) ^ see1);
+                see2 = hash_mix(hash_read8(data + 32) ^ hash_secret[3], hash_read8(data + 40) ^ see2);
+                data += 48;
+                remaining -= 48;
+            } while (remaining > 48);
+
+            seed ^= see1 ^ see2;
+        }
+
+        while (remaining > 16) {
+            seed = hash_mix(hash_read8(data) ^ hash_secret[1], hash_read8(data + 8) ^ seed);
+            data += 16;
+            remaining -= 16;
+        }
+
+        a = hash_read8(data + remaining - 16);
+        b = hash_read8(data + remaining - 8);
+    }
+
+    a ^= hash_secret[1];
+    b ^= seed;
+    hash_multiply(&a, &b);
+
+    return hash_mix(a ^ hash_secret[0] ^ length, b ^ hash_secret[1]);
+}
+
+u64 hash_combine(u64 a, u64 b) {
+    return hash_mix(a ^ hash_secret[0], b ^ hash_secret[1]);
 }
 
 char *escape(char c) {
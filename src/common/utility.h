@@ -2,6 +2,7 @@
 #define UTILITY_H
 
 #include <bowl/common.h>
+#include <time.h>
 
 #ifndef MAX
 #define MAX(x, y) ((x) > (y) ? (x) : (y))
@@ -11,7 +12,38 @@
 #define MIN(x, y) ((x) < (y) ? (x) : (y))
 #endif
 
-bool is_integer(double value);
+#define BOWL_VM_VERSION "0.0.1-alpha"
+
+/**
+ * Returns the seed of all hash functions, which is chosen randomly once per process.
+ * @return The seed.
+ */
+u64 hash_seed(void);
+
+/**
+ * Adopts the seed of another process (e.g., the one which wrote an image), which is only possible
+ * as long as the seed of this process was not chosen yet.
+ * @param seed The seed.
+ * @return Whether the seed is in use now.
+ */
+bool hash_seed_restore(u64 seed);
+
+/**
+ * Hashes an arbitrary sequence of bytes (using the 'wyhash' algorithm).
+ * @param bytes The bytes.
+ * @param length The number of bytes.
+ * @param seed The seed of the hash.
+ * @return The hash of the bytes.
+ */
+u64 hash_bytes(const void *bytes, u64 length, u64 seed);
+
+/**
+ * Combines two hashes (or a hash and an arbitrary 64-bit word) into a new hash.
+ * @param a The first hash.
+ * @param b The second hash.
+ * @return The combined hash.
+ */
+u64 hash_combine(u64 a, u64 b);
 
 char *escape(char c);
 
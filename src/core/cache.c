@@ -0,0 +1,533 @@
+#include "cache.h"
+#include "core.h"
+#include <errno.h>
+#include <fcntl.h>
+
+#if defined(OS_UNIX)
+    #include <unistd.h>
+#elif defined(OS_WINDOWS)
+    #include <io.h>
+#endif
+
+// the first bytes of every precompiled file, the last of which is the version of the format
+#define CACHE_MAGIC "bowlc\0\0\1"
+// the version of the tokens, which must be incremented whenever the scanner produces different tokens
+#define CACHE_FORMAT_VERSION 1
+// tells whether a precompiled file was written on a machine with the same byte order
+#define CACHE_BYTE_ORDER ((u64) 0x0102030405060708)
+// the number of bytes which are read at once
+#define CACHE_CHUNK_SIZE ((u64) 64 * 1024)
+
+typedef enum {
+    CacheNumberTag,
+    CacheFalseTag,
+    CacheTrueTag,
+    CacheSymbolTag,
+    CacheStringTag
+} CacheTag;
+
+typedef struct {
+    char magic[8];
+    u64 order;
+    /** The hash of the version of the virtual machine and of the format of the tokens. */
+    u64 version;
+    /** The hash of the source. */
+    u64 source;
+    u64 source_length;
+    /** The number of distinct symbols, which precede the tokens. */
+    u64 symbols;
+    u64 tokens;
+    /** The number of bytes which follow the header. */
+    u64 size;
+    /** The hash of the bytes which follow the header. */
+    u64 checksum;
+} CacheHeader;
+
+static inline u64 cache_version(void) {
+    // the hashes are persistent, such that they must not depend on the seed of the process
+    return hash_bytes(BOWL_VM_VERSION, sizeof(BOWL_VM_VERSION) - 1, CACHE_FORMAT_VERSION);
+}
+
+static char *cache_path(const char *path) {
+    const u64 length = strlen(path);
+    char *const cached = malloc(length + 2);
+
+    if (cached != NULL) {
+        memcpy(cached, path, length);
+        cached[length] = 'c';
+        cached[length + 1] = '\0';
+    }
+
+    return cached;
+}
+
+static bool cache_read_file(const char *path, u8 **bytes, u64 *length) {
+    // reads the whole file, whose bytes must be released using 'free' (on failure, 'errno' tells why)
+    const int descriptor = open(path, O_RDONLY);
+
+    if (descriptor < 0) {
+        return false;
+    }
+
+    u8 *buffer = NULL;
+    u64 capacity = 0;
+    i64 count = 0;
+    *length = 0;
+
+    do {
+        *length += count;
+
+        if (*length == capacity) {
+            capacity = MAX(capacity * 2, CACHE_CHUNK_SIZE);
+            u8 *const resized = realloc(buffer, capacity);
+
+            if (resized == NULL) {
+                count = -1;
+                errno = ENOMEM;
+                break;
+            }
+
+            buffer = resized;
+        }
+
+        do {
+            count = read(descriptor, &buffer[*length], capacity - *length);
+        } while (count < 0 && errno == EINTR);
+    } while (count > 0);
+
+    const int error = errno;
+    close(descriptor);
+
+    if (count < 0) {
+        free(buffer);
+        errno = error;
+        return false;
+    }
+
+    *bytes = buffer;
+    return true;
+}
+
+static bool cache_write_varint(Output *output, u64 value) {
+    char bytes[10];
+    u64 length = 0;
+
+    do {
+        bytes[length++] = (char) ((value & 0x7F) | (value >= 0x80 ? 0x80 : 0));
+        value >>= 7;
+    } while (value != 0);
+
+    return output_write(output, bytes, length);
+}
+
+static bool cache_write_text(Output *output, BowlValue text) {
+    // the codepoints are aligned to their width (relative to the end of the header), such that they can be read in place
+    static const char padding[4] = { 0 };
+    const char width = (char) text->string.width;
+
+    return output_write(output, &width, 1)
+        && cache_write_varint(output, text->string.length)
+        && output_write(output, padding, (width - output->length % width) % width)
+        && output_write(output, (const char *) text->string.bytes, text->string.length * width);
+}
+
+static u64 cache_symbol_slot(BowlValue *symbols, u64 capacity, BowlValue symbol) {
+    // symbols are interned, such that equal symbols are the same value
+    u64 slot = hash_combine((u64) (uintptr_t) symbol, 0) & (capacity - 1);
+
+    while (symbols[slot] != NULL && symbols[slot] != symbol) {
+        slot = (slot + 1) & (capacity - 1);
+    }
+
+    return slot;
+}
+
+static bool cache_write(const char *path, BowlValue tokens, u64 source, u64 source_length) {
+    // writes the precompiled form (on failure, 'errno' tells why)
+    const u64 count = tokens == NULL ? 0 : tokens->list.length;
+    u64 capacity = 16;
+
+    while (capacity < count * 2) {
+        capacity *= 2;
+    }
+
+    Output output;
+    const bool buffered = output_buffer(&output, OUTPUT_CAPACITY);
+    BowlValue *const values = malloc(MAX(count, 1) * sizeof(BowlValue));
+    BowlValue *const symbols = calloc(capacity, sizeof(BowlValue));
+    u64 *const indices = malloc(capacity * sizeof(u64));
+    bool success = buffered && values != NULL && symbols != NULL && indices != NULL;
+    u64 symbol_count = 0;
+
+    if (success) {
+        u64 i = 0;
+
+        for (BowlValue list = tokens; list != NULL; list = list->list.tail) {
+            values[i++] = list->list.head;
+        }
+
+        // the distinct symbols are written first
+        for (i = 0; i < count && success; ++i) {
+            if (values[i]->type == BowlSymbolValue) {
+                const u64 slot = cache_symbol_slot(symbols, capacity, values[i]);
+
+                if (symbols[slot] == NULL) {
+                    symbols[slot] = values[i];
+                    indices[slot] = symbol_count++;
+                    success = cache_write_text(&output, values[i]);
+                }
+            }
+        }
+
+        // the tokens are written in reverse order, such that the list can be built from its end
+        for (i = count; i-- > 0 && success;) {
+            const BowlValue value = values[i];
+            char tag;
+
+            switch (value->type) {
+                case BowlNumberValue:
+                    tag = CacheNumberTag;
+                    success = output_write(&output, &tag, 1) && output_write(&output, (const char *) &value->number.value, sizeof(double));
+                    break;
+                case BowlBooleanValue:
+                    tag = value->boolean.value ? CacheTrueTag : CacheFalseTag;
+                    success = output_write(&output, &tag, 1);
+                    break;
+                case BowlSymbolValue:
+                    tag = CacheSymbolTag;
+                    success = output_write(&output, &tag, 1) && cache_write_varint(&output, indices[cache_symbol_slot(symbols, capacity, value)]);
+                    break;
+                case BowlStringValue:
+                    tag = CacheStringTag;
+                    success = output_write(&output, &tag, 1) && cache_write_text(&output, value);
+                    break;
+                default:
+                    // tokens are never of any other type
+                    errno = EINVAL;
+                    success = false;
+                    break;
+            }
+        }
+
+        if (output.failure) {
+            errno = ENOMEM;
+        }
+    } else {
+        errno = ENOMEM;
+    }
+
+    free(values);
+    free(symbols);
+    free(indices);
+
+    if (success) {
+        CacheHeader header = {
+            .order = CACHE_BYTE_ORDER,
+            .version = cache_version(),
+            .source = source,
+            .source_length = source_length,
+            .symbols = symbol_count,
+            .tokens = count,
+            .size = output.length,
+            .checksum = hash_bytes(output.bytes, output.length, 0)
+        };
+
+        memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+
+        // the file is replaced at once, such that other processes never read an incomplete file
+        char *const temporary = malloc(strlen(path) + 5);
+        FILE *file = NULL;
+
+        if (temporary != NULL) {
+            sprintf(temporary, "%s.tmp", path);
+            file = fopen(temporary, "wb");
+        } else {
+            errno = ENOMEM;
+        }
+
+        if (file != NULL) {
+            success = fwrite(&header, sizeof(CacheHeader), 1, file) == 1;
+            success = success && (output.length == 0 || fwrite(output.bytes, output.length, 1, file) == 1);
+            success = fclose(file) == 0 && success;
+            success = success && rename(temporary, path) == 0;
+
+            if (!success) {
+                const int error = errno;
+                remove(temporary);
+                errno = error;
+            }
+        } else {
+            success = false;
+        }
+
+        free(temporary);
+    }
+
+    if (buffered) {
+        const int error = errno;
+        free(output.bytes);
+        errno = error;
+    }
+
+    return success;
+}
+
+static bool cache_read_varint(const u8 **position, const u8 *end, u64 *value) {
+    *value = 0;
+
+    for (u64 shift = 0; *position < end && shift < 64; shift += 7) {
+        const u8 byte = *(*position)++;
+        *value |= (u64) (byte & 0x7F) << shift;
+
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool cache_read_text(const u8 **position, const u8 *body, const u8 *end, u64 *width, u64 *length) {
+    if (*position == end) {
+        return false;
+    }
+
+    *width = *(*position)++;
+
+    if ((*width != 1 && *width != 2 && *width != 4) || !cache_read_varint(position, end, length)) {
+        return false;
+    }
+
+    *position += (*width - (*position - body) % *width) % *width;
+    return *position <= end && *length <= (u64) (end - *position) / *width;
+}
+
+static BowlResult cache_decode(BowlStack stack, const u8 *bytes, u64 length, u64 source, u64 source_length, bool *found) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+    BowlResult result = { .failure = false, .value = NULL };
+    CacheHeader header;
+
+    *found = false;
+
+    if (length < sizeof(CacheHeader)) {
+        return result;
+    }
+
+    memcpy(&header, bytes, sizeof(CacheHeader));
+    const u8 *const body = &bytes[sizeof(CacheHeader)];
+    const u8 *const end = &bytes[length];
+
+    // a precompiled file is only used if it belongs to the very same source and virtual machine
+    const bool valid = memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) == 0
+        && header.order == CACHE_BYTE_ORDER
+        && header.version == cache_version()
+        && header.source == source
+        && header.source_length == source_length
+        && header.size == length - sizeof(CacheHeader)
+        && header.symbols <= header.size
+        && header.tokens <= header.size
+        && header.checksum == hash_bytes(body, header.size, 0);
+
+    if (!valid) {
+        return result;
+    }
+
+    result = bowl_vector(&frame, NULL, header.symbols);
+
+    if (result.failure) {
+        return result;
+    }
+
+    frame.registers[1] = result.value;
+    const u8 *position = body;
+
+    for (u64 i = 0; i < header.symbols; ++i) {
+        u64 width, count;
+
+        if (!cache_read_text(&position, body, end, &width, &count)) {
+            result.value = NULL;
+            return result;
+        }
+
+        result = bowl_text(&frame, BowlSymbolValue, position, width, count);
+
+        if (result.failure) {
+            return result;
+        }
+
+        frame.registers[1]->vector.elements[i] = result.value;
+        position += count * width;
+    }
+
+    for (u64 i = 0; i < header.tokens; ++i) {
+        const u8 tag = position == end ? 0xFF : *position++;
+        u64 width, count;
+        double number;
+
+        switch (tag) {
+            case CacheNumberTag:
+                if ((u64) (end - position) < sizeof(double)) {
+                    result.value = NULL;
+                    return result;
+                }
+
+                memcpy(&number, position, sizeof(double));
+                position += sizeof(double);
+                result = bowl_number(&frame, number);
+                break;
+            case CacheFalseTag:
+            case CacheTrueTag:
+                result = bowl_boolean(&frame, tag == CacheTrueTag);
+                break;
+            case CacheSymbolTag:
+                if (!cache_read_varint(&position, end, &count) || count >= header.symbols) {
+                    result.value = NULL;
+                    return result;
+                }
+
+                result.value = frame.registers[1]->vector.elements[count];
+                break;
+            case CacheStringTag:
+                if (!cache_read_text(&position, body, end, &width, &count)) {
+                    result.value = NULL;
+                    return result;
+                }
+
+                result = bowl_text(&frame, BowlStringValue, position, width, count);
+                position += count * width;
+                break;
+            default:
+                result.value = NULL;
+                return result;
+        }
+
+        if (!result.failure) {
+            result = bowl_list(&frame, result.value, frame.registers[0]);
+        }
+
+        if (result.failure) {
+            return result;
+        }
+
+        frame.registers[0] = result.value;
+    }
+
+    *found = position == end;
+    result.value = *found ? frame.registers[0] : NULL;
+    return result;
+}
+
+static BowlResult cache_load(BowlStack stack, const char *path, const u8 *source, u64 source_length, bool *found) {
+    BowlResult result = { .failure = false, .value = NULL };
+    char *const cached = cache_path(path);
+    u8 *bytes;
+    u64 length;
+
+    *found = false;
+
+    if (cached == NULL) {
+        result.failure = true;
+        result.exception = bowl_exception_out_of_heap;
+        return result;
+    }
+
+    // a precompiled file which is missing or cannot be read is the same as an outdated one
+    if (cache_read_file(cached, &bytes, &length)) {
+        result = cache_decode(stack, bytes, length, hash_bytes(source, source_length, 0), source_length, found);
+        free(bytes);
+    }
+
+    free(cached);
+    return result;
+}
+
+static BowlResult cache_compile(BowlStack stack, const char *path, const u8 *source, u64 length, bool *written) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+    BowlResult result = bowl_tokens_utf8(&frame, source, length);
+    char *const cached = cache_path(path);
+
+    *written = false;
+
+    if (!result.failure) {
+        *written = cached != NULL && cache_write(cached, result.value, hash_bytes(source, length, 0), length);
+    }
+
+    if (cached == NULL) {
+        errno = ENOMEM;
+    }
+
+    const int error = errno;
+    free(cached);
+    errno = error;
+
+    return result;
+}
+
+static BowlResult cache_read_failure(BowlStack stack, const char *path) {
+    BowlResult result = bowl_format_exception(stack, "failed to read file '%s' (%s)", path, strerror(errno));
+    result.failure = true;
+    return result;
+}
+
+BowlResult bowl_tokens_cached(BowlStack stack, const char *path) {
+    u8 *source;
+    u64 length;
+    bool found;
+
+    if (!cache_read_file(path, &source, &length)) {
+        return cache_read_failure(stack, path);
+    }
+
+    BowlResult result = cache_load(stack, path, source, length, &found);
+
+    if (!result.failure && !found) {
+        bool written;
+        result = cache_compile(stack, path, source, length, &written);
+    }
+
+    free(source);
+    return result;
+}
+
+BowlResult bowl_tokens_precompiled(BowlStack stack, const char *path, bool *found) {
+    char *const cached = cache_path(path);
+    const bool exists = cached != NULL && access(cached, F_OK) == 0;
+    BowlResult result = { .failure = false, .value = NULL };
+    u8 *source;
+    u64 length;
+
+    free(cached);
+    *found = false;
+
+    // the source is only read if there is a precompiled file at all
+    if (!exists) {
+        return result;
+    } else if (!cache_read_file(path, &source, &length)) {
+        return cache_read_failure(stack, path);
+    }
+
+    result = cache_load(stack, path, source, length, found);
+    free(source);
+    return result;
+}
+
+BowlResult bowl_tokens_compile(BowlStack stack, const char *path) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+    u8 *source;
+    u64 length;
+    bool written;
+
+    if (!cache_read_file(path, &source, &length)) {
+        return cache_read_failure(&frame, path);
+    }
+
+    BowlResult result = cache_compile(&frame, path, source, length, &written);
+    free(source);
+
+    if (!result.failure && !written) {
+        result = bowl_format_exception(&frame, "failed to write the precompiled form of file '%s' (%s)", path, strerror(errno));
+        result.failure = true;
+    }
+
+    return result;
+}
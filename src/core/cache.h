@@ -0,0 +1,47 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "../common/utility.h"
+#include <bowl/bowl.h>
+#include <bowl/api.h>
+
+/*
+ * The tokens of a source file can be stored in a precompiled form next to the file (its path
+ * followed by 'c', e.g., 'boot.bowlc' for 'boot.bowl'). The precompiled form is only used as long
+ * as the hash of the source, the version of the virtual machine and the version of the format of
+ * the tokens match the ones which it was written for (the latter must be incremented whenever the
+ * scanner changes, see 'cache.c'). Reading it requires a single pass over its bytes without
+ * scanning: the values are stored in their representation in the heap, every distinct symbol is
+ * stored only once and the tokens are stored in reverse order, such that the list is built from
+ * its end.
+ */
+
+/**
+ * Tokenizes a UTF-8 encoded source file using its precompiled form. If the precompiled form is
+ * missing or outdated, the source is tokenized and the precompiled form is written (failures to
+ * write it are ignored).
+ * @param stack The stack of the current environment.
+ * @param path The path of the source file.
+ * @return Either the list of tokens or an exception.
+ */
+BowlResult bowl_tokens_cached(BowlStack stack, const char *path);
+
+/**
+ * Loads the tokens of a source file from its precompiled form, but only if it is up to date.
+ * @param stack The stack of the current environment.
+ * @param path The path of the source file.
+ * @param found Is set to whether the precompiled form was up to date (if not, the result is the
+ * empty list).
+ * @return Either the list of tokens or an exception.
+ */
+BowlResult bowl_tokens_precompiled(BowlStack stack, const char *path, bool *found);
+
+/**
+ * Tokenizes a UTF-8 encoded source file and writes its precompiled form.
+ * @param stack The stack of the current environment.
+ * @param path The path of the source file.
+ * @return Either the list of tokens or an exception.
+ */
+BowlResult bowl_tokens_compile(BowlStack stack, const char *path);
+
+#endif
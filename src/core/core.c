@@ -5,14 +5,13 @@ TODOs:
 - Update all string-to-symbol and symbol-to-string functions (a symbol consists of unicode codepoints)
 - Update all functions which use symbols (including hash, equals, print, etc.)
 - Improve printing overall
-- Check if all utf8 fields for strings are set correctly to 0 at the beginning
 */ 
 
-BOWL_STATIC_UNICODE_STRING(bowl_exception_out_of_heap_message, "\0\0\0o\0\0\0u\0\0\0t\0\0\0 \0\0\0o\0\0\0f\0\0\0 \0\0\0h\0\0\0e\0\0\0a\0\0\0p\0\0\0 \0\0\0m\0\0\0e\0\0\0m\0\0\0o\0\0\0r\0\0\0y", 18);
-BOWL_STATIC_UNICODE_STRING(bowl_exception_finalization_failure_message, "\0\0\0f\0\0\0i\0\0\0n\0\0\0a\0\0\0l\0\0\0i\0\0\0z\0\0\0a\0\0\0t\0\0\0i\0\0\0o\0\0\0n\0\0\0 \0\0\0f\0\0\0a\0\0\0i\0\0\0l\0\0\0e\0\0\0d", 19);
-BOWL_STATIC_UNICODE_STRING(bowl_exception_malformed_utf8_message, "\0\0\0m\0\0\0a\0\0\0l\0\0\0f\0\0\0o\0\0\0r\0\0\0m\0\0\0e\0\0\0d\0\0\0 \0\0\0U\0\0\0T\0\0\0F\0\0\0-\0\0\08\0\0\0 \0\0\0s\0\0\0e\0\0\0q\0\0\0u\0\0\0e\0\0\0n\0\0\0c\0\0\0e", 24);
-BOWL_STATIC_UNICODE_STRING(bowl_exception_incomplete_utf8_message, "\0\0\0i\0\0\0n\0\0\0c\0\0\0o\0\0\0m\0\0\0p\0\0\0l\0\0\0e\0\0\0t\0\0\0e\0\0\0 \0\0\0U\0\0\0T\0\0\0F\0\0\0-\0\0\08\0\0\0 \0\0\0s\0\0\0e\0\0\0q\0\0\0u\0\0\0e\0\0\0n\0\0\0c\0\0\0e", 25);
-BOWL_STATIC_UNICODE_STRING(bowl_sentinel_value_internal, "", 0);
+BOWL_STATIC_ASCII_STRING(bowl_exception_out_of_heap_message, "out of heap memory");
+BOWL_STATIC_ASCII_STRING(bowl_exception_finalization_failure_message, "finalization failed");
+BOWL_STATIC_ASCII_STRING(bowl_exception_malformed_utf8_message, "malformed UTF-8 sequence");
+BOWL_STATIC_ASCII_STRING(bowl_exception_incomplete_utf8_message, "incomplete UTF-8 sequence");
+BOWL_STATIC_ASCII_STRING(bowl_sentinel_value_internal, "");
 
 static struct bowl_value bowl_exception_out_of_heap_value = {
     .type = BowlExceptionValue,
@@ -60,86 +59,42 @@ const BowlValue bowl_exception_malformed_utf8 = &bowl_exception_malformed_utf8_v
 const BowlValue bowl_exception_incomplete_utf8 = &bowl_exception_incomplete_utf8_value;
 const BowlValue bowl_sentinel_value = &bowl_sentinel_value_internal.value;
 
-static BowlResult bowl_map_insert(BowlStack stack, BowlValue bucket, BowlValue key, BowlValue value) {
-    BowlStackFrame arguments = BOWL_ALLOCATE_STACK_FRAME(stack, bucket, key, value);
-    BowlStackFrame variables = BOWL_ALLOCATE_STACK_FRAME(&arguments, NULL, NULL, NULL);
+static BowlResult bowl_register_entry(BowlStack stack, char *documentation, BowlValue library, BowlFunction function) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, library, NULL, NULL);
     BowlResult result;
-    bool found = false;
-
-    variables.registers[0] = NULL;
-    while (arguments.registers[0] != NULL) {
-        if (!found && bowl_value_equals(arguments.registers[1], arguments.registers[0]->list.head)) {
-            result = bowl_list(&variables, arguments.registers[2], variables.registers[0]);
-
-            if (result.failure) {
-                return result;
-            }
-
-            variables.registers[0] = result.value;
-            result = bowl_list(&variables, arguments.registers[1], variables.registers[0]);
-
-            if (result.failure) {
-                return result;
-            }
-
-            variables.registers[0] = result.value;
-            found = true;
-        } else {
-            result = bowl_list(&variables, arguments.registers[0]->list.tail->list.head, variables.registers[0]);
-
-            if (result.failure) {
-                return result;
-            }
-
-            variables.registers[0] = result.value;
-            result = bowl_list(&variables, arguments.registers[0]->list.head, variables.registers[0]);
-
-            if (result.failure) {
-                return result;
-            }
 
-            variables.registers[0] = result.value;
-        }
+    result = bowl_string_utf8(&frame, documentation, strlen(documentation));
 
-        arguments.registers[0] = arguments.registers[0]->list.tail->list.tail;
+    if (result.failure) {
+        return result;
     }
 
-    if (!found) {
-        result = bowl_list(&variables, arguments.registers[2], variables.registers[0]);
-
-        if (result.failure) {
-            return result;
-        }
+    result = bowl_list(&frame, result.value, NULL);
 
-        variables.registers[0] = result.value;
-        result = bowl_list(&variables, arguments.registers[1], variables.registers[0]);
+    if (result.failure) {
+        return result;
+    }
 
-        if (result.failure) {
-            return result;
-        }
+    frame.registers[1] = result.value;
+    result = bowl_function(&frame, frame.registers[0], function);
 
-        variables.registers[0] = result.value;
+    if (result.failure) {
+        return result;
     }
 
-    result.value = variables.registers[0];
-    return result;
+    return bowl_list(&frame, result.value, frame.registers[1]);
+}
+
+static BowlResult bowl_register_name(BowlStack stack, char *name) {
+    // the name is decoded directly from UTF-8 without a temporary buffer of codepoints
+    return bowl_symbol_utf8(stack, (u8 *) name, strlen(name));
 }
 
 BowlValue bowl_register_function(BowlStack stack, char *name, char *documentation, BowlValue library, BowlFunction function) {
     BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, library, NULL, NULL);
 
-    BOWL_TRY(&frame.registers[1], bowl_string_utf8(&frame, documentation, strlen(documentation)));
-    BOWL_TRY(&frame.registers[1], bowl_list(&frame, frame.registers[1], NULL));
-    BOWL_TRY(&frame.registers[2], bowl_function(&frame, frame.registers[0], function));
-    BOWL_TRY(&frame.registers[1], bowl_list(&frame, frame.registers[2], frame.registers[1]));
-
-    u32 *const unicode_name = unicode_from_string(name);
-    if (unicode_name == NULL) {
-        return bowl_exception_out_of_heap;
-    }
-    BOWL_TRY(&frame.registers[2], bowl_symbol(&frame, unicode_name, strlen(name)));
-    free(unicode_name);
-
+    BOWL_TRY(&frame.registers[1], bowl_register_entry(&frame, documentation, frame.registers[0], function));
+    BOWL_TRY(&frame.registers[2], bowl_register_name(&frame, name));
     BOWL_TRY(frame.dictionary, bowl_map_put(&frame, *frame.dictionary, frame.registers[2], frame.registers[1]));
 
     return NULL;
@@ -151,305 +106,223 @@ BowlValue bowl_register(BowlStack stack, BowlValue library, BowlFunctionEntry en
 }
 
 BowlValue bowl_register_all(BowlStack stack, BowlValue library, BowlFunctionEntry entries[], u64 entries_length) {
-    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, library, NULL, NULL);
-    
-    for (u64 i = 0; i < entries_length; ++i) {
-        const BowlValue exception = bowl_register(&frame, frame.registers[0], entries[i]);
-        if (exception != NULL) {
-            return exception;
-        }
-    }
-
-    return NULL;
-}
-
-
-BowlValue bowl_map_get_or_else(BowlValue map, BowlValue key, BowlValue otherwise) {
-    const u64 index = bowl_value_hash(key) % map->map.capacity;
-    BowlValue bucket = map->map.buckets[index];
-
-    while (bucket != NULL) {
-        if (bowl_value_equals(key, bucket->list.head)) {
-            return bucket->list.tail->list.head;
-        }
-
-        bucket = bucket->list.tail->list.tail;
-    }
-    
-    return otherwise;
-}
-
-BowlResult bowl_map_merge(BowlStack stack, BowlValue a, BowlValue b) {
-    BowlStackFrame arguments = BOWL_ALLOCATE_STACK_FRAME(stack, a, b, NULL);
+    BowlStackFrame arguments = BOWL_ALLOCATE_STACK_FRAME(stack, library, NULL, NULL);
     BowlStackFrame variables = BOWL_ALLOCATE_STACK_FRAME(&arguments, NULL, NULL, NULL);
-    BowlResult result = bowl_map(&variables, (u64) ((arguments.registers[0]->map.capacity + arguments.registers[1]->map.capacity) * (4.0 / 3.0)));
-    
-    if (result.failure) {
-        return result;
-    }
-
-    arguments.registers[2] = result.value;
+    BowlMapBuilder builder;
 
-    // add the first map
-    for (u64 i = 0; i < arguments.registers[0]->map.capacity; ++i) {
-        variables.registers[0] = arguments.registers[0]->map.buckets[i];
-
-        while (variables.registers[0] != NULL) {
-            result = bowl_map_put(&variables, arguments.registers[2], variables.registers[0]->list.head, variables.registers[0]->list.tail->list.head);
-
-            if (result.failure) {
-                return result;
-            }
-            
-            arguments.registers[2] = result.value;
-            variables.registers[0] = variables.registers[0]->list.tail->list.tail;
-        }
+    // collect all functions first and publish them as a single new dictionary
+    BowlValue exception = bowl_map_builder_begin(&variables, &builder, &arguments.registers[1], *arguments.dictionary, entries_length);
+    if (exception != NULL) {
+        return exception;
     }
 
-    // add the second map
-    for (u64 i = 0; i < arguments.registers[1]->map.capacity; ++i) {
-        variables.registers[0] = arguments.registers[1]->map.buckets[i];
+    for (u64 i = 0; i < entries_length; ++i) {
+        BOWL_TRY(&variables.registers[0], bowl_register_entry(&variables, entries[i].documentation, arguments.registers[0], entries[i].function));
+        BOWL_TRY(&variables.registers[1], bowl_register_name(&variables, entries[i].name));
 
-        while (variables.registers[0] != NULL) {
-            result = bowl_map_put(&variables, arguments.registers[2], variables.registers[0]->list.head, variables.registers[0]->list.tail->list.head);
-            
-            if (result.failure) {
-                return result;
-            }
-                
-            arguments.registers[2] = result.value;
-            variables.registers[0] = variables.registers[0]->list.tail->list.tail;
+        exception = bowl_map_builder_put(&variables, &builder, variables.registers[1], variables.registers[0]);
+        if (exception != NULL) {
+            return exception;
         }
     }
 
-    result.value = arguments.registers[2];
-    result.failure = false;
+    BOWL_TRY(arguments.dictionary, bowl_map_builder_freeze(&variables, &builder));
 
-    return result;
+    return NULL;
 }
 
-static BowlResult bowl_map_delete_at(BowlStack stack, BowlValue map, u64 bucket, u64 index) {
-    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, map, NULL, NULL);
-    BowlResult result;
-
-    result = bowl_value_clone(&frame, frame.registers[0]);
-
-    if (result.failure) {
-        return result;
-    }
-
-    frame.registers[0] = result.value;
-
-    frame.registers[1] = frame.registers[0]->map.buckets[bucket];
-    u64 current = 0;
-    while (frame.registers[1] != NULL) {
-        if (index != current) {
-            result = bowl_list(&frame, frame.registers[1]->list.tail->list.head, frame.registers[2]);
-
-            if (result.failure) {
-                return result;
-            }
-
-            frame.registers[2] = result.value;
-            result = bowl_list(&frame, frame.registers[1]->list.head, frame.registers[2]);
-
-            if (result.failure) {
-                return result;
-            }
-
-            frame.registers[2] = result.value;
+bool bowl_library_is_loaded(char *path) {
+    #if defined(OS_UNIX)
+        void *handle = dlopen(path, RTLD_LAZY | RTLD_NOLOAD);
+        if (handle != NULL) {
+            dlclose(handle);
+            return true;
+        } else {
+            return false;
         }
-
-        frame.registers[1] = frame.registers[1]->list.tail->list.tail;
-        ++current;
-    }
-
-    frame.registers[0]->map.buckets[bucket] = frame.registers[2];
-    result.value = frame.registers[0];
-    result.failure = false;
-
-    return result;
+    #elif defined(OS_WINDOWS)
+        return GetModuleHandle(path) != NULL;
+    #else
+        return false;
+    #endif
 }
 
-BowlResult bowl_map_delete(BowlStack stack, BowlValue map, BowlValue key) {
-    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, map, key, NULL);
-
-    const u64 index = bowl_value_hash(frame.registers[1]) % frame.registers[0]->map.capacity;
-
-    frame.registers[2] = frame.registers[0]->map.buckets[index];
-    u64 current = 0;
-    while (frame.registers[2] != NULL) {
-        if (bowl_value_equals(frame.registers[2]->list.head, frame.registers[1])) {
-            return bowl_map_delete_at(&frame, frame.registers[0], index, current);
-        }
-
-        frame.registers[2] = frame.registers[2]->list.tail->list.tail;
-        ++current;
-    }
-
-    BowlResult result = {
-        .value = frame.registers[0],
-        .failure = false
-    };
-
-    return result;
+static inline u64 bowl_list_cell_hash(u64 head, u64 tail) {
+    // the hash of a cell only depends on the hashes of its head and its tail
+    const u64 hash = hash_combine(hash_combine(hash_combine(hash_seed(), BowlListValue), head), tail);
+    return hash == 0 ? 1 : hash;
 }
 
-BowlResult bowl_map_put(BowlStack stack, BowlValue map, BowlValue key, BowlValue value) {
-    static const double load_factor = 0.75;
+static u64 bowl_list_hash(BowlValue list) {
+    // collect all cells whose hash is unknown, such that they can be hashed from the back without recursion
+    BowlValue buffer[64];
+    BowlValue *cells = buffer;
+    u64 capacity = sizeof(buffer) / sizeof(buffer[0]);
+    u64 length = 0;
 
-    BowlStackFrame arguments = BOWL_ALLOCATE_STACK_FRAME(stack, map, key, value);
-    BowlStackFrame variables = BOWL_ALLOCATE_STACK_FRAME(&arguments, NULL, NULL, NULL);
-    BowlResult result;
+    for (BowlValue cell = list; cell != NULL && cell->hash == 0; cell = cell->list.tail) {
+        if (length == capacity) {
+            BowlValue *const new_cells = cells == buffer ? malloc(2 * capacity * sizeof(BowlValue)) : realloc(cells, 2 * capacity * sizeof(BowlValue));
 
-    // resize capacity if it exceeds the load factor
-    u64 capacity = arguments.registers[0]->map.capacity;
-    if (arguments.registers[0]->map.length + 1 >= capacity * load_factor) {
-        capacity = MAX(capacity * 2, (arguments.registers[0]->map.length + 1) * 2);
-    }
-
-    // copy the buckets
-    result = bowl_map(&variables, capacity);
-    if (result.failure) {
-        return result;
-    }
-
-    variables.registers[0] = result.value;
-    variables.registers[0]->map.length = arguments.registers[0]->map.length;
-    if (capacity != arguments.registers[0]->map.capacity) {
-        for (u64 i = 0; i < arguments.registers[0]->map.capacity; ++i) {
-            variables.registers[1] = arguments.registers[0]->map.buckets[i];
-            while (variables.registers[1] != NULL) {
-                variables.registers[2] = variables.registers[1]->list.head;
-                variables.registers[1] = variables.registers[1]->list.tail;
-
-                const u64 index = bowl_value_hash(variables.registers[2]) % capacity;
-                result = bowl_map_insert(
-                    &variables,
-                    variables.registers[0]->map.buckets[index],
-                    variables.registers[2],
-                    variables.registers[1]->list.head
-                );
-
-                if (result.failure) {
-                    return result;
-                }
-
-                variables.registers[0]->map.buckets[index] = result.value;
-                variables.registers[1] = variables.registers[1]->list.tail;
+            if (new_cells == NULL) {
+                // hash the remaining cells recursively instead
+                break;
+            } else if (cells == buffer) {
+                memcpy(new_cells, buffer, sizeof(buffer));
             }
-        }
-    } else {
-        for (u64 i = 0; i < capacity; ++i) {
-            variables.registers[0]->map.buckets[i] = arguments.registers[0]->map.buckets[i];
-        }
-    }
-
-    // insert the new key-value pair
-    const u64 index = bowl_value_hash(arguments.registers[1]) % capacity;
-    const u64 length = bowl_value_length(variables.registers[0]->map.buckets[index]);
 
-    result = bowl_map_insert(
-        &variables, 
-        variables.registers[0]->map.buckets[index], 
-        arguments.registers[1], 
-        arguments.registers[2]
-    );
+            cells = new_cells;
+            capacity *= 2;
+        }
 
-    if (result.failure) {
-        return result;
+        cells[length++] = cell;
     }
 
-    variables.registers[0]->map.buckets[index] = result.value;
-
-    if (bowl_value_length(result.value) > length) {
-        variables.registers[0]->map.length += 1;
+    while (length > 0) {
+        const BowlValue cell = cells[--length];
+        cell->hash = bowl_list_cell_hash(bowl_value_hash(cell->list.head), bowl_value_hash(cell->list.tail));
     }
 
-    result.value = variables.registers[0];
+    if (cells != buffer) {
+        free(cells);
+    }
 
-    return result;
-}
-
-bool bowl_library_is_loaded(char *path) {
-    #if defined(OS_UNIX)
-        void *handle = dlopen(path, RTLD_LAZY | RTLD_NOLOAD);
-        if (handle != NULL) {
-            dlclose(handle);
-            return true;
-        } else {
-            return false;
-        }
-    #elif defined(OS_WINDOWS)
-        return GetModuleHandle(path) != NULL;
-    #else
-        return false;
-    #endif
+    return list->hash;
 }
 
 u64 bowl_value_hash(BowlValue value) {
     if (value == NULL) {
         return 31;
     } else if (value->hash == 0) {
-        value->hash = 31;
+        // each type uses its own seed such that e.g. a symbol and a string with the same codepoints differ
+        const u64 seed = hash_combine(hash_seed(), value->type);
+        u64 hash = seed;
 
         switch (value->type) {
             case BowlSymbolValue:
-                for (u64 i = 0, end = value->symbol.length; i < end; ++i) {
-                    value->hash += pow(value->symbol.codepoints[i] * 31, end - (i + 1));
-                }
+                hash = intern_hash(value->symbol.bytes, value->symbol.width, value->symbol.length);
                 break;
 
             case BowlNumberValue:
-                value->hash += *((u64 *) (&value->number.value)) * 31;
+                {
+                    // '0.0' and '-0.0' are equal and must have the same hash
+                    const double number = value->number.value == 0.0 ? 0.0 : value->number.value;
+                    u64 bits;
+                    memcpy(&bits, &number, sizeof(bits));
+                    hash = hash_combine(seed, bits);
+                }
                 break;
 
             case BowlBooleanValue:
-                value->hash = value->boolean.value ? 7 : 31;
+                hash = hash_combine(seed, value->boolean.value);
                 break;
 
             case BowlStringValue:
-                for (u64 i = 0, end = value->string.length; i < end; ++i) {
-                    value->hash += pow(value->string.codepoints[i] * 31, end - (i + 1));
-                }
+                // the hash depends neither on the width nor on the kind of the string
+                hash = text_hash(value, seed);
                 break;
 
             case BowlNativeValue:
-                value->hash += (u64) value->function.function * 31;
+                hash = hash_combine(seed, (u64) value->function.function);
                 break;
 
             case BowlLibraryValue:
-                value->hash += (u64) value->library.handle * 31;
+                hash = hash_combine(seed, (u64) value->library.handle);
                 break;
 
             case BowlListValue:
-                value->hash += bowl_value_hash(value->list.head) * 31;
-                value->hash += bowl_value_hash(value->list.tail) * 31;
+                hash = bowl_list_hash(value);
                 break;
 
             case BowlMapValue:
-                for (u64 i = 0, end = value->map.capacity; i < end; ++i) {
-                    value->hash += bowl_value_hash(value->map.buckets[i]) * 31;
+                {
+                    // the order of the pairs depends on the hashes => use an order-independent combination
+                    MapIterator iterator = map_iterator(value);
+                    BowlValue entry_key;
+                    BowlValue entry_value;
+
+                    while (map_iterator_next(&iterator, &entry_key, &entry_value)) {
+                        hash += hash_combine(bowl_value_hash(entry_key), bowl_value_hash(entry_value));
+                    }
+                }
+                break;
+
+            case BowlSortedMapValue:
+                {
+                    // the order of the pairs is unique => use an order-dependent combination
+                    BowlValue root = value;
+                    BowlSortedMapCursor cursor = bowl_sorted_map_cursor(&root);
+                    BowlValue entry_key;
+                    BowlValue entry_value;
+
+                    while (bowl_sorted_map_cursor_next(&cursor, &entry_key, &entry_value)) {
+                        hash = hash_combine(hash, bowl_value_hash(entry_key));
+                        hash = hash_combine(hash, bowl_value_hash(entry_value));
+                    }
                 }
                 break;
 
             case BowlVectorValue:
                 for (u64 i = 0, end = value->vector.length; i < end; ++i) {
-                    value->hash += bowl_value_hash(value->vector.elements[i]) * 31;
+                    hash = hash_combine(hash, bowl_value_hash(value->vector.elements[i]));
                 }
                 break;
 
             case BowlExceptionValue:
-                value->hash += bowl_value_hash(value->exception.cause) * 31;
-                value->hash += bowl_value_hash(value->exception.message) * 31;
+                hash = hash_combine(hash_combine(seed, bowl_value_hash(value->exception.cause)), bowl_value_hash(value->exception.message));
                 break;
         }
+
+        // a hash of zero marks a hash which has not been computed yet
+        value->hash = hash == 0 ? 1 : hash;
     }
 
     return value->hash;
 }
 
-bool bowl_value_equals(BowlValue a, BowlValue b) {
+typedef struct {
+    BowlValue (*pairs)[2];
+    u64 length;
+    u64 capacity;
+    BowlValue buffer[32][2];
+} BowlEqualsStack;
+
+static bool bowl_equals_push(BowlEqualsStack *stack, BowlValue a, BowlValue b) {
+    if (a == b) {
+        // shared substructure does not need to be compared
+        return true;
+    }
+
+    if (stack->length == stack->capacity) {
+        const u64 capacity = stack->capacity * 2;
+        BowlValue (*pairs)[2];
+
+        if (stack->pairs == stack->buffer) {
+            pairs = malloc(capacity * sizeof(stack->pairs[0]));
+            if (pairs != NULL) {
+                memcpy(pairs, stack->buffer, sizeof(stack->buffer));
+            }
+        } else {
+            pairs = realloc(stack->pairs, capacity * sizeof(stack->pairs[0]));
+        }
+
+        if (pairs == NULL) {
+            return false;
+        }
+
+        stack->pairs = pairs;
+        stack->capacity = capacity;
+    }
+
+    stack->pairs[stack->length][0] = a;
+    stack->pairs[stack->length][1] = b;
+    ++stack->length;
+
+    return true;
+}
+
+static bool bowl_equals_step(BowlEqualsStack *stack, BowlValue a, BowlValue b) {
+    // compares two values, whereas the elements of compound values are pushed onto the stack
     if (a == b) {
         return true;
     } else if (a == NULL || b == NULL) {
@@ -458,116 +331,154 @@ bool bowl_value_equals(BowlValue a, BowlValue b) {
         return false;
     } else if (a->hash != 0 && b->hash != 0 && a->hash != b->hash) {
         return false;
-    } else {
-        switch (a->type) {
-            case BowlSymbolValue:
-                if (a->symbol.length != b->symbol.length) {
-                    return false;
-                }
+    }
 
-                for (u64 i = 0, end = a->symbol.length; i < end; ++i) {
-                    if (a->symbol.codepoints[i] != b->symbol.codepoints[i]) {
-                        return false;
-                    }
-                }
+    switch (a->type) {
+        case BowlSymbolValue:
+            return a->symbol.length == b->symbol.length
+                && a->symbol.width == b->symbol.width
+                && memcmp(a->symbol.bytes, b->symbol.bytes, a->symbol.length * a->symbol.width) == 0;
 
-                return true;
+        case BowlNumberValue:
+            return a->number.value == b->number.value;
 
-            case BowlNumberValue:
-                return a->number.value == b->number.value;
+        case BowlBooleanValue:
+            return a->boolean.value == b->boolean.value;
 
-            case BowlBooleanValue:
-                return a->boolean.value == b->boolean.value;
+        case BowlStringValue:
+            if (a->string.length != b->string.length) {
+                return false;
+            } else if (text_is_flat(a) && text_is_flat(b)) {
+                // flat strings are always stored in their smallest width
+                return a->string.width == b->string.width
+                    && memcmp(a->string.bytes, b->string.bytes, a->string.length * a->string.width) == 0;
+            } else {
+                return text_compare_values(a, b, a->string.length) == 0;
+            }
 
-            case BowlStringValue:
-                if (a->string.length != b->string.length) {
-                    return false;
-                }
+        case BowlNativeValue:
+            return a->function.function == b->function.function;
 
-                for (u64 i = 0, end = a->string.length; i < end; ++i) {
-                    if (a->string.codepoints[i] != b->string.codepoints[i]) {
-                        return false;
-                    }
-                }
+        case BowlLibraryValue:
+            return a->library.handle == b->library.handle;
 
-                return true;
+        case BowlVectorValue:
+            if (a->vector.length != b->vector.length) {
+                return false;
+            }
 
-            case BowlNativeValue:
-                return a->function.function == b->function.function;
+            for (u64 i = 0, end = a->vector.length; i < end; ++i) {
+                if (!bowl_equals_push(stack, a->vector.elements[i], b->vector.elements[i])) {
+                    return false;
+                }
+            }
 
-            case BowlLibraryValue:
-                return a->library.handle == b->library.handle;
+            return true;
 
-            case BowlVectorValue:
-                if (a->vector.length != b->vector.length) {
+        case BowlListValue:
+            if (a->list.length != b->list.length) {
+                return false;
+            }
+
+            // walk both spines until they share the same tail
+            while (a != b) {
+                if (a->hash != 0 && b->hash != 0 && a->hash != b->hash) {
                     return false;
                 }
 
-                {
-                    const u64 length = a->vector.length;
-                    for (register u64 i = 0; i < length; ++i) {
-                        if (!bowl_value_equals(a->vector.elements[i], b->vector.elements[i])) {
-                            return false;
-                        }
+                const BowlValue a_head = a->list.head;
+                const BowlValue b_head = b->list.head;
+
+                if (a_head != NULL && a_head->type == BowlListValue) {
+                    // nested lists are compared later such that the native stack does not grow
+                    if (!bowl_equals_push(stack, a_head, b_head)) {
+                        return false;
                     }
+                } else if (!bowl_equals_step(stack, a_head, b_head)) {
+                    return false;
                 }
 
-                return true;
+                a = a->list.tail;
+                b = b->list.tail;
+            }
 
-            case BowlListValue:
-                if (a->list.length != b->list.length) {
-                    return false;
-                }
+            return true;
 
-                do {
-                    if (!bowl_value_equals(a->list.head, b->list.head)) {
+        case BowlMapValue:
+            if (a->map.length != b->map.length) {
+                return false;
+            }
+
+            {
+                // both maps have the same size => it suffices to find every key of one map in the other
+                MapIterator iterator = map_iterator(a);
+                BowlValue key;
+                BowlValue entry;
+
+                while (map_iterator_next(&iterator, &key, &entry)) {
+                    const BowlValue other = bowl_map_get_or_else(b, key, bowl_sentinel_value);
+
+                    if (other == bowl_sentinel_value || !bowl_equals_push(stack, entry, other)) {
                         return false;
                     }
+                }
+            }
 
-                    a = a->list.tail;
-                    b = b->list.tail;
-                } while (a != NULL);
+            return true;
 
-                return true;
+        case BowlSortedMapValue:
+            if (a->map.length != b->map.length) {
+                return false;
+            }
 
-            case BowlMapValue:
-                if (a->map.length != b->map.length) {
-                    return false;
+            {
+                // both maps are sorted => compare the pairs one by one
+                BowlSortedMapCursor a_cursor = bowl_sorted_map_cursor(&a);
+                BowlSortedMapCursor b_cursor = bowl_sorted_map_cursor(&b);
+                BowlValue a_key, a_entry, b_key, b_entry;
+
+                while (bowl_sorted_map_cursor_next(&a_cursor, &a_key, &a_entry)) {
+                    bowl_sorted_map_cursor_next(&b_cursor, &b_key, &b_entry);
+
+                    if (!bowl_equals_push(stack, a_key, b_key) || !bowl_equals_push(stack, a_entry, b_entry)) {
+                        return false;
+                    }
                 }
+            }
 
-                return bowl_map_subset_of(a, b) && bowl_map_subset_of(b, a);
+            return true;
 
-            case BowlExceptionValue:
-                return bowl_value_equals(a->exception.message, b->exception.message) 
-                    && bowl_value_equals(a->exception.cause, b->exception.cause);
-        }
+        case BowlExceptionValue:
+            return bowl_equals_push(stack, a->exception.message, b->exception.message)
+                && bowl_equals_push(stack, a->exception.cause, b->exception.cause);
     }
-}
 
-bool bowl_map_subset_of(BowlValue superset, BowlValue subset) {
-    if (subset->map.length > superset->map.length) {
-        return false;
-    }
+    return false;
+}
 
-    for (u64 i = 0, end = subset->map.capacity; i < end; ++i) {
-        BowlValue bucket = subset->map.buckets[i];
+bool bowl_value_equals(BowlValue a, BowlValue b) {
+    // use an explicit stack such that deeply nested values cannot exhaust the native stack
+    BowlEqualsStack stack;
+    bool equal = true;
 
-        while (bucket != NULL) {
-            const BowlValue result = bowl_map_get_or_else(superset, bucket->list.head, bowl_sentinel_value);
+    stack.pairs = stack.buffer;
+    stack.length = 0;
+    stack.capacity = sizeof(stack.buffer) / sizeof(stack.buffer[0]);
 
-            bucket = bucket->list.tail;
+    if (!bowl_equals_push(&stack, a, b)) {
+        return false;
+    }
 
-            if (result == bowl_sentinel_value) {
-                return false;
-            } else if (!bowl_value_equals(bucket->list.head, result)) {
-                return false;
-            }
+    while (equal && stack.length > 0) {
+        --stack.length;
+        equal = bowl_equals_step(&stack, stack.pairs[stack.length][0], stack.pairs[stack.length][1]);
+    }
 
-            bucket = bucket->list.tail;
-        }
+    if (stack.pairs != stack.buffer) {
+        free(stack.pairs);
     }
 
-    return true;
+    return equal;
 }
 
 u64 bowl_value_byte_size(BowlValue value) {
@@ -576,13 +487,15 @@ u64 bowl_value_byte_size(BowlValue value) {
     } else {
         switch (value->type) {
             case BowlSymbolValue:
-                return sizeof(struct bowl_value) + value->symbol.length * sizeof(u32);
+                return sizeof(struct bowl_value) + value->symbol.length * value->symbol.width;
             case BowlStringValue:
-                return sizeof(struct bowl_value) + value->string.length * sizeof(u32);
+                return sizeof(struct bowl_value) + text_storage_size(value);
             case BowlLibraryValue:
                 return sizeof(struct bowl_value) + value->library.length * sizeof(u8);
             case BowlMapValue:
-                return sizeof(struct bowl_value) + value->map.capacity * sizeof(BowlValue);
+                return sizeof(struct bowl_value) + map_node_slots(value) * sizeof(BowlValue);
+            case BowlSortedMapValue:
+                return sizeof(struct bowl_value) + sorted_map_node_slots(value) * sizeof(BowlValue);
             case BowlVectorValue:
                 return sizeof(struct bowl_value) + value->vector.length * sizeof(BowlValue);
             default:
@@ -607,377 +520,176 @@ void bowl_value_debug(BowlValue value, char *message, ...) {
     fflush(stdout);
 }
 
-void bowl_value_dump(FILE *stream, BowlValue value) {
-    if (value == NULL) {
-        fprintf(stream, "[ ]");
-    } else {
-        switch (value->type) {
-            case BowlSymbolValue:
-                for (u64 i = 0, end = value->symbol.length; i < end; ++i) {
-                    u8 bytes[4];
-                    u64 written = unicode_utf8_encode(value->symbol.codepoints[i], &bytes[0]);
-                    if (written == 0) written = 3; // unicode replacement character was written
-                    fwrite(&bytes[0], sizeof(u8), written, stream);
-                }
-                break;
-
-            case BowlNumberValue:
-                if (is_integer(value->number.value)) {
-                    fprintf(stream, "%" PRId64, (u64) value->number.value);
-                } else {
-                    fprintf(stream, "%f", value->number.value);
-                }
-                break;
-            
-            case BowlBooleanValue:
-                if (value->boolean.value) {
-                    fprintf(stream, "true");
-                } else {
-                    fprintf(stream, "false");
-                }
-                break;
-
-            case BowlNativeValue:
-                fprintf(stream, "function#0x%08" PRIX64, (u64) value->function.function);
-                break;
-
-            case BowlLibraryValue:
-                fprintf(stream, "library#0x%08" PRIX64, (u64) value->library.handle);
-                break;
-
-            case BowlVectorValue:
-                fprintf(stream, "(");
-                for (u64 i = 0; i < value->vector.length; ++i) {
-                    fprintf(stream, " ");
-                    bowl_value_dump(stream, value->vector.elements[i]);
-                }
-                fprintf(stream, " )");
-                break;
-
-            case BowlListValue:
-                fprintf(stream, "[ ");
-
-                do {
-                    bowl_value_dump(stream, value->list.head);
-                    value = value->list.tail;
-                    if (value != NULL) {
-                        fprintf(stream, " ");
-                    }
-                } while (value != NULL);
-
-                fprintf(stream, " ]");
-                break;
-
-            case BowlExceptionValue:
-                bowl_value_dump(stream, value->exception.message);
-                fprintf(stream, " exception");
-                break;
-
-            case BowlStringValue:
-                fwrite("\"", sizeof(char), 1, stream);
-                
-                // TODO: ASCII escape sequences
-                {
-                    for (u64 i = 0, end = value->string.length; i < end; ++i) {
-                        u8 bytes[4];
-                        u64 written = unicode_utf8_encode(value->string.codepoints[i], &bytes[0]);
-                        if (written == 0) written = 3; // unicode replacement character was written
-                        fwrite(&bytes[0], sizeof(u8), written, stream);
-                    }
-                }
-
-                fwrite("\"", sizeof(char), 1, stream);
-                break;
-
-            case BowlMapValue:
-                fprintf(stream, "{ ");
-
-                bool first = true;
-                for (u64 i = 0, end = value->map.capacity; i < end; ++i) {
-                    BowlValue bucket = value->map.buckets[i];
-
-                    if (!first && bucket != NULL) {
-                        fprintf(stream, " ");
-                    } else if (bucket != NULL) {
-                        first = false;
-                    }
+static bool bowl_value_write(Output *output, BowlValue value, bool show);
 
-                    while (bucket != NULL) {
-                        bowl_value_dump(stream, bucket->list.head);
-                        bucket = bucket->list.tail;
-                        fprintf(stream, " : ");
-                        bowl_value_dump(stream, bucket->list.head);
-                        bucket = bucket->list.tail;
-
-                        if (bucket != NULL) {
-                            fprintf(stream, " ");
-                        }
-                    }
-                }
-
-                if (first) {
-                    fprintf(stream, "}");
-                } else {
-                    fprintf(stream, " }");
-                }
-                break;
-        }
+static bool bowl_value_write_map(Output *output, BowlValue key, BowlValue entry, bool first, bool show) {
+    // 'show' writes an entry such that it can be read again
+    if (!first && !output_write(output, " ", 1)) {
+        return false;
     }
-}
 
-static bool bowl_value_printf_buffer(char **buffer, u64 *length, u64 *capacity, char *message, ...) {
-    va_list list;
-
-    va_start(list, message);
-    u64 required = vsnprintf(NULL, 0, message, list);
-    va_end(list);
-    
-    if (required < 0) {
-        free(*buffer);
-        *buffer = NULL;
-        *length = 0;
-        *capacity = 0;
+    if (show && !output_write(output, "[ ", 2)) {
         return false;
     }
 
-    required += 1;
-
-    if (required > *capacity - *length) {
-        *capacity = MAX(*capacity * 2, *capacity + (required - (*capacity - *length)));
+    if (!bowl_value_write(output, key, show) || !output_string(output, show ? " " : " : ") || !bowl_value_write(output, entry, show)) {
+        return false;
+    }
 
-        char *const new_buffer = realloc(*buffer, *capacity * sizeof(char));
-        if (new_buffer == NULL) {
-            free(*buffer);
-            *buffer = NULL;
-            *length = 0;
-            *capacity = 0;
-            return false;
-        }
+    return !show || output_write(output, " ]", 2);
+}
 
-        *buffer = new_buffer;
+static bool bowl_value_write(Output *output, BowlValue value, bool show) {
+    if (value == NULL) {
+        return output_write(output, "[ ]", 3);
     }
 
-    va_start(list, message);
-    required = vsnprintf(*buffer + *length, *capacity - *length, message, list);
-    va_end(list);
+    switch (value->type) {
+        case BowlSymbolValue:
+            return output_text(output, value->symbol.bytes, value->symbol.width, value->symbol.length);
 
-    if (required < *capacity - *length && required >= 0) {
-        *length += required;
-        return true;
-    } else {
-        // something unexpected happened
-        free(*buffer);
-        *buffer = NULL;
-        *length = 0;
-        *capacity = 0;
-        return false;
-    }
-}
+        case BowlNumberValue:
+            return output_number(output, value->number.value);
 
-static void bowl_value_show_buffer(BowlValue value, char **buffer, u64 *length, u64 *capacity) {
-    if (value == NULL) {
-        bowl_value_printf_buffer(buffer, length, capacity, "[ ]");
-    } else {
-        switch (value->type) {
-            case BowlSymbolValue:
-                for (u64 i = 0, end = value->symbol.length; i < end; ++i) {
-                    u8 bytes[4];
-                    u64 written = unicode_utf8_encode(value->symbol.codepoints[i], &bytes[0]);
-                    if (written == 0) written = 3; // unicode replacement character was written
-                    for (u64 j = 0; j < written; ++j) {
-                        if (!bowl_value_printf_buffer(buffer, length, capacity, "%c", bytes[j])) {
-                            return;
-                        }
-                    }
-                }
-                break;
+        case BowlBooleanValue:
+            return value->boolean.value ? output_write(output, "true", 4) : output_write(output, "false", 5);
+
+        case BowlNativeValue:
+            return output_printf(output, "function#0x%08" PRIX64, (u64) value->function.function);
 
-            case BowlNumberValue:
-                if (is_integer(value->number.value)) {
-                    if (!bowl_value_printf_buffer(buffer, length, capacity, "%" PRId64, (u64) value->number.value)) {
-                        return;
-                    }
-                } else {
-                    if (!bowl_value_printf_buffer(buffer, length, capacity, "%f", value->number.value)) {
-                        return;
-                    }
-                }
-                break;
+        case BowlLibraryValue:
+            return output_printf(output, "library#0x%08" PRIX64, (u64) value->library.handle);
 
-            case BowlVectorValue:
-                if (!bowl_value_printf_buffer(buffer, length, capacity, "(")) {
-                    return;
+        case BowlVectorValue:
+            if (!output_write(output, "(", 1)) {
+                return false;
+            }
+
+            for (u64 i = 0; i < value->vector.length; ++i) {
+                if (!output_write(output, " ", 1) || !bowl_value_write(output, value->vector.elements[i], show)) {
+                    return false;
                 }
+            }
 
-                for (u64 i = 0; i < value->vector.length; ++i) {
-                    if (!bowl_value_printf_buffer(buffer, length, capacity, " ")) {
-                        return;
-                    }
+            return output_write(output, " )", 2);
 
-                    bowl_value_show_buffer(value->vector.elements[i], buffer, length, capacity);
-                    if (*buffer == NULL) {
-                        return;
-                    }
-                }
+        case BowlListValue:
+            if (!output_write(output, "[ ", 2)) {
+                return false;
+            }
 
-                if (!bowl_value_printf_buffer(buffer, length, capacity, " )")) {
-                    return;
-                }
-                break;
-            
-            case BowlBooleanValue:
-                if (value->boolean.value) {
-                    if (!bowl_value_printf_buffer(buffer, length, capacity, "true")) {
-                        return;
-                    }
-                } else {
-                    if (!bowl_value_printf_buffer(buffer, length, capacity, "false")) {
-                        return;
-                    }
+            do {
+                if (!bowl_value_write(output, value->list.head, show)) {
+                    return false;
                 }
-                break;
 
-            case BowlNativeValue:
-                if (!bowl_value_printf_buffer(buffer, length, capacity, "function#0x%08" PRIX64, (u64) value->function.function)) {
-                    return;
-                }
-                break;
+                value = value->list.tail;
 
-            case BowlLibraryValue:
-                if (!bowl_value_printf_buffer(buffer, length, capacity, "library#0x%08" PRIX64, (u64) value->library.handle)) {
-                    return;
+                if (value != NULL && !output_write(output, " ", 1)) {
+                    return false;
                 }
-                break;
+            } while (value != NULL);
 
-            case BowlListValue:
-                if (!bowl_value_printf_buffer(buffer, length, capacity, "[ ")) {
-                    return;
-                }
+            return output_write(output, " ]", 2);
 
-                do {
-                    bowl_value_show_buffer(value->list.head, buffer, length, capacity);
-                    if (*buffer == NULL) {
-                        return;
-                    }
-                    value = value->list.tail;
-                    if (value != NULL) {
-                        if (!bowl_value_printf_buffer(buffer, length, capacity, " ")) {
-                            return;
-                        }
-                    }
-                } while (value != NULL);
+        case BowlExceptionValue:
+            return bowl_value_write(output, value->exception.message, show) && output_write(output, " exception", 10);
 
-                if (!bowl_value_printf_buffer(buffer, length, capacity, " ]")) {
-                    return;
-                }
-                break;
+        case BowlStringValue:
+            if (!output_write(output, "\"", 1)) {
+                return false;
+            }
 
-            case BowlExceptionValue:
-                bowl_value_show_buffer(value->exception.message, buffer, length, capacity);
+            // TODO: ASCII escape sequences
+            {
+                TextReader reader = text_reader(value, 0);
+                const u8 *run;
+                u64 width, length;
 
-                if (*buffer == NULL) {
-                    return;
+                while (text_reader_next(&reader, &run, &width, &length)) {
+                    if (!output_text(output, run, width, length)) {
+                        return false;
+                    }
                 }
+            }
 
-                if (!bowl_value_printf_buffer(buffer, length, capacity, " exception")) {
-                    return;
-                }
-                break;
+            return output_write(output, "\"", 1);
 
-            case BowlStringValue:
-                if (!bowl_value_printf_buffer(buffer, length, capacity, "\"")) {
-                    return;
-                }
+        case BowlMapValue:
+            if (!output_string(output, show ? "[ " : "{ ")) {
+                return false;
+            }
 
-                {
-                    for (u64 i = 0, end = value->string.length; i < end; ++i) {
-                        u8 bytes[4];
-                        u64 written = unicode_utf8_encode(value->string.codepoints[i], &bytes[0]);
-                        if (written == 0) written = 3; // unicode replacement character was written
-                        for (u64 j = 0; j < written; ++j) {
-                            if (!bowl_value_printf_buffer(buffer, length, capacity, "%c", bytes[j])) {
-                                return;
-                            }
-                        }
+            {
+                bool first = true;
+                MapIterator iterator = map_iterator(value);
+                BowlValue key;
+                BowlValue entry;
+
+                while (map_iterator_next(&iterator, &key, &entry)) {
+                    if (!bowl_value_write_map(output, key, entry, first, show)) {
+                        return false;
                     }
-                }
 
-                if (!bowl_value_printf_buffer(buffer, length, capacity, "\"")) {
-                    return;
+                    first = false;
                 }
-                break;
 
-            case BowlMapValue:
-                if (!bowl_value_printf_buffer(buffer, length, capacity, "[ ")) {
-                    return;
+                if (show) {
+                    return output_string(output, first ? "] map-from-list" : " ] map-from-list");
+                } else {
+                    return output_string(output, first ? "}" : " }");
                 }
+            }
+
+        case BowlSortedMapValue:
+            if (!output_string(output, show ? "[ " : "{ ")) {
+                return false;
+            }
 
+            {
                 bool first = true;
-                for (u64 i = 0, end = value->map.capacity; i < end; ++i) {
-                    BowlValue bucket = value->map.buckets[i];
-
-                    if (!first && bucket != NULL) {
-                        if (!bowl_value_printf_buffer(buffer, length, capacity, " ")) {
-                            return;
-                        }
-                    } else if (bucket != NULL) {
-                        first = false;
-                    }
+                BowlValue root = value;
+                BowlSortedMapCursor cursor = bowl_sorted_map_cursor(&root);
+                BowlValue key;
+                BowlValue entry;
 
-                    while (bucket != NULL) {
-                        if (!bowl_value_printf_buffer(buffer, length, capacity, "[ ")) {
-                            return;
-                        }
-
-                        bowl_value_show_buffer(bucket->list.head, buffer, length, capacity);
-                        if (*buffer == NULL) {
-                            return;
-                        }
-
-                        bucket = bucket->list.tail;
-                        if (!bowl_value_printf_buffer(buffer, length, capacity, " ")) {
-                            return;
-                        }
-                        
-                        bowl_value_show_buffer(bucket->list.head, buffer, length, capacity);
-                        if (*buffer == NULL) {
-                            return;
-                        }
-
-                        bucket = bucket->list.tail;
-                        if (!bowl_value_printf_buffer(buffer, length, capacity, " ]")) {
-                            return;
-                        }
-
-                        if (bucket != NULL) {
-                            if (!bowl_value_printf_buffer(buffer, length, capacity, " ")) {
-                                return;
-                            }
-                        }
+                while (bowl_sorted_map_cursor_next(&cursor, &key, &entry)) {
+                    if (!bowl_value_write_map(output, key, entry, first, show)) {
+                        return false;
                     }
+
+                    first = false;
                 }
 
-                if (first) {
-                    if (!bowl_value_printf_buffer(buffer, length, capacity, "] map-from-list")) {
-                        return;
-                    }
+                if (show) {
+                    return output_string(output, first ? "] sorted-map-from-list" : " ] sorted-map-from-list");
                 } else {
-                    if (!bowl_value_printf_buffer(buffer, length, capacity, " ] map-from-list")) {
-                        return;
-                    }
+                    return output_string(output, first ? "}" : " }");
                 }
-                break;
-        }
+            }
     }
+
+    return true;
+}
+
+void bowl_value_dump(FILE *stream, BowlValue value) {
+    // the output is collected in a buffer instead of being written codepoint by codepoint
+    Output output;
+    output_stream(&output, stream);
+    bowl_value_write(&output, value, false);
+    output_flush(&output);
 }
 
 void bowl_value_show(BowlValue value, char **buffer, u64 *length) {
-    u64 capacity = 4096;
-    *length = 0;
-    *buffer = malloc(capacity * sizeof(char));
-    if (*buffer != NULL) {
-        bowl_value_show_buffer(value, buffer, length, &capacity);
+    Output output;
+
+    if (output_buffer(&output, 4096) && bowl_value_write(&output, value, true)) {
+        // the result is null-terminated
+        output_write(&output, "", 1);
     }
+
+    *buffer = output.bytes;
+    *length = output.failure ? 0 : output.length - 1;
 }
 
 u64 bowl_value_length(BowlValue value) {
@@ -990,6 +702,7 @@ u64 bowl_value_length(BowlValue value) {
             case BowlListValue:
                 return value->list.length;
             case BowlMapValue:
+            case BowlSortedMapValue:
                 return value->map.length;
             case BowlStringValue: 
                 return value->string.length;
@@ -1012,7 +725,8 @@ char *bowl_type_name(BowlValueType type) {
         [BowlStringValue]  = "string",
         [BowlLibraryValue] = "library",
         [BowlVectorValue]  = "vector",
-        [BowlExceptionValue]  = "exception"
+        [BowlExceptionValue]  = "exception",
+        [BowlSortedMapValue]  = "sorted-map"
     };
 
     return types[type];
@@ -1048,30 +762,29 @@ BowlResult bowl_format_exception(BowlStack stack, char *message, ...) {
         return result;
     }
 
-    if (!result.failure) {
-        va_start(list, message);
-        const u64 written = vsnprintf(&buffer[0], required + 1, message, list);
-        va_end(list);
+    va_start(list, message);
+    const u64 written = vsnprintf(&buffer[0], required + 1, message, list);
+    va_end(list);
 
-        if (written < 0 || written >= required + 1) {
-            result.exception = &format_exception;
-            result.failure = true;
-            return result;
-        }
+    if (written < 0 || written >= required + 1) {
+        free(buffer);
+        result.exception = &format_exception;
+        result.failure = true;
+        return result;
+    }
 
-        result = gc_allocate(stack, BowlStringValue, written * sizeof(u32));
+    result = gc_allocate(stack, BowlStringValue, written * sizeof(u8));
 
-        if (!result.failure) {
-            result.value->string.length = written;
-            
-            for (u64 i = 0; i < written; ++i) {
-                result.value->string.codepoints[i] = (u32) buffer[i];
-            }
+    if (!result.failure) {
+        // every byte is interpreted as a single codepoint
+        result.value->string.length = written;
+        result.value->string.width = sizeof(u8);
+        memcpy(&result.value->string.bytes[0], &buffer[0], written * sizeof(u8));
 
-            result = bowl_exception(stack, NULL, result.value);
-        }
+        result = bowl_exception(stack, NULL, result.value);
     }
 
+    free(buffer);
     return result;
 }
 
@@ -1086,6 +799,16 @@ BowlResult bowl_value_clone(BowlStack stack, BowlValue value) {
     if (frame.registers[0] == NULL) {
         result.value = NULL;
         result.failure = false;
+    } else if (frame.registers[0]->type == BowlStringValue && (frame.registers[0]->string.width & TEXT_EXTERNAL)) {
+        // only a single value may own the external codepoints => the copy is a slice of the whole string
+        result = gc_allocate(&frame, BowlStringValue, sizeof(TextSlice));
+
+        if (!result.failure) {
+            result.value->string.length = frame.registers[0]->string.length;
+            result.value->string.width = TEXT_SLICE | (frame.registers[0]->string.width & TEXT_WIDTH_MASK);
+            ((TextSlice *) &result.value->string.bytes[0])->parent = frame.registers[0];
+            ((TextSlice *) &result.value->string.bytes[0])->offset = 0;
+        }
     } else {
         const u64 size = bowl_value_byte_size(frame.registers[0]);
         const u64 additional = size - sizeof(struct bowl_value);
@@ -1099,8 +822,8 @@ BowlResult bowl_value_clone(BowlStack stack, BowlValue value) {
     return result;
 }
 
-BowlResult bowl_list_reverse(BowlStack stack, BowlValue list) {
-    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, list, NULL, NULL);
+static BowlResult bowl_list_reverse_onto(BowlStack stack, BowlValue list, BowlValue tail) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, list, tail, NULL);
     BowlResult result;
 
     while (frame.registers[0] != NULL) {
@@ -1120,155 +843,338 @@ BowlResult bowl_list_reverse(BowlStack stack, BowlValue list) {
     return result;
 }
 
-BowlResult bowl_tokens(BowlStack stack, BowlValue string) {
-    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, string, NULL, NULL);
-    BowlScanner scanner = scanner_from(&frame.registers[0]);
+BowlResult bowl_list_reverse(BowlStack stack, BowlValue list) {
+    return bowl_list_reverse_onto(stack, list, NULL);
+}
+
+static BowlResult bowl_symbol_text(BowlStack stack, BowlValue *text, const u8 *bytes, u64 width, u64 start, u64 length) {
+    // the codepoints are either part of the string or the symbol 'text' (which may be moved by the garbage collector) or of 'bytes'
+    const u8 *source = text == NULL ? bytes : (*text)->string.bytes;
+    const u64 symbol_width = text_width(&source[start * width], width, length);
+    const u8 *key = &source[start * width];
+    u8 buffer[256];
+    u8 *narrowed = NULL;
     BowlResult result;
 
-    while (scanner_has_next(&scanner)) {
-        switch (scanner_next(&scanner)) {
-            case BowlErrorToken:
-                result = bowl_format_exception(&frame, "%s in line %" PRId64 " at character %" PRId64, scanner.token.error.message, scanner.token.line, scanner.token.column);
+    if (symbol_width != width) {
+        // symbols are hashed in their smallest width
+        narrowed = length * symbol_width <= sizeof(buffer) ? buffer : malloc(length * symbol_width);
+
+        if (narrowed == NULL) {
+            result.failure = true;
+            result.exception = bowl_exception_out_of_heap;
+            return result;
+        }
+
+        text_copy(narrowed, symbol_width, key, width, length);
+        key = narrowed;
+    }
+
+    const u64 hash = intern_hash(key, symbol_width, length);
+    result.failure = false;
+    result.value = intern_find(key, symbol_width, length, hash);
+
+    if (result.value == NULL) {
+        result = gc_allocate(stack, BowlSymbolValue, length * symbol_width);
+
+        if (!result.failure) {
+            source = text == NULL ? bytes : (*text)->string.bytes;
+            result.value->symbol.length = length;
+            result.value->symbol.width = symbol_width;
+            text_copy(result.value->symbol.bytes, symbol_width, &source[start * width], width, length);
+            result.value->hash = hash;
+
+            const BowlValue exception = intern_insert(result.value);
+
+            if (exception != NULL) {
                 result.failure = true;
-                return result;
+                result.exception = exception;
+            }
+        }
+    }
 
-            case BowlBooleanToken:
-                result = bowl_boolean(&frame, scanner.token.boolean.value);
-                break;
+    if (narrowed != NULL && narrowed != buffer) {
+        free(narrowed);
+    }
 
-            case BowlNumberToken:
-                result = bowl_number(&frame, scanner.token.number.value);
-                break;
+    return result;
+}
 
-            case BowlSymbolToken:
-                result = bowl_allocate(&frame, BowlSymbolValue, scanner.token.symbol.length * sizeof(u32));
-                
-                if (!result.failure) {
-                    result.value->symbol.length = scanner.token.symbol.length;
-                    memcpy(&result.value->symbol.codepoints[0], &(*scanner.string)->string.codepoints[scanner.token.symbol.start], scanner.token.symbol.length * sizeof(u32));
-                }
+static BowlResult bowl_text_utf8(BowlStack stack, BowlValueType type, u8 *bytes, u64 length) {
+    // the first pass validates the bytes and finds the number of codepoints as well as their width
+    u64 count;
+    u32 maximum;
+    const u32 state = unicode_utf8_measure(bytes, length, &count, &maximum);
+    BowlResult result;
 
-                break;
+    if (state == UNICODE_UTF8_STATE_REJECT) {
+        result.failure = true;
+        result.value = bowl_exception_malformed_utf8;
+        return result;
+    } else if (state != UNICODE_UTF8_STATE_ACCEPT) {
+        result.failure = true;
+        result.value = bowl_exception_incomplete_utf8;
+        return result;
+    }
 
-            case BowlStringToken: 
-                result = bowl_allocate(&frame, BowlStringValue, scanner.token.string.length * sizeof(u32));
+    const u64 width = text_width_of(maximum);
+    result = gc_allocate(stack, type, count * width);
 
-                if (!result.failure) {
-                    
-                    u64 j = 0;
-                    for (u64 i = 0; i < scanner.token.string.length;) {
-                        u32 codepoint;
-                        i += unicode_escape_sequence(&(*scanner.string)->string.codepoints[scanner.token.string.start + i], scanner.token.string.length - i, &codepoint);
-                        result.value->string.codepoints[j++] = codepoint;
-                    }
+    if (!result.failure) {
+        result.value->string.length = count;
+        result.value->string.width = width;
+        unicode_utf8_decode_text(bytes, length, result.value->string.bytes, width);
+    }
 
-                    result.value->string.length = j;
-                }
+    return result;
+}
 
-                break;
+static BowlResult bowl_string_escaped(BowlStack stack, BowlValue *text, const u8 *bytes, u64 width, u64 start, u64 length) {
+    // the codepoints are either part of the string 'text' (which may be moved by the garbage collector) or of 'bytes'
+    const u8 *source = text == NULL ? bytes : (*text)->string.bytes;
+    u64 count = 0;
+    u32 maximum = 0;
+
+    // the escape sequences are resolved twice: first to find the length and the width of the string, then to fill it
+    for (u64 i = 0; i < length; ++count) {
+        u32 codepoint;
+        i += unicode_text_escape_sequence(&source[(start + i) * width], width, length - i, &codepoint);
+        maximum |= codepoint;
+    }
+
+    const u64 string_width = text_width_of(maximum);
+    BowlResult result = bowl_allocate(stack, BowlStringValue, count * string_width);
+
+    if (!result.failure) {
+        source = text == NULL ? bytes : (*text)->string.bytes;
+        result.value->string.length = count;
+        result.value->string.width = string_width;
+
+        u64 j = 0;
+        for (u64 i = 0; i < length; ++j) {
+            u32 codepoint;
+            i += unicode_text_escape_sequence(&source[(start + i) * width], width, length - i, &codepoint);
+            TEXT_PUT(result.value->string.bytes, string_width, j, codepoint);
         }
+    }
+
+    return result;
+}
+
+static BowlResult bowl_token_utf8(BowlStack stack, const u8 *bytes, u64 length, bool symbol, bool escaped) {
+    // the codepoints of the token are only decoded if the bytes cannot be used directly
+    u8 ascii = 0;
+
+    for (u64 i = 0; symbol && i < length; ++i) {
+        ascii |= bytes[i];
+    }
+
+    if (symbol && ascii < 0x80) {
+        return bowl_symbol_text(stack, NULL, bytes, 1, 0, length);
+    } else if (!symbol && !escaped) {
+        return bowl_text_utf8(stack, BowlStringValue, (u8 *) bytes, length);
+    }
+
+    u64 count;
+    u32 maximum;
+    u32 buffer[64];
+    BowlResult result;
+
+    unicode_utf8_measure(bytes, length, &count, &maximum);
+    u32 *const codepoints = count <= sizeof(buffer) / sizeof(buffer[0]) ? buffer : malloc(count * sizeof(u32));
+
+    if (codepoints == NULL) {
+        result.failure = true;
+        result.exception = bowl_exception_out_of_heap;
+        return result;
+    }
+
+    unicode_utf8_decode_text(bytes, length, (u8 *) codepoints, sizeof(u32));
+
+    if (symbol) {
+        result = bowl_symbol_text(stack, NULL, (const u8 *) codepoints, sizeof(u32), 0, count);
+    } else {
+        result = bowl_string_escaped(stack, NULL, (const u8 *) codepoints, sizeof(u32), 0, count);
+    }
+
+    if (codepoints != buffer) {
+        free(codepoints);
+    }
+
+    return result;
+}
+
+BowlResult bowl_token_value(BowlStack stack, BowlScanner *scanner, const BowlToken *token) {
+    BowlResult result;
+    u64 width;
+
+    switch (token->type) {
+        case BowlBooleanToken:
+            return bowl_boolean(stack, token->boolean.value);
+
+        case BowlNumberToken:
+            return bowl_number(stack, token->number.value);
+
+        case BowlSymbolToken:
+            // repeated symbols share a single value
+            if (scanner->string == NULL) {
+                return bowl_token_utf8(stack, &scanner->bytes[token->symbol.start], token->symbol.length, true, false);
+            } else {
+                width = (*scanner->string)->string.width;
+                return bowl_symbol_text(stack, scanner->string, NULL, width, token->symbol.start, token->symbol.length);
+            }
+
+        case BowlStringToken:
+            if (scanner->string == NULL) {
+                return bowl_token_utf8(stack, &scanner->bytes[token->string.start], token->string.length, false, token->string.escaped);
+            } else {
+                width = (*scanner->string)->string.width;
+                return bowl_string_escaped(stack, scanner->string, NULL, width, token->string.start, token->string.length);
+            }
+
+        case BowlErrorToken:
+        default:
+            result = bowl_format_exception(stack, "%s in line %" PRId64 " at character %" PRId64, token->error.message, token->line, token->column);
+            result.failure = true;
+            return result;
+    }
+}
+
+BowlResult bowl_tokens_scanner(BowlStack stack, BowlScanner *scanner, BowlValue tail) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, tail, NULL);
+    BowlResult result;
+
+    while (scanner_has_next(scanner)) {
+        scanner_next(scanner);
+        result = bowl_token_value(&frame, scanner, &scanner->token);
 
         if (result.failure) {
             return result;
         }
 
-        result = bowl_list(&frame, result.value, frame.registers[1]);
+        result = bowl_list(&frame, result.value, frame.registers[0]);
 
         if (result.failure) {
             return result;
         }
 
-        frame.registers[1] = result.value;
+        frame.registers[0] = result.value;
     }
 
-    return bowl_list_reverse(&frame, frame.registers[1]);
+    return bowl_list_reverse_onto(&frame, frame.registers[0], frame.registers[1]);
 }
 
-BowlResult bowl_symbol(BowlStack stack, u32 *codepoints, u64 length) {
-    BowlResult result = gc_allocate(stack, BowlSymbolValue, length * sizeof(u32));
+BowlResult bowl_tokens(BowlStack stack, BowlValue string) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, string, NULL, NULL);
+    // the scanner requires the codepoints to be stored contiguously
+    BowlResult result = bowl_string_flatten(&frame, string);
 
-    if (!result.failure) {
-        result.value->symbol.length = length;
-        memcpy(&result.value->symbol.codepoints[0], codepoints, length * sizeof(u32));
-        bowl_value_hash(result.value);    
+    if (result.failure) {
+        return result;
     }
 
-    return result;
+    frame.registers[0] = result.value;
+    BowlScanner scanner = scanner_from(&frame.registers[0]);
+    const u64 threads = parallel_threads(frame.registers[0]->string.length);
+
+    if (threads > 1) {
+        return bowl_tokens_parallel(&frame, &scanner, threads);
+    }
+
+    return bowl_tokens_scanner(&frame, &scanner, NULL);
 }
 
-BowlResult bowl_symbol_utf8(BowlStack stack, u8 *bytes, u64 length) {
-    // the heap waste is removed by the next gc run
-    BowlResult result = gc_allocate(stack, BowlSymbolValue, length * sizeof(u32));
+BowlResult bowl_tokens_utf8(BowlStack stack, const u8 *bytes, u64 length) {
+    // the bytes are validated at once such that the scanner does not need to care about malformed sequences
+    u64 count;
+    u32 maximum;
+    const u32 state = unicode_utf8_measure(bytes, length, &count, &maximum);
+    BowlResult result;
 
-    if (!result.failure) {
-        u32 state = UNICODE_UTF8_STATE_ACCEPT;
-        u32 codepoint = 0;
-
-        u64 p = 0;
-        for (u64 i = 0; i < length; ++i) {
-            if (unicode_utf8_decode(&state, &codepoint, bytes[i]) == UNICODE_UTF8_STATE_ACCEPT) {
-                result.value->symbol.codepoints[p++] = codepoint;
-            } else if (state == UNICODE_UTF8_STATE_REJECT) {
-                result.failure = true;
-                result.value = bowl_exception_malformed_utf8;
-                return result;
-            }
-        }
+    if (state == UNICODE_UTF8_STATE_REJECT) {
+        result.failure = true;
+        result.value = bowl_exception_malformed_utf8;
+        return result;
+    } else if (state != UNICODE_UTF8_STATE_ACCEPT) {
+        result.failure = true;
+        result.value = bowl_exception_incomplete_utf8;
+        return result;
+    }
 
-        if (state != UNICODE_UTF8_STATE_ACCEPT) {
-            result.failure = true;
-            result.value = bowl_exception_incomplete_utf8;
-            return result;
-        }
+    BowlScanner scanner = scanner_from_utf8(bytes, length);
+    const u64 threads = parallel_threads(length);
+
+    if (threads > 1) {
+        return bowl_tokens_parallel(stack, &scanner, threads);
+    }
+
+    return bowl_tokens_scanner(stack, &scanner, NULL);
+}
+
+static BowlResult bowl_symbol_intern(BowlValue symbol) {
+    // either replaces the symbol by an equal symbol which is already interned or interns the symbol itself
+    BowlResult result = {
+        .failure = false,
+        .value = intern_find(symbol->symbol.bytes, symbol->symbol.width, symbol->symbol.length, bowl_value_hash(symbol))
+    };
 
-        result.value->symbol.length = p;
+    if (result.value == NULL) {
+        const BowlValue exception = intern_insert(symbol);
+        result.failure = exception != NULL;
+        result.value = result.failure ? exception : symbol;
     }
 
     return result;
 }
 
-BowlResult bowl_string(BowlStack stack, u32 *codepoints, u64 length) {
-    BowlResult result = gc_allocate(stack, BowlStringValue, length * sizeof(u32));
+BowlResult bowl_text(BowlStack stack, BowlValueType type, const u8 *bytes, u64 width, u64 length) {
+    if (type == BowlSymbolValue) {
+        return bowl_symbol_text(stack, NULL, bytes, width, 0, length);
+    }
+
+    const u64 string_width = text_width(bytes, width, length);
+    BowlResult result = gc_allocate(stack, BowlStringValue, length * string_width);
 
     if (!result.failure) {
         result.value->string.length = length;
-        memcpy(&result.value->string.codepoints[0], &codepoints[0], length * sizeof(u32));
+        result.value->string.width = string_width;
+        text_copy(result.value->string.bytes, string_width, bytes, width, length);
     }
 
     return result;
 }
 
-BowlResult bowl_string_utf8(BowlStack stack, u8 *bytes, u64 length) {
-    // the heap waste is removed by the next gc run
-    BowlResult result = gc_allocate(stack, BowlStringValue, length * sizeof(u32));
+BowlResult bowl_symbol(BowlStack stack, u32 *codepoints, u64 length) {
+    return bowl_symbol_text(stack, NULL, (const u8 *) codepoints, sizeof(u32), 0, length);
+}
+
+BowlResult bowl_symbol_utf8(BowlStack stack, u8 *bytes, u64 length) {
+    BowlResult result = bowl_text_utf8(stack, BowlSymbolValue, bytes, length);
 
     if (!result.failure) {
-        u32 state = UNICODE_UTF8_STATE_ACCEPT;
-        u32 codepoint = 0;
-
-        u64 p = 0;
-        for (u64 i = 0; i < length; ++i) {
-            if (unicode_utf8_decode(&state, &codepoint, bytes[i]) == UNICODE_UTF8_STATE_ACCEPT) {
-                result.value->string.codepoints[p++] = codepoint;
-            } else if (state == UNICODE_UTF8_STATE_REJECT) {
-                result.failure = true;
-                result.value = bowl_exception_malformed_utf8;
-                return result;
-            }
-        }
+        result = bowl_symbol_intern(result.value);
+    }
 
-        if (state != UNICODE_UTF8_STATE_ACCEPT) {
-            result.failure = true;
-            result.value = bowl_exception_incomplete_utf8;
-            return result;
-        }
+    return result;
+}
+
+BowlResult bowl_string(BowlStack stack, u32 *codepoints, u64 length) {
+    const u64 width = text_width((const u8 *) codepoints, sizeof(u32), length);
+    BowlResult result = gc_allocate(stack, BowlStringValue, length * width);
 
-        result.value->string.length = p;
+    if (!result.failure) {
+        result.value->string.length = length;
+        result.value->string.width = width;
+        text_copy(result.value->string.bytes, width, (const u8 *) codepoints, sizeof(u32), length);
     }
 
     return result;
 }
 
+BowlResult bowl_string_utf8(BowlStack stack, u8 *bytes, u64 length) {
+    return bowl_text_utf8(stack, BowlStringValue, bytes, length);
+}
+
 BowlResult bowl_function(BowlStack stack, BowlValue library, BowlFunction function) {
     BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, library, NULL, NULL);
     BowlResult result = gc_allocate(&frame, BowlNativeValue, 0);
@@ -1294,23 +1200,18 @@ BowlResult bowl_list(BowlStack stack, BowlValue head, BowlValue tail) {
         } else {
             result.value->list.length = frame.registers[1]->list.length + 1;
         }
-    }
-
-    return result;
-}
 
-BowlResult bowl_map(BowlStack stack, u64 capacity) {
-    BowlResult result = gc_allocate(stack, BowlMapValue, capacity * sizeof(BowlValue));
+        // extend the hash of the tail if it is known already (numbers and booleans are cheap to hash)
+        const BowlValue head = frame.registers[0];
+        const BowlValue tail = frame.registers[1];
+        const bool head_hashed = head == NULL || head->hash != 0 || head->type == BowlNumberValue || head->type == BowlBooleanValue;
+        const bool tail_hashed = tail == NULL || tail->hash != 0;
 
-    if (!result.failure) {
-        result.value->map.capacity = capacity;
-        result.value->map.length = 0;
-        
-        for (u64 i = 0; i < capacity; ++i) {
-            result.value->map.buckets[i] = NULL;
+        if (head_hashed && tail_hashed) {
+            result.value->hash = bowl_list_cell_hash(bowl_value_hash(head), bowl_value_hash(tail));
         }
     }
-    
+
     return result;
 }
 
@@ -1378,6 +1279,29 @@ BowlResult bowl_vector(BowlStack stack, BowlValue value, u64 const length) {
     return result;
 }
 
+BowlValue bowl_vector_reserve(BowlStack stack, u64 slot, u64 length, u64 additional) {
+    const BowlValue vector = stack->registers[slot];
+
+    if (vector != NULL && length + additional <= vector->vector.length) {
+        return NULL;
+    }
+
+    const u64 capacity = MAX(vector == NULL ? 64 : vector->vector.length * 2, length + additional);
+    BowlResult result = bowl_vector(stack, NULL, capacity);
+
+    if (result.failure) {
+        return result.exception;
+    }
+
+    // the old vector may have been moved by the allocation
+    if (length > 0) {
+        memcpy(result.value->vector.elements, stack->registers[slot]->vector.elements, length * sizeof(BowlValue));
+    }
+
+    stack->registers[slot] = result.value;
+    return NULL;
+}
+
 BowlResult bowl_exception(BowlStack stack, BowlValue cause, BowlValue message) {
     BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, cause, message, NULL);
     BowlResult result = gc_allocate(&frame, BowlExceptionValue, 0);
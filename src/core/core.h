@@ -7,5 +7,60 @@
 #include <bowl/unicode.h>
 #include "../syntax/scanner.h"
 #include "gc.h"
+#include "text.h"
+#include "unicode.h"
+#include "output.h"
+#include "parallel.h"
+
+/**
+ * Tokenizes UTF-8 encoded bytes just like 'bowl_tokens' tokenizes a string, but without decoding
+ * the whole source first. Only the codepoints of the resulting symbols and strings are decoded.
+ * @param stack The stack of the current environment.
+ * @param bytes The UTF-8 encoded source.
+ * @param length The number of bytes.
+ * @return Either the list of tokens or an exception.
+ */
+BowlResult bowl_tokens_utf8(BowlStack stack, const u8 *bytes, u64 length);
+
+/**
+ * Creates the value of a token (or the exception which describes an error token).
+ * @param stack The stack of the current environment.
+ * @param scanner The scanner which produced the token.
+ * @param token The token, which must not be the end of the source.
+ * @return Either the value of the token or an exception.
+ */
+BowlResult bowl_token_value(BowlStack stack, BowlScanner *scanner, const BowlToken *token);
+
+/**
+ * Creates a symbol or a string from codepoints which are stored in the representation of 'text.h'.
+ * @param stack The stack of the current environment.
+ * @param type Either 'BowlSymbolValue' or 'BowlStringValue'.
+ * @param bytes The codepoints (which must not be part of the heap).
+ * @param width The width of the codepoints.
+ * @param length The number of codepoints.
+ * @return Either the symbol (or string) or an exception.
+ */
+BowlResult bowl_text(BowlStack stack, BowlValueType type, const u8 *bytes, u64 width, u64 length);
+
+/**
+ * Tokenizes the source of a scanner until the scanner stops and prepends the tokens to a list.
+ * @param stack The stack of the current environment.
+ * @param scanner The scanner, whose state afterwards tells where it stopped.
+ * @param tail The list which should follow the tokens.
+ * @return Either the tokens followed by the tail or an exception.
+ */
+BowlResult bowl_tokens_scanner(BowlStack stack, BowlScanner *scanner, BowlValue tail);
+
+/**
+ * Makes room for further elements in a vector which is used as a growing buffer. If the vector is
+ * too small (or 'NULL'), it is replaced by a vector which is at least twice as large and which
+ * starts with the same elements.
+ * @param stack The stack of the current environment.
+ * @param slot The register of the stack which contains the vector.
+ * @param length The number of elements which are in use.
+ * @param additional The number of elements which should be added.
+ * @return Either an exception or 'NULL' on success.
+ */
+BowlValue bowl_vector_reserve(BowlStack stack, u64 slot, u64 length, u64 additional);
 
 #endif
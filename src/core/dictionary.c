@@ -0,0 +1,52 @@
+#include "dictionary.h"
+
+typedef struct {
+    BowlValue dictionary;
+    BowlValue symbol;
+    BowlValue entry;
+} DictionaryCacheEntry;
+
+static DictionaryCacheEntry dictionary_cache[DICTIONARY_CACHE_SIZE];
+
+static BowlDictionaryStatistics dictionary_statistics = {
+    .hits = 0,
+    .misses = 0
+};
+
+static inline u64 dictionary_cache_index(BowlValue dictionary, BowlValue symbol) {
+    // values are aligned => drop the low bits before mixing both addresses
+    const u64 mixed = (((u64) symbol >> 4) ^ ((u64) dictionary >> 4)) * 0x9E3779B97F4A7C15ULL;
+    return (mixed >> 32) & (DICTIONARY_CACHE_SIZE - 1);
+}
+
+BowlValue bowl_dictionary_get_or_else(BowlValue dictionary, BowlValue symbol, BowlValue otherwise) {
+    DictionaryCacheEntry *const cached = &dictionary_cache[dictionary_cache_index(dictionary, symbol)];
+
+    if (cached->dictionary == dictionary && cached->symbol == symbol && dictionary != NULL) {
+        ++dictionary_statistics.hits;
+        return cached->entry;
+    }
+
+    ++dictionary_statistics.misses;
+
+    const BowlValue entry = bowl_map_get_or_else(dictionary, symbol, bowl_sentinel_value);
+
+    if (entry == bowl_sentinel_value) {
+        // misses are not cached since the default value may differ between lookups
+        return otherwise;
+    }
+
+    cached->dictionary = dictionary;
+    cached->symbol = symbol;
+    cached->entry = entry;
+
+    return entry;
+}
+
+BowlDictionaryStatistics bowl_dictionary_statistics(void) {
+    return dictionary_statistics;
+}
+
+void dictionary_cache_clear(void) {
+    memset(dictionary_cache, 0, sizeof(dictionary_cache));
+}
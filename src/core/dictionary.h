@@ -0,0 +1,44 @@
+#ifndef DICTIONARY_H
+#define DICTIONARY_H
+
+#include "../common/utility.h"
+#include <bowl/bowl.h>
+#include <bowl/api.h>
+
+#define DICTIONARY_CACHE_SIZE 4096
+
+typedef struct {
+    /** The number of lookups which were answered by the cache. */
+    u64 hits;
+    /** The number of lookups which had to search the dictionary. */
+    u64 misses;
+} BowlDictionaryStatistics;
+
+/**
+ * Looks up the entry of a symbol in the provided dictionary.
+ *
+ * The result is equivalent to 'bowl_map_get_or_else', but successful lookups are cached by the
+ * identity of the dictionary and the symbol. Since maps are persistent, every modification of
+ * the dictionary results in a new dictionary value such that stale entries are never hit. The
+ * cache is cleared whenever the garbage collector runs.
+ * @param dictionary The dictionary.
+ * @param symbol The symbol which should be resolved.
+ * @param otherwise The value which is returned if the dictionary does not contain the symbol.
+ * @return Either the entry of the symbol or the provided default value.
+ */
+BowlValue bowl_dictionary_get_or_else(BowlValue dictionary, BowlValue symbol, BowlValue otherwise);
+
+/**
+ * Returns the number of cache hits and misses of all dictionary lookups so far.
+ * @return The statistics of the dictionary cache.
+ */
+BowlDictionaryStatistics bowl_dictionary_statistics(void);
+
+/**
+ * Removes all entries from the dictionary cache.
+ *
+ * This function must be called whenever values are relocated by the garbage collector.
+ */
+void dictionary_cache_clear(void);
+
+#endif
@@ -0,0 +1,317 @@
+#include "embed.h"
+#include "core.h"
+#include "output.h"
+#include <errno.h>
+#include <math.h>
+
+// the number of bytes of a text which are written into a single line of a string literal
+#define EMBED_LINE_BYTES 64
+
+#if !defined(BOWL_EMBEDDED_BOOT)
+    // the virtual machine was built without an embedded boot program
+    BowlValue bowl_embedded_boot = NULL;
+    BowlValue bowl_embedded_symbols[] = { NULL };
+#endif
+
+BowlValue embed_intern(void) {
+    for (BowlValue *symbol = bowl_embedded_symbols; *symbol != NULL; ++symbol) {
+        const BowlValue value = *symbol;
+        const u64 hash = bowl_value_hash(value);
+
+        if (intern_find(value->symbol.bytes, value->symbol.width, value->symbol.length, hash) == NULL) {
+            const BowlValue exception = intern_insert(value);
+
+            if (exception != NULL) {
+                return exception;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+typedef struct {
+    Output *output;
+    /** The distinct symbols which were written so far (an open addressing table of 'capacity' slots). */
+    BowlValue *symbols;
+    /** The index of the definition of each symbol in 'symbols'. */
+    u64 *indices;
+    u64 capacity;
+    /** The indices of the definitions of the distinct symbols in the order of their first occurrence. */
+    u64 *distinct;
+    u64 symbol_count;
+    /** The number of definitions which were written so far. */
+    u64 value_count;
+} EmbedWriter;
+
+static u64 embed_symbol_slot(EmbedWriter *writer, BowlValue symbol) {
+    // symbols are interned, such that equal symbols are the same value
+    u64 slot = hash_combine((u64) (uintptr_t) symbol, 0) & (writer->capacity - 1);
+
+    while (writer->symbols[slot] != NULL && writer->symbols[slot] != symbol) {
+        slot = (slot + 1) & (writer->capacity - 1);
+    }
+
+    return slot;
+}
+
+static u64 embed_count_symbols(BowlValue list) {
+    // the token lists are only nested a few levels deep (e.g., the boot program within the boot loader)
+    u64 count = 0;
+
+    for (; list != NULL; list = list->list.tail) {
+        const BowlValue value = list->list.head;
+
+        if (value != NULL && value->type == BowlSymbolValue) {
+            ++count;
+        } else if (value != NULL && value->type == BowlListValue) {
+            count += embed_count_symbols(value);
+        }
+    }
+
+    return count;
+}
+
+static bool embed_write_byte(Output *output, u8 byte) {
+    // question marks are escaped as well, such that they never form a trigraph
+    if (byte < 0x20 || byte >= 0x7F || byte == '"' || byte == '\\' || byte == '?') {
+        return output_printf(output, "\\%03o", byte);
+    } else {
+        return output_write(output, (const char *) &byte, 1);
+    }
+}
+
+static bool embed_write_text(Output *output, const char *type, const char *field, BowlValue text, u64 index) {
+    // texts of any kind are written as flat texts of the smallest width (a slice may be wider than its codepoints)
+    const u8 *bytes;
+    u64 width, length;
+    u64 target = 1;
+    TextReader reader = text_reader(text, 0);
+
+    while (text_reader_next(&reader, &bytes, &width, &length)) {
+        target = MAX(target, text_width(bytes, width, length));
+    }
+
+    // the codepoints are written as a string literal, whose terminating zero is part of the storage
+    const u64 size = text->string.length * target;
+    bool success = output_printf(output, "static union { struct bowl_value value; u8 storage[offsetof(struct bowl_value, %s.bytes) + %" PRIu64 "]; } embedded_value_%" PRIu64 " = { .value = { .type = %s, .location = NULL, .hash = 0, .%s = { .length = %" PRIu64 ", .width = %" PRIu64 ", .bytes =\n    \"", field, size + 1, index, type, field, text->string.length, target);
+    u64 written = 0;
+
+    reader = text_reader(text, 0);
+
+    while (success && text_reader_next(&reader, &bytes, &width, &length)) {
+        for (u64 i = 0; i < length && success; ++i) {
+            u32 codepoint;
+            TEXT_PUT((u8 *) &codepoint, target, 0, TEXT_AT(bytes, width, i));
+
+            for (u64 j = 0; j < target && success; ++j, ++written) {
+                if (written > 0 && written % EMBED_LINE_BYTES == 0) {
+                    success = output_string(output, "\"\n    \"");
+                }
+
+                success = success && embed_write_byte(output, ((const u8 *) &codepoint)[j]);
+            }
+        }
+    }
+
+    return success && output_string(output, "\"\n} } };\n");
+}
+
+static bool embed_write_number(Output *output, double number, u64 index) {
+    // hexadecimal literals represent every finite number exactly
+    char literal[64];
+
+    if (isnan(number)) {
+        strcpy(literal, "NAN");
+    } else if (isinf(number)) {
+        strcpy(literal, number < 0 ? "-INFINITY" : "INFINITY");
+    } else {
+        sprintf(literal, "%a", number);
+    }
+
+    return output_printf(output, "static struct bowl_value embedded_value_%" PRIu64 " = { .type = BowlNumberValue, .location = NULL, .hash = 0, .number = { .value = %s } };\n", index, literal);
+}
+
+static bool embed_write_reference(Output *output, BowlValue value, u64 index) {
+    if (value == NULL) {
+        return output_string(output, "NULL");
+    }
+
+    // texts are defined as unions, which contain the value along with its codepoints
+    const bool text = value->type == BowlSymbolValue || value->type == BowlStringValue;
+    return output_printf(output, "&embedded_value_%" PRIu64 "%s", index, text ? ".value" : "");
+}
+
+static bool embed_write_value(EmbedWriter *writer, BowlValue value, u64 *index);
+
+static bool embed_write_list(EmbedWriter *writer, BowlValue list, u64 *index) {
+    // the elements are defined in front of the list nodes which refer to them
+    const u64 count = list->list.length;
+    BowlValue *const values = malloc(count * sizeof(BowlValue));
+    u64 *const heads = malloc(count * sizeof(u64));
+    bool success = values != NULL && heads != NULL;
+    u64 i = 0;
+
+    if (!success) {
+        errno = ENOMEM;
+    }
+
+    for (; list != NULL && i < count && success; list = list->list.tail, ++i) {
+        values[i] = list->list.head;
+        success = embed_write_value(writer, values[i], &heads[i]);
+    }
+
+    // the list is built from its end, such that every node refers to one which is defined already
+    for (i = count; i-- > 0 && success;) {
+        const u64 node = writer->value_count++;
+
+        success = output_printf(writer->output, "static struct bowl_value embedded_value_%" PRIu64 " = { .type = BowlListValue, .location = NULL, .hash = 0, .list = { .head = ", node)
+            && embed_write_reference(writer->output, values[i], heads[i])
+            && output_string(writer->output, ", .tail = ")
+            && (i + 1 == count ? output_string(writer->output, "NULL") : output_printf(writer->output, "&embedded_value_%" PRIu64, *index))
+            && output_printf(writer->output, ", .length = %" PRIu64 " } };\n", count - i);
+
+        *index = node;
+    }
+
+    free(values);
+    free(heads);
+
+    return success;
+}
+
+static bool embed_write_value(EmbedWriter *writer, BowlValue value, u64 *index) {
+    // writes the definition of a value, unless it is 'NULL' (the empty list) or a symbol which was written already
+    if (value == NULL) {
+        *index = 0;
+        return true;
+    } else if (value->type == BowlListValue) {
+        return embed_write_list(writer, value, index);
+    } else if (value->type == BowlSymbolValue) {
+        const u64 slot = embed_symbol_slot(writer, value);
+
+        if (writer->symbols[slot] != NULL) {
+            *index = writer->indices[slot];
+            return true;
+        }
+
+        writer->symbols[slot] = value;
+        writer->indices[slot] = writer->value_count;
+        writer->distinct[writer->symbol_count++] = writer->value_count;
+    }
+
+    *index = writer->value_count++;
+
+    switch (value->type) {
+        case BowlNumberValue:
+            return embed_write_number(writer->output, value->number.value, *index);
+        case BowlBooleanValue:
+            return output_printf(writer->output, "static struct bowl_value embedded_value_%" PRIu64 " = { .type = BowlBooleanValue, .location = NULL, .hash = 0, .boolean = { .value = %s } };\n", *index, value->boolean.value ? "true" : "false");
+        case BowlSymbolValue:
+            return embed_write_text(writer->output, "BowlSymbolValue", "symbol", value, *index);
+        case BowlStringValue:
+            return embed_write_text(writer->output, "BowlStringValue", "string", value, *index);
+        default:
+            // tokens are never of any other type
+            errno = EINVAL;
+            return false;
+    }
+}
+
+static bool embed_write_source(Output *output, BowlValue tokens, const char *path) {
+    // writes the source into the buffer (on failure, 'errno' tells why)
+    const u64 count = embed_count_symbols(tokens);
+    EmbedWriter writer = {
+        .output = output,
+        .capacity = 16,
+        .symbol_count = 0,
+        .value_count = 0
+    };
+
+    while (writer.capacity < count * 2) {
+        writer.capacity *= 2;
+    }
+
+    writer.symbols = calloc(writer.capacity, sizeof(BowlValue));
+    writer.indices = malloc(writer.capacity * sizeof(u64));
+    writer.distinct = malloc(MAX(count, 1) * sizeof(u64));
+
+    bool success = writer.symbols != NULL && writer.indices != NULL && writer.distinct != NULL;
+    u64 boot = 0;
+
+    if (!success) {
+        errno = ENOMEM;
+    }
+
+    success = success
+        && output_printf(output, "// the boot program of the bowl virtual machine (written by its flag '-embed' for the boot file '%s')\n", path)
+        && output_string(output, "#include <bowl/bowl.h>\n#include <math.h>\n#include <stdbool.h>\n#include <stddef.h>\n\n")
+        && embed_write_value(&writer, tokens, &boot)
+        && output_string(output, "\nBowlValue bowl_embedded_boot = ")
+        && embed_write_reference(output, tokens, boot)
+        && output_string(output, ";\n\nBowlValue bowl_embedded_symbols[] = {\n");
+
+    // the symbols are listed in the order of their first occurrence, such that the source is reproducible
+    for (u64 i = 0; i < writer.symbol_count && success; ++i) {
+        success = output_printf(output, "    &embedded_value_%" PRIu64 ".value,\n", writer.distinct[i]);
+    }
+
+    success = success && output_string(output, "    NULL\n};\n");
+
+    if (output->failure) {
+        errno = ENOMEM;
+    }
+
+    free(writer.symbols);
+    free(writer.indices);
+    free(writer.distinct);
+
+    return success;
+}
+
+BowlValue embed_write(BowlStack stack, BowlValue tokens, const char *path) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, tokens, NULL, NULL);
+    Output output;
+
+    if (!output_buffer(&output, OUTPUT_CAPACITY)) {
+        return bowl_exception_out_of_heap;
+    }
+
+    bool success = embed_write_source(&output, frame.registers[0], bowl_settings_boot_path);
+
+    // the file is replaced at once, such that a build never compiles an incomplete file
+    char *const temporary = success ? malloc(strlen(path) + 5) : NULL;
+    FILE *file = NULL;
+
+    if (temporary != NULL) {
+        sprintf(temporary, "%s.tmp", path);
+        file = fopen(temporary, "wb");
+    } else if (success) {
+        errno = ENOMEM;
+    }
+
+    if (file != NULL) {
+        success = output.length == 0 || fwrite(output.bytes, output.length, 1, file) == 1;
+        success = fclose(file) == 0 && success;
+        success = success && rename(temporary, path) == 0;
+
+        if (!success) {
+            const int error = errno;
+            remove(temporary);
+            errno = error;
+        }
+    } else {
+        success = false;
+    }
+
+    const int error = errno;
+    free(temporary);
+    free(output.bytes);
+    errno = error;
+
+    if (!success) {
+        return bowl_format_exception(&frame, "failed to write the embedded boot program '%s' (%s)", path, strerror(errno)).value;
+    }
+
+    return NULL;
+}
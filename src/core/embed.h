@@ -0,0 +1,43 @@
+#ifndef EMBED_H
+#define EMBED_H
+
+#include "../common/utility.h"
+#include <bowl/bowl.h>
+#include <bowl/api.h>
+
+/*
+ * The tokens of the boot program can be embedded into the virtual machine at build time. They are
+ * written as C source which defines every value statically (just like 'BOWL_STATIC_ASCII_STRING'),
+ * such that the boot program is in memory as soon as the virtual machine starts, outside of the
+ * heap and without being read or tokenized. The source is compiled together with the virtual
+ * machine if 'BOWL_EMBEDDED_BOOT' is defined (see the target 'embedded' of the makefile).
+ */
+
+/**
+ * The list of tokens of the embedded boot program (or 'NULL' if there is none).
+ */
+extern BowlValue bowl_embedded_boot;
+
+/**
+ * The distinct symbols of the embedded boot program, followed by 'NULL'.
+ */
+extern BowlValue bowl_embedded_symbols[];
+
+/**
+ * Adds the symbols of the embedded boot program to the intern table, such that the tokens of
+ * other programs share them.
+ * @return Either an exception or 'NULL' on success.
+ */
+BowlValue embed_intern(void);
+
+/**
+ * Writes a list of tokens as C source which defines 'bowl_embedded_boot' and
+ * 'bowl_embedded_symbols'.
+ * @param stack The stack of the current environment.
+ * @param tokens The list of tokens.
+ * @param path The path of the C source file.
+ * @return Either an exception or 'NULL' on success.
+ */
+BowlValue embed_write(BowlStack stack, BowlValue tokens, const char *path);
+
+#endif
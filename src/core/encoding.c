@@ -0,0 +1,154 @@
+#include "encoding.h"
+
+typedef struct {
+    BowlValue text;
+    char *bytes;
+    u64 length;
+} EncodingEntry;
+
+// an open addressing hash table with linear probing from texts to their encodings (the capacity is always a power of two)
+static EncodingEntry *encoding_table = NULL;
+static u64 encoding_capacity = 0;
+static u64 encoding_size = 0;
+
+static inline u64 encoding_index(BowlValue text, u64 capacity) {
+    // the text is identified by its address
+    return hash_combine(0, (u64) text) & (capacity - 1);
+}
+
+static void encoding_place(EncodingEntry *table, u64 capacity, EncodingEntry entry) {
+    u64 index = encoding_index(entry.text, capacity);
+
+    while (table[index].text != NULL) {
+        index = (index + 1) & (capacity - 1);
+    }
+
+    table[index] = entry;
+}
+
+static EncodingEntry *encoding_find(BowlValue text) {
+    if (encoding_size == 0) {
+        return NULL;
+    }
+
+    for (u64 index = encoding_index(text, encoding_capacity); encoding_table[index].text != NULL; index = (index + 1) & (encoding_capacity - 1)) {
+        if (encoding_table[index].text == text) {
+            return &encoding_table[index];
+        }
+    }
+
+    return NULL;
+}
+
+static bool encoding_insert(EncodingEntry entry) {
+    // keep the load factor below one half
+    if (2 * (encoding_size + 1) > encoding_capacity) {
+        const u64 capacity = MAX(encoding_capacity * 2, 64);
+        EncodingEntry *const table = calloc(capacity, sizeof(EncodingEntry));
+
+        if (table == NULL) {
+            return false;
+        }
+
+        for (u64 i = 0; i < encoding_capacity; ++i) {
+            if (encoding_table[i].text != NULL) {
+                encoding_place(table, capacity, encoding_table[i]);
+            }
+        }
+
+        free(encoding_table);
+        encoding_table = table;
+        encoding_capacity = capacity;
+    }
+
+    encoding_place(encoding_table, encoding_capacity, entry);
+    ++encoding_size;
+
+    return true;
+}
+
+const char *bowl_text_borrow(BowlValue text, u64 *length) {
+    const EncodingEntry *const cached = encoding_find(text);
+
+    if (cached != NULL) {
+        if (length != NULL) {
+            *length = cached->length;
+        }
+
+        return cached->bytes;
+    }
+
+    // encode into a buffer which is large enough for any codepoints and shrink it afterwards
+    EncodingEntry entry = {
+        .text = text,
+        .bytes = malloc(text->string.length * 4 + 1),
+        .length = 0
+    };
+
+    if (entry.bytes == NULL) {
+        return NULL;
+    }
+
+    TextReader reader = text_reader(text, 0);
+    const u8 *run;
+    u64 width, run_length;
+
+    while (text_reader_next(&reader, &run, &width, &run_length)) {
+        entry.length += unicode_utf8_encode_text(run, width, run_length, (u8 *) &entry.bytes[entry.length]);
+    }
+
+    entry.bytes[entry.length] = '\0';
+
+    char *const bytes = realloc(entry.bytes, entry.length + 1);
+
+    if (bytes != NULL) {
+        entry.bytes = bytes;
+    }
+
+    if (!encoding_insert(entry)) {
+        free(entry.bytes);
+        return NULL;
+    }
+
+    if (length != NULL) {
+        *length = entry.length;
+    }
+
+    return entry.bytes;
+}
+
+void encoding_collect(void) {
+    if (encoding_size == 0) {
+        return;
+    }
+
+    // removing entries would break the probe sequences => rebuild the table from the surviving texts
+    EncodingEntry *const table = calloc(encoding_capacity, sizeof(EncodingEntry));
+    u64 size = 0;
+
+    for (u64 i = 0; i < encoding_capacity; ++i) {
+        EncodingEntry entry = encoding_table[i];
+
+        if (entry.text == NULL) {
+            continue;
+        }
+
+        entry.text = gc_forward(entry.text);
+
+        if (entry.text == NULL || table == NULL) {
+            // the text is no longer reachable (or the table cannot be rebuilt, in which case the encoding is computed again)
+            free(entry.bytes);
+        } else {
+            encoding_place(table, encoding_capacity, entry);
+            ++size;
+        }
+    }
+
+    free(encoding_table);
+    encoding_table = table;
+    encoding_size = size;
+
+    if (table == NULL) {
+        encoding_capacity = 0;
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef ENCODING_H
+#define ENCODING_H
+
+#include "../common/utility.h"
+#include <bowl/bowl.h>
+#include <bowl/api.h>
+#include "gc.h"
+#include "text.h"
+#include "unicode.h"
+
+/**
+ * Returns the UTF-8 encoding of a string or a symbol as a null-terminated C string.
+ *
+ * The encoding is computed on the first call and cached afterwards. It is neither allocated in
+ * the heap nor moved by the garbage collector. Thus, the result remains valid as long as the
+ * text is reachable and must not be released by the caller.
+ * @param text The string or the symbol (of any kind).
+ * @param length The location where the number of bytes (without the null terminator) should be
+ * stored, or 'NULL'.
+ * @return Either the encoding or 'NULL' if there is not enough memory.
+ */
+const char *bowl_text_borrow(BowlValue text, u64 *length);
+
+/**
+ * Updates the cached encodings after all reachable values were relocated by the garbage
+ * collector and releases the encodings of all texts which are no longer reachable.
+ */
+void encoding_collect(void);
+
+#endif
@@ -0,0 +1,242 @@
+#include "external.h"
+#include "core.h"
+#include <errno.h>
+#include <fcntl.h>
+
+#if defined(OS_UNIX)
+    #include <sys/mman.h>
+    #include <unistd.h>
+#elif defined(OS_WINDOWS)
+    #include <io.h>
+#endif
+
+typedef struct {
+    /** The external string, which is not kept alive by this reference. */
+    BowlValue string;
+    /** The region which contains the codepoints. */
+    void *address;
+    u64 size;
+    /** Whether the region is a mapped file (or was allocated by 'malloc' otherwise). */
+    bool mapped;
+} ExternalRegion;
+
+// the regions of all external strings which were alive after the last garbage collection
+static ExternalRegion *external_list = NULL;
+static u64 external_list_size = 0;
+static u64 external_list_capacity = 0;
+
+static void external_release(ExternalRegion region) {
+    #if defined(OS_UNIX)
+        if (region.mapped) {
+            munmap(region.address, region.size);
+            return;
+        }
+    #endif
+
+    free(region.address);
+}
+
+static BowlResult external_failure(BowlStack stack, const char *message, const char *path) {
+    BowlResult result = bowl_format_exception(stack, "%s '%s' (%s)", message, path, strerror(errno));
+    result.failure = true;
+    return result;
+}
+
+static bool external_read(int descriptor, u8 *bytes, u64 size) {
+    u64 offset = 0;
+
+    while (offset < size) {
+        const i64 count = read(descriptor, &bytes[offset], size - offset);
+
+        if (count < 0 && errno == EINTR) {
+            continue;
+        } else if (count <= 0) {
+            // the file was truncated in the meantime
+            errno = count == 0 ? EIO : errno;
+            return false;
+        }
+
+        offset += count;
+    }
+
+    return true;
+}
+
+static bool external_reserve(void) {
+    if (external_list_size < external_list_capacity) {
+        return true;
+    }
+
+    const u64 capacity = MAX(external_list_capacity * 2, 16);
+    ExternalRegion *const list = realloc(external_list, capacity * sizeof(ExternalRegion));
+
+    if (list == NULL) {
+        return false;
+    }
+
+    external_list = list;
+    external_list_capacity = capacity;
+
+    return true;
+}
+
+BowlResult bowl_string_file(BowlStack stack, const char *path) {
+    const int descriptor = open(path, O_RDONLY);
+
+    if (descriptor < 0) {
+        return external_failure(stack, "failed to open file", path);
+    }
+
+    const i64 size = lseek(descriptor, 0, SEEK_END);
+
+    if (size < 0 || lseek(descriptor, 0, SEEK_SET) < 0) {
+        const BowlResult result = external_failure(stack, "failed to read file", path);
+        close(descriptor);
+        return result;
+    } else if (size == 0) {
+        // empty regions cannot be mapped
+        close(descriptor);
+        return bowl_string_utf8(stack, (u8 *) "", 0);
+    }
+
+    ExternalRegion region = {
+        .string = NULL,
+        .address = NULL,
+        .size = (u64) size,
+        .mapped = false
+    };
+
+    #if defined(OS_UNIX)
+        // the pages are read on demand and they are shared with the page cache
+        region.address = mmap(NULL, region.size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        region.mapped = region.address != MAP_FAILED;
+
+        if (!region.mapped) {
+            region.address = NULL;
+        }
+    #endif
+
+    if (region.address == NULL) {
+        // the file cannot be mapped => read it into memory instead
+        region.address = malloc(region.size);
+
+        if (region.address == NULL) {
+            close(descriptor);
+            return (BowlResult) { .failure = true, .exception = bowl_exception_out_of_heap };
+        } else if (!external_read(descriptor, region.address, region.size)) {
+            const BowlResult result = external_failure(stack, "failed to read file", path);
+            free(region.address);
+            close(descriptor);
+            return result;
+        }
+    }
+
+    close(descriptor);
+
+    u64 count;
+    u32 maximum;
+    const u32 state = unicode_utf8_measure(region.address, region.size, &count, &maximum);
+
+    if (state != UNICODE_UTF8_STATE_ACCEPT) {
+        external_release(region);
+        return (BowlResult) { .failure = true, .exception = state == UNICODE_UTF8_STATE_REJECT ? bowl_exception_malformed_utf8 : bowl_exception_incomplete_utf8 };
+    }
+
+    const u64 width = text_width_of(maximum);
+
+    if (count != region.size) {
+        // the bytes are not the codepoints themselves => decode them once
+        u8 *const codepoints = malloc(count * width);
+
+        if (codepoints != NULL) {
+            unicode_utf8_decode_text(region.address, region.size, codepoints, width);
+        }
+
+        external_release(region);
+        region.address = codepoints;
+        region.size = count * width;
+        region.mapped = false;
+    }
+
+    if (region.address == NULL) {
+        return (BowlResult) { .failure = true, .exception = bowl_exception_out_of_heap };
+    }
+
+    // the region must be registered as soon as the string exists, which cannot fail afterwards
+    if (!external_reserve()) {
+        external_release(region);
+        return (BowlResult) { .failure = true, .exception = bowl_exception_out_of_heap };
+    }
+
+    BowlResult result = gc_allocate(stack, BowlStringValue, sizeof(TextExternal));
+
+    if (result.failure) {
+        external_release(region);
+        return result;
+    }
+
+    TextExternal *const external = (TextExternal *) &result.value->string.bytes[0];
+    external->bytes = region.address;
+    external->size = region.size;
+    result.value->string.length = count;
+    result.value->string.width = TEXT_EXTERNAL | width;
+
+    region.string = result.value;
+    external_list[external_list_size++] = region;
+
+    return result;
+}
+
+BowlValue bowl_string_file_function(BowlStack stack) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+
+    if (*frame.datastack == NULL) {
+        return bowl_format_exception(&frame, "stack underflow in function '%s'", __FUNCTION__).value;
+    }
+
+    BOWL_STACK_POP_VALUE(&frame, &frame.registers[0]);
+
+    if (frame.registers[0] == NULL || frame.registers[0]->type != BowlStringValue) {
+        return bowl_format_exception(&frame, "argument of illegal type '%s' in function '%s' (expected type 'string')", bowl_value_type(frame.registers[0]), __FUNCTION__).value;
+    }
+
+    const char *const path = bowl_text_borrow(frame.registers[0], NULL);
+
+    if (path == NULL) {
+        return bowl_exception_out_of_heap;
+    }
+
+    BowlResult result = bowl_string_file(&frame, path);
+
+    if (result.failure) {
+        return result.exception;
+    }
+
+    result = bowl_list(&frame, result.value, *frame.datastack);
+
+    if (result.failure) {
+        return result.exception;
+    }
+
+    *frame.datastack = result.value;
+
+    return NULL;
+}
+
+void external_collect(void) {
+    u64 size = 0;
+
+    for (u64 i = 0; i < external_list_size; ++i) {
+        ExternalRegion region = external_list[i];
+        region.string = gc_forward(region.string);
+
+        if (region.string == NULL) {
+            // neither the string nor any of its slices are reachable
+            external_release(region);
+        } else {
+            external_list[size++] = region;
+        }
+    }
+
+    external_list_size = size;
+}
@@ -0,0 +1,42 @@
+#ifndef EXTERNAL_H
+#define EXTERNAL_H
+
+#include "../common/utility.h"
+#include <bowl/bowl.h>
+#include <bowl/api.h>
+
+/*
+ * External strings store their codepoints outside of the heap, such that large files are neither
+ * copied into the heap nor moved by every garbage collection (see 'text.h').
+ *
+ * A file which consists of ASCII characters only is mapped into memory and its bytes are used as
+ * codepoints of width one in place. Any other file is decoded once into a region of the smallest
+ * width which fits all of its codepoints. The region is released as soon as the string is no
+ * longer reachable (slices of the string keep it alive). Modifying a file while it is mapped is
+ * undefined, just like for any other mapped file.
+ */
+
+/**
+ * Creates a string of the UTF-8 encoded contents of a file, whose codepoints are stored outside of
+ * the heap.
+ * @param stack The stack of the current environment.
+ * @param path The path of the file.
+ * @return Either the string or an exception.
+ */
+BowlResult bowl_string_file(BowlStack stack, const char *path);
+
+/**
+ * The native function 'string:file', which pops the path of a file from the datastack and pushes the
+ * external string of its contents (see 'bowl_string_file').
+ * @param stack The stack of the current environment.
+ * @return Either an exception or 'NULL' on success.
+ */
+BowlValue bowl_string_file_function(BowlStack stack);
+
+/**
+ * Updates the external strings after all reachable values were relocated by the garbage collector
+ * and releases the codepoints of all strings which are no longer reachable.
+ */
+void external_collect(void);
+
+#endif
@@ -11,6 +11,14 @@ static BowlValue *gc_libraries = NULL;
 static u64 gc_libraries_capacity = 0;
 static u64 gc_libraries_size = 0;
 
+// the number of garbage collections so far
+static u64 gc_epoch = 0;
+
+static inline u64 gc_aligned(u64 bytes) {
+    // strings and symbols may occupy any number of bytes, but every value must start at an aligned address
+    return (bytes + sizeof(u64) - 1) & ~(u64) (sizeof(u64) - 1);
+}
+
 static inline bool gc_is_managed(BowlValue value) {
     // only objects that reside inside the 'gc_heap_src' are managed by the garbage collector
     return (u64) value >= (u64) gc_heap_src && (u64) value < (u64) (gc_heap_src + gc_heap_size);
@@ -47,7 +55,7 @@ static BowlValue gc_relocate(BowlValue value) {
     } else if (value->location == NULL) {
         const BowlValue copy = (BowlValue) (gc_heap_dst + gc_heap_ptr);
         const u64 bytes = bowl_value_byte_size(value);
-        gc_heap_ptr += bytes;
+        gc_heap_ptr += gc_aligned(bytes);
         memcpy(copy, value, bytes);
         value->location = copy;
     }
@@ -61,6 +69,10 @@ BowlValue bowl_collect_garbage(BowlStack stack) {
     gc_heap_dst = gc_heap_src;
     gc_heap_src = swap;
     gc_heap_ptr = 0;
+    ++gc_epoch;
+
+    // all cached lookups refer to the old locations of the values
+    dictionary_cache_clear();
 
     // mark the root objects
     register BowlStack current = stack;
@@ -88,8 +100,7 @@ BowlValue bowl_collect_garbage(BowlStack stack) {
     register u64 scan = 0;
     while (scan < gc_heap_ptr) {
         const BowlValue value = (BowlValue) (gc_heap_dst + scan);
-        const u64 bytes = bowl_value_byte_size(value);
-        scan += bytes;
+        scan += gc_aligned(bowl_value_byte_size(value));
 
         switch (value->type) {
             case BowlNativeValue:
@@ -99,8 +110,27 @@ BowlValue bowl_collect_garbage(BowlStack stack) {
                 value->list.head = gc_relocate(value->list.head);
                 value->list.tail = gc_relocate(value->list.tail);
                 break;
-            case BowlMapValue:
-                for (u64 i = 0, end = value->map.capacity; i < end; ++i) {
+            case BowlMapValue: {
+                u64 length;
+                BowlValue *const references = map_node_references(value, &length);
+
+                for (u64 i = 0; i < length; ++i) {
+                    references[i] = gc_relocate(references[i]);
+                }
+                break;
+            }
+            case BowlStringValue: {
+                // slices and concatenations refer to other strings
+                u64 length;
+                BowlValue *const references = text_references(value, &length);
+
+                for (u64 i = 0; i < length; ++i) {
+                    references[i] = gc_relocate(references[i]);
+                }
+                break;
+            }
+            case BowlSortedMapValue:
+                for (u64 i = 0, end = sorted_map_node_slots(value); i < end; ++i) {
                     value->map.buckets[i] = gc_relocate(value->map.buckets[i]);
                 }
                 break;
@@ -128,6 +158,18 @@ BowlValue bowl_collect_garbage(BowlStack stack) {
         }
     }
 
+    // forget all interned symbols which are no longer reachable
+    intern_collect();
+
+    // release the encodings of all texts which are no longer reachable
+    encoding_collect();
+
+    // close all token streams which are no longer reachable
+    stream_collect();
+
+    // release the codepoints of all external strings which are no longer reachable
+    external_collect();
+
     // clean up all libraries which are no longer needed
     BowlLibraryResult result = {
         .failure = false,
@@ -157,6 +199,18 @@ BowlValue bowl_collect_garbage(BowlStack stack) {
     }
 }
 
+BowlValue gc_forward(BowlValue value) {
+    if (value == NULL || !gc_is_managed(value)) {
+        return value;
+    }
+
+    return value->location;
+}
+
+u64 gc_collections(void) {
+    return gc_epoch;
+}
+
 static bool gc_heap_reallocate(u64 new_heap_size) {
     u8 *const new_heap_src = realloc(gc_heap_src, new_heap_size * sizeof(u8));
     if (new_heap_src == NULL) {
@@ -199,7 +253,7 @@ BowlResult gc_allocate(BowlStack stack, BowlValueType type, u64 additional) {
         .value = NULL
     };
 
-    const u64 bytes = sizeof(struct bowl_value) + additional;
+    const u64 bytes = gc_aligned(sizeof(struct bowl_value) + additional);
 
     if (gc_heap_ptr + bytes > gc_heap_size) {
         // try to collect garbage
@@ -209,17 +263,19 @@ BowlResult gc_allocate(BowlStack stack, BowlValueType type, u64 additional) {
             return result;
         }
 
-        // resize the heaps if there is still not enough memory available
-        if (gc_heap_ptr + bytes > gc_heap_size) {
+        // resize the heaps if the values which are still alive take up more than half of them, since
+        // the next collection would follow soon otherwise (which makes a growing heap quadratic)
+        if (gc_heap_ptr + bytes > gc_heap_size / 2) {
             // the new heap size is either twice as large or at least as large to contain the requested object
-            const u64 minimum_heap_size = gc_heap_size + (gc_heap_ptr + bytes - gc_heap_size);
+            const u64 minimum_heap_size = MAX(gc_heap_size, gc_heap_ptr + bytes);
             const u64 new_heap_size = MAX(gc_heap_size * 2, minimum_heap_size);
             
             // try to resize the heap to the "best" heap size
             result.exception = gc_heap_resize(stack, new_heap_size);
             if (result.exception == bowl_exception_out_of_heap && minimum_heap_size < new_heap_size) {
-                // try to resize the heap to the minimum if it is truly smaller than the "best" heap size
-                result.exception = gc_heap_resize(stack, minimum_heap_size);
+                // try to resize the heap to the minimum if it is truly smaller than the "best" heap size (the
+                // current heap is kept if the requested object fits into it)
+                result.exception = minimum_heap_size == gc_heap_size ? NULL : gc_heap_resize(stack, minimum_heap_size);
                 if (result.exception != NULL) {
                     result.failure = true;
                     return result;
@@ -6,9 +6,21 @@
 #include <bowl/api.h>
 
 #include "library.h"
+#include "map.h"
+#include "sorted.h"
+#include "dictionary.h"
+#include "intern.h"
+#include "text.h"
+#include "encoding.h"
+#include "stream.h"
+#include "external.h"
 
 BowlResult gc_allocate(BowlStack stack, BowlValueType type, u64 additional);
 
 BowlResult gc_add_library(BowlStack stack, BowlValue library);
 
+u64 gc_collections(void);
+
+BowlValue gc_forward(BowlValue value);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,668 @@
+#define _GNU_SOURCE
+#include "image.h"
+#include "core.h"
+#include <errno.h>
+#include <fcntl.h>
+
+#if defined(OS_UNIX)
+    #include <dlfcn.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+// the first bytes of every image, the last of which is the version of the format
+#define IMAGE_MAGIC "bowlimg\1"
+// the version of the layout of the values, which must be incremented whenever the layout of any value changes
+#define IMAGE_LAYOUT_VERSION 1
+// tells whether an image was written on a machine with the same byte order
+#define IMAGE_BYTE_ORDER ((u64) 0x0102030405060708)
+// the address at which images are mapped, unless it is occupied already
+#define IMAGE_BASE ((u64) 0x100000000000)
+// the values of the virtual machine itself which may be referenced by an image
+#define IMAGE_STATICS 5
+
+typedef struct {
+    char magic[8];
+    u64 order;
+    /** The hash of the version of the virtual machine and of the layout of the values. */
+    u64 version;
+    /** The hash seed of the process which wrote the image. */
+    u64 seed;
+    /** The address at which the image is meant to be mapped. */
+    u64 base;
+    u64 size;
+    /** The dictionary, the datastack and the callstack. */
+    BowlValue roots[3];
+    /** The offsets of the first value and behind the last value. */
+    u64 values;
+    u64 values_end;
+    /** The offsets and the lengths of the tables which are required to restore the image. */
+    u64 natives;
+    u64 natives_length;
+    u64 statics;
+    u64 statics_length;
+    u64 libraries;
+    u64 libraries_length;
+    u64 symbols;
+    u64 symbols_length;
+} ImageHeader;
+
+typedef struct {
+    /** The offset of the native function. */
+    u64 value;
+    /** The offset of the exported name of the function. */
+    u64 name;
+} ImageNative;
+
+typedef struct {
+    /** The offset of a reference to a value of the virtual machine itself. */
+    u64 slot;
+    /** The index of the value (see 'image_statics'). */
+    u64 index;
+} ImageStatic;
+
+typedef struct {
+    /** All values which are reachable from the roots, in the order in which they were found. */
+    BowlValue *values;
+    /** The offsets of the values within the image. */
+    u64 *offsets;
+    u64 length;
+    u64 capacity;
+    /** A hash table from the values to their indices (plus one, such that zero marks a free slot). */
+    u64 *table;
+    u64 table_capacity;
+} ImageWriter;
+
+const char *bowl_settings_image_path = NULL;
+
+static void image_statics(BowlValue statics[IMAGE_STATICS]) {
+    statics[0] = bowl_exception_out_of_heap;
+    statics[1] = bowl_exception_finalization_failure;
+    statics[2] = bowl_exception_malformed_utf8;
+    statics[3] = bowl_exception_incomplete_utf8;
+    statics[4] = bowl_sentinel_value;
+}
+
+static u64 image_static_index(BowlValue value) {
+    // the identity of these values matters, thus they are not copied into the image
+    BowlValue statics[IMAGE_STATICS];
+    image_statics(statics);
+
+    for (u64 i = 0; i < IMAGE_STATICS; ++i) {
+        if (statics[i] == value) {
+            return i;
+        }
+    }
+
+    return IMAGE_STATICS;
+}
+
+static inline u64 image_aligned(u64 bytes) {
+    return (bytes + sizeof(u64) - 1) & ~(u64) (sizeof(u64) - 1);
+}
+
+static inline u64 image_version(void) {
+    // the hashes are persistent, such that they must not depend on the seed of the process
+    return hash_bytes(BOWL_VM_VERSION, sizeof(BOWL_VM_VERSION) - 1, IMAGE_LAYOUT_VERSION);
+}
+
+static BowlValue *image_references(BowlValue value, u64 *length) {
+    // strings are stored flat, thus they never refer to other values within an image
+    switch (value->type) {
+        case BowlNativeValue:
+            *length = 1;
+            return &value->function.library;
+        case BowlListValue:
+            *length = 2;
+            return &value->list.head;
+        case BowlMapValue:
+            return map_node_references(value, length);
+        case BowlSortedMapValue:
+            *length = sorted_map_node_slots(value);
+            return value->map.buckets;
+        case BowlVectorValue:
+            *length = value->vector.length;
+            return value->vector.elements;
+        case BowlExceptionValue:
+            *length = 2;
+            return &value->exception.cause;
+        default:
+            *length = 0;
+            return NULL;
+    }
+}
+
+static bool image_hash_is_stable(BowlValue value) {
+    // the hashes of native functions and libraries are their addresses, which differ once the image is restored
+    while (value != NULL) {
+        if (value->type == BowlNativeValue || value->type == BowlLibraryValue) {
+            return false;
+        }
+
+        u64 length;
+        BowlValue *const references = image_references(value, &length);
+
+        if (length == 0) {
+            return true;
+        }
+
+        for (u64 i = 0; i + 1 < length; ++i) {
+            if (!image_hash_is_stable(references[i])) {
+                return false;
+            }
+        }
+
+        // the last reference is the tail of a list, which is followed without recursion
+        value = references[length - 1];
+    }
+
+    return true;
+}
+
+static bool image_keys_are_stable(BowlValue node) {
+    // the pairs of a map node are laid out by the hashes (or the order) of their keys, which must not change
+    u64 length;
+    BowlValue *const pairs = image_references(node, &length);
+    const u64 count = node->type == BowlMapValue ? map_node_pair_count(node) : node->map.capacity & ~SORTED_MAP_BRANCH;
+
+    for (u64 i = 0; i < count; ++i) {
+        if (!image_hash_is_stable(pairs[2 * i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static u64 image_text_width(BowlValue text) {
+    // the smallest width of the codepoints of a slice or a concatenation
+    TextReader reader = text_reader(text, 0);
+    const u8 *bytes;
+    u64 width, length, result = 1;
+
+    while (result < 4 && text_reader_next(&reader, &bytes, &width, &length)) {
+        result = MAX(result, text_width(bytes, width, length));
+    }
+
+    return result;
+}
+
+static u64 image_value_size(BowlValue value) {
+    if (value->type == BowlStringValue && !text_is_flat(value)) {
+        return sizeof(struct bowl_value) + value->string.length * image_text_width(value);
+    }
+
+    return bowl_value_byte_size(value);
+}
+
+static u64 image_rank(BowlValue value) {
+    // native functions and libraries are written while the image is restored => keep them together at the end
+    return value->type == BowlNativeValue ? 2 : value->type == BowlLibraryValue ? 1 : 0;
+}
+
+static u64 image_writer_find(ImageWriter *writer, BowlValue value) {
+    u64 slot = hash_combine((u64) (uintptr_t) value, 0) & (writer->table_capacity - 1);
+
+    while (writer->table[slot] != 0 && writer->values[writer->table[slot] - 1] != value) {
+        slot = (slot + 1) & (writer->table_capacity - 1);
+    }
+
+    return slot;
+}
+
+static bool image_writer_add(ImageWriter *writer, BowlValue value) {
+    if (value == NULL || image_static_index(value) != IMAGE_STATICS) {
+        return true;
+    }
+
+    if (2 * (writer->length + 1) > writer->table_capacity) {
+        const u64 capacity = MAX(writer->table_capacity * 2, 1024);
+        u64 *const table = calloc(capacity, sizeof(u64));
+        BowlValue *const values = realloc(writer->values, capacity * sizeof(BowlValue));
+
+        if (values != NULL) {
+            writer->values = values;
+        }
+
+        if (table == NULL || values == NULL) {
+            free(table);
+            return false;
+        }
+
+        free(writer->table);
+        writer->table = table;
+        writer->table_capacity = capacity;
+        writer->capacity = capacity;
+
+        for (u64 i = 0; i < writer->length; ++i) {
+            writer->table[image_writer_find(writer, writer->values[i])] = i + 1;
+        }
+    }
+
+    const u64 slot = image_writer_find(writer, value);
+
+    if (writer->table[slot] == 0) {
+        writer->values[writer->length++] = value;
+        writer->table[slot] = writer->length;
+    }
+
+    return true;
+}
+
+static BowlValue image_writer_reference(ImageWriter *writer, BowlValue value) {
+    // the address of a value once the image is mapped at its base
+    return value == NULL ? NULL : (BowlValue) (IMAGE_BASE + writer->offsets[writer->table[image_writer_find(writer, value)] - 1]);
+}
+
+static void image_copy(u8 *target, BowlValue value) {
+    // copies a value into the image without any of the state which depends on the current process
+    if (value->type == BowlStringValue && !text_is_flat(value)) {
+        const BowlValue copy = (BowlValue) target;
+        const u64 width = image_text_width(value);
+        TextReader reader = text_reader(value, 0);
+        const u8 *bytes;
+        u64 bytes_width, length, index = 0;
+
+        memcpy(copy, value, sizeof(struct bowl_value));
+        copy->string.width = width;
+
+        while (text_reader_next(&reader, &bytes, &bytes_width, &length)) {
+            text_copy(&copy->string.bytes[index * width], width, bytes, bytes_width, length);
+            index += length;
+        }
+    } else {
+        memcpy(target, value, bowl_value_byte_size(value));
+    }
+
+    const BowlValue copy = (BowlValue) target;
+    copy->location = NULL;
+
+    switch (copy->type) {
+        case BowlSymbolValue:
+            copy->hash = bowl_value_hash(value);
+            break;
+        case BowlStringValue:
+        case BowlNumberValue:
+        case BowlBooleanValue:
+            // these hashes only depend on the contents and the seed, which is restored together with the image
+            break;
+        case BowlNativeValue:
+            copy->function.function = NULL;
+            copy->hash = 0;
+            break;
+        case BowlLibraryValue:
+            copy->library.handle = NULL;
+            copy->hash = 0;
+            break;
+        default:
+            // the hash may depend on the address of a native function or library
+            copy->hash = 0;
+            break;
+    }
+}
+
+static BowlValue image_failure(BowlStack stack, const char *message, const char *path) {
+    return bowl_format_exception(stack, "%s '%s' (%s)", message, path, strerror(errno)).value;
+}
+
+BowlValue image_write(BowlStack stack, const char *path) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+
+    #if defined(OS_UNIX)
+        // nothing is allocated in the heap until the image is written, thus the values do not move
+        const BowlValue roots[3] = { *frame.dictionary, *frame.datastack, *frame.callstack };
+        ImageWriter writer = { .values = NULL, .offsets = NULL, .length = 0, .capacity = 0, .table = NULL, .table_capacity = 0 };
+        bool success = true;
+        Dl_info program;
+
+        dladdr((void *) image_write, &program);
+
+        for (u64 i = 0; i < 3 && success; ++i) {
+            success = image_writer_add(&writer, roots[i]);
+        }
+
+        for (u64 i = 0; i < writer.length && success; ++i) {
+            u64 length;
+            BowlValue *const references = image_references(writer.values[i], &length);
+
+            for (u64 j = 0; j < length && success; ++j) {
+                success = image_writer_add(&writer, references[j]);
+            }
+        }
+
+        writer.offsets = success ? malloc(MAX(writer.length, 1) * sizeof(u64)) : NULL;
+        const char **const names = success ? calloc(MAX(writer.length, 1), sizeof(char *)) : NULL;
+
+        if (writer.offsets == NULL || names == NULL) {
+            free(writer.values);
+            free(writer.offsets);
+            free(writer.table);
+            free(names);
+            return bowl_exception_out_of_heap;
+        }
+
+        // the values are laid out by their rank, followed by the tables and the names of the native functions
+        u64 offset = image_aligned(sizeof(ImageHeader));
+        u64 natives = 0, statics = 0, libraries = 0, symbols = 0, names_size = 0;
+        BowlValue unnamed = NULL;
+        BowlValue unstable = NULL;
+
+        for (u64 rank = 0; rank < 3; ++rank) {
+            for (u64 i = 0; i < writer.length; ++i) {
+                if (image_rank(writer.values[i]) == rank) {
+                    writer.offsets[i] = offset;
+                    offset += image_aligned(image_value_size(writer.values[i]));
+                }
+            }
+        }
+
+        const u64 values_end = offset;
+
+        for (u64 i = 0; i < writer.length; ++i) {
+            const BowlValue value = writer.values[i];
+            u64 length;
+            BowlValue *const references = image_references(value, &length);
+
+            for (u64 j = 0; j < length; ++j) {
+                statics += references[j] != NULL && image_static_index(references[j]) != IMAGE_STATICS;
+            }
+
+            if (value->type == BowlNativeValue) {
+                // only functions which are exported by their library (or the virtual machine) can be found again
+                Dl_info info;
+                const bool named = dladdr((void *) value->function.function, &info) != 0 && info.dli_sname != NULL && info.dli_saddr == (void *) value->function.function;
+
+                if (!named || (value->function.library == NULL && info.dli_fbase != program.dli_fbase)) {
+                    unnamed = value;
+                } else {
+                    names[i] = info.dli_sname;
+                    names_size += strlen(info.dli_sname) + 1;
+                }
+
+                ++natives;
+            } else if (value->type == BowlLibraryValue) {
+                ++libraries;
+            } else if (value->type == BowlSymbolValue) {
+                ++symbols;
+            } else if ((value->type == BowlMapValue || value->type == BowlSortedMapValue) && !image_keys_are_stable(value)) {
+                unstable = value;
+            }
+        }
+
+        for (u64 i = 0; i < 3; ++i) {
+            statics += roots[i] != NULL && image_static_index(roots[i]) != IMAGE_STATICS;
+        }
+
+        ImageHeader header = {
+            .order = IMAGE_BYTE_ORDER,
+            .version = image_version(),
+            .seed = hash_seed(),
+            .base = IMAGE_BASE,
+            .values = image_aligned(sizeof(ImageHeader)),
+            .values_end = values_end,
+            .natives = values_end,
+            .natives_length = natives,
+            .statics = values_end + natives * sizeof(ImageNative),
+            .statics_length = statics,
+            .libraries = values_end + natives * sizeof(ImageNative) + statics * sizeof(ImageStatic),
+            .libraries_length = libraries,
+            .symbols = values_end + natives * sizeof(ImageNative) + statics * sizeof(ImageStatic) + libraries * sizeof(u64),
+            .symbols_length = symbols
+        };
+
+        memcpy(header.magic, IMAGE_MAGIC, sizeof(header.magic));
+        header.size = header.symbols + symbols * sizeof(u64) + names_size;
+
+        u8 *const image = unnamed == NULL && unstable == NULL ? calloc(header.size, sizeof(u8)) : NULL;
+
+        if (image != NULL) {
+            ImageNative *native = (ImageNative *) &image[header.natives];
+            ImageStatic *reference = (ImageStatic *) &image[header.statics];
+            u64 *library = (u64 *) &image[header.libraries];
+            u64 *symbol = (u64 *) &image[header.symbols];
+            u64 name = header.symbols + symbols * sizeof(u64);
+
+            for (u64 i = 0; i < writer.length; ++i) {
+                const BowlValue value = writer.values[i];
+                const BowlValue copy = (BowlValue) &image[writer.offsets[i]];
+                u64 length;
+
+                image_copy((u8 *) copy, value);
+                BowlValue *const references = image_references(copy, &length);
+
+                for (u64 j = 0; j < length; ++j) {
+                    const u64 index = references[j] == NULL ? IMAGE_STATICS : image_static_index(references[j]);
+
+                    if (index != IMAGE_STATICS) {
+                        // patched as soon as the image is restored
+                        *reference++ = (ImageStatic) { .slot = (u64) ((u8 *) &references[j] - image), .index = index };
+                        references[j] = NULL;
+                    } else {
+                        references[j] = image_writer_reference(&writer, references[j]);
+                    }
+                }
+
+                if (value->type == BowlNativeValue) {
+                    *native++ = (ImageNative) { .value = writer.offsets[i], .name = name };
+                    memcpy(&image[name], names[i], strlen(names[i]) + 1);
+                    name += strlen(names[i]) + 1;
+                } else if (value->type == BowlLibraryValue) {
+                    *library++ = writer.offsets[i];
+                } else if (value->type == BowlSymbolValue) {
+                    *symbol++ = writer.offsets[i];
+                }
+            }
+
+            for (u64 i = 0; i < 3; ++i) {
+                const u64 index = roots[i] == NULL ? IMAGE_STATICS : image_static_index(roots[i]);
+
+                if (index != IMAGE_STATICS) {
+                    *reference++ = (ImageStatic) { .slot = offsetof(ImageHeader, roots) + i * sizeof(BowlValue), .index = index };
+                    header.roots[i] = NULL;
+                } else {
+                    header.roots[i] = image_writer_reference(&writer, roots[i]);
+                }
+            }
+
+            memcpy(image, &header, sizeof(ImageHeader));
+        }
+
+        free(writer.values);
+        free(writer.offsets);
+        free(writer.table);
+        free(names);
+
+        if (unnamed != NULL) {
+            return bowl_format_exception(&frame, "failed to find the exported name of a native function while writing the image '%s'", path).value;
+        } else if (unstable != NULL) {
+            return bowl_format_exception(&frame, "failed to write the image '%s' (a key of a map contains a native function or a library)", path).value;
+        } else if (image == NULL) {
+            return bowl_exception_out_of_heap;
+        }
+
+        // the image is replaced at once, such that other processes never map an incomplete image
+        char *const temporary = malloc(strlen(path) + 5);
+
+        if (temporary == NULL) {
+            free(image);
+            return bowl_exception_out_of_heap;
+        }
+
+        sprintf(temporary, "%s.tmp", path);
+        FILE *const file = fopen(temporary, "wb");
+        success = file != NULL;
+        success = success && fwrite(image, header.size, 1, file) == 1;
+        success = (file == NULL || fclose(file) == 0) && success;
+        success = success && rename(temporary, path) == 0;
+
+        const int error = errno;
+        remove(temporary);
+        free(temporary);
+        free(image);
+        errno = error;
+
+        return success ? NULL : image_failure(&frame, "failed to write the image", path);
+    #else
+        return bowl_format_exception(&frame, "failed to write the image '%s' (images are not supported on this platform)", path).value;
+    #endif
+}
+
+BowlValue image_load(BowlStack stack, const char *path) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+
+    #if defined(OS_UNIX)
+        const int descriptor = open(path, O_RDONLY);
+        ImageHeader header;
+
+        if (descriptor < 0) {
+            return image_failure(&frame, "failed to open the image", path);
+        }
+
+        const bool complete = read(descriptor, &header, sizeof(ImageHeader)) == sizeof(ImageHeader);
+        const i64 size = lseek(descriptor, 0, SEEK_END);
+
+        // the tables must be within the image, such that they can be read without further checks
+        const bool valid = complete
+            && memcmp(header.magic, IMAGE_MAGIC, sizeof(header.magic)) == 0
+            && header.order == IMAGE_BYTE_ORDER
+            && header.version == image_version()
+            && header.size == (u64) size
+            && header.values_end <= header.natives
+            && header.natives + header.natives_length * sizeof(ImageNative) <= header.statics
+            && header.statics + header.statics_length * sizeof(ImageStatic) <= header.libraries
+            && header.libraries + header.libraries_length * sizeof(u64) <= header.symbols
+            && header.symbols + header.symbols_length * sizeof(u64) <= header.size;
+
+        if (!valid) {
+            close(descriptor);
+            return bowl_format_exception(&frame, "the file '%s' is not an image of this virtual machine", path).value;
+        } else if (!hash_seed_restore(header.seed)) {
+            close(descriptor);
+            return bowl_format_exception(&frame, "the image '%s' must be restored before any value is hashed", path).value;
+        }
+
+        // the pages are shared with all other processes until they are written
+        u8 *const image = mmap((void *) header.base, header.size, PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0);
+        close(descriptor);
+
+        if (image == MAP_FAILED) {
+            return image_failure(&frame, "failed to map the image", path);
+        }
+
+        BowlValue *const roots = ((ImageHeader *) image)->roots;
+
+        if ((u64) image != header.base) {
+            // the address is occupied => move all references which point into the image
+            const u64 delta = (u64) image - header.base;
+
+            for (u64 offset = header.values; offset < header.values_end;) {
+                const BowlValue value = (BowlValue) &image[offset];
+                u64 length;
+                BowlValue *const references = image_references(value, &length);
+                offset += image_aligned(bowl_value_byte_size(value));
+
+                for (u64 i = 0; i < length; ++i) {
+                    if ((u64) references[i] - header.base < header.size) {
+                        references[i] = (BowlValue) ((u64) references[i] + delta);
+                    }
+                }
+            }
+
+            for (u64 i = 0; i < 3; ++i) {
+                if ((u64) roots[i] - header.base < header.size) {
+                    roots[i] = (BowlValue) ((u64) roots[i] + delta);
+                }
+            }
+        }
+
+        BowlValue statics[IMAGE_STATICS];
+        image_statics(statics);
+
+        for (u64 i = 0; i < header.statics_length; ++i) {
+            const ImageStatic *const reference = &((const ImageStatic *) &image[header.statics])[i];
+            *(BowlValue *) &image[reference->slot] = statics[reference->index];
+        }
+
+        // the symbols of the image are interned first, such that the libraries register their functions with them
+        for (u64 i = 0; i < header.symbols_length; ++i) {
+            const BowlValue symbol = (BowlValue) &image[((const u64 *) &image[header.symbols])[i]];
+
+            if (intern_find(symbol->symbol.bytes, symbol->symbol.width, symbol->symbol.length, symbol->hash) == NULL) {
+                const BowlValue exception = intern_insert(symbol);
+
+                if (exception != NULL) {
+                    return exception;
+                }
+            }
+        }
+
+        // the libraries are initialized once more, but the functions which they register are dropped (the
+        // libraries are not passed to the garbage collector, which would skip them anyway since values of the
+        // image are never collected, thus they stay open until the process exits)
+        BowlValue dictionary = NULL;
+        BowlValue callstack = NULL;
+        BowlValue datastack = NULL;
+        BowlStackFrame scratch = BOWL_EMPTY_STACK_FRAME(&frame);
+        scratch.dictionary = &dictionary;
+        scratch.callstack = &callstack;
+        scratch.datastack = &datastack;
+
+        BOWL_TRY(&dictionary, bowl_map(&scratch, 16));
+
+        for (u64 i = 0; i < header.libraries_length; ++i) {
+            const BowlValue library = (BowlValue) &image[((const u64 *) &image[header.libraries])[i]];
+            const BowlLibraryResult result = library_open(&scratch, library);
+
+            if (result.failure) {
+                return result.exception;
+            }
+
+            library->library.handle = result.handle;
+        }
+
+        void *const program = dlopen(NULL, RTLD_LAZY);
+
+        for (u64 i = 0; i < header.natives_length; ++i) {
+            const ImageNative *const native = &((const ImageNative *) &image[header.natives])[i];
+            const BowlValue value = (BowlValue) &image[native->value];
+            const char *const name = (const char *) &image[native->name];
+            void *const handle = value->function.library == NULL ? program : value->function.library->library.handle;
+
+            value->function.function = (BowlFunction) dlsym(handle, name);
+
+            if (value->function.function == NULL) {
+                return bowl_format_exception(&frame, "failed to find the native function '%s' of the image '%s'", name, path).value;
+            }
+        }
+
+        *frame.dictionary = roots[0];
+        *frame.datastack = roots[1];
+        *frame.callstack = roots[2];
+
+        return NULL;
+    #else
+        return bowl_format_exception(&frame, "failed to map the image '%s' (images are not supported on this platform)", path).value;
+    #endif
+}
+
+BowlValue bowl_image_dump(BowlStack stack) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+
+    if (*frame.datastack == NULL) {
+        return bowl_format_exception(&frame, "stack underflow in function '%s'", __FUNCTION__).value;
+    }
+
+    BOWL_STACK_POP_VALUE(&frame, &frame.registers[0]);
+
+    if (frame.registers[0] == NULL || frame.registers[0]->type != BowlStringValue) {
+        return bowl_format_exception(&frame, "argument of illegal type '%s' in function '%s' (expected type 'string')", bowl_value_type(frame.registers[0]), __FUNCTION__).value;
+    }
+
+    const char *const path = bowl_text_borrow(frame.registers[0], NULL);
+
+    if (path == NULL) {
+        return bowl_exception_out_of_heap;
+    }
+
+    return image_write(&frame, path);
+}
@@ -0,0 +1,58 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include "../common/utility.h"
+#include <bowl/bowl.h>
+#include <bowl/api.h>
+
+/*
+ * An image holds the dictionary, the datastack and the callstack of an environment together with
+ * all values which are reachable from them, such that a booted environment can be restored
+ * without booting it again.
+ *
+ * The values are stored in their representation in the heap, with all references already pointing
+ * to the address at which the image is meant to be mapped. Thus, an image which is mapped at this
+ * address is used in place: its pages are shared between all processes which map it (copy-on-write)
+ * and only the pages of native functions and libraries are written while they are relinked. Native
+ * functions are recorded by their exported name and found using 'dlsym' after their libraries were
+ * opened again. Images are only supported on Unix.
+ *
+ * The values of an image are never collected and they never refer to values in the heap. Hence, the
+ * libraries of an image are deliberately not registered with the garbage collector: they remain
+ * open (and are never finalized) until the process exits. The hash seed of the process which wrote
+ * the image is adopted, such that the layout of its maps remains valid. This does not hold for the
+ * hashes of native functions and libraries, which are their addresses. Therefore, maps whose keys
+ * contain any of them cannot be written into an image.
+ */
+
+/**
+ * The path of the image which is restored before the program is executed (or 'NULL' to boot).
+ */
+extern const char *bowl_settings_image_path;
+
+/**
+ * Writes the dictionary, the datastack and the callstack of the current environment into an image.
+ * @param stack The stack of the current environment.
+ * @param path The path of the image.
+ * @return Either an exception or 'NULL' on success.
+ */
+BowlValue image_write(BowlStack stack, const char *path);
+
+/**
+ * Maps an image and restores the dictionary, the datastack and the callstack of the current
+ * environment from it. This must happen before any value is hashed.
+ * @param stack The stack of the current environment.
+ * @param path The path of the image.
+ * @return Either an exception or 'NULL' on success.
+ */
+BowlValue image_load(BowlStack stack, const char *path);
+
+/**
+ * The native function 'image:dump', which pops the path of an image from the datastack and writes
+ * the current environment into it (see 'image_write').
+ * @param stack The stack of the current environment.
+ * @return Either an exception or 'NULL' on success.
+ */
+BowlValue bowl_image_dump(BowlStack stack);
+
+#endif
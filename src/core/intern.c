@@ -0,0 +1,97 @@
+#include "intern.h"
+
+// an open addressing hash table with linear probing (the capacity is always a power of two)
+static BowlValue *intern_table = NULL;
+static u64 intern_capacity = 0;
+static u64 intern_size = 0;
+
+static void intern_place(BowlValue *table, u64 capacity, BowlValue symbol) {
+    u64 index = symbol->hash & (capacity - 1);
+
+    while (table[index] != NULL) {
+        index = (index + 1) & (capacity - 1);
+    }
+
+    table[index] = symbol;
+}
+
+u64 intern_hash(const u8 *bytes, u64 width, u64 length) {
+    const u64 hash = hash_bytes(bytes, length * width, hash_combine(hash_seed(), BowlSymbolValue));
+    // a hash of zero marks a hash which has not been computed yet
+    return hash == 0 ? 1 : hash;
+}
+
+BowlValue intern_find(const u8 *bytes, u64 width, u64 length, u64 hash) {
+    if (intern_size == 0) {
+        return NULL;
+    }
+
+    for (u64 index = hash & (intern_capacity - 1); intern_table[index] != NULL; index = (index + 1) & (intern_capacity - 1)) {
+        const BowlValue symbol = intern_table[index];
+
+        if (symbol->hash == hash && symbol->symbol.length == length && symbol->symbol.width == width && memcmp(symbol->symbol.bytes, bytes, length * width) == 0) {
+            return symbol;
+        }
+    }
+
+    return NULL;
+}
+
+BowlValue intern_insert(BowlValue symbol) {
+    // keep the load factor below one half
+    if (2 * (intern_size + 1) > intern_capacity) {
+        const u64 capacity = MAX(intern_capacity * 2, 256);
+        BowlValue *const table = calloc(capacity, sizeof(BowlValue));
+
+        if (table == NULL) {
+            return bowl_exception_out_of_heap;
+        }
+
+        for (u64 i = 0; i < intern_capacity; ++i) {
+            if (intern_table[i] != NULL) {
+                intern_place(table, capacity, intern_table[i]);
+            }
+        }
+
+        free(intern_table);
+        intern_table = table;
+        intern_capacity = capacity;
+    }
+
+    intern_place(intern_table, intern_capacity, symbol);
+    ++intern_size;
+
+    return NULL;
+}
+
+void intern_collect(void) {
+    if (intern_size == 0) {
+        return;
+    }
+
+    // removing entries would break the probe sequences => rebuild the table from the surviving symbols
+    BowlValue *const table = calloc(intern_capacity, sizeof(BowlValue));
+    u64 size = 0;
+
+    if (table == NULL) {
+        // interning is merely an optimization => simply forget all symbols
+        memset(intern_table, 0, intern_capacity * sizeof(BowlValue));
+        intern_size = 0;
+        return;
+    }
+
+    for (u64 i = 0; i < intern_capacity; ++i) {
+        if (intern_table[i] != NULL) {
+            const BowlValue symbol = gc_forward(intern_table[i]);
+
+            if (symbol != NULL) {
+                intern_place(table, intern_capacity, symbol);
+                ++size;
+            }
+        }
+    }
+
+    free(intern_table);
+    intern_table = table;
+    intern_size = size;
+}
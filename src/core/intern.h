@@ -0,0 +1,51 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include "../common/utility.h"
+#include <bowl/bowl.h>
+#include <bowl/api.h>
+#include "gc.h"
+#include "text.h"
+
+/**
+ * Computes the hash of a symbol with the provided codepoints.
+ *
+ * The result is equal to the value of 'bowl_value_hash' for such a symbol. The codepoints must
+ * be stored in their smallest width (see 'text_width').
+ * @param bytes The codepoints of the symbol.
+ * @param width The width of the codepoints.
+ * @param length The number of codepoints.
+ * @return The hash of the symbol.
+ */
+u64 intern_hash(const u8 *bytes, u64 width, u64 length);
+
+/**
+ * Looks up the interned symbol with the provided codepoints.
+ *
+ * This function does not allocate. Thus, the codepoints may reside in the heap of the
+ * garbage collector. The codepoints must be stored in their smallest width.
+ * @param bytes The codepoints of the symbol.
+ * @param width The width of the codepoints.
+ * @param length The number of codepoints.
+ * @param hash The hash of the symbol (see 'intern_hash').
+ * @return Either the interned symbol or 'NULL' if there is no such symbol.
+ */
+BowlValue intern_find(const u8 *bytes, u64 width, u64 length, u64 hash);
+
+/**
+ * Adds a symbol to the intern table. There must not be an equal symbol in the table yet.
+ *
+ * The table holds weak references only, i.e., symbols which are not reachable otherwise
+ * are removed by the garbage collector.
+ * @param symbol The symbol whose hash must already be computed.
+ * @return Either 'NULL' or an exception.
+ */
+BowlValue intern_insert(BowlValue symbol);
+
+/**
+ * Updates the intern table after all reachable values were relocated by the garbage
+ * collector and removes all symbols which are no longer reachable.
+ */
+void intern_collect(void);
+
+#endif
@@ -0,0 +1,1064 @@
+#include "json.h"
+#include "core.h"
+#include "map.h"
+#include "sorted.h"
+#include "../syntax/number.h"
+#include <errno.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+// the classes of the bytes of a document
+#define JSON_SPACE 1
+#define JSON_OPERATOR 2
+#define JSON_QUOTE 4
+#define JSON_BACKSLASH 8
+// the number of keys which are remembered while a document is read, such that repeated keys share their string
+#define JSON_KEYS 256
+// the length of the longest key which is remembered
+#define JSON_KEY_LENGTH 32
+
+static const u8 json_classes[256] = {
+    [' '] = JSON_SPACE,
+    ['\t'] = JSON_SPACE,
+    ['\n'] = JSON_SPACE,
+    ['\r'] = JSON_SPACE,
+    ['['] = JSON_OPERATOR,
+    [']'] = JSON_OPERATOR,
+    ['{'] = JSON_OPERATOR,
+    ['}'] = JSON_OPERATOR,
+    [':'] = JSON_OPERATOR,
+    [','] = JSON_OPERATOR,
+    ['"'] = JSON_QUOTE,
+    ['\\'] = JSON_BACKSLASH
+};
+
+typedef struct {
+    const u8 *bytes;
+    u64 length;
+    /** The offset of the first byte which was not indexed yet. */
+    u64 offset;
+    /** All bits are set if the last byte which was indexed is part of a string. */
+    u64 in_string;
+    /** Whether the next byte is escaped by a backslash (either zero or one). */
+    u64 escaped;
+    /** Whether the last byte which was indexed is part of a literal (either zero or one). */
+    u64 scalar;
+    /** The offsets of the structural characters of the current window. */
+    u64 *indices;
+    u64 count;
+    /** The index of the next offset which is returned. */
+    u64 position;
+} JsonIndexer;
+
+typedef enum {
+    /** A value or the end of an empty array is expected. */
+    JsonFirstValueState,
+    /** A value is expected. */
+    JsonValueState,
+    /** A key or the end of an empty object is expected. */
+    JsonFirstKeyState,
+    /** A key is expected. */
+    JsonKeyState,
+    /** The colon between a key and its value is expected. */
+    JsonColonState,
+    /** Either a comma or the end of the current array or object is expected. */
+    JsonSeparatorState,
+    /** The document is complete. */
+    JsonEndState
+} JsonState;
+
+typedef struct {
+    /** Either '[' or '{'. */
+    u8 bracket;
+    /** The index of the first element on the stack of values. */
+    u64 base;
+} JsonPending;
+
+typedef struct {
+    const u8 *bytes;
+    u64 length;
+    /** A buffer for strings with escape sequences. */
+    u8 *buffer;
+    u64 buffer_capacity;
+    /** The reason why the document is malformed (or 'NULL'). */
+    const char *error;
+    u64 error_offset;
+    /** Whether there was not enough memory to read the document. */
+    bool out_of_memory;
+} JsonReader;
+
+typedef enum {
+    /** Writes a value. */
+    JsonValueWork,
+    /** Writes a key and the colon behind it. */
+    JsonKeyWork,
+    /** Writes the end of an array or an object. */
+    JsonCloseWork
+} JsonWorkKind;
+
+typedef struct {
+    JsonWorkKind kind;
+    BowlValue value;
+    /** Whether a comma is written in front of the value or the key. */
+    bool separated;
+    /** The bracket which closes the array or the object. */
+    char bracket;
+} JsonWork;
+
+typedef struct {
+    Output *output;
+    /** The work which is still to be done (the next one is on top). */
+    JsonWork *work;
+    u64 work_length;
+    u64 work_capacity;
+} JsonWriter;
+
+static inline void json_classify(const u8 *block, u64 *backslash, u64 *quote, u64 *space, u64 *operator) {
+    // computes the bit masks of the 64 bytes of a block (the first byte is the least significant bit)
+    *backslash = *quote = *space = *operator = 0;
+
+    #if defined(__SSE2__)
+        const __m128i backslashes = _mm_set1_epi8('\\');
+        const __m128i quotes = _mm_set1_epi8('"');
+        const __m128i blanks = _mm_set1_epi8(' ');
+        const __m128i tabs = _mm_set1_epi8('\t');
+        const __m128i newlines = _mm_set1_epi8('\n');
+        const __m128i returns = _mm_set1_epi8('\r');
+        const __m128i colons = _mm_set1_epi8(':');
+        const __m128i commas = _mm_set1_epi8(',');
+        const __m128i opening = _mm_set1_epi8('{');
+        const __m128i closing = _mm_set1_epi8('}');
+        const __m128i lowercase = _mm_set1_epi8(0x20);
+
+        for (u64 i = 0; i < 4; ++i) {
+            const __m128i chunk = _mm_loadu_si128((const __m128i *) &block[16 * i]);
+            // brackets become braces, whereas no other byte does
+            const __m128i folded = _mm_or_si128(chunk, lowercase);
+            const __m128i spaces = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, blanks), _mm_cmpeq_epi8(chunk, tabs)), _mm_or_si128(_mm_cmpeq_epi8(chunk, newlines), _mm_cmpeq_epi8(chunk, returns)));
+            const __m128i operators = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, opening), _mm_cmpeq_epi8(folded, closing)), _mm_or_si128(_mm_cmpeq_epi8(chunk, colons), _mm_cmpeq_epi8(chunk, commas)));
+
+            *backslash |= (u64) (u16) _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, backslashes)) << (16 * i);
+            *quote |= (u64) (u16) _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quotes)) << (16 * i);
+            *space |= (u64) (u16) _mm_movemask_epi8(spaces) << (16 * i);
+            *operator |= (u64) (u16) _mm_movemask_epi8(operators) << (16 * i);
+        }
+    #else
+        for (u64 i = 0; i < 64; ++i) {
+            const u8 class = json_classes[block[i]];
+            *backslash |= (u64) ((class & JSON_BACKSLASH) != 0) << i;
+            *quote |= (u64) ((class & JSON_QUOTE) != 0) << i;
+            *space |= (u64) ((class & JSON_SPACE) != 0) << i;
+            *operator |= (u64) ((class & JSON_OPERATOR) != 0) << i;
+        }
+    #endif
+}
+
+static inline u64 json_escaped(JsonIndexer *indexer, u64 backslash) {
+    // finds the bytes behind an odd number of backslashes
+    const u64 even = 0x5555555555555555ull;
+    backslash &= ~indexer->escaped;
+
+    const u64 follows = (backslash << 1) | indexer->escaped;
+    // the sequences of backslashes which start at an odd bit are carried one bit further than the others
+    const u64 odd_starts = backslash & ~even & ~follows;
+    u64 even_sequences;
+    indexer->escaped = __builtin_add_overflow(odd_starts, backslash, &even_sequences);
+
+    return (even ^ (even_sequences << 1)) & follows;
+}
+
+static inline u64 json_prefix_xor(u64 bits) {
+    // every bit becomes the parity of itself and all bits below it
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+static void json_index_block(JsonIndexer *indexer, const u8 *block, u64 base) {
+    u64 backslash, quote, space, operator;
+    json_classify(block, &backslash, &quote, &space, &operator);
+    quote &= ~json_escaped(indexer, backslash);
+
+    // the opening quotes and the contents of strings (but not their closing quotes)
+    const u64 in_string = json_prefix_xor(quote) ^ indexer->in_string;
+    indexer->in_string = (u64) ((i64) in_string >> 63);
+
+    const u64 scalar = ~(space | operator | quote);
+    const u64 follows_scalar = (scalar << 1) | indexer->scalar;
+    indexer->scalar = scalar >> 63;
+
+    // operators and the beginnings of strings and literals, unless they are part of a string
+    u64 structural = (operator | quote | (scalar & ~follows_scalar)) & ~(in_string ^ quote);
+
+    while (structural != 0) {
+        indexer->indices[indexer->count++] = base + (u64) __builtin_ctzll(structural);
+        structural &= structural - 1;
+    }
+}
+
+static void json_index(JsonIndexer *indexer) {
+    // indexes the next window, whose size is a multiple of the size of a block
+    const u64 end = MIN(indexer->offset + JSON_WINDOW, indexer->length);
+    indexer->count = 0;
+    indexer->position = 0;
+
+    for (; indexer->offset + 64 <= end; indexer->offset += 64) {
+        json_index_block(indexer, &indexer->bytes[indexer->offset], indexer->offset);
+    }
+
+    if (indexer->offset < end) {
+        // the last block is filled up with spaces
+        u8 block[64];
+        memset(block, ' ', sizeof(block));
+        memcpy(block, &indexer->bytes[indexer->offset], end - indexer->offset);
+        json_index_block(indexer, block, indexer->offset);
+        indexer->offset = end;
+    }
+}
+
+static inline bool json_next(JsonIndexer *indexer, u64 *offset) {
+    while (indexer->position == indexer->count) {
+        if (indexer->offset >= indexer->length) {
+            return false;
+        }
+
+        json_index(indexer);
+    }
+
+    *offset = indexer->indices[indexer->position++];
+    return true;
+}
+
+static inline bool json_is_digit(u8 byte) {
+    return (u8) (byte - '0') < 10;
+}
+
+static inline bool json_is_end(JsonReader *reader, u64 offset) {
+    // literals must be followed by the end of the document, a space or an operator
+    return offset >= reader->length || (json_classes[reader->bytes[offset]] & (JSON_SPACE | JSON_OPERATOR)) != 0;
+}
+
+static inline bool json_fail(JsonReader *reader, const char *error, u64 offset) {
+    reader->error = error;
+    reader->error_offset = offset;
+    return false;
+}
+
+static inline u64 json_find_string_end(const u8 *bytes, u64 offset, u64 length) {
+    // finds the first quote, backslash, or control character
+    #if defined(__SSE2__)
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i control = _mm_set1_epi8(0x1F);
+
+        for (; offset + 16 <= length; offset += 16) {
+            const __m128i chunk = _mm_loadu_si128((const __m128i *) &bytes[offset]);
+            const __m128i controls = _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk);
+            const int mask = _mm_movemask_epi8(_mm_or_si128(controls, _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash))));
+
+            if (mask != 0) {
+                return offset + __builtin_ctz((unsigned) mask);
+            }
+        }
+    #endif
+
+    while (offset < length && bytes[offset] != '"' && bytes[offset] != '\\' && bytes[offset] >= 0x20) {
+        ++offset;
+    }
+
+    return offset;
+}
+
+static bool json_reserve(JsonReader *reader, u64 capacity) {
+    if (capacity > reader->buffer_capacity) {
+        const u64 resized_capacity = MAX(capacity, MAX(reader->buffer_capacity * 2, 256));
+        u8 *const buffer = realloc(reader->buffer, resized_capacity);
+
+        if (buffer == NULL) {
+            reader->out_of_memory = true;
+            return false;
+        }
+
+        reader->buffer = buffer;
+        reader->buffer_capacity = resized_capacity;
+    }
+
+    return true;
+}
+
+static bool json_hexadecimal(JsonReader *reader, u64 offset, u32 *codepoint) {
+    // reads the four hexadecimal digits of an escape sequence
+    *codepoint = 0;
+
+    if (reader->length - offset < 4) {
+        return false;
+    }
+
+    for (u64 i = offset; i < offset + 4; ++i) {
+        const u8 byte = reader->bytes[i];
+        const u8 lower = byte | 0x20;
+
+        if (json_is_digit(byte)) {
+            *codepoint = *codepoint * 16 + (byte - '0');
+        } else if (lower >= 'a' && lower <= 'f') {
+            *codepoint = *codepoint * 16 + (lower - 'a' + 10);
+        } else {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static u64 json_unescape(JsonReader *reader, u64 offset, u8 *target, u64 *written) {
+    // resolves the escape sequence at the offset, stores its UTF-8 encoding and returns the number of bytes it takes (or zero)
+    u32 codepoint;
+
+    if (offset + 1 >= reader->length) {
+        return 0;
+    }
+
+    *written = 1;
+
+    switch (reader->bytes[offset + 1]) {
+        case '"': *target = '"'; return 2;
+        case '\\': *target = '\\'; return 2;
+        case '/': *target = '/'; return 2;
+        case 'b': *target = '\b'; return 2;
+        case 'f': *target = '\f'; return 2;
+        case 'n': *target = '\n'; return 2;
+        case 'r': *target = '\r'; return 2;
+        case 't': *target = '\t'; return 2;
+        case 'u': break;
+        default: return 0;
+    }
+
+    if (!json_hexadecimal(reader, offset + 2, &codepoint)) {
+        return 0;
+    }
+
+    u64 read = 6;
+
+    if (codepoint >= 0xD800 && codepoint <= 0xDBFF) {
+        // a high surrogate must be followed by the escape sequence of a low surrogate
+        u32 low;
+
+        if (offset + 7 >= reader->length || reader->bytes[offset + 6] != '\\' || reader->bytes[offset + 7] != 'u' || !json_hexadecimal(reader, offset + 8, &low) || low < 0xDC00 || low > 0xDFFF) {
+            return 0;
+        }
+
+        codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+        read = 12;
+    } else if (codepoint >= 0xDC00 && codepoint <= 0xDFFF) {
+        return 0;
+    }
+
+    *written = codepoint < 0x80 ? 1 : codepoint < 0x800 ? 2 : codepoint < 0x10000 ? 3 : 4;
+
+    if (codepoint < 0x80) {
+        *target++ = (u8) codepoint;
+    } else if (codepoint < 0x800) {
+        *target++ = (u8) (0xC0 | (codepoint >> 6));
+        *target++ = (u8) (0x80 | (codepoint & 0x3F));
+    } else if (codepoint < 0x10000) {
+        *target++ = (u8) (0xE0 | (codepoint >> 12));
+        *target++ = (u8) (0x80 | ((codepoint >> 6) & 0x3F));
+        *target++ = (u8) (0x80 | (codepoint & 0x3F));
+    } else {
+        *target++ = (u8) (0xF0 | (codepoint >> 18));
+        *target++ = (u8) (0x80 | ((codepoint >> 12) & 0x3F));
+        *target++ = (u8) (0x80 | ((codepoint >> 6) & 0x3F));
+        *target++ = (u8) (0x80 | (codepoint & 0x3F));
+    }
+
+    return read;
+}
+
+static bool json_string(JsonReader *reader, u64 offset, const u8 **bytes, u64 *length) {
+    // finds the contents of the string which starts at the offset, resolving its escape sequences if necessary
+    const u64 start = offset + 1;
+    u64 position = json_find_string_end(reader->bytes, start, reader->length);
+
+    if (position < reader->length && reader->bytes[position] == '"') {
+        *bytes = &reader->bytes[start];
+        *length = position - start;
+        return true;
+    }
+
+    u64 used = 0;
+    u64 run = start;
+
+    for (;;) {
+        if (position >= reader->length) {
+            return json_fail(reader, "unclosed string", offset);
+        } else if (reader->bytes[position] < 0x20) {
+            return json_fail(reader, "control character in a string", position);
+        } else if (!json_reserve(reader, used + (position - run) + 4)) {
+            return false;
+        }
+
+        memcpy(&reader->buffer[used], &reader->bytes[run], position - run);
+        used += position - run;
+
+        if (reader->bytes[position] == '"') {
+            break;
+        }
+
+        u64 written;
+        const u64 read = json_unescape(reader, position, &reader->buffer[used], &written);
+
+        if (read == 0) {
+            return json_fail(reader, "illegal escape sequence", position);
+        }
+
+        used += written;
+        run = position + read;
+        position = json_find_string_end(reader->bytes, run, reader->length);
+    }
+
+    *bytes = reader->buffer;
+    *length = used;
+    return true;
+}
+
+static bool json_number(JsonReader *reader, u64 offset, double *value) {
+    // reads a number of the form -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+    const u8 *const bytes = reader->bytes;
+    const u64 length = reader->length;
+    u64 position = offset;
+    bool negative = false;
+
+    NumberDecimal decimal = {
+        .mantissa = 0,
+        .digits = 0,
+        .exponent = 0,
+        .truncated = false
+    };
+
+    if (bytes[position] == '-') {
+        negative = true;
+        ++position;
+    }
+
+    if (position >= length || !json_is_digit(bytes[position])) {
+        return json_fail(reader, "illegal number", offset);
+    } else if (bytes[position] == '0') {
+        ++position;
+    } else {
+        do {
+            number_decimal_digit(&decimal, bytes[position] - '0', false);
+            ++position;
+        } while (position < length && json_is_digit(bytes[position]));
+    }
+
+    if (position < length && bytes[position] == '.') {
+        ++position;
+
+        if (position >= length || !json_is_digit(bytes[position])) {
+            return json_fail(reader, "illegal number", offset);
+        }
+
+        do {
+            number_decimal_digit(&decimal, bytes[position] - '0', true);
+            ++position;
+        } while (position < length && json_is_digit(bytes[position]));
+    }
+
+    if (position < length && (bytes[position] | 0x20) == 'e') {
+        ++position;
+
+        bool exponent_negative = false;
+
+        if (position < length && (bytes[position] == '-' || bytes[position] == '+')) {
+            exponent_negative = bytes[position] == '-';
+            ++position;
+        }
+
+        if (position >= length || !json_is_digit(bytes[position])) {
+            return json_fail(reader, "illegal number", offset);
+        }
+
+        i64 exponent = 0;
+
+        do {
+            // any exponent beyond this limit overflows or underflows anyway
+            if (exponent < 100000) {
+                exponent = exponent * 10 + (bytes[position] - '0');
+            }
+            ++position;
+        } while (position < length && json_is_digit(bytes[position]));
+
+        decimal.exponent += exponent_negative ? -exponent : exponent;
+    }
+
+    if (!json_is_end(reader, position)) {
+        return json_fail(reader, "illegal number", offset);
+    }
+
+    *value = number_from_literal(&decimal, negative, &bytes[offset], 1, position - offset);
+
+    return true;
+}
+
+static inline bool json_literal(JsonReader *reader, u64 offset, const char *literal, u64 length) {
+    return reader->length - offset >= length && memcmp(&reader->bytes[offset], literal, length) == 0 && json_is_end(reader, offset + length);
+}
+
+static BowlResult json_text(BowlStackFrame *frame, JsonReader *reader, u64 offset, bool key) {
+    // creates the string which starts at the offset (keys are shared with the ones which were read before)
+    BowlResult result = { .failure = false, .value = NULL };
+    const u8 *bytes;
+    u64 length;
+
+    if (!json_string(reader, offset, &bytes, &length)) {
+        return result;
+    }
+
+    const bool remembered = key && bytes != reader->buffer && length <= JSON_KEY_LENGTH;
+    const u64 slot = remembered ? hash_bytes(bytes, length, 0) & (JSON_KEYS - 1) : 0;
+
+    if (remembered) {
+        // a string of single-byte codepoints is equal to the bytes only if they are ASCII
+        const BowlValue known = frame->registers[0]->vector.elements[slot];
+
+        if (known != NULL && known->string.width == 1 && known->string.length == length && memcmp(known->string.bytes, bytes, length) == 0) {
+            result.value = known;
+            return result;
+        }
+    }
+
+    result = bowl_string_utf8(frame, (u8 *) bytes, length);
+
+    if (result.failure && (result.exception == bowl_exception_malformed_utf8 || result.exception == bowl_exception_incomplete_utf8)) {
+        result.failure = false;
+        result.value = NULL;
+        json_fail(reader, "malformed UTF-8 in a string", offset);
+    } else if (!result.failure && remembered && result.value->string.width == 1 && result.value->string.length == length) {
+        frame->registers[0]->vector.elements[slot] = result.value;
+    }
+
+    return result;
+}
+
+static BowlValue json_build(BowlStackFrame *frame, u8 bracket, u64 base, u64 length) {
+    // creates the array or the object from its elements, which is stored in the third register afterwards
+    #define JSON_ELEMENT(index) (frame->registers[1]->vector.elements[base + (index)])
+
+    if (bracket == '[') {
+        frame->registers[2] = NULL;
+
+        for (u64 i = length; i-- > 0;) {
+            BOWL_TRY(&frame->registers[2], bowl_list(frame, JSON_ELEMENT(i), frame->registers[2]));
+        }
+
+        return NULL;
+    }
+
+    BowlStackFrame variables = BOWL_ALLOCATE_STACK_FRAME(frame, NULL, NULL, NULL);
+    BowlMapBuilder builder;
+    BowlValue exception;
+
+    if ((exception = bowl_map_builder_begin(&variables, &builder, &variables.registers[0], NULL, length / 2)) != NULL) {
+        return exception;
+    }
+
+    for (u64 i = 0; i < length; i += 2) {
+        if ((exception = bowl_map_builder_put(&variables, &builder, JSON_ELEMENT(i), JSON_ELEMENT(i + 1))) != NULL) {
+            return exception;
+        }
+    }
+
+    #undef JSON_ELEMENT
+
+    BOWL_TRY(&frame->registers[2], bowl_map_builder_freeze(&variables, &builder));
+    return NULL;
+}
+
+BowlResult bowl_json_parse(BowlStack stack, const u8 *bytes, u64 length) {
+    // the first register holds the keys which were read recently, the second one the values which are not complete yet
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+    BowlResult result = bowl_vector(&frame, NULL, JSON_KEYS);
+
+    if (result.failure) {
+        return result;
+    }
+
+    frame.registers[0] = result.value;
+
+    JsonIndexer indexer = {
+        .bytes = bytes,
+        .length = length,
+        .offset = 0,
+        .in_string = 0,
+        .escaped = 0,
+        .scalar = 0,
+        .indices = malloc(JSON_WINDOW * sizeof(u64)),
+        .count = 0,
+        .position = 0
+    };
+
+    JsonReader reader = {
+        .bytes = bytes,
+        .length = length,
+        .buffer = NULL,
+        .buffer_capacity = 0,
+        .error = NULL,
+        .error_offset = 0,
+        .out_of_memory = false
+    };
+
+    JsonPending *pending = NULL;
+    u64 pending_length = 0, pending_capacity = 0, values_length = 0, offset = 0;
+    JsonState state = JsonValueState;
+    BowlValue exception = indexer.indices == NULL ? bowl_exception_out_of_heap : NULL;
+
+    while (exception == NULL && reader.error == NULL && !reader.out_of_memory && json_next(&indexer, &offset)) {
+        const u8 byte = bytes[offset];
+        const u8 bracket = pending_length > 0 ? pending[pending_length - 1].bracket : 0;
+        bool closed = false;
+
+        result.failure = false;
+        result.value = NULL;
+
+        switch (state) {
+            case JsonEndState:
+                json_fail(&reader, "unexpected character behind the document", offset);
+                continue;
+
+            case JsonSeparatorState:
+                if (byte == ',') {
+                    state = bracket == '[' ? JsonValueState : JsonKeyState;
+                    continue;
+                } else if (byte != (bracket == '[' ? ']' : '}')) {
+                    json_fail(&reader, bracket == '[' ? "expected ',' or ']'" : "expected ',' or '}'", offset);
+                    continue;
+                }
+
+                closed = true;
+                break;
+
+            case JsonColonState:
+                if (byte != ':') {
+                    json_fail(&reader, "expected ':'", offset);
+                } else {
+                    state = JsonValueState;
+                }
+                continue;
+
+            case JsonFirstKeyState:
+            case JsonKeyState:
+                if (byte == '}' && state == JsonFirstKeyState) {
+                    closed = true;
+                } else if (byte != '"') {
+                    json_fail(&reader, "expected a key", offset);
+                    continue;
+                } else {
+                    result = json_text(&frame, &reader, offset, true);
+                    state = JsonColonState;
+                }
+                break;
+
+            case JsonFirstValueState:
+            case JsonValueState:
+                if (byte == ']' && state == JsonFirstValueState) {
+                    closed = true;
+                    break;
+                }
+
+                state = JsonSeparatorState;
+
+                switch (byte) {
+                    case '[':
+                    case '{':
+                        if (pending_length == pending_capacity) {
+                            const u64 capacity = MAX(pending_capacity * 2, 64);
+                            JsonPending *const resized = realloc(pending, capacity * sizeof(JsonPending));
+
+                            if (resized == NULL) {
+                                exception = bowl_exception_out_of_heap;
+                                continue;
+                            }
+
+                            pending = resized;
+                            pending_capacity = capacity;
+                        }
+
+                        pending[pending_length++] = (JsonPending) { .bracket = byte, .base = values_length };
+                        state = byte == '[' ? JsonFirstValueState : JsonFirstKeyState;
+                        continue;
+
+                    case '"':
+                        result = json_text(&frame, &reader, offset, false);
+                        break;
+
+                    case 't':
+                    case 'f':
+                        if (json_literal(&reader, offset, byte == 't' ? "true" : "false", byte == 't' ? 4 : 5)) {
+                            result = bowl_boolean(&frame, byte == 't');
+                        } else {
+                            json_fail(&reader, "illegal literal", offset);
+                        }
+                        break;
+
+                    case 'n':
+                        if (!json_literal(&reader, offset, "null", 4)) {
+                            json_fail(&reader, "illegal literal", offset);
+                        }
+                        break;
+
+                    default:
+                        {
+                            double number;
+
+                            if (byte == '-' || json_is_digit(byte)) {
+                                if (json_number(&reader, offset, &number)) {
+                                    result = bowl_number(&frame, number);
+                                }
+                            } else {
+                                json_fail(&reader, "unexpected character", offset);
+                            }
+                        }
+                        break;
+                }
+                break;
+        }
+
+        if (reader.error != NULL || reader.out_of_memory) {
+            continue;
+        } else if (result.failure) {
+            exception = result.exception;
+            continue;
+        }
+
+        if (closed) {
+            // the elements of the array or the object are replaced by the value itself
+            const u64 base = pending[--pending_length].base;
+
+            if ((exception = json_build(&frame, bracket, base, values_length - base)) != NULL) {
+                continue;
+            }
+
+            for (u64 i = base; i < values_length; ++i) {
+                frame.registers[1]->vector.elements[i] = NULL;
+            }
+
+            values_length = base;
+            state = JsonSeparatorState;
+        } else {
+            frame.registers[2] = result.value;
+        }
+
+        if ((exception = bowl_vector_reserve(&frame, 1, values_length, 1)) != NULL) {
+            continue;
+        }
+
+        frame.registers[1]->vector.elements[values_length++] = frame.registers[2];
+
+        if (pending_length == 0) {
+            state = JsonEndState;
+        }
+    }
+
+    free(indexer.indices);
+    free(reader.buffer);
+    free(pending);
+
+    if (exception == NULL && reader.error == NULL && !reader.out_of_memory && state != JsonEndState) {
+        json_fail(&reader, "unexpected end of the document", length);
+    }
+
+    if (reader.out_of_memory) {
+        result.failure = true;
+        result.exception = bowl_exception_out_of_heap;
+    } else if (exception != NULL) {
+        result.failure = true;
+        result.exception = exception;
+    } else if (reader.error != NULL) {
+        result = bowl_format_exception(&frame, "malformed JSON (%s at byte %" PRIu64 ")", reader.error, reader.error_offset);
+        result.failure = true;
+    } else {
+        result.failure = false;
+        result.value = frame.registers[1]->vector.elements[0];
+    }
+
+    return result;
+}
+
+static JsonWork *json_work(JsonWriter *writer, u64 length) {
+    // returns the first of 'length' new work items on top of the others
+    if (writer->work_length + length > writer->work_capacity) {
+        const u64 capacity = MAX(writer->work_capacity * 2, writer->work_length + length);
+        JsonWork *const work = realloc(writer->work, capacity * sizeof(JsonWork));
+
+        if (work == NULL) {
+            return NULL;
+        }
+
+        writer->work = work;
+        writer->work_capacity = capacity;
+    }
+
+    JsonWork *const first = &writer->work[writer->work_length];
+    writer->work_length += length;
+    return first;
+}
+
+static bool json_write_escape(Output *output, u32 codepoint) {
+    static const char digits[] = "0123456789abcdef";
+    char sequence[6] = { '\\', 'u', '0', '0', digits[(codepoint >> 4) & 0xF], digits[codepoint & 0xF] };
+
+    switch (codepoint) {
+        case '"': return output_write(output, "\\\"", 2);
+        case '\\': return output_write(output, "\\\\", 2);
+        case '\b': return output_write(output, "\\b", 2);
+        case '\f': return output_write(output, "\\f", 2);
+        case '\n': return output_write(output, "\\n", 2);
+        case '\r': return output_write(output, "\\r", 2);
+        case '\t': return output_write(output, "\\t", 2);
+        default: return output_write(output, sequence, sizeof(sequence));
+    }
+}
+
+static bool json_write_text(Output *output, BowlValue text) {
+    // the codepoints are written as they are, except for quotes, backslashes and control characters
+    TextReader reader = text_reader(text, 0);
+    const u8 *bytes;
+    u64 width, length;
+    bool success = output_write(output, "\"", 1);
+
+    while (success && text_reader_next(&reader, &bytes, &width, &length)) {
+        u64 start = 0;
+
+        for (u64 i = 0; i < length && success; ++i) {
+            const u32 codepoint = TEXT_AT(bytes, width, i);
+
+            if (codepoint >= 0x20 && codepoint != '"' && codepoint != '\\') {
+                continue;
+            }
+
+            success = output_text(output, &bytes[start * width], width, i - start) && json_write_escape(output, codepoint);
+            start = i + 1;
+        }
+
+        success = success && output_text(output, &bytes[start * width], width, length - start);
+    }
+
+    return success && output_write(output, "\"", 1);
+}
+
+static bool json_write_value(JsonWriter *writer, BowlValue value, BowlValue *failure) {
+    Output *const output = writer->output;
+    JsonWork *work;
+    u64 length;
+
+    if (value == NULL) {
+        return output_write(output, "null", 4);
+    }
+
+    // the elements are pushed in reverse order, such that the first one is written first
+    switch (value->type) {
+        case BowlBooleanValue:
+            return value->boolean.value ? output_write(output, "true", 4) : output_write(output, "false", 5);
+
+        case BowlNumberValue:
+            if (!isfinite(value->number.value)) {
+                *failure = value;
+                return false;
+            }
+
+            return output_number(output, value->number.value);
+
+        case BowlSymbolValue:
+        case BowlStringValue:
+            return json_write_text(output, value);
+
+        case BowlListValue:
+            length = 0;
+
+            for (BowlValue node = value; node != NULL; node = node->list.tail) {
+                ++length;
+            }
+
+            if ((work = json_work(writer, length + 1)) == NULL) {
+                return false;
+            }
+
+            work[0] = (JsonWork) { .kind = JsonCloseWork, .value = NULL, .separated = false, .bracket = ']' };
+
+            for (BowlValue node = value; node != NULL; node = node->list.tail) {
+                work[length] = (JsonWork) { .kind = JsonValueWork, .value = node->list.head, .separated = node != value, .bracket = 0 };
+                --length;
+            }
+
+            return output_write(output, "[", 1);
+
+        case BowlVectorValue:
+            length = value->vector.length;
+
+            if ((work = json_work(writer, length + 1)) == NULL) {
+                return false;
+            }
+
+            work[0] = (JsonWork) { .kind = JsonCloseWork, .value = NULL, .separated = false, .bracket = ']' };
+
+            for (u64 i = 0; i < length; ++i) {
+                work[length - i] = (JsonWork) { .kind = JsonValueWork, .value = value->vector.elements[i], .separated = i > 0, .bracket = 0 };
+            }
+
+            return output_write(output, "[", 1);
+
+        case BowlMapValue:
+        case BowlSortedMapValue:
+            {
+                length = value->map.length;
+
+                if ((work = json_work(writer, 2 * length + 1)) == NULL) {
+                    return false;
+                }
+
+                work[0] = (JsonWork) { .kind = JsonCloseWork, .value = NULL, .separated = false, .bracket = '}' };
+
+                BowlValue root = value;
+                MapIterator iterator;
+                BowlSortedMapCursor cursor;
+                BowlValue key, element;
+                u64 i = 2 * length;
+
+                if (value->type == BowlMapValue) {
+                    iterator = map_iterator(value);
+                } else {
+                    cursor = bowl_sorted_map_cursor(&root);
+                }
+
+                while (i > 0 && (value->type == BowlMapValue ? map_iterator_next(&iterator, &key, &element) : bowl_sorted_map_cursor_next(&cursor, &key, &element))) {
+                    if (key == NULL || (key->type != BowlStringValue && key->type != BowlSymbolValue)) {
+                        *failure = value;
+                        return false;
+                    }
+
+                    // every pair but the first one is preceded by a comma
+                    work[i] = (JsonWork) { .kind = JsonKeyWork, .value = key, .separated = i < 2 * length, .bracket = 0 };
+                    work[i - 1] = (JsonWork) { .kind = JsonValueWork, .value = element, .separated = false, .bracket = 0 };
+                    i -= 2;
+                }
+
+                return output_write(output, "{", 1);
+            }
+
+        default:
+            // exceptions, native functions and libraries have no counterpart in JSON
+            *failure = value;
+            return false;
+    }
+}
+
+bool json_write(Output *output, BowlValue value, BowlValue *failure) {
+    // nothing is allocated in the heap, thus the values do not move
+    JsonWriter writer = {
+        .output = output,
+        .work = NULL,
+        .work_length = 0,
+        .work_capacity = 0
+    };
+
+    *failure = NULL;
+
+    JsonWork *const first = json_work(&writer, 1);
+    bool success = first != NULL;
+
+    if (success) {
+        *first = (JsonWork) { .kind = JsonValueWork, .value = value, .separated = false, .bracket = 0 };
+    }
+
+    while (success && writer.work_length > 0) {
+        const JsonWork work = writer.work[--writer.work_length];
+
+        if (work.separated && !output_write(output, ",", 1)) {
+            success = false;
+            break;
+        }
+
+        switch (work.kind) {
+            case JsonValueWork:
+                success = json_write_value(&writer, work.value, failure);
+                break;
+
+            case JsonKeyWork:
+                success = json_write_text(output, work.value) && output_write(output, ":", 1);
+                break;
+
+            case JsonCloseWork:
+                success = output_write(output, &work.bracket, 1);
+                break;
+        }
+    }
+
+    free(writer.work);
+
+    return success && !output->failure;
+}
+
+static BowlValue json_failure(BowlStack stack, Output *output, BowlValue failure) {
+    if (failure != NULL && failure->type == BowlNumberValue) {
+        return bowl_format_exception(stack, "failed to convert the number %g into JSON", failure->number.value).value;
+    } else if (failure != NULL && (failure->type == BowlMapValue || failure->type == BowlSortedMapValue)) {
+        return bowl_format_exception(stack, "failed to convert a map into JSON (its keys must be strings or symbols)").value;
+    } else if (failure != NULL) {
+        return bowl_format_exception(stack, "failed to convert a value of type '%s' into JSON", bowl_value_type(failure)).value;
+    } else if (output->failure && errno != ENOMEM && errno != 0) {
+        return bowl_format_exception(stack, "failed to write the JSON document (%s)", strerror(errno)).value;
+    } else {
+        return bowl_exception_out_of_heap;
+    }
+}
+
+BowlValue bowl_json_emit(BowlStack stack, BowlValue value, u8 **bytes, u64 *length) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, value, NULL, NULL);
+    BowlValue failure;
+    Output output;
+
+    *bytes = NULL;
+    *length = 0;
+
+    if (!output_buffer(&output, OUTPUT_CAPACITY)) {
+        return bowl_exception_out_of_heap;
+    }
+
+    if (!json_write(&output, frame.registers[0], &failure)) {
+        free(output.bytes);
+        errno = ENOMEM;
+        return json_failure(&frame, &output, failure);
+    }
+
+    *bytes = (u8 *) output.bytes;
+    *length = output.length;
+    return NULL;
+}
+
+BowlValue bowl_json_emit_stream(BowlStack stack, BowlValue value, FILE *stream) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, value, NULL, NULL);
+    BowlValue failure;
+    Output output;
+
+    errno = 0;
+    output_stream(&output, stream);
+
+    const bool success = json_write(&output, frame.registers[0], &failure);
+
+    if (success) {
+        output_flush(&output);
+    }
+
+    if (!success || output.failure) {
+        return json_failure(&frame, &output, failure);
+    }
+
+    return NULL;
+}
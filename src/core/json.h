@@ -0,0 +1,62 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include "../common/utility.h"
+#include <bowl/bowl.h>
+#include <bowl/api.h>
+#include "output.h"
+
+/*
+ * JSON documents are read in two stages, following the design of simdjson. The first stage
+ * classifies the bytes 64 at a time and collects the offsets of all structural characters (i.e.,
+ * brackets, braces, colons, commas, and the beginnings of strings and literals), skipping the
+ * contents of strings by means of bit masks. The second stage walks over these offsets and builds
+ * the values without any recursion.
+ *
+ * Objects are read into maps with string keys, arrays into lists, and 'null' into the empty list
+ * (such that 'null' and '[]' cannot be told apart). Vectors are written as arrays, and sorted maps
+ * as objects. Numbers which are not finite, exceptions, native functions and libraries cannot be
+ * written, and neither can maps whose keys are not strings or symbols.
+ */
+
+// the number of bytes which are indexed at once by the first stage
+#define JSON_WINDOW 16384
+
+/**
+ * Writes a value as JSON into a buffer (which is flushed into its stream or grows as required).
+ * @param output The buffer.
+ * @param value The value.
+ * @param failure Is set to the value which cannot be written (if any).
+ * @return Either 'true' on success, or 'false' if the value cannot be written or the buffer failed.
+ */
+bool json_write(Output *output, BowlValue value, BowlValue *failure);
+
+/**
+ * Reads a JSON document from UTF-8 encoded bytes.
+ * @param stack The stack of the current environment.
+ * @param bytes The bytes (e.g., a file which is mapped into memory).
+ * @param length The number of bytes.
+ * @return Either the value of the document or an exception.
+ */
+BowlResult bowl_json_parse(BowlStack stack, const u8 *bytes, u64 length);
+
+/**
+ * Writes a value as a JSON document into a newly allocated buffer.
+ * @param stack The stack of the current environment.
+ * @param value The value.
+ * @param bytes The location where the buffer should be stored (which must be released using 'free').
+ * @param length The location where the number of bytes should be stored.
+ * @return Either an exception or 'NULL' on success.
+ */
+BowlValue bowl_json_emit(BowlStack stack, BowlValue value, u8 **bytes, u64 *length);
+
+/**
+ * Writes a value as a JSON document into a stream, without collecting the whole document in memory.
+ * @param stack The stack of the current environment.
+ * @param value The value.
+ * @param stream The stream.
+ * @return Either an exception or 'NULL' on success.
+ */
+BowlValue bowl_json_emit_stream(BowlStack stack, BowlValue value, FILE *stream);
+
+#endif
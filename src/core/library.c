@@ -36,13 +36,7 @@ static inline void library_remove_entry(BowlLibraryMapBucket *bucket, u64 index)
 }
 
 static inline u64 library_hash(u8 *bytes, u64 length) {
-    register u64 hash = 31;
-
-    for (u64 i = 0; i < length; ++i) {
-        hash += pow(bytes[i] * 31, length - (i + 1));
-    }
-
-    return hash;
+    return hash_bytes(bytes, length, hash_seed());
 }
 
 static inline u64 library_equals(u8 *a, u64 a_length, u8 *b, u64 b_length) {
@@ -0,0 +1,936 @@
+#include "map.h"
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+static inline u64 map_popcount(u32 bits) {
+    #if defined(__GNUC__)
+        return (u64) __builtin_popcount(bits);
+    #else
+        u64 count = 0;
+        while (bits != 0) {
+            bits &= bits - 1;
+            ++count;
+        }
+        return count;
+    #endif
+}
+
+static inline u32 map_data_bitmap(BowlValue node) {
+    return (u32) node->map.capacity;
+}
+
+static inline u32 map_node_bitmap(BowlValue node) {
+    return (u32) (node->map.capacity >> 32);
+}
+
+static inline bool map_is_flat(BowlValue node) {
+    return node->map.capacity == 0;
+}
+
+static inline u64 map_hash(BowlValue key) {
+    // the hashes are well distributed in all bits, thus the trie can consume the lower bits first
+    return bowl_value_hash(key);
+}
+
+static inline u32 map_fragment(u64 hash, u64 shift) {
+    return (u32) ((hash >> shift) & MAP_MASK);
+}
+
+static inline u64 map_data_index(BowlValue node, u32 bit) {
+    return map_popcount(map_data_bitmap(node) & (bit - 1));
+}
+
+static inline u64 map_child_index(BowlValue node, u32 bit) {
+    return 2 * map_popcount(map_data_bitmap(node)) + map_popcount(map_node_bitmap(node) & (bit - 1));
+}
+
+static inline u32 map_fingerprint(u64 hash) {
+    return (u32) hash;
+}
+
+static inline u64 map_flat_lane_slots(u64 length) {
+    // two fingerprints share a single slot
+    return (length + 1) / 2;
+}
+
+static inline u32 *map_flat_lane(BowlValue node) {
+    return (u32 *) &node->map.buckets[0];
+}
+
+static inline BowlValue *map_node_pairs(BowlValue node) {
+    if (map_is_flat(node)) {
+        return &node->map.buckets[map_flat_lane_slots(node->map.length)];
+    } else {
+        return &node->map.buckets[0];
+    }
+}
+
+u64 map_node_pair_count(BowlValue node) {
+    if (map_is_flat(node)) {
+        return node->map.length;
+    } else {
+        return map_popcount(map_data_bitmap(node));
+    }
+}
+
+static inline u64 map_node_child_count(BowlValue node) {
+    return map_popcount(map_node_bitmap(node));
+}
+
+u64 map_node_slots(BowlValue node) {
+    if (map_is_flat(node)) {
+        return map_flat_lane_slots(node->map.length) + 2 * node->map.length;
+    } else {
+        return 2 * map_popcount(map_data_bitmap(node)) + map_popcount(map_node_bitmap(node));
+    }
+}
+
+BowlValue *map_node_references(BowlValue node, u64 *length) {
+    if (map_is_flat(node)) {
+        *length = 2 * node->map.length;
+    } else {
+        *length = map_node_slots(node);
+    }
+
+    return map_node_pairs(node);
+}
+
+static BowlResult map_node_allocate(BowlStack stack, u32 data_bitmap, u32 node_bitmap, u64 length, u64 slots) {
+    BowlResult result = gc_allocate(stack, BowlMapValue, slots * sizeof(BowlValue));
+
+    if (!result.failure) {
+        result.value->map.capacity = ((u64) node_bitmap << 32) | data_bitmap;
+        result.value->map.length = length;
+    }
+
+    return result;
+}
+
+static BowlResult map_flat_allocate(BowlStack stack, u64 length) {
+    BowlResult result = map_node_allocate(stack, 0, 0, length, map_flat_lane_slots(length) + 2 * length);
+
+    if (!result.failure && length % 2 == 1) {
+        // clear the unused half of the last fingerprint slot
+        map_flat_lane(result.value)[length] = 0;
+    }
+
+    return result;
+}
+
+static u64 map_flat_find(BowlValue node, BowlValue key, u64 hash) {
+    const u32 *const lane = map_flat_lane(node);
+    const BowlValue *const pairs = map_node_pairs(node);
+    const u32 fingerprint = map_fingerprint(hash);
+    const u64 length = node->map.length;
+    u64 i = 0;
+
+    #if defined(__SSE2__)
+        // compare four fingerprints at once (reading past the lane is fine since the pairs follow)
+        const __m128i needle = _mm_set1_epi32((int) fingerprint);
+
+        for (; i < length; i += 4) {
+            const __m128i candidates = _mm_loadu_si128((const __m128i *) &lane[i]);
+            u32 matches = (u32) _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(candidates, needle)));
+
+            if (length - i < 4) {
+                matches &= ((u32) 1 << (length - i)) - 1;
+            }
+
+            while (matches != 0) {
+                const u64 index = i + (u64) __builtin_ctz(matches);
+
+                if (bowl_value_equals(key, pairs[2 * index])) {
+                    return index;
+                }
+
+                matches &= matches - 1;
+            }
+        }
+    #else
+        for (; i < length; ++i) {
+            if (lane[i] == fingerprint && bowl_value_equals(key, pairs[2 * i])) {
+                return i;
+            }
+        }
+    #endif
+
+    return (u64) -1;
+}
+
+static BowlResult map_node_pair(BowlStack stack, BowlValue key1, BowlValue value1, u64 hash1, BowlValue key2, BowlValue value2, u64 hash2, u64 shift) {
+    BowlStackFrame first = BOWL_ALLOCATE_STACK_FRAME(stack, key1, value1, NULL);
+    BowlStackFrame second = BOWL_ALLOCATE_STACK_FRAME(&first, key2, value2, NULL);
+    BowlResult result;
+
+    if (shift >= 64) {
+        // the hashes are equal => create a flat node that holds both pairs
+        result = map_flat_allocate(&second, 2);
+
+        if (!result.failure) {
+            BowlValue *const pairs = map_node_pairs(result.value);
+            map_flat_lane(result.value)[0] = map_fingerprint(hash1);
+            map_flat_lane(result.value)[1] = map_fingerprint(hash2);
+            pairs[0] = first.registers[0];
+            pairs[1] = first.registers[1];
+            pairs[2] = second.registers[0];
+            pairs[3] = second.registers[1];
+        }
+
+        return result;
+    }
+
+    const u32 fragment1 = map_fragment(hash1, shift);
+    const u32 fragment2 = map_fragment(hash2, shift);
+
+    if (fragment1 == fragment2) {
+        result = map_node_pair(&second, first.registers[0], first.registers[1], hash1, second.registers[0], second.registers[1], hash2, shift + MAP_BITS);
+
+        if (result.failure) {
+            return result;
+        }
+
+        first.registers[2] = result.value;
+        result = map_node_allocate(&second, 0, (u32) 1 << fragment1, 2, 1);
+
+        if (!result.failure) {
+            result.value->map.buckets[0] = first.registers[2];
+        }
+    } else {
+        result = map_node_allocate(&second, ((u32) 1 << fragment1) | ((u32) 1 << fragment2), 0, 2, 4);
+
+        if (!result.failure) {
+            const u64 index1 = fragment1 < fragment2 ? 0 : 2;
+            const u64 index2 = 2 - index1;
+            result.value->map.buckets[index1] = first.registers[0];
+            result.value->map.buckets[index1 + 1] = first.registers[1];
+            result.value->map.buckets[index2] = second.registers[0];
+            result.value->map.buckets[index2 + 1] = second.registers[1];
+        }
+    }
+
+    return result;
+}
+
+static BowlResult map_flat_put(BowlStack stack, BowlValue node, BowlValue key, BowlValue value, u64 hash, bool *added) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, node, key, value);
+    BowlResult result;
+    const u64 length = node->map.length;
+    const u64 index = map_flat_find(node, key, hash);
+
+    if (index != (u64) -1) {
+        if (map_node_pairs(node)[2 * index + 1] == value) {
+            result.failure = false;
+            result.value = node;
+            return result;
+        }
+
+        // replace the value of the existing pair
+        result = map_flat_allocate(&frame, length);
+
+        if (!result.failure) {
+            memcpy(result.value->map.buckets, frame.registers[0]->map.buckets, map_node_slots(frame.registers[0]) * sizeof(BowlValue));
+            map_node_pairs(result.value)[2 * index + 1] = frame.registers[2];
+        }
+
+        return result;
+    }
+
+    result = map_flat_allocate(&frame, length + 1);
+
+    if (!result.failure) {
+        BowlValue *const pairs = map_node_pairs(result.value);
+
+        memcpy(map_flat_lane(result.value), map_flat_lane(frame.registers[0]), length * sizeof(u32));
+        map_flat_lane(result.value)[length] = map_fingerprint(hash);
+        memcpy(pairs, map_node_pairs(frame.registers[0]), 2 * length * sizeof(BowlValue));
+        pairs[2 * length] = frame.registers[1];
+        pairs[2 * length + 1] = frame.registers[2];
+        *added = true;
+    }
+
+    return result;
+}
+
+static BowlResult map_node_put(BowlStack stack, BowlValue node, BowlValue key, BowlValue value, u64 hash, u64 shift, bool *added);
+
+static BowlResult map_flat_expand(BowlStack stack, BowlValue node, BowlValue key, BowlValue value, u64 hash, bool *added) {
+    BowlStackFrame arguments = BOWL_ALLOCATE_STACK_FRAME(stack, node, key, value);
+    BowlStackFrame variables = BOWL_ALLOCATE_STACK_FRAME(&arguments, NULL, NULL, NULL);
+
+    // start the trie with the new pair and move all pairs of the flat node into it
+    BowlResult result = map_node_allocate(&variables, (u32) 1 << map_fragment(hash, 0), 0, 1, 2);
+
+    if (result.failure) {
+        return result;
+    }
+
+    result.value->map.buckets[0] = arguments.registers[1];
+    result.value->map.buckets[1] = arguments.registers[2];
+    variables.registers[0] = result.value;
+
+    for (u64 i = 0, end = arguments.registers[0]->map.length; i < end; ++i) {
+        const BowlValue *const pairs = map_node_pairs(arguments.registers[0]);
+        bool unused = false;
+
+        result = map_node_put(&variables, variables.registers[0], pairs[2 * i], pairs[2 * i + 1], map_hash(pairs[2 * i]), 0, &unused);
+
+        if (result.failure) {
+            return result;
+        }
+
+        variables.registers[0] = result.value;
+    }
+
+    *added = true;
+
+    return result;
+}
+
+static BowlResult map_node_put(BowlStack stack, BowlValue node, BowlValue key, BowlValue value, u64 hash, u64 shift, bool *added) {
+    BowlStackFrame arguments = BOWL_ALLOCATE_STACK_FRAME(stack, node, key, value);
+    BowlStackFrame variables = BOWL_ALLOCATE_STACK_FRAME(&arguments, NULL, NULL, NULL);
+    BowlResult result;
+
+    if (map_is_flat(node)) {
+        // small maps stay flat, whereas flat nodes below the maximum depth hold colliding keys
+        if (shift >= 64 || node->map.length < MAP_FLAT_LIMIT || map_flat_find(node, key, hash) != (u64) -1) {
+            return map_flat_put(&variables, node, key, value, hash, added);
+        } else {
+            return map_flat_expand(&variables, node, key, value, hash, added);
+        }
+    }
+
+    const u32 bit = (u32) 1 << map_fragment(hash, shift);
+    const u64 slots = map_node_slots(node);
+
+    if (map_data_bitmap(node) & bit) {
+        const u64 index = 2 * map_data_index(node, bit);
+        const BowlValue existing = node->map.buckets[index];
+
+        if (bowl_value_equals(existing, key)) {
+            if (node->map.buckets[index + 1] == value) {
+                result.failure = false;
+                result.value = node;
+                return result;
+            }
+
+            // replace the value of the existing pair
+            result = map_node_allocate(&variables, map_data_bitmap(node), map_node_bitmap(node), node->map.length, slots);
+
+            if (!result.failure) {
+                memcpy(result.value->map.buckets, arguments.registers[0]->map.buckets, slots * sizeof(BowlValue));
+                result.value->map.buckets[index + 1] = arguments.registers[2];
+            }
+
+            return result;
+        }
+
+        // move both pairs into a new child node
+        result = map_node_pair(
+            &variables,
+            existing,
+            node->map.buckets[index + 1],
+            map_hash(existing),
+            key,
+            value,
+            hash,
+            shift + MAP_BITS
+        );
+
+        if (result.failure) {
+            return result;
+        }
+
+        variables.registers[0] = result.value;
+        node = arguments.registers[0];
+        result = map_node_allocate(&variables, map_data_bitmap(node) & ~bit, map_node_bitmap(node) | bit, node->map.length + 1, slots - 1);
+
+        if (!result.failure) {
+            const BowlValue *const source = arguments.registers[0]->map.buckets;
+            BowlValue *const destination = result.value->map.buckets;
+            const u64 child = map_child_index(result.value, bit);
+
+            // the pair is removed from the data section and the child is inserted into the node section
+            memcpy(&destination[0], &source[0], index * sizeof(BowlValue));
+            memcpy(&destination[index], &source[index + 2], (child - index) * sizeof(BowlValue));
+            destination[child] = variables.registers[0];
+            memcpy(&destination[child + 1], &source[child + 2], (slots - child - 2) * sizeof(BowlValue));
+            *added = true;
+        }
+
+        return result;
+    } else if (map_node_bitmap(node) & bit) {
+        const u64 index = map_child_index(node, bit);
+        bool child_added = false;
+
+        result = map_node_put(&variables, node->map.buckets[index], key, value, hash, shift + MAP_BITS, &child_added);
+
+        if (result.failure || result.value == arguments.registers[0]->map.buckets[index]) {
+            if (!result.failure) {
+                result.value = arguments.registers[0];
+            }
+
+            return result;
+        }
+
+        variables.registers[0] = result.value;
+        node = arguments.registers[0];
+        result = map_node_allocate(&variables, map_data_bitmap(node), map_node_bitmap(node), node->map.length + (child_added ? 1 : 0), slots);
+
+        if (!result.failure) {
+            memcpy(result.value->map.buckets, arguments.registers[0]->map.buckets, slots * sizeof(BowlValue));
+            result.value->map.buckets[index] = variables.registers[0];
+            *added = child_added;
+        }
+
+        return result;
+    } else {
+        // insert a new pair into the data section
+        const u64 index = 2 * map_data_index(node, bit);
+        result = map_node_allocate(&variables, map_data_bitmap(node) | bit, map_node_bitmap(node), node->map.length + 1, slots + 2);
+
+        if (!result.failure) {
+            const BowlValue *const source = arguments.registers[0]->map.buckets;
+            BowlValue *const destination = result.value->map.buckets;
+
+            memcpy(&destination[0], &source[0], index * sizeof(BowlValue));
+            destination[index] = arguments.registers[1];
+            destination[index + 1] = arguments.registers[2];
+            memcpy(&destination[index + 2], &source[index], (slots - index) * sizeof(BowlValue));
+            *added = true;
+        }
+
+        return result;
+    }
+}
+
+static BowlResult map_node_delete(BowlStack stack, BowlValue node, BowlValue key, u64 hash, u64 shift) {
+    BowlStackFrame arguments = BOWL_ALLOCATE_STACK_FRAME(stack, node, key, NULL);
+    BowlResult result = {
+        .failure = false,
+        .value = node
+    };
+
+    if (map_is_flat(node)) {
+        const u64 length = node->map.length;
+        const u64 i = map_flat_find(node, key, hash);
+
+        if (i == (u64) -1) {
+            return result;
+        }
+
+        result = map_flat_allocate(&arguments, length - 1);
+
+        if (!result.failure) {
+            const u32 *const lane = map_flat_lane(arguments.registers[0]);
+            const BowlValue *const source = map_node_pairs(arguments.registers[0]);
+            BowlValue *const destination = map_node_pairs(result.value);
+
+            memcpy(&map_flat_lane(result.value)[0], &lane[0], i * sizeof(u32));
+            memcpy(&map_flat_lane(result.value)[i], &lane[i + 1], (length - i - 1) * sizeof(u32));
+            memcpy(&destination[0], &source[0], 2 * i * sizeof(BowlValue));
+            memcpy(&destination[2 * i], &source[2 * (i + 1)], 2 * (length - i - 1) * sizeof(BowlValue));
+        }
+
+        return result;
+    }
+
+    const u32 bit = (u32) 1 << map_fragment(hash, shift);
+    const u64 slots = map_node_slots(node);
+
+    if (map_data_bitmap(node) & bit) {
+        const u64 index = 2 * map_data_index(node, bit);
+
+        if (!bowl_value_equals(node->map.buckets[index], key)) {
+            return result;
+        }
+
+        if (node->map.length == 1) {
+            // the last pair of the map was removed
+            return map_flat_allocate(&arguments, 0);
+        }
+
+        result = map_node_allocate(&arguments, map_data_bitmap(node) & ~bit, map_node_bitmap(node), node->map.length - 1, slots - 2);
+
+        if (!result.failure) {
+            const BowlValue *const source = arguments.registers[0]->map.buckets;
+            memcpy(&result.value->map.buckets[0], &source[0], index * sizeof(BowlValue));
+            memcpy(&result.value->map.buckets[index], &source[index + 2], (slots - index - 2) * sizeof(BowlValue));
+        }
+
+        return result;
+    } else if (map_node_bitmap(node) & bit) {
+        const u64 index = map_child_index(node, bit);
+
+        result = map_node_delete(&arguments, node->map.buckets[index], key, hash, shift + MAP_BITS);
+
+        if (result.failure || result.value == arguments.registers[0]->map.buckets[index]) {
+            if (!result.failure) {
+                result.value = arguments.registers[0];
+            }
+
+            return result;
+        }
+
+        arguments.registers[2] = result.value;
+        node = arguments.registers[0];
+
+        if (arguments.registers[2]->map.length == 1) {
+            // a child with a single pair is not allowed => move the pair into this node
+            const u64 data = 2 * map_data_index(node, bit);
+            result = map_node_allocate(&arguments, map_data_bitmap(node) | bit, map_node_bitmap(node) & ~bit, node->map.length - 1, slots + 1);
+
+            if (!result.failure) {
+                const BowlValue *const source = arguments.registers[0]->map.buckets;
+                BowlValue *const destination = result.value->map.buckets;
+
+                memcpy(&destination[0], &source[0], data * sizeof(BowlValue));
+                destination[data] = map_node_pairs(arguments.registers[2])[0];
+                destination[data + 1] = map_node_pairs(arguments.registers[2])[1];
+                memcpy(&destination[data + 2], &source[data], (index - data) * sizeof(BowlValue));
+                memcpy(&destination[index + 2], &source[index + 1], (slots - index - 1) * sizeof(BowlValue));
+            }
+        } else {
+            result = map_node_allocate(&arguments, map_data_bitmap(node), map_node_bitmap(node), node->map.length - 1, slots);
+
+            if (!result.failure) {
+                memcpy(result.value->map.buckets, arguments.registers[0]->map.buckets, slots * sizeof(BowlValue));
+                result.value->map.buckets[index] = arguments.registers[2];
+            }
+        }
+
+        return result;
+    } else {
+        return result;
+    }
+}
+
+static BowlResult map_put_all(BowlStack stack, BowlValue map, BowlValue node, bool overwrite) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, map, node, NULL);
+    BowlResult result = {
+        .failure = false,
+        .value = map
+    };
+
+    const u64 pairs = map_node_pair_count(node);
+    const u64 children = map_is_flat(node) ? 0 : map_node_child_count(node);
+
+    for (u64 i = 0; i < pairs; ++i) {
+        const BowlValue key = map_node_pairs(frame.registers[1])[2 * i];
+
+        if (!overwrite && bowl_map_get_or_else(frame.registers[0], key, bowl_sentinel_value) != bowl_sentinel_value) {
+            continue;
+        }
+
+        result = bowl_map_put(&frame, frame.registers[0], key, map_node_pairs(frame.registers[1])[2 * i + 1]);
+
+        if (result.failure) {
+            return result;
+        }
+
+        frame.registers[0] = result.value;
+    }
+
+    for (u64 i = 0; i < children; ++i) {
+        result = map_put_all(&frame, frame.registers[0], frame.registers[1]->map.buckets[2 * pairs + i], overwrite);
+
+        if (result.failure) {
+            return result;
+        }
+
+        frame.registers[0] = result.value;
+    }
+
+    result.value = frame.registers[0];
+    result.failure = false;
+
+    return result;
+}
+
+typedef struct {
+    /** The fragments of the hash in the order in which they are consumed by the trie. */
+    u64 order;
+    /** The hash of the key. */
+    u64 hash;
+    /** The index of the pair in the builder. */
+    u64 index;
+} MapBuilderEntry;
+
+static inline u64 map_order(u64 hash) {
+    u64 order = 0;
+
+    for (u64 shift = 0; shift < 64; shift += MAP_BITS) {
+        const u64 bits = MIN(MAP_BITS, 64 - shift);
+        order = (order << bits) | ((hash >> shift) & ((1 << bits) - 1));
+    }
+
+    return order;
+}
+
+static int map_builder_compare(const void *a, const void *b) {
+    const MapBuilderEntry *const x = a;
+    const MapBuilderEntry *const y = b;
+
+    if (x->order != y->order) {
+        return x->order < y->order ? -1 : 1;
+    } else if (x->index != y->index) {
+        return x->index < y->index ? -1 : 1;
+    } else {
+        return 0;
+    }
+}
+
+static inline u64 map_builder_group(MapBuilderEntry *entries, u64 length, u64 start, u64 shift) {
+    const u32 fragment = map_fragment(entries[start].hash, shift);
+    u64 end = start + 1;
+
+    while (end < length && map_fragment(entries[end].hash, shift) == fragment) {
+        ++end;
+    }
+
+    return end;
+}
+
+static BowlResult map_builder_node(BowlStack stack, BowlMapBuilder *builder, MapBuilderEntry *entries, u64 length, u64 shift) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+    BowlResult result;
+
+    if (shift >= 64 || (shift == 0 && length <= MAP_FLAT_LIMIT)) {
+        // either a small map or all entries share the same hash
+        result = map_flat_allocate(&frame, length);
+
+        if (!result.failure) {
+            const BowlValue *const pairs = (*builder->pairs)->vector.elements;
+
+            for (u64 i = 0; i < length; ++i) {
+                map_flat_lane(result.value)[i] = map_fingerprint(entries[i].hash);
+                map_node_pairs(result.value)[2 * i] = pairs[2 * entries[i].index];
+                map_node_pairs(result.value)[2 * i + 1] = pairs[2 * entries[i].index + 1];
+            }
+        }
+
+        return result;
+    }
+
+    // the entries are sorted by their fragments => every slot is a contiguous range of entries
+    u32 data_bitmap = 0;
+    u32 node_bitmap = 0;
+    for (u64 i = 0, j; i < length; i = j) {
+        const u32 fragment = map_fragment(entries[i].hash, shift);
+        j = map_builder_group(entries, length, i, shift);
+
+        if (j - i == 1) {
+            data_bitmap |= (u32) 1 << fragment;
+        } else {
+            node_bitmap |= (u32) 1 << fragment;
+        }
+    }
+
+    const u64 data_slots = 2 * map_popcount(data_bitmap);
+    result = map_node_allocate(&frame, data_bitmap, node_bitmap, length, data_slots + map_popcount(node_bitmap));
+
+    if (result.failure) {
+        return result;
+    }
+
+    frame.registers[0] = result.value;
+
+    // the data section is filled immediately, while the children are still missing
+    const BowlValue *const pairs = (*builder->pairs)->vector.elements;
+    for (u64 i = 0, j, data = 0, child = data_slots; i < length; i = j) {
+        j = map_builder_group(entries, length, i, shift);
+
+        if (j - i == 1) {
+            frame.registers[0]->map.buckets[data++] = pairs[2 * entries[i].index];
+            frame.registers[0]->map.buckets[data++] = pairs[2 * entries[i].index + 1];
+        } else {
+            frame.registers[0]->map.buckets[child++] = NULL;
+        }
+    }
+
+    for (u64 i = 0, j, child = data_slots; i < length; i = j) {
+        j = map_builder_group(entries, length, i, shift);
+
+        if (j - i > 1) {
+            result = map_builder_node(&frame, builder, &entries[i], j - i, shift + MAP_BITS);
+
+            if (result.failure) {
+                return result;
+            }
+
+            frame.registers[0]->map.buckets[child++] = result.value;
+        }
+    }
+
+    result.value = frame.registers[0];
+    result.failure = false;
+
+    return result;
+}
+
+MapIterator map_iterator(BowlValue map) {
+    MapIterator iterator = {
+        .depth = 1
+    };
+
+    iterator.nodes[0] = map;
+    iterator.positions[0] = 0;
+
+    return iterator;
+}
+
+bool map_iterator_next(MapIterator *iterator, BowlValue *key, BowlValue *value) {
+    while (iterator->depth > 0) {
+        const BowlValue node = iterator->nodes[iterator->depth - 1];
+        const u64 position = iterator->positions[iterator->depth - 1];
+        const u64 pairs = map_node_pair_count(node);
+
+        if (position < pairs) {
+            *key = map_node_pairs(node)[2 * position];
+            *value = map_node_pairs(node)[2 * position + 1];
+            iterator->positions[iterator->depth - 1] = position + 1;
+            return true;
+        } else if (!map_is_flat(node) && position - pairs < map_node_child_count(node)) {
+            iterator->positions[iterator->depth - 1] = position + 1;
+            iterator->nodes[iterator->depth] = node->map.buckets[2 * pairs + (position - pairs)];
+            iterator->positions[iterator->depth] = 0;
+            ++iterator->depth;
+        } else {
+            --iterator->depth;
+        }
+    }
+
+    return false;
+}
+
+BowlMapCursor bowl_map_cursor(BowlValue *map) {
+    BowlMapCursor cursor = {
+        .map = map,
+        .epoch = gc_collections(),
+        .iterator = map_iterator(*map)
+    };
+
+    return cursor;
+}
+
+bool bowl_map_cursor_next(BowlMapCursor *cursor, BowlValue *key, BowlValue *value) {
+    MapIterator *const iterator = &cursor->iterator;
+
+    if (cursor->epoch != gc_collections() && iterator->depth > 0) {
+        // the nodes were relocated but their layout is the same => follow the positions again
+        iterator->nodes[0] = *cursor->map;
+
+        for (u64 i = 1; i < iterator->depth; ++i) {
+            const BowlValue parent = iterator->nodes[i - 1];
+            const u64 pairs = map_node_pair_count(parent);
+            // the position of the parent was advanced as soon as the child was entered
+            iterator->nodes[i] = parent->map.buckets[2 * pairs + (iterator->positions[i - 1] - 1 - pairs)];
+        }
+
+        cursor->epoch = gc_collections();
+    }
+
+    return map_iterator_next(iterator, key, value);
+}
+
+BowlValue bowl_map_get_or_else(BowlValue map, BowlValue key, BowlValue otherwise) {
+    const u64 hash = map_hash(key);
+    BowlValue node = map;
+
+    for (u64 shift = 0; !map_is_flat(node); shift += MAP_BITS) {
+        const u32 bit = (u32) 1 << map_fragment(hash, shift);
+
+        if (map_data_bitmap(node) & bit) {
+            const u64 index = 2 * map_data_index(node, bit);
+
+            if (bowl_value_equals(key, node->map.buckets[index])) {
+                return node->map.buckets[index + 1];
+            }
+
+            return otherwise;
+        } else if (map_node_bitmap(node) & bit) {
+            node = node->map.buckets[map_child_index(node, bit)];
+        } else {
+            return otherwise;
+        }
+    }
+
+    const u64 index = map_flat_find(node, key, hash);
+    return index == (u64) -1 ? otherwise : map_node_pairs(node)[2 * index + 1];
+}
+
+BowlResult bowl_map_merge(BowlStack stack, BowlValue a, BowlValue b) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, a, b, NULL);
+    const u64 smaller = MIN(a->map.length, b->map.length);
+    const u64 larger = MAX(a->map.length, b->map.length);
+
+    if (smaller * MAP_FANOUT < larger) {
+        // the larger map is used as the base to share as much of its structure as possible, while
+        // the pairs of the second map always take precedence
+        if (frame.registers[0]->map.length >= frame.registers[1]->map.length) {
+            return map_put_all(&frame, frame.registers[0], frame.registers[1], true);
+        } else {
+            return map_put_all(&frame, frame.registers[1], frame.registers[0], false);
+        }
+    }
+
+    // both maps are of similar size => build the result from scratch
+    BowlMapBuilder builder;
+    BowlResult result;
+
+    result.exception = bowl_map_builder_begin(&frame, &builder, &frame.registers[2], frame.registers[0], frame.registers[1]->map.length);
+
+    if (result.exception != NULL) {
+        result.failure = true;
+        return result;
+    }
+
+    // enough space was reserved => nothing is allocated during the iteration
+    MapIterator iterator = map_iterator(frame.registers[1]);
+    BowlValue key;
+    BowlValue value;
+
+    while (map_iterator_next(&iterator, &key, &value)) {
+        bowl_map_builder_put(&frame, &builder, key, value);
+    }
+
+    return bowl_map_builder_freeze(&frame, &builder);
+}
+
+BowlResult bowl_map_delete(BowlStack stack, BowlValue map, BowlValue key) {
+    return map_node_delete(stack, map, key, map_hash(key), 0);
+}
+
+BowlResult bowl_map_put(BowlStack stack, BowlValue map, BowlValue key, BowlValue value) {
+    bool added = false;
+    return map_node_put(stack, map, key, value, map_hash(key), 0, &added);
+}
+
+bool bowl_map_subset_of(BowlValue superset, BowlValue subset) {
+    if (subset->map.length > superset->map.length) {
+        return false;
+    }
+
+    MapIterator iterator = map_iterator(subset);
+    BowlValue key;
+    BowlValue value;
+
+    while (map_iterator_next(&iterator, &key, &value)) {
+        const BowlValue result = bowl_map_get_or_else(superset, key, bowl_sentinel_value);
+
+        if (result == bowl_sentinel_value) {
+            return false;
+        } else if (!bowl_value_equals(value, result)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+BowlValue bowl_map_builder_begin(BowlStack stack, BowlMapBuilder *builder, BowlValue *pairs, BowlValue map, u64 additional) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, map, NULL, NULL);
+    const u64 initial = map == NULL ? 0 : map->map.length;
+
+    builder->pairs = pairs;
+    builder->length = 0;
+
+    BowlResult result = bowl_vector(&frame, NULL, 2 * MAX(initial + additional, 8));
+
+    if (result.failure) {
+        return result.exception;
+    }
+
+    *pairs = result.value;
+
+    if (frame.registers[0] != NULL) {
+        // the vector is large enough for all pairs => nothing is allocated during the iteration
+        MapIterator iterator = map_iterator(frame.registers[0]);
+        BowlValue key;
+        BowlValue value;
+
+        while (map_iterator_next(&iterator, &key, &value)) {
+            (*pairs)->vector.elements[2 * builder->length] = key;
+            (*pairs)->vector.elements[2 * builder->length + 1] = value;
+            ++builder->length;
+        }
+    }
+
+    return NULL;
+}
+
+BowlValue bowl_map_builder_put(BowlStack stack, BowlMapBuilder *builder, BowlValue key, BowlValue value) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, key, value, NULL);
+
+    if (2 * (builder->length + 1) > (*builder->pairs)->vector.length) {
+        const BowlResult result = bowl_vector(&frame, NULL, 2 * (*builder->pairs)->vector.length);
+
+        if (result.failure) {
+            return result.exception;
+        }
+
+        memcpy(result.value->vector.elements, (*builder->pairs)->vector.elements, 2 * builder->length * sizeof(BowlValue));
+        *builder->pairs = result.value;
+    }
+
+    (*builder->pairs)->vector.elements[2 * builder->length] = frame.registers[0];
+    (*builder->pairs)->vector.elements[2 * builder->length + 1] = frame.registers[1];
+    ++builder->length;
+
+    return NULL;
+}
+
+BowlResult bowl_map_builder_freeze(BowlStack stack, BowlMapBuilder *builder) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+    BowlResult result;
+    const u64 length = builder->length;
+
+    if (length == 0) {
+        return bowl_map(&frame, 0);
+    }
+
+    MapBuilderEntry *const entries = malloc(length * sizeof(MapBuilderEntry));
+    if (entries == NULL) {
+        result.failure = true;
+        result.exception = bowl_exception_out_of_heap;
+        return result;
+    }
+
+    for (u64 i = 0; i < length; ++i) {
+        entries[i].hash = map_hash((*builder->pairs)->vector.elements[2 * i]);
+        entries[i].order = map_order(entries[i].hash);
+        entries[i].index = i;
+    }
+
+    qsort(entries, length, sizeof(MapBuilderEntry), map_builder_compare);
+
+    // drop all pairs whose keys are put again later on (equal keys are adjacent after sorting)
+    u64 unique = 0;
+    for (u64 i = 0; i < length; ++i) {
+        const BowlValue key = (*builder->pairs)->vector.elements[2 * entries[i].index];
+        bool overwritten = false;
+
+        for (u64 j = i + 1; j < length && entries[j].order == entries[i].order; ++j) {
+            if (bowl_value_equals(key, (*builder->pairs)->vector.elements[2 * entries[j].index])) {
+                overwritten = true;
+                break;
+            }
+        }
+
+        if (!overwritten) {
+            entries[unique++] = entries[i];
+        }
+    }
+
+    result = map_builder_node(&frame, builder, entries, unique, 0);
+    free(entries);
+
+    return result;
+}
+
+BowlResult bowl_map(BowlStack stack, u64 capacity) {
+    // the capacity is just a hint which is not needed by the trie
+    return map_node_allocate(stack, 0, 0, 0, 0);
+}
@@ -0,0 +1,157 @@
+#ifndef MAP_H
+#define MAP_H
+
+#include "../common/utility.h"
+#include <bowl/bowl.h>
+#include <bowl/api.h>
+#include "gc.h"
+
+/*
+ * Maps are persistent hash array mapped tries (in the compressed 'CHAMP' layout). Every node
+ * of the trie is a value of type 'BowlMapValue' whose fields are interpreted as follows:
+ *
+ * - 'length' is the number of key-value pairs which are stored in the subtree of the node.
+ * - 'capacity' holds two bitmaps: the lower 32 bits mark the slots which contain an inline
+ *   key-value pair, while the upper 32 bits mark the slots which point to a child node.
+ * - 'buckets' contains all inline key-value pairs (as consecutive key and value entries)
+ *   followed by all child nodes, each of them in the order of their slots.
+ *
+ * A node whose 'capacity' is zero is a flat node. It starts with a lane of 'length' 32-bit hash
+ * fingerprints (two per slot) followed by 'length' consecutive key-value pairs. Flat nodes are
+ * used for small maps (up to 'MAP_FLAT_LIMIT' pairs) as well as for keys whose hashes fully
+ * collide.
+ */
+
+#define MAP_BITS 5
+#define MAP_FANOUT (1 << MAP_BITS)
+#define MAP_MASK (MAP_FANOUT - 1)
+#define MAP_MAX_DEPTH ((64 + MAP_BITS - 1) / MAP_BITS)
+#define MAP_FLAT_LIMIT 8
+
+typedef struct {
+    /** The nodes on the path from the root to the current node. */
+    BowlValue nodes[MAP_MAX_DEPTH + 1];
+    /** The index of the next slot which should be visited in each of the nodes. */
+    u64 positions[MAP_MAX_DEPTH + 1];
+    /** The number of nodes on the path (zero if the iteration is finished). */
+    u64 depth;
+} MapIterator;
+
+typedef struct {
+    /** A reference to the map which is iterated (this reference must be visible to the garbage collector). */
+    BowlValue *map;
+    /** The number of garbage collections at the time the path of the iterator was computed. */
+    u64 epoch;
+    /** The position within the map. */
+    MapIterator iterator;
+} BowlMapCursor;
+
+typedef struct {
+    /** A reference to the vector which stores the keys and values (this reference must be visible to the garbage collector). */
+    BowlValue *pairs;
+    /** The number of pairs which were put into the builder so far. */
+    u64 length;
+} BowlMapBuilder;
+
+/**
+ * Returns the number of value slots which are used by the provided map node.
+ * @param node The map node.
+ * @return The number of slots in the 'buckets' field of the node.
+ */
+u64 map_node_slots(BowlValue node);
+
+/**
+ * Returns the slots of the provided map node which contain references to other values.
+ * @param node The map node.
+ * @param length The location where the number of references should be stored.
+ * @return The first of the references.
+ */
+BowlValue *map_node_references(BowlValue node, u64 *length);
+
+/**
+ * Returns the number of key-value pairs which are stored in the provided map node itself.
+ * @param node The map node.
+ * @return The number of pairs, which precede the children in the references of the node.
+ */
+u64 map_node_pair_count(BowlValue node);
+
+/**
+ * Creates an iterator over all key-value pairs of the provided map.
+ *
+ * The iterator holds raw references into the map. Therefore, it must not be used any
+ * longer as soon as the garbage collector may have been run.
+ * @param map The map which should be iterated.
+ * @return The iterator.
+ */
+MapIterator map_iterator(BowlValue map);
+
+/**
+ * Advances the iterator to the next key-value pair.
+ * @param iterator The iterator.
+ * @param key The location where the next key should be stored.
+ * @param value The location where the next value should be stored.
+ * @return Either 'true' if another key-value pair was found, or 'false' otherwise.
+ */
+bool map_iterator_next(MapIterator *iterator, BowlValue *key, BowlValue *value);
+
+/**
+ * Creates a cursor over all key-value pairs of a map.
+ *
+ * In contrast to 'map_iterator', the cursor does not allocate and stays valid if the garbage
+ * collector runs during the iteration. For this, the map is referenced by the location 'map',
+ * which must be part of the stack of the caller (e.g., one of its registers).
+ * @param map The location of the map which should be iterated.
+ * @return The cursor.
+ */
+BowlMapCursor bowl_map_cursor(BowlValue *map);
+
+/**
+ * Advances the cursor to the next key-value pair.
+ *
+ * The key and the value are not visible to the garbage collector. Therefore, they must be
+ * stored in the stack of the caller before any further allocation.
+ * @param cursor The cursor.
+ * @param key The location where the next key should be stored.
+ * @param value The location where the next value should be stored.
+ * @return Either 'true' if another key-value pair was found, or 'false' otherwise.
+ */
+bool bowl_map_cursor_next(BowlMapCursor *cursor, BowlValue *key, BowlValue *value);
+
+/**
+ * Starts to build a new map.
+ *
+ * The pairs are collected in a privately owned vector, which is stored in the location
+ * referenced by 'pairs'. This location must be part of the provided stack (e.g., one of
+ * its registers) since the vector is managed by the garbage collector.
+ * @param stack The stack of the current environment.
+ * @param builder The builder which should be initialized.
+ * @param pairs The location of the vector which stores the pairs.
+ * @param map A map whose pairs are used as the initial content, or 'NULL'.
+ * @param additional The number of pairs which are expected to be put into the builder.
+ * @return Either 'NULL' or an exception.
+ */
+BowlValue bowl_map_builder_begin(BowlStack stack, BowlMapBuilder *builder, BowlValue *pairs, BowlValue map, u64 additional);
+
+/**
+ * Puts a key-value pair into the builder without creating an intermediate map.
+ *
+ * If the same key is put more than once, the value which was put last is used.
+ * @param stack The stack of the current environment.
+ * @param builder The builder.
+ * @param key The key.
+ * @param value The value.
+ * @return Either 'NULL' or an exception.
+ */
+BowlValue bowl_map_builder_put(BowlStack stack, BowlMapBuilder *builder, BowlValue key, BowlValue value);
+
+/**
+ * Creates the immutable map from all pairs which were put into the builder.
+ *
+ * Each node of the map is allocated exactly once. The builder must not be used afterwards.
+ * @param stack The stack of the current environment.
+ * @param builder The builder.
+ * @return Either the new map or an exception.
+ */
+BowlResult bowl_map_builder_freeze(BowlStack stack, BowlMapBuilder *builder);
+
+#endif
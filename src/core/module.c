@@ -22,7 +22,121 @@ static void fail(BowlValue exception) {
     exit(EXIT_FAILURE);
 }
 
-void execute(char *program) {
+static BowlResult tokenize_program(BowlStack stack, char *program) {
+    return bowl_tokens_utf8(stack, (u8 *) program, strlen(program));
+}
+
+static BowlResult tokenize_file(BowlStack stack, char *path) {
+    bool found;
+    BowlResult result = bowl_tokens_precompiled(stack, path, &found);
+
+    if (result.failure || found) {
+        return result;
+    }
+
+    return bowl_tokens_file(stack, path);
+}
+
+static BowlResult tokenize_boot(BowlStack stack, char *program) {
+    // the symbol which is replaced by the tokens of the boot file
+    BOWL_STATIC_ASCII_SYMBOL(boot_symbol, "boot:tokens");
+
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+    BowlResult result = tokenize_program(&frame, program);
+
+    if (result.failure) {
+        return result;
+    }
+
+    frame.registers[0] = result.value;
+    result = bowl_tokens_cached(&frame, bowl_settings_boot_path);
+
+    if (result.failure) {
+        return result;
+    }
+
+    frame.registers[1] = result.value;
+
+    // the tokens in front of the symbol are collected in reverse order
+    while (frame.registers[0] != NULL && !bowl_value_equals(frame.registers[0]->list.head, &boot_symbol.value)) {
+        result = bowl_list(&frame, frame.registers[0]->list.head, frame.registers[2]);
+
+        if (result.failure) {
+            return result;
+        }
+
+        frame.registers[2] = result.value;
+        frame.registers[0] = frame.registers[0]->list.tail;
+    }
+
+    if (frame.registers[0] != NULL) {
+        result = bowl_list(&frame, frame.registers[1], frame.registers[0]->list.tail);
+
+        if (result.failure) {
+            return result;
+        }
+
+        frame.registers[0] = result.value;
+    }
+
+    while (frame.registers[2] != NULL) {
+        result = bowl_list(&frame, frame.registers[2]->list.head, frame.registers[0]);
+
+        if (result.failure) {
+            return result;
+        }
+
+        frame.registers[0] = result.value;
+        frame.registers[2] = frame.registers[2]->list.tail;
+    }
+
+    result.value = frame.registers[0];
+    return result;
+}
+
+static BowlResult tokenize_embedded(BowlStack stack, char *program) {
+    // the tokens are in memory already, only their symbols are interned (the parameters are only
+    // needed by the other tokenizers which are passed to 'execute_tokens')
+    (void) stack;
+    (void) program;
+
+    BowlResult result;
+    result.exception = embed_intern();
+    result.failure = result.exception != NULL;
+
+    if (!result.failure) {
+        result.value = bowl_embedded_boot;
+    }
+
+    return result;
+}
+
+static BowlResult prepend_tokens(BowlStack stack, BowlValue tokens, BowlValue tail) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, tail, NULL);
+    BowlResult result = bowl_list_reverse(&frame, tokens);
+
+    if (result.failure) {
+        return result;
+    }
+
+    frame.registers[0] = result.value;
+
+    while (frame.registers[0] != NULL) {
+        result = bowl_list(&frame, frame.registers[0]->list.head, frame.registers[1]);
+
+        if (result.failure) {
+            return result;
+        }
+
+        frame.registers[1] = result.value;
+        frame.registers[0] = frame.registers[0]->list.tail;
+    }
+
+    result.value = frame.registers[1];
+    return result;
+}
+
+static void execute_tokens(BowlResult (*tokenize)(BowlStack stack, char *source), char *source) {
     BowlStackFrame stack;
 
     BowlValue callstack = NULL;
@@ -30,7 +144,7 @@ void execute(char *program) {
     BowlValue dictionary = NULL;
 
     for (u64 i = 0; i < sizeof(stack.registers) / sizeof(stack.registers[0]); ++i) {
-        stack.registers[0] = NULL;
+        stack.registers[i] = NULL;
     }
 
     stack.previous = NULL;
@@ -38,13 +152,21 @@ void execute(char *program) {
     stack.datastack = &datastack;
     stack.dictionary = &dictionary;
 
-    BowlResult result = bowl_string_utf8(&stack, program, strlen(program));
+    // the image must be restored before the program is tokenized, since its symbols are hashed
+    if (bowl_settings_image_path != NULL) {
+        const BowlValue exception = image_load(&stack, (char *) bowl_settings_image_path);
 
-    if (result.failure) {
-        fail(result.exception);
+        if (exception != NULL) {
+            fail(exception);
+        }
     }
 
-    result = bowl_tokens(&stack, result.value);
+    BowlResult result = tokenize(&stack, source);
+
+    if (!result.failure && callstack != NULL) {
+        // the program is executed in front of the callstack which was restored from the image
+        result = prepend_tokens(&stack, result.value, callstack);
+    }
 
     if (result.failure) {
         fail(result.exception);
@@ -65,28 +187,101 @@ void execute(char *program) {
     }
 }
 
-BowlValue bowl_module_initialize(BowlStack stack, BowlValue library) {
-    BOWL_STATIC_ASCII_SYMBOL(run_symbol, "run");
-   
-    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, library, NULL, NULL);
+void execute(char *program) {
+    execute_tokens(tokenize_program, program);
+}
+
+void execute_file(char *path) {
+    execute_tokens(tokenize_file, path);
+}
+
+void execute_boot(char *program) {
+    execute_tokens(tokenize_boot, program);
+}
+
+void execute_embedded(void) {
+    execute_tokens(tokenize_embedded, NULL);
+}
+
+void compile_file(char *path) {
+    BowlValue callstack = NULL;
+    BowlValue datastack = NULL;
+    BowlValue dictionary = NULL;
+
+    BowlStackFrame stack = BOWL_EMPTY_STACK_FRAME(NULL);
+    stack.callstack = &callstack;
+    stack.datastack = &datastack;
+    stack.dictionary = &dictionary;
+
+    const BowlResult result = bowl_tokens_compile(&stack, path);
 
-    // set up the dictionary
-    BowlResult result = bowl_map(&frame, 16);
     if (result.failure) {
-        return result.exception;
+        fail(result.exception);
     }
-    
-    *frame.dictionary = result.value;
+}
+
+void embed_boot(char *program, char *path) {
+    BowlValue callstack = NULL;
+    BowlValue datastack = NULL;
+    BowlValue dictionary = NULL;
+
+    BowlStackFrame stack = BOWL_EMPTY_STACK_FRAME(NULL);
+    stack.callstack = &callstack;
+    stack.datastack = &datastack;
+    stack.dictionary = &dictionary;
+
+    const BowlResult result = tokenize_boot(&stack, program);
 
-    // bootstrap the kernel
-    result = bowl_library(&frame, (char *) bowl_settings_kernel_path);
-    
     if (result.failure) {
-        return result.exception;
+        fail(result.exception);
     }
 
-    // remember a reference of the native library to avoid it from being closed
-    frame.registers[1] = result.value;
+    stack.registers[0] = result.value;
+    const BowlValue exception = embed_write(&stack, stack.registers[0], path);
+
+    if (exception != NULL) {
+        fail(exception);
+    }
+}
+
+BowlValue bowl_module_initialize(BowlStack stack, BowlValue library) {
+    BOWL_STATIC_ASCII_SYMBOL(run_symbol, "run");
+   
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, library, NULL, NULL);
+    BowlResult result;
+
+    // the dictionary (including the kernel) may have been restored from an image already
+    if (*frame.dictionary == NULL) {
+        // set up the dictionary
+        result = bowl_map(&frame, 16);
+        if (result.failure) {
+            return result.exception;
+        }
+        
+        *frame.dictionary = result.value;
+
+        // bootstrap the kernel
+        result = bowl_library(&frame, (char *) bowl_settings_kernel_path);
+        
+        if (result.failure) {
+            return result.exception;
+        }
+
+        // remember a reference of the native library to avoid it from being closed
+        frame.registers[1] = result.value;
+
+        BowlValue exception = bowl_register_function(&frame, "image:dump", "Writes the dictionary, the datastack and the callstack into the image file whose path is on top of the datastack.", NULL, bowl_image_dump);
+
+        if (exception != NULL) {
+            return exception;
+        }
+
+        exception = bowl_register_function(&frame, "string:file", "Replaces the path on top of the datastack with the contents of the file, which are not copied into the heap.", NULL, bowl_string_file_function);
+
+        if (exception != NULL) {
+            return exception;
+        }
+    }
 
     // set up the datastack
     result = bowl_list(&frame, *frame.dictionary, *frame.datastack);
@@ -110,7 +305,7 @@ BowlValue bowl_module_initialize(BowlStack stack, BowlValue library) {
     *frame.datastack = result.value;
 
     // the function 'run' should be present in the dictionary by now
-    const BowlValue run = bowl_map_get_or_else(*frame.dictionary, &run_symbol.value, bowl_sentinel_value);
+    const BowlValue run = bowl_dictionary_get_or_else(*frame.dictionary, &run_symbol.value, bowl_sentinel_value);
 
     if (run == bowl_sentinel_value) {
         return bowl_format_exception(&frame, "failed to initialize module 'kernel' in function '%s'", __FUNCTION__).value;
@@ -5,7 +5,21 @@
 #include <bowl/module.h>
 #include "gc.h"
 #include "core.h"
+#include "cache.h"
+#include "image.h"
+#include "embed.h"
+#include "external.h"
 
 void execute(char *program);
 
+void execute_file(char *path);
+
+void execute_boot(char *program);
+
+void execute_embedded(void);
+
+void compile_file(char *path);
+
+void embed_boot(char *program, char *path);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include "output.h"
+#include <errno.h>
+
+#if defined(OS_UNIX)
+    #include <unistd.h>
+#elif defined(OS_WINDOWS)
+    #include <io.h>
+#endif
+
+static inline bool output_is_flushed(Output *output) {
+    return output->stream != NULL || output->descriptor >= 0;
+}
+
+void output_stream(Output *output, FILE *stream) {
+    output->stream = stream;
+    output->descriptor = -1;
+    output->bytes = output->storage;
+    output->length = 0;
+    output->capacity = OUTPUT_CAPACITY;
+    output->failure = false;
+}
+
+void output_descriptor(Output *output, int descriptor) {
+    output->stream = NULL;
+    output->descriptor = descriptor;
+    output->bytes = output->storage;
+    output->length = 0;
+    output->capacity = OUTPUT_CAPACITY;
+    output->failure = false;
+}
+
+bool output_buffer(Output *output, u64 capacity) {
+    output->stream = NULL;
+    output->descriptor = -1;
+    output->bytes = malloc(capacity * sizeof(char));
+    output->length = 0;
+    output->capacity = capacity;
+    output->failure = output->bytes == NULL;
+    return !output->failure;
+}
+
+static void output_fail(Output *output) {
+    if (!output_is_flushed(output)) {
+        free(output->bytes);
+        output->bytes = NULL;
+    }
+
+    output->length = 0;
+    output->capacity = 0;
+    output->failure = true;
+}
+
+bool output_reserve(Output *output, u64 length) {
+    if (output->failure) {
+        return false;
+    } else if (length <= output->capacity - output->length) {
+        return true;
+    } else if (output_is_flushed(output)) {
+        output_flush(output);
+        return !output->failure;
+    }
+
+    const u64 capacity = MAX(output->capacity * 2, output->length + length);
+    char *const bytes = realloc(output->bytes, capacity * sizeof(char));
+
+    if (bytes == NULL) {
+        output_fail(output);
+        return false;
+    }
+
+    output->bytes = bytes;
+    output->capacity = capacity;
+    return true;
+}
+
+bool output_write(Output *output, const char *bytes, u64 length) {
+    while (length > 0) {
+        const u64 chunk = MIN(length, OUTPUT_CAPACITY);
+
+        if (!output_reserve(output, chunk)) {
+            return false;
+        }
+
+        memcpy(&output->bytes[output->length], bytes, chunk);
+        output->length += chunk;
+        bytes += chunk;
+        length -= chunk;
+    }
+
+    return true;
+}
+
+bool output_string(Output *output, const char *string) {
+    return output_write(output, string, strlen(string));
+}
+
+bool output_number(Output *output, double number) {
+    if (!output_reserve(output, NUMBER_FORMAT_LENGTH)) {
+        return false;
+    }
+
+    output->length += number_format(number, &output->bytes[output->length]);
+    return true;
+}
+
+bool output_printf(Output *output, const char *format, ...) {
+    va_list list;
+
+    // numbers and addresses fit into the reserved room such that they are formatted only once
+    if (!output_reserve(output, 64)) {
+        return false;
+    }
+
+    va_start(list, format);
+    const int required = vsnprintf(&output->bytes[output->length], output->capacity - output->length, format, list);
+    va_end(list);
+
+    if (required < 0) {
+        output_fail(output);
+        return false;
+    } else if ((u64) required < output->capacity - output->length) {
+        output->length += required;
+        return true;
+    }
+
+    // the output is too large for the room => format it into a temporary buffer
+    char *const buffer = malloc((u64) required + 1);
+
+    if (buffer == NULL) {
+        output_fail(output);
+        return false;
+    }
+
+    va_start(list, format);
+    vsnprintf(buffer, (u64) required + 1, format, list);
+    va_end(list);
+
+    const bool result = output_write(output, buffer, (u64) required);
+    free(buffer);
+    return result;
+}
+
+bool output_text(Output *output, const u8 *bytes, u64 width, u64 length) {
+    // every codepoint takes at most four bytes
+    const u64 chunk = OUTPUT_CAPACITY / 4;
+
+    while (length > 0) {
+        const u64 n = MIN(length, chunk);
+
+        if (!output_reserve(output, n * 4)) {
+            return false;
+        }
+
+        output->length += unicode_utf8_encode_text(bytes, width, n, (u8 *) &output->bytes[output->length]);
+        bytes += n * width;
+        length -= n;
+    }
+
+    return true;
+}
+
+void output_flush(Output *output) {
+    if (output->failure || output->length == 0) {
+        return;
+    }
+
+    if (output->stream != NULL) {
+        if (fwrite(output->bytes, sizeof(char), output->length, output->stream) != output->length) {
+            output_fail(output);
+            return;
+        }
+    } else if (output->descriptor >= 0) {
+        // a write may be interrupted (or cut short) at any point
+        for (u64 offset = 0; offset < output->length;) {
+            #if defined(OS_WINDOWS)
+                const i64 written = _write(output->descriptor, &output->bytes[offset], (unsigned int) MIN(output->length - offset, (u64) 1 << 30));
+            #else
+                const i64 written = write(output->descriptor, &output->bytes[offset], output->length - offset);
+            #endif
+
+            if (written < 0 && errno == EINTR) {
+                continue;
+            } else if (written <= 0) {
+                output_fail(output);
+                return;
+            }
+
+            offset += (u64) written;
+        }
+    }
+
+    output->length = 0;
+}
@@ -0,0 +1,113 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include "../common/utility.h"
+#include <bowl/bowl.h>
+#include <bowl/api.h>
+#include "text.h"
+#include "unicode.h"
+#include "../syntax/number.h"
+
+#define OUTPUT_CAPACITY 4096
+
+/**
+ * A buffer which collects the output of 'bowl_value_dump' and 'bowl_value_show'. The buffer is
+ * either flushed into a stream (or a file descriptor) whenever it is full or it grows as required.
+ */
+typedef struct {
+    /** The stream into which the buffer is flushed (or 'NULL'). */
+    FILE *stream;
+    /** The file descriptor into which the buffer is flushed (or '-1'). The buffer grows if neither is set. */
+    int descriptor;
+    /** The bytes which were written so far. */
+    char *bytes;
+    /** The number of bytes which were written so far. */
+    u64 length;
+    /** The number of bytes which fit into the buffer. */
+    u64 capacity;
+    /** Whether the buffer failed to grow, in which case all further output is dropped. */
+    bool failure;
+    /** The bytes of a buffer which is flushed into a stream. */
+    char storage[OUTPUT_CAPACITY];
+} Output;
+
+/**
+ * Initializes a buffer which is flushed into the provided stream.
+ * @param output The buffer.
+ * @param stream The stream.
+ */
+void output_stream(Output *output, FILE *stream);
+
+/**
+ * Initializes a buffer which is flushed into the provided file descriptor.
+ * @param output The buffer.
+ * @param descriptor The file descriptor.
+ */
+void output_descriptor(Output *output, int descriptor);
+
+/**
+ * Initializes a buffer which grows as required. The bytes must be released using 'free'.
+ * @param output The buffer.
+ * @param capacity The initial capacity.
+ * @return Either 'true' if the buffer was allocated, or 'false' otherwise.
+ */
+bool output_buffer(Output *output, u64 capacity);
+
+/**
+ * Makes room for the provided number of bytes, either by flushing or by growing the buffer.
+ * @param output The buffer.
+ * @param length The number of bytes, which must not exceed 'OUTPUT_CAPACITY'.
+ * @return Either 'true' if there is enough room, or 'false' if the buffer failed.
+ */
+bool output_reserve(Output *output, u64 length);
+
+/**
+ * Appends bytes to the buffer.
+ * @param output The buffer.
+ * @param bytes The bytes.
+ * @param length The number of bytes.
+ * @return Either 'true' on success, or 'false' if the buffer failed.
+ */
+bool output_write(Output *output, const char *bytes, u64 length);
+
+/**
+ * Appends a null-terminated string to the buffer.
+ * @param output The buffer.
+ * @param string The string.
+ * @return Either 'true' on success, or 'false' if the buffer failed.
+ */
+bool output_string(Output *output, const char *string);
+
+/**
+ * Appends formatted output to the buffer, just like 'printf'.
+ * @param output The buffer.
+ * @param format The format string.
+ * @return Either 'true' on success, or 'false' if the buffer failed.
+ */
+bool output_printf(Output *output, const char *format, ...);
+
+/**
+ * Appends the shortest decimal representation of a number which is read as the same number again.
+ * @param output The buffer.
+ * @param number The number.
+ * @return Either 'true' on success, or 'false' if the buffer failed.
+ */
+bool output_number(Output *output, double number);
+
+/**
+ * Appends codepoints encoded as UTF-8 to the buffer.
+ * @param output The buffer.
+ * @param bytes The codepoints.
+ * @param width The width of the codepoints (see 'text.h').
+ * @param length The number of codepoints.
+ * @return Either 'true' on success, or 'false' if the buffer failed.
+ */
+bool output_text(Output *output, const u8 *bytes, u64 width, u64 length);
+
+/**
+ * Writes the bytes of a stream buffer into its stream. If writing fails, the buffer fails as well.
+ * @param output The buffer.
+ */
+void output_flush(Output *output);
+
+#endif
@@ -0,0 +1,289 @@
+#include "parallel.h"
+#include "core.h"
+
+#if defined(OS_UNIX)
+    #include <pthread.h>
+    #include <unistd.h>
+#endif
+
+// the smallest number of bytes (or codepoints) which is worth to be scanned by a thread of its own
+#define PARALLEL_MINIMUM_CHUNK ((u64) 512 * 1024)
+#define PARALLEL_MAXIMUM_THREADS 16
+
+typedef struct {
+    BowlToken *tokens;
+    u64 length;
+    u64 capacity;
+} ParallelTokens;
+
+typedef struct {
+    /** The scanner of the whole source. */
+    BowlScanner scanner;
+    /** The offset of the first character of the chunk, which follows a newline (unless it is the first chunk). */
+    u64 start;
+    u64 end;
+    /** The number of newlines within the chunk. */
+    u64 lines;
+    /** The tokens in front of the shared ones if the chunk starts between two tokens. */
+    ParallelTokens outside;
+    /** The tokens in front of the shared ones if the chunk starts inside of a string literal. */
+    ParallelTokens inside;
+    /** The tokens on which both scans agree. */
+    ParallelTokens shared;
+    /** Whether the next chunk starts inside of a string literal if this chunk starts between two tokens. */
+    bool outside_open;
+    /** Whether the next chunk starts inside of a string literal if this chunk starts inside of one as well. */
+    bool inside_open;
+    /** Whether there was not enough memory to store the tokens. */
+    bool failure;
+} ParallelChunk;
+
+static inline u64 parallel_length(BowlScanner *scanner) {
+    return scanner->string == NULL ? scanner->length : (*scanner->string)->string.length;
+}
+
+static u64 parallel_line_end(BowlScanner *scanner, u64 offset, u64 length) {
+    // returns the offset behind the first newline at or after the provided offset
+    if (scanner->string == NULL) {
+        const u8 *const newline = memchr(&scanner->bytes[offset], '\n', length - offset);
+        return newline == NULL ? length : (u64) (newline - scanner->bytes) + 1;
+    }
+
+    const BowlValue string = *scanner->string;
+
+    while (offset < length && TEXT_AT(string->string.bytes, string->string.width, offset) != '\n') {
+        ++offset;
+    }
+
+    return MIN(offset + 1, length);
+}
+
+static u64 parallel_count_lines(BowlScanner *scanner, u64 start, u64 end) {
+    u64 count = 0;
+
+    if (scanner->string == NULL) {
+        const u8 *position = &scanner->bytes[start];
+        const u8 *const limit = &scanner->bytes[end];
+
+        while ((position = memchr(position, '\n', limit - position)) != NULL) {
+            ++position;
+            ++count;
+        }
+    } else {
+        const BowlValue string = *scanner->string;
+
+        for (u64 i = start; i < end; ++i) {
+            count += TEXT_AT(string->string.bytes, string->string.width, i) == '\n';
+        }
+    }
+
+    return count;
+}
+
+static void parallel_push(ParallelChunk *chunk, ParallelTokens *tokens, const BowlToken *token) {
+    if (tokens->length == tokens->capacity) {
+        const u64 capacity = MAX(tokens->capacity * 2, 256);
+        BowlToken *const resized = realloc(tokens->tokens, capacity * sizeof(BowlToken));
+
+        if (resized == NULL) {
+            chunk->failure = true;
+            return;
+        }
+
+        tokens->tokens = resized;
+        tokens->capacity = capacity;
+    }
+
+    tokens->tokens[tokens->length++] = *token;
+}
+
+static void parallel_scan(ParallelChunk *chunk) {
+    BowlScanner outside = chunk->scanner;
+    outside.offset = chunk->start;
+    outside.line = 1;
+    outside.column = 1;
+    outside.limit = chunk->end;
+    outside.token_available = false;
+
+    // a string literal which is not closed at all is reported by the chunk in which it starts
+    BowlScanner inside = outside;
+    bool inside_done = !scanner_skip_string(&inside) || inside.offset > chunk->end;
+    bool outside_done = false;
+    bool converged = false;
+
+    chunk->lines = parallel_count_lines(&chunk->scanner, chunk->start, chunk->end);
+    chunk->inside_open = inside_done;
+    chunk->outside_open = false;
+
+    while (!(outside_done && inside_done) && !chunk->failure) {
+        if (!converged && !inside_done && !outside_done && inside.offset == outside.offset) {
+            // both scans stopped behind the same token, i.e., they yield the same tokens from now on
+            converged = true;
+            inside_done = true;
+        }
+
+        // the scan which lags behind is advanced first
+        const bool advance_inside = !inside_done && (outside_done || inside.offset < outside.offset);
+        BowlScanner *const scanner = advance_inside ? &inside : &outside;
+        ParallelTokens *const tokens = advance_inside ? &chunk->inside : converged ? &chunk->shared : &chunk->outside;
+        const BowlTokenType type = scanner_next(scanner);
+
+        if (type != BowlEndOfStreamToken) {
+            parallel_push(chunk, tokens, &scanner->token);
+        }
+
+        // the next chunk starts inside of a string literal if the last token is a string literal which spans its beginning
+        const bool open = type == BowlStringToken && scanner->offset > chunk->end;
+
+        if (type != BowlEndOfStreamToken) {
+            chunk->outside_open = advance_inside ? chunk->outside_open : open;
+            chunk->inside_open = advance_inside || converged ? open : chunk->inside_open;
+        }
+
+        if (advance_inside) {
+            inside_done = type == BowlEndOfStreamToken || type == BowlErrorToken;
+        } else {
+            outside_done = type == BowlEndOfStreamToken || type == BowlErrorToken;
+        }
+    }
+}
+
+#if defined(OS_UNIX)
+    static void *parallel_worker(void *chunk) {
+        parallel_scan(chunk);
+        return NULL;
+    }
+#endif
+
+static void parallel_free(ParallelChunk *chunks, u64 count) {
+    for (u64 i = 0; i < count; ++i) {
+        free(chunks[i].outside.tokens);
+        free(chunks[i].inside.tokens);
+        free(chunks[i].shared.tokens);
+    }
+
+    free(chunks);
+}
+
+u64 parallel_threads(u64 length) {
+    #if defined(OS_UNIX)
+        const i64 cores = sysconf(_SC_NPROCESSORS_ONLN);
+        const u64 threads = MIN(MIN((u64) MAX(cores, 1), length / PARALLEL_MINIMUM_CHUNK), PARALLEL_MAXIMUM_THREADS);
+        return MAX(threads, 1);
+    #else
+        return 1;
+    #endif
+}
+
+BowlResult bowl_tokens_parallel(BowlStack stack, BowlScanner *scanner, u64 threads) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+    const u64 length = parallel_length(scanner);
+    ParallelChunk *const chunks = calloc(MAX(threads, 1), sizeof(ParallelChunk));
+    BowlResult result;
+
+    if (chunks == NULL) {
+        result.failure = true;
+        result.exception = bowl_exception_out_of_heap;
+        return result;
+    }
+
+    // split the source into chunks of roughly the same size, each of which ends behind a newline
+    u64 count = 0;
+
+    for (u64 i = 1, start = 0; i <= threads && start < length; ++i) {
+        const u64 end = i == threads ? length : parallel_line_end(scanner, MAX(start, i * (length / threads)), length);
+        chunks[count].scanner = *scanner;
+        chunks[count].start = start;
+        chunks[count].end = end;
+        ++count;
+        start = end;
+    }
+
+    #if defined(OS_UNIX)
+        pthread_t workers[PARALLEL_MAXIMUM_THREADS];
+        bool started[PARALLEL_MAXIMUM_THREADS] = { false };
+
+        for (u64 i = 1; i < count && i < PARALLEL_MAXIMUM_THREADS; ++i) {
+            started[i] = pthread_create(&workers[i], NULL, parallel_worker, &chunks[i]) == 0;
+        }
+
+        for (u64 i = 0; i < count; ++i) {
+            if (i < PARALLEL_MAXIMUM_THREADS && started[i]) {
+                pthread_join(workers[i], NULL);
+            } else {
+                parallel_scan(&chunks[i]);
+            }
+        }
+    #else
+        for (u64 i = 0; i < count; ++i) {
+            parallel_scan(&chunks[i]);
+        }
+    #endif
+
+    // the first chunk starts between two tokens, every other chunk continues where the previous one ends
+    bool inside = false;
+    u64 line = 0;
+
+    for (u64 i = 0; i < count; ++i) {
+        ParallelChunk *const chunk = &chunks[i];
+
+        if (chunk->failure) {
+            parallel_free(chunks, count);
+            result.failure = true;
+            result.exception = bowl_exception_out_of_heap;
+            return result;
+        }
+
+        // only the tokens of the actual start are kept (as the ones of 'outside')
+        if (inside) {
+            free(chunk->outside.tokens);
+            chunk->outside = chunk->inside;
+        } else {
+            free(chunk->inside.tokens);
+        }
+
+        chunk->inside = (ParallelTokens) { .tokens = NULL, .length = 0, .capacity = 0 };
+
+        // the first error in the order of the source is reported
+        for (u64 j = 0; j < chunk->outside.length + chunk->shared.length; ++j) {
+            BowlToken token = j < chunk->outside.length ? chunk->outside.tokens[j] : chunk->shared.tokens[j - chunk->outside.length];
+
+            if (token.type == BowlErrorToken) {
+                token.line += line;
+                result = bowl_token_value(&frame, scanner, &token);
+                parallel_free(chunks, count);
+                return result;
+            }
+        }
+
+        inside = inside ? chunk->inside_open : chunk->outside_open;
+        line += chunk->lines;
+    }
+
+    // the list is built from its end, such that it does not need to be reversed
+    for (u64 i = count; i-- > 0;) {
+        const ParallelChunk *const chunk = &chunks[i];
+
+        for (u64 j = chunk->outside.length + chunk->shared.length; j-- > 0;) {
+            const BowlToken *const token = j < chunk->outside.length ? &chunk->outside.tokens[j] : &chunk->shared.tokens[j - chunk->outside.length];
+            result = bowl_token_value(&frame, scanner, token);
+
+            if (!result.failure) {
+                result = bowl_list(&frame, result.value, frame.registers[0]);
+            }
+
+            if (result.failure) {
+                parallel_free(chunks, count);
+                return result;
+            }
+
+            frame.registers[0] = result.value;
+        }
+    }
+
+    parallel_free(chunks, count);
+
+    result.failure = false;
+    result.value = frame.registers[0];
+    return result;
+}
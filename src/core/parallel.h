@@ -0,0 +1,35 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "../common/utility.h"
+#include <bowl/bowl.h>
+#include <bowl/api.h>
+#include "../syntax/scanner.h"
+
+/*
+ * Large sources are tokenized on several threads. The source is split into chunks at newlines,
+ * which are either between two tokens or inside of a string literal (no other token spans a
+ * newline). Each worker scans its chunk twice in lockstep: once as if the chunk started between
+ * two tokens and once as if it started inside of a string literal. Both scans usually agree after
+ * the first few tokens, such that the rest of the tokens is only stored once. Afterwards, the
+ * actual start of each chunk follows from the end of the previous one, and the values of the
+ * tokens are allocated on the calling thread (the heap is not shared with the workers).
+ */
+
+/**
+ * Returns the number of threads which should tokenize a source of the provided length.
+ * @param length The number of bytes (or codepoints) of the source.
+ * @return The number of threads, which is one if the source should be tokenized sequentially.
+ */
+u64 parallel_threads(u64 length);
+
+/**
+ * Tokenizes the source of a scanner on several threads, with the same result as 'bowl_tokens_scanner'.
+ * @param stack The stack of the current environment.
+ * @param scanner A scanner at the beginning of its source (of either kind).
+ * @param threads The number of threads.
+ * @return Either the list of tokens or an exception.
+ */
+BowlResult bowl_tokens_parallel(BowlStack stack, BowlScanner *scanner, u64 threads);
+
+#endif
@@ -0,0 +1,944 @@
+#include "serialize.h"
+#include "core.h"
+#include "map.h"
+#include "sorted.h"
+#include <errno.h>
+#include <math.h>
+
+// the values of the virtual machine itself, whose identity is preserved
+#define SERIALIZE_STATICS 5
+// the number of codepoints which are converted at once while a text is written
+#define SERIALIZE_CHUNK 1024
+
+typedef enum {
+    /** Writes a value. */
+    SerializeWriteWork,
+    /** Numbers a value after all of its elements were written. */
+    SerializeNumberWork,
+    /** Numbers the nodes of a list after all of its elements were written. */
+    SerializeNumberListWork
+} SerializeWorkKind;
+
+typedef struct {
+    SerializeWorkKind kind;
+    BowlValue value;
+    /** The number of list nodes which are numbered. */
+    u64 length;
+} SerializeWork;
+
+typedef struct {
+    BowlValue value;
+    u64 number;
+} SerializeEntry;
+
+typedef struct {
+    Output *output;
+    /** The number of bytes which were written so far. */
+    u64 offset;
+    /** A hash table from the values which were numbered to their numbers. */
+    SerializeEntry *entries;
+    u64 length;
+    u64 capacity;
+    /** The number of the next value. */
+    u64 count;
+    /** The work which is still to be done (the next one is on top). */
+    SerializeWork *work;
+    u64 work_length;
+    u64 work_capacity;
+} SerializeWriter;
+
+typedef struct {
+    /** The tag of the value. */
+    u8 tag;
+    /** The number of elements which are still to be read. */
+    u64 remaining;
+    /** The index of the first element on the stack of values. */
+    u64 base;
+    /** The number of elements of a list (without its tail) or the number of pairs of a map. */
+    u64 length;
+} SerializePending;
+
+typedef struct {
+    /** The bytes which were not read yet (only if there is no stream). */
+    const u8 *position;
+    const u8 *end;
+    /** The stream from which the bytes are read (or 'NULL'). */
+    FILE *stream;
+    /** The number of bytes which were read so far. */
+    u64 offset;
+    /** A buffer for the bytes of a stream and for codepoints which cannot be used in place. */
+    u8 *buffer;
+    u64 buffer_capacity;
+    /** Whether there was not enough memory to read the value. */
+    bool out_of_memory;
+} SerializeReader;
+
+static void serialize_statics(BowlValue statics[SERIALIZE_STATICS]) {
+    statics[0] = bowl_exception_out_of_heap;
+    statics[1] = bowl_exception_finalization_failure;
+    statics[2] = bowl_exception_malformed_utf8;
+    statics[3] = bowl_exception_incomplete_utf8;
+    statics[4] = bowl_sentinel_value;
+}
+
+static u64 serialize_static_index(BowlValue value) {
+    BowlValue statics[SERIALIZE_STATICS];
+    serialize_statics(statics);
+
+    for (u64 i = 0; i < SERIALIZE_STATICS; ++i) {
+        if (statics[i] == value) {
+            return i;
+        }
+    }
+
+    return SERIALIZE_STATICS;
+}
+
+static inline bool serialize_little_endian(void) {
+    const u16 probe = 1;
+    return *(const u8 *) &probe == 1;
+}
+
+static inline u64 serialize_width_index(u64 width) {
+    return width == 1 ? 0 : width == 2 ? 1 : 2;
+}
+
+static void serialize_swap(u8 *bytes, u64 width, u64 length) {
+    // converts codepoints between little-endian and the byte order of the machine
+    if (serialize_little_endian() || width == 1) {
+        return;
+    }
+
+    for (u64 i = 0; i < length; ++i) {
+        u8 *const codepoint = &bytes[i * width];
+
+        for (u64 j = 0; j < width / 2; ++j) {
+            const u8 byte = codepoint[j];
+            codepoint[j] = codepoint[width - 1 - j];
+            codepoint[width - 1 - j] = byte;
+        }
+    }
+}
+
+static bool serialize_bytes(SerializeWriter *writer, const void *bytes, u64 length) {
+    writer->offset += length;
+    return output_write(writer->output, bytes, length);
+}
+
+static bool serialize_byte(SerializeWriter *writer, u8 byte) {
+    return serialize_bytes(writer, &byte, 1);
+}
+
+static bool serialize_varint(SerializeWriter *writer, u64 value) {
+    u8 bytes[10];
+    u64 length = 0;
+
+    do {
+        bytes[length++] = (u8) ((value & 0x7F) | (value >= 0x80 ? 0x80 : 0));
+        value >>= 7;
+    } while (value != 0);
+
+    return serialize_bytes(writer, bytes, length);
+}
+
+static bool serialize_number(SerializeWriter *writer, double number) {
+    // integers which are exactly representable (except for '-0.0') take as few bytes as possible
+    if (number >= -9007199254740992.0 && number <= 9007199254740992.0 && (double) (i64) number == number && !(number == 0.0 && signbit(number))) {
+        const i64 integer = (i64) number;
+        return serialize_byte(writer, SerializeIntegerTag) && serialize_varint(writer, ((u64) integer << 1) ^ (u64) (integer >> 63));
+    }
+
+    u64 bits;
+    u8 bytes[8];
+    memcpy(&bits, &number, sizeof(bits));
+
+    for (u64 i = 0; i < 8; ++i) {
+        bytes[i] = (u8) (bits >> (8 * i));
+    }
+
+    return serialize_byte(writer, SerializeNumberTag) && serialize_bytes(writer, bytes, sizeof(bytes));
+}
+
+static bool serialize_text(SerializeWriter *writer, BowlValue text) {
+    static const u8 padding[4] = { 0 };
+    TextReader reader = text_reader(text, 0);
+    const u8 *bytes;
+    u64 chunk_width, length, width = 1;
+
+    // the smallest width of all codepoints (of all parts of a concatenation)
+    while (width < 4 && text_reader_next(&reader, &bytes, &chunk_width, &length)) {
+        width = MAX(width, text_width(bytes, chunk_width, length));
+    }
+
+    const u8 tag = (text->type == BowlSymbolValue ? SerializeSymbolTag : SerializeStringTag) + serialize_width_index(width);
+
+    // the codepoints are aligned to their width (relative to the beginning), such that they can be read in place
+    bool success = serialize_byte(writer, tag)
+        && serialize_varint(writer, text->string.length)
+        && serialize_bytes(writer, padding, (width - writer->offset % width) % width);
+
+    reader = text_reader(text, 0);
+
+    while (success && text_reader_next(&reader, &bytes, &chunk_width, &length)) {
+        if (chunk_width == width && (width == 1 || serialize_little_endian())) {
+            success = serialize_bytes(writer, bytes, length * width);
+            continue;
+        }
+
+        u8 converted[SERIALIZE_CHUNK * 4];
+
+        for (u64 i = 0; i < length && success; i += SERIALIZE_CHUNK) {
+            const u64 n = MIN(length - i, SERIALIZE_CHUNK);
+            text_copy(converted, width, &bytes[i * chunk_width], chunk_width, n);
+            serialize_swap(converted, width, n);
+            success = serialize_bytes(writer, converted, n * width);
+        }
+    }
+
+    return success;
+}
+
+static u64 serialize_slot(SerializeWriter *writer, BowlValue value) {
+    // values are at least three slots apart in the heap, so the neighbours of a value stay neighbours in the table
+    u64 slot = ((u64) (uintptr_t) value / 16) & (writer->capacity - 1);
+
+    while (writer->entries[slot].value != NULL && writer->entries[slot].value != value) {
+        slot = (slot + 1) & (writer->capacity - 1);
+    }
+
+    return slot;
+}
+
+static bool serialize_find(SerializeWriter *writer, BowlValue value, u64 *number) {
+    if (writer->length == 0) {
+        return false;
+    }
+
+    const SerializeEntry *const entry = &writer->entries[serialize_slot(writer, value)];
+
+    if (entry->value == NULL) {
+        return false;
+    }
+
+    *number = entry->number;
+    return true;
+}
+
+static bool serialize_enumerate(SerializeWriter *writer, BowlValue value) {
+    // the value takes the next number even if it is known already (the reader cannot tell)
+    const u64 number = writer->count++;
+
+    if (2 * (writer->length + 1) > writer->capacity) {
+        const u64 capacity = MAX(writer->capacity * 2, 256);
+        SerializeEntry *const entries = calloc(capacity, sizeof(SerializeEntry));
+
+        if (entries == NULL) {
+            return false;
+        }
+
+        SerializeEntry *const old_entries = writer->entries;
+        const u64 old_capacity = writer->capacity;
+
+        writer->entries = entries;
+        writer->capacity = capacity;
+
+        for (u64 i = 0; i < old_capacity; ++i) {
+            if (old_entries[i].value != NULL) {
+                writer->entries[serialize_slot(writer, old_entries[i].value)] = old_entries[i];
+            }
+        }
+
+        free(old_entries);
+    }
+
+    SerializeEntry *const entry = &writer->entries[serialize_slot(writer, value)];
+
+    if (entry->value == NULL) {
+        *entry = (SerializeEntry) { .value = value, .number = number };
+        ++writer->length;
+    }
+
+    return true;
+}
+
+static SerializeWork *serialize_reserve(SerializeWriter *writer, u64 length) {
+    // returns the first of 'length' new work items on top of the others
+    if (writer->work_length + length > writer->work_capacity) {
+        const u64 capacity = MAX(writer->work_capacity * 2, writer->work_length + length);
+        SerializeWork *const work = realloc(writer->work, capacity * sizeof(SerializeWork));
+
+        if (work == NULL) {
+            return NULL;
+        }
+
+        writer->work = work;
+        writer->work_capacity = capacity;
+    }
+
+    SerializeWork *const first = &writer->work[writer->work_length];
+    writer->work_length += length;
+    return first;
+}
+
+static bool serialize_value(SerializeWriter *writer, BowlValue value, BowlValue *failure) {
+    const u64 index = value == NULL ? SERIALIZE_STATICS : serialize_static_index(value);
+    u64 number, length;
+    SerializeWork *work;
+
+    if (value == NULL) {
+        return serialize_byte(writer, SerializeNullTag);
+    } else if (index != SERIALIZE_STATICS) {
+        return serialize_byte(writer, SerializeStaticTag) && serialize_varint(writer, index);
+    } else if (serialize_find(writer, value, &number)) {
+        return serialize_byte(writer, SerializeReferenceTag) && serialize_varint(writer, number);
+    }
+
+    // the elements are pushed in reverse order, such that the first one is written first
+    switch (value->type) {
+        case BowlBooleanValue:
+            return serialize_byte(writer, value->boolean.value ? SerializeTrueTag : SerializeFalseTag);
+
+        case BowlNumberValue:
+            return serialize_number(writer, value->number.value);
+
+        case BowlSymbolValue:
+        case BowlStringValue:
+            return serialize_text(writer, value) && serialize_enumerate(writer, value);
+
+        case BowlListValue:
+            {
+                // the list ends in front of the first node which was written before
+                BowlValue tail = value;
+                length = 0;
+
+                do {
+                    tail = tail->list.tail;
+                    ++length;
+                } while (tail != NULL && !serialize_find(writer, tail, &number));
+
+                if ((work = serialize_reserve(writer, length + 2)) == NULL) {
+                    return false;
+                }
+
+                work[0] = (SerializeWork) { .kind = SerializeNumberListWork, .value = value, .length = length };
+                work[1] = (SerializeWork) { .kind = SerializeWriteWork, .value = tail, .length = 0 };
+
+                for (BowlValue node = value; node != tail; node = node->list.tail) {
+                    work[1 + length--] = (SerializeWork) { .kind = SerializeWriteWork, .value = node->list.head, .length = 0 };
+                }
+
+                return serialize_byte(writer, SerializeListTag) && serialize_varint(writer, work[0].length);
+            }
+
+        case BowlVectorValue:
+            length = value->vector.length;
+
+            if ((work = serialize_reserve(writer, length + 1)) == NULL) {
+                return false;
+            }
+
+            work[0] = (SerializeWork) { .kind = SerializeNumberWork, .value = value, .length = 0 };
+
+            for (u64 i = 0; i < length; ++i) {
+                work[length - i] = (SerializeWork) { .kind = SerializeWriteWork, .value = value->vector.elements[i], .length = 0 };
+            }
+
+            return serialize_byte(writer, SerializeVectorTag) && serialize_varint(writer, length);
+
+        case BowlMapValue:
+        case BowlSortedMapValue:
+            {
+                length = value->map.length;
+
+                if ((work = serialize_reserve(writer, 2 * length + 1)) == NULL) {
+                    return false;
+                }
+
+                work[0] = (SerializeWork) { .kind = SerializeNumberWork, .value = value, .length = 0 };
+
+                BowlValue root = value;
+                MapIterator iterator;
+                BowlSortedMapCursor cursor;
+                BowlValue key, element;
+                u64 i = 2 * length;
+
+                if (value->type == BowlMapValue) {
+                    iterator = map_iterator(value);
+                } else {
+                    cursor = bowl_sorted_map_cursor(&root);
+                }
+
+                while (i > 0 && (value->type == BowlMapValue ? map_iterator_next(&iterator, &key, &element) : bowl_sorted_map_cursor_next(&cursor, &key, &element))) {
+                    work[i--] = (SerializeWork) { .kind = SerializeWriteWork, .value = key, .length = 0 };
+                    work[i--] = (SerializeWork) { .kind = SerializeWriteWork, .value = element, .length = 0 };
+                }
+
+                return serialize_byte(writer, value->type == BowlMapValue ? SerializeMapTag : SerializeSortedMapTag) && serialize_varint(writer, length);
+            }
+
+        case BowlExceptionValue:
+            if ((work = serialize_reserve(writer, 3)) == NULL) {
+                return false;
+            }
+
+            work[0] = (SerializeWork) { .kind = SerializeNumberWork, .value = value, .length = 0 };
+            work[1] = (SerializeWork) { .kind = SerializeWriteWork, .value = value->exception.message, .length = 0 };
+            work[2] = (SerializeWork) { .kind = SerializeWriteWork, .value = value->exception.cause, .length = 0 };
+
+            return serialize_byte(writer, SerializeExceptionTag);
+
+        default:
+            // native functions and libraries only exist within this process
+            *failure = value;
+            return false;
+    }
+}
+
+bool serialize_write(Output *output, BowlValue value, BowlValue *failure) {
+    // nothing is allocated in the heap, thus the values do not move
+    SerializeWriter writer = {
+        .output = output,
+        .offset = 0,
+        .entries = NULL,
+        .length = 0,
+        .capacity = 0,
+        .count = 0,
+        .work = NULL,
+        .work_length = 0,
+        .work_capacity = 0
+    };
+
+    *failure = NULL;
+
+    SerializeWork *const first = serialize_reserve(&writer, 1);
+    bool success = first != NULL && serialize_bytes(&writer, SERIALIZE_MAGIC, SERIALIZE_MAGIC_LENGTH);
+
+    if (first != NULL) {
+        *first = (SerializeWork) { .kind = SerializeWriteWork, .value = value, .length = 0 };
+    }
+
+    while (success && writer.work_length > 0) {
+        const SerializeWork work = writer.work[--writer.work_length];
+
+        switch (work.kind) {
+            case SerializeWriteWork:
+                success = serialize_value(&writer, work.value, failure);
+                break;
+            case SerializeNumberWork:
+                success = serialize_enumerate(&writer, work.value);
+                break;
+            case SerializeNumberListWork:
+                {
+                    BowlValue node = work.value;
+
+                    for (u64 i = 0; i < work.length && success; ++i, node = node->list.tail) {
+                        success = serialize_enumerate(&writer, node);
+                    }
+                }
+                break;
+        }
+    }
+
+    free(writer.entries);
+    free(writer.work);
+
+    return success && !output->failure;
+}
+
+static BowlValue serialize_failure(BowlStack stack, Output *output, BowlValue failure) {
+    if (failure != NULL) {
+        return bowl_format_exception(stack, "failed to serialize a value of type '%s'", bowl_value_type(failure)).value;
+    } else if (output->failure && errno != ENOMEM && errno != 0) {
+        return bowl_format_exception(stack, "failed to write the serialized value (%s)", strerror(errno)).value;
+    } else {
+        return bowl_exception_out_of_heap;
+    }
+}
+
+BowlValue bowl_value_serialize(BowlStack stack, BowlValue value, u8 **bytes, u64 *length) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, value, NULL, NULL);
+    BowlValue failure;
+    Output output;
+
+    *bytes = NULL;
+    *length = 0;
+
+    if (!output_buffer(&output, OUTPUT_CAPACITY)) {
+        return bowl_exception_out_of_heap;
+    }
+
+    if (!serialize_write(&output, frame.registers[0], &failure)) {
+        free(output.bytes);
+        errno = ENOMEM;
+        return serialize_failure(&frame, &output, failure);
+    }
+
+    *bytes = (u8 *) output.bytes;
+    *length = output.length;
+    return NULL;
+}
+
+BowlValue bowl_value_serialize_stream(BowlStack stack, BowlValue value, FILE *stream) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, value, NULL, NULL);
+    BowlValue failure;
+    Output output;
+
+    errno = 0;
+    output_stream(&output, stream);
+
+    const bool success = serialize_write(&output, frame.registers[0], &failure);
+
+    if (success) {
+        output_flush(&output);
+    }
+
+    if (!success || output.failure) {
+        return serialize_failure(&frame, &output, failure);
+    }
+
+    return NULL;
+}
+
+BowlValue bowl_value_serialize_descriptor(BowlStack stack, BowlValue value, int descriptor) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, value, NULL, NULL);
+    BowlValue failure;
+    Output output;
+
+    errno = 0;
+    output_descriptor(&output, descriptor);
+
+    const bool success = serialize_write(&output, frame.registers[0], &failure);
+
+    if (success) {
+        output_flush(&output);
+    }
+
+    if (!success || output.failure) {
+        return serialize_failure(&frame, &output, failure);
+    }
+
+    return NULL;
+}
+
+static bool serialize_buffer(SerializeReader *reader, u64 capacity) {
+    if (capacity > reader->buffer_capacity) {
+        const u64 resized_capacity = MAX(capacity, reader->buffer_capacity * 2);
+        u8 *const buffer = realloc(reader->buffer, resized_capacity);
+
+        if (buffer == NULL) {
+            reader->out_of_memory = true;
+            return false;
+        }
+
+        reader->buffer = buffer;
+        reader->buffer_capacity = resized_capacity;
+    }
+
+    return true;
+}
+
+static bool serialize_read(SerializeReader *reader, u64 length, const u8 **bytes) {
+    // provides the next bytes either in place or (for a stream) in the buffer
+    if (reader->stream == NULL) {
+        if ((u64) (reader->end - reader->position) < length) {
+            return false;
+        }
+
+        *bytes = reader->position;
+        reader->position += length;
+    } else {
+        if (!serialize_buffer(reader, MAX(length, 16)) || fread(reader->buffer, 1, length, reader->stream) != length) {
+            return false;
+        }
+
+        *bytes = reader->buffer;
+    }
+
+    reader->offset += length;
+    return true;
+}
+
+static bool serialize_read_byte(SerializeReader *reader, u8 *byte) {
+    const u8 *bytes;
+
+    if (!serialize_read(reader, 1, &bytes)) {
+        return false;
+    }
+
+    *byte = *bytes;
+    return true;
+}
+
+static bool serialize_read_varint(SerializeReader *reader, u64 *value) {
+    u8 byte;
+    *value = 0;
+
+    for (u64 shift = 0; shift < 64; shift += 7) {
+        if (!serialize_read_byte(reader, &byte)) {
+            return false;
+        }
+
+        *value |= (u64) (byte & 0x7F) << shift;
+
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool serialize_read_text(SerializeReader *reader, u64 width, u64 length, const u8 **codepoints) {
+    const u8 *bytes;
+
+    if (!serialize_read(reader, (width - reader->offset % width) % width, &bytes)) {
+        return false;
+    } else if (length > UINT64_MAX / width || !serialize_read(reader, length * width, &bytes)) {
+        return false;
+    }
+
+    // the codepoints are used in place, unless they are misaligned or in another byte order
+    if (width > 1 && (((uintptr_t) bytes % width) != 0 || !serialize_little_endian())) {
+        if (bytes != reader->buffer && !serialize_buffer(reader, length * width)) {
+            return false;
+        }
+
+        memmove(reader->buffer, bytes, length * width);
+        serialize_swap(reader->buffer, width, length);
+        bytes = reader->buffer;
+    }
+
+    for (u64 i = 0; i < length && width == 4; ++i) {
+        if (TEXT_AT(bytes, width, i) > 0x10FFFF) {
+            return false;
+        }
+    }
+
+    *codepoints = bytes;
+    return true;
+}
+
+static BowlValue serialize_build(BowlStackFrame *frame, SerializePending *pending, u64 *table_length) {
+    // creates the value from its elements, which is stored in the third register afterwards
+    BowlValue exception;
+
+    #define SERIALIZE_ELEMENT(index) (frame->registers[1]->vector.elements[pending->base + (index)])
+
+    switch (pending->tag) {
+        case SerializeListTag:
+            frame->registers[2] = SERIALIZE_ELEMENT(pending->length);
+
+            if (frame->registers[2] != NULL && frame->registers[2]->type != BowlListValue) {
+                return bowl_format_exception(frame, "malformed serialized value (the tail of a list is of type '%s')", bowl_value_type(frame->registers[2])).value;
+            }
+
+            for (u64 i = pending->length; i-- > 0;) {
+                BOWL_TRY(&frame->registers[2], bowl_list(frame, SERIALIZE_ELEMENT(i), frame->registers[2]));
+            }
+
+            // the nodes are numbered in their order
+            if ((exception = bowl_vector_reserve(frame, 0, *table_length, pending->length)) != NULL) {
+                return exception;
+            }
+
+            BowlValue node = frame->registers[2];
+
+            for (u64 i = 0; i < pending->length; ++i, node = node->list.tail) {
+                frame->registers[0]->vector.elements[(*table_length)++] = node;
+            }
+
+            return NULL;
+
+        case SerializeVectorTag:
+            BOWL_TRY(&frame->registers[2], bowl_vector(frame, NULL, pending->length));
+
+            for (u64 i = 0; i < pending->length; ++i) {
+                frame->registers[2]->vector.elements[i] = SERIALIZE_ELEMENT(i);
+            }
+
+            break;
+
+        case SerializeMapTag:
+            {
+                BowlStackFrame variables = BOWL_ALLOCATE_STACK_FRAME(frame, NULL, NULL, NULL);
+                BowlMapBuilder builder;
+
+                if ((exception = bowl_map_builder_begin(&variables, &builder, &variables.registers[0], NULL, pending->length)) != NULL) {
+                    return exception;
+                }
+
+                for (u64 i = 0; i < pending->length; ++i) {
+                    if ((exception = bowl_map_builder_put(&variables, &builder, SERIALIZE_ELEMENT(2 * i), SERIALIZE_ELEMENT(2 * i + 1))) != NULL) {
+                        return exception;
+                    }
+                }
+
+                BOWL_TRY(&frame->registers[2], bowl_map_builder_freeze(&variables, &builder));
+            }
+            break;
+
+        case SerializeSortedMapTag:
+            BOWL_TRY(&frame->registers[2], bowl_sorted_map(frame));
+
+            for (u64 i = 0; i < pending->length; ++i) {
+                BOWL_TRY(&frame->registers[2], bowl_sorted_map_put(frame, frame->registers[2], SERIALIZE_ELEMENT(2 * i), SERIALIZE_ELEMENT(2 * i + 1)));
+            }
+
+            break;
+
+        case SerializeExceptionTag:
+            BOWL_TRY(&frame->registers[2], bowl_exception(frame, SERIALIZE_ELEMENT(0), SERIALIZE_ELEMENT(1)));
+            break;
+    }
+
+    #undef SERIALIZE_ELEMENT
+
+    if ((exception = bowl_vector_reserve(frame, 0, *table_length, 1)) != NULL) {
+        return exception;
+    }
+
+    frame->registers[0]->vector.elements[(*table_length)++] = frame->registers[2];
+    return NULL;
+}
+
+static BowlResult serialize_deserialize(BowlStack stack, SerializeReader *reader) {
+    // the first register holds the numbered values, the second one the values which are not complete yet
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+    BowlValue statics[SERIALIZE_STATICS];
+    SerializePending *pending = NULL;
+    u64 pending_length = 0, pending_capacity = 0;
+    u64 table_length = 0, values_length = 0;
+    BowlValue exception = NULL;
+    const u8 *magic;
+    bool malformed = !serialize_read(reader, SERIALIZE_MAGIC_LENGTH, &magic) || memcmp(magic, SERIALIZE_MAGIC, SERIALIZE_MAGIC_LENGTH) != 0;
+
+    serialize_statics(statics);
+
+    while (!malformed && exception == NULL && !reader->out_of_memory) {
+        // complete all values whose elements were read
+        while (pending_length > 0 && pending[pending_length - 1].remaining == 0 && exception == NULL) {
+            SerializePending *const top = &pending[--pending_length];
+
+            if ((exception = serialize_build(&frame, top, &table_length)) != NULL) {
+                break;
+            }
+
+            // the elements are no longer needed
+            for (u64 i = top->base; i < values_length; ++i) {
+                frame.registers[1]->vector.elements[i] = NULL;
+            }
+
+            values_length = top->base;
+
+            // a value without any elements takes up an additional slot
+            if ((exception = bowl_vector_reserve(&frame, 1, values_length, 1)) != NULL) {
+                break;
+            }
+
+            frame.registers[1]->vector.elements[values_length++] = frame.registers[2];
+
+            if (pending_length > 0) {
+                --pending[pending_length - 1].remaining;
+            }
+        }
+
+        if (exception != NULL || (pending_length == 0 && values_length == 1)) {
+            break;
+        }
+
+        u8 tag;
+        u64 length = 0;
+        const u8 *bytes;
+        BowlResult result = { .failure = false, .value = NULL };
+
+        if (!serialize_read_byte(reader, &tag)) {
+            malformed = true;
+            break;
+        }
+
+        switch (tag) {
+            case SerializeNullTag:
+                break;
+
+            case SerializeFalseTag:
+            case SerializeTrueTag:
+                result = bowl_boolean(&frame, tag == SerializeTrueTag);
+                break;
+
+            case SerializeIntegerTag:
+                if (!(malformed = !serialize_read_varint(reader, &length))) {
+                    result = bowl_number(&frame, (double) ((i64) (length >> 1) ^ -(i64) (length & 1)));
+                }
+                break;
+
+            case SerializeNumberTag:
+                if (!(malformed = !serialize_read(reader, 8, &bytes))) {
+                    u64 bits = 0;
+                    double number;
+
+                    for (u64 i = 0; i < 8; ++i) {
+                        bits |= (u64) bytes[i] << (8 * i);
+                    }
+
+                    memcpy(&number, &bits, sizeof(number));
+                    result = bowl_number(&frame, number);
+                }
+                break;
+
+            case SerializeSymbolTag:
+            case SerializeSymbolTag + 1:
+            case SerializeSymbolTag + 2:
+            case SerializeStringTag:
+            case SerializeStringTag + 1:
+            case SerializeStringTag + 2:
+                {
+                    const bool symbol = tag < SerializeStringTag;
+                    const u64 width = (u64) 1 << (tag - (symbol ? SerializeSymbolTag : SerializeStringTag));
+
+                    malformed = !serialize_read_varint(reader, &length) || !serialize_read_text(reader, width, length, &bytes);
+
+                    if (!malformed) {
+                        result = bowl_text(&frame, symbol ? BowlSymbolValue : BowlStringValue, bytes, width, length);
+                    }
+
+                    if (!result.failure && !malformed) {
+                        frame.registers[2] = result.value;
+                        exception = bowl_vector_reserve(&frame, 0, table_length, 1);
+
+                        if (exception == NULL) {
+                            frame.registers[0]->vector.elements[table_length++] = frame.registers[2];
+                            result.value = frame.registers[2];
+                        }
+                    }
+                }
+                break;
+
+            case SerializeStaticTag:
+                malformed = !serialize_read_varint(reader, &length) || length >= SERIALIZE_STATICS;
+                result.value = malformed ? NULL : statics[length];
+                break;
+
+            case SerializeReferenceTag:
+                malformed = !serialize_read_varint(reader, &length) || length >= table_length;
+                result.value = malformed ? NULL : frame.registers[0]->vector.elements[length];
+                break;
+
+            case SerializeListTag:
+            case SerializeVectorTag:
+            case SerializeMapTag:
+            case SerializeSortedMapTag:
+            case SerializeExceptionTag:
+                if (tag != SerializeExceptionTag) {
+                    malformed = !serialize_read_varint(reader, &length) || length > (UINT64_MAX - 1) / 2;
+                }
+
+                if (!malformed && pending_length == pending_capacity) {
+                    const u64 capacity = MAX(pending_capacity * 2, 64);
+                    SerializePending *const resized = realloc(pending, capacity * sizeof(SerializePending));
+
+                    if (resized == NULL) {
+                        reader->out_of_memory = true;
+                        break;
+                    }
+
+                    pending = resized;
+                    pending_capacity = capacity;
+                }
+
+                if (!malformed) {
+                    pending[pending_length++] = (SerializePending) {
+                        .tag = tag,
+                        .remaining = tag == SerializeListTag ? length + 1 : tag == SerializeVectorTag ? length : tag == SerializeExceptionTag ? 2 : 2 * length,
+                        .base = values_length,
+                        .length = length
+                    };
+                }
+
+                continue;
+
+            default:
+                malformed = true;
+                break;
+        }
+
+        if (malformed || exception != NULL || reader->out_of_memory) {
+            break;
+        } else if (result.failure) {
+            exception = result.exception;
+            break;
+        }
+
+        // the value is an element of the value which is read at the moment
+        frame.registers[2] = result.value;
+
+        if ((exception = bowl_vector_reserve(&frame, 1, values_length, 1)) != NULL) {
+            break;
+        }
+
+        frame.registers[1]->vector.elements[values_length++] = frame.registers[2];
+
+        if (pending_length > 0) {
+            --pending[pending_length - 1].remaining;
+        }
+    }
+
+    free(pending);
+
+    BowlResult result;
+
+    if (reader->out_of_memory) {
+        result.failure = true;
+        result.exception = bowl_exception_out_of_heap;
+    } else if (malformed) {
+        result = bowl_format_exception(&frame, "malformed serialized value (at byte %" PRIu64 ")", reader->offset);
+        result.failure = true;
+    } else if (exception != NULL) {
+        result.failure = true;
+        result.exception = exception;
+    } else {
+        result.failure = false;
+        result.value = frame.registers[1]->vector.elements[0];
+    }
+
+    return result;
+}
+
+BowlResult bowl_value_deserialize(BowlStack stack, const u8 *bytes, u64 length, u64 *consumed) {
+    SerializeReader reader = {
+        .position = bytes,
+        .end = bytes + length,
+        .stream = NULL,
+        .offset = 0,
+        .buffer = NULL,
+        .buffer_capacity = 0,
+        .out_of_memory = false
+    };
+
+    BowlResult result = serialize_deserialize(stack, &reader);
+    free(reader.buffer);
+
+    if (!result.failure && consumed != NULL) {
+        *consumed = reader.offset;
+    } else if (!result.failure && reader.offset != length) {
+        result = bowl_format_exception(stack, "malformed serialized value (%" PRIu64 " bytes behind its end)", length - reader.offset);
+        result.failure = true;
+    }
+
+    return result;
+}
+
+BowlResult bowl_value_deserialize_stream(BowlStack stack, FILE *stream) {
+    SerializeReader reader = {
+        .position = NULL,
+        .end = NULL,
+        .stream = stream,
+        .offset = 0,
+        .buffer = NULL,
+        .buffer_capacity = 0,
+        .out_of_memory = false
+    };
+
+    BowlResult result = serialize_deserialize(stack, &reader);
+    free(reader.buffer);
+    return result;
+}
@@ -0,0 +1,111 @@
+#ifndef SERIALIZE_H
+#define SERIALIZE_H
+
+#include "../common/utility.h"
+#include <bowl/bowl.h>
+#include <bowl/api.h>
+#include "output.h"
+
+/*
+ * Values are serialized into a compact binary form, which starts with the bytes 'SERIALIZE_MAGIC'
+ * followed by the value itself. Every value starts with a tag (see 'SerializeTag'):
+ *
+ * - Integral numbers are stored as zig-zag encoded variable-length integers (7 bits per byte,
+ *   least significant group first), all other numbers as their 8 bytes in little-endian order.
+ * - Symbols and strings are stored in the smallest width which fits all of their codepoints (the
+ *   width is part of the tag), followed by their length and their codepoints in little-endian
+ *   order. Slices and concatenations are stored as flat strings.
+ * - Lists store the number of their elements, the elements and the list which follows them (which
+ *   is the empty list unless the list shares its tail with another value).
+ * - Vectors store their length and their elements, maps and sorted maps store the number of their
+ *   pairs followed by each key and its value, and exceptions store their cause and their message.
+ *
+ * Every symbol, string, list node, vector, map and exception is numbered in the order in which it
+ * is completed (i.e., a symbol or a string as soon as it is read, any other value after all of its
+ * elements were read, and the nodes of a list in their order after the list was read). A value
+ * which occurs more than once is stored only once and referenced by its number afterwards, such
+ * that shared values stay shared. Native functions and libraries cannot be serialized.
+ */
+
+// the first bytes of every serialized value, the last of which is the version of the format
+#define SERIALIZE_MAGIC "bwl\1"
+#define SERIALIZE_MAGIC_LENGTH 4
+
+typedef enum {
+    SerializeNullTag,
+    SerializeFalseTag,
+    SerializeTrueTag,
+    SerializeIntegerTag,
+    SerializeNumberTag,
+    /** The tags of the texts, which are followed by the tags for the widths two and four. */
+    SerializeSymbolTag,
+    SerializeStringTag = SerializeSymbolTag + 3,
+    SerializeListTag = SerializeStringTag + 3,
+    SerializeVectorTag,
+    SerializeMapTag,
+    SerializeSortedMapTag,
+    SerializeExceptionTag,
+    /** One of the values of the virtual machine itself, like 'bowl_sentinel_value'. */
+    SerializeStaticTag,
+    /** A value which was stored before. */
+    SerializeReferenceTag
+} SerializeTag;
+
+/**
+ * Serializes a value into a buffer (which is flushed into its stream or grows as required).
+ * @param output The buffer.
+ * @param value The value.
+ * @param failure Is set to the value which cannot be serialized (if any).
+ * @return Either 'true' on success, or 'false' if the value cannot be serialized or the buffer failed.
+ */
+bool serialize_write(Output *output, BowlValue value, BowlValue *failure);
+
+/**
+ * Serializes a value into a newly allocated buffer.
+ * @param stack The stack of the current environment.
+ * @param value The value.
+ * @param bytes The location where the buffer should be stored (which must be released using 'free').
+ * @param length The location where the number of bytes should be stored.
+ * @return Either an exception or 'NULL' on success.
+ */
+BowlValue bowl_value_serialize(BowlStack stack, BowlValue value, u8 **bytes, u64 *length);
+
+/**
+ * Serializes a value into a stream, without collecting the whole output in memory.
+ * @param stack The stack of the current environment.
+ * @param value The value.
+ * @param stream The stream.
+ * @return Either an exception or 'NULL' on success.
+ */
+BowlValue bowl_value_serialize_stream(BowlStack stack, BowlValue value, FILE *stream);
+
+/**
+ * Serializes a value into a file descriptor, without collecting the whole output in memory.
+ * @param stack The stack of the current environment.
+ * @param value The value.
+ * @param descriptor The file descriptor.
+ * @return Either an exception or 'NULL' on success.
+ */
+BowlValue bowl_value_serialize_descriptor(BowlStack stack, BowlValue value, int descriptor);
+
+/**
+ * Deserializes a value from a buffer. The buffer is read in place (e.g., a file which is mapped into
+ * memory) and it may be released as soon as this function returns.
+ * @param stack The stack of the current environment.
+ * @param bytes The buffer.
+ * @param length The number of bytes in the buffer.
+ * @param consumed The location where the number of bytes of the value should be stored, or 'NULL' if
+ * the buffer must not contain anything else.
+ * @return Either the value or an exception.
+ */
+BowlResult bowl_value_deserialize(BowlStack stack, const u8 *bytes, u64 length, u64 *consumed);
+
+/**
+ * Deserializes a value from a stream. Nothing behind the value is read from the stream.
+ * @param stack The stack of the current environment.
+ * @param stream The stream.
+ * @return Either the value or an exception.
+ */
+BowlResult bowl_value_deserialize_stream(BowlStack stack, FILE *stream);
+
+#endif
@@ -0,0 +1,711 @@
+#include "sorted.h"
+
+// the maximum number of pairs of a sequence which is about to be distributed among nodes
+#define SORTED_MAP_SEQUENCE (2 * SORTED_MAP_MAXIMUM + 1)
+
+static inline u64 sorted_size(BowlValue node) {
+    return node->map.capacity & ~SORTED_MAP_BRANCH;
+}
+
+static inline bool sorted_is_branch(BowlValue node) {
+    return (node->map.capacity & SORTED_MAP_BRANCH) != 0;
+}
+
+static inline BowlValue *sorted_pairs(BowlValue node) {
+    return &node->map.buckets[0];
+}
+
+static inline BowlValue *sorted_children(BowlValue node) {
+    return &node->map.buckets[2 * sorted_size(node)];
+}
+
+static inline BowlValueType sorted_type(BowlValue value) {
+    // the empty list is represented by 'NULL'
+    return value == NULL ? BowlListValue : value->type;
+}
+
+u64 sorted_map_node_slots(BowlValue node) {
+    const u64 size = sorted_size(node);
+    return sorted_is_branch(node) ? 3 * size + 1 : 2 * size;
+}
+
+static BowlResult sorted_allocate(BowlStack stack, u64 size, bool branch) {
+    const u64 slots = branch ? 3 * size + 1 : 2 * size;
+    BowlResult result = gc_allocate(stack, BowlSortedMapValue, slots * sizeof(BowlValue));
+
+    if (!result.failure) {
+        result.value->map.capacity = size | (branch ? SORTED_MAP_BRANCH : 0);
+        result.value->map.length = 0;
+        // the node may be visited by the garbage collector before it is filled
+        memset(result.value->map.buckets, 0, slots * sizeof(BowlValue));
+    }
+
+    return result;
+}
+
+static void sorted_fill(BowlValue node, const BowlValue *pairs, const BowlValue *children) {
+    const u64 size = sorted_size(node);
+    u64 length = size;
+
+    memcpy(sorted_pairs(node), pairs, 2 * size * sizeof(BowlValue));
+
+    if (sorted_is_branch(node)) {
+        memcpy(sorted_children(node), children, (size + 1) * sizeof(BowlValue));
+
+        for (u64 i = 0; i <= size; ++i) {
+            length += children[i]->map.length;
+        }
+    }
+
+    node->map.length = length;
+}
+
+int bowl_value_compare(BowlValue a, BowlValue b) {
+    if (a == b) {
+        return 0;
+    }
+
+    const BowlValueType a_type = sorted_type(a);
+    const BowlValueType b_type = sorted_type(b);
+
+    if (a_type != b_type) {
+        return a_type < b_type ? -1 : 1;
+    }
+
+    switch (a_type) {
+        case BowlNumberValue:
+            if (a->number.value < b->number.value) {
+                return -1;
+            } else if (a->number.value > b->number.value) {
+                return 1;
+            } else if (a->number.value == b->number.value) {
+                return 0;
+            } else {
+                // at least one of the numbers is 'NaN' (which is the only value that is not equal to itself)
+                const bool a_nan = a->number.value != a->number.value;
+                const bool b_nan = b->number.value != b->number.value;
+                return a_nan == b_nan ? 0 : (a_nan ? 1 : -1);
+            }
+
+        case BowlBooleanValue:
+            return (int) a->boolean.value - (int) b->boolean.value;
+
+        case BowlSymbolValue:
+            return text_compare(a->symbol.bytes, a->symbol.width, a->symbol.length, b->symbol.bytes, b->symbol.width, b->symbol.length);
+
+        case BowlStringValue:
+            {
+                // strings may be slices or concatenations
+                const int order = text_compare_values(a, b, MIN(a->string.length, b->string.length));
+                return order != 0 ? order : (a->string.length > b->string.length) - (a->string.length < b->string.length);
+            }
+
+        case BowlListValue:
+            while (a != NULL && b != NULL) {
+                const int order = bowl_value_compare(a->list.head, b->list.head);
+
+                if (order != 0) {
+                    return order;
+                }
+
+                a = a->list.tail;
+                b = b->list.tail;
+            }
+
+            return a == b ? 0 : (a == NULL ? -1 : 1);
+
+        case BowlVectorValue:
+            for (u64 i = 0, end = MIN(a->vector.length, b->vector.length); i < end; ++i) {
+                const int order = bowl_value_compare(a->vector.elements[i], b->vector.elements[i]);
+
+                if (order != 0) {
+                    return order;
+                }
+            }
+
+            return a->vector.length == b->vector.length ? 0 : (a->vector.length < b->vector.length ? -1 : 1);
+
+        default: {
+            // there is no natural order => at least stay consistent
+            const u64 a_hash = bowl_value_hash(a);
+            const u64 b_hash = bowl_value_hash(b);
+            return a_hash == b_hash ? 0 : (a_hash < b_hash ? -1 : 1);
+        }
+    }
+}
+
+static bool sorted_is_orderable(BowlValue value) {
+    switch (sorted_type(value)) {
+        case BowlNumberValue:
+        case BowlBooleanValue:
+        case BowlSymbolValue:
+        case BowlStringValue:
+            return true;
+
+        case BowlListValue:
+            for (; value != NULL; value = value->list.tail) {
+                if (!sorted_is_orderable(value->list.head)) {
+                    return false;
+                }
+            }
+
+            return true;
+
+        case BowlVectorValue:
+            for (u64 i = 0, end = value->vector.length; i < end; ++i) {
+                if (!sorted_is_orderable(value->vector.elements[i])) {
+                    return false;
+                }
+            }
+
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static bool sorted_starts_with(BowlValue value, BowlValue prefix) {
+    if (sorted_type(value) != sorted_type(prefix)) {
+        return false;
+    }
+
+    switch (sorted_type(value)) {
+        case BowlSymbolValue:
+        case BowlStringValue:
+            // symbols and strings share the same layout, whereas the value and the prefix may differ in width and kind
+            return value->string.length >= prefix->string.length
+                && text_compare_values(value, prefix, prefix->string.length) == 0;
+
+        default:
+            return bowl_value_compare(value, prefix) == 0;
+    }
+}
+
+static u64 sorted_search(BowlValue node, BowlValue key, bool *found) {
+    // finds the index of the first key which is not less than the provided key
+    const BowlValue *const pairs = sorted_pairs(node);
+    u64 low = 0;
+    u64 high = sorted_size(node);
+
+    *found = false;
+
+    while (low < high) {
+        const u64 middle = low + (high - low) / 2;
+        const int order = bowl_value_compare(pairs[2 * middle], key);
+
+        if (order < 0) {
+            low = middle + 1;
+        } else if (order > 0) {
+            high = middle;
+        } else {
+            *found = true;
+            return middle;
+        }
+    }
+
+    return low;
+}
+
+static BowlResult sorted_replace(BowlStack stack, BowlValue node, u64 slot, BowlValue value, u64 length) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, node, value, NULL);
+    BowlResult result = sorted_allocate(&frame, sorted_size(node), sorted_is_branch(node));
+
+    if (!result.failure) {
+        memcpy(result.value->map.buckets, frame.registers[0]->map.buckets, sorted_map_node_slots(frame.registers[0]) * sizeof(BowlValue));
+        result.value->map.buckets[slot] = frame.registers[1];
+        result.value->map.length = length;
+    }
+
+    return result;
+}
+
+static BowlResult sorted_insert(BowlStack stack, BowlValue node, u64 index, BowlValue key, BowlValue value, BowlValue left, BowlValue right, bool *split) {
+    // inserts the pair at the index and (for branches) replaces the child at the index by the two provided children
+    BowlStackFrame arguments = BOWL_ALLOCATE_STACK_FRAME(stack, node, key, value);
+    BowlStackFrame halves = BOWL_ALLOCATE_STACK_FRAME(&arguments, left, right, NULL);
+    BowlStackFrame variables = BOWL_ALLOCATE_STACK_FRAME(&halves, NULL, NULL, NULL);
+    const bool branch = sorted_is_branch(node);
+    const u64 size = sorted_size(node) + 1;
+    const u64 left_size = size / 2;
+    BowlResult result;
+
+    // allocate all nodes in advance since the pairs are collected in memory the garbage collector does not know of
+    if (size <= SORTED_MAP_MAXIMUM) {
+        result = sorted_allocate(&variables, size, branch);
+        if (result.failure) {
+            return result;
+        }
+        variables.registers[0] = result.value;
+    } else {
+        result = sorted_allocate(&variables, left_size, branch);
+        if (result.failure) {
+            return result;
+        }
+        variables.registers[0] = result.value;
+
+        result = sorted_allocate(&variables, size - left_size - 1, branch);
+        if (result.failure) {
+            return result;
+        }
+        variables.registers[1] = result.value;
+
+        result = sorted_allocate(&variables, 1, true);
+        if (result.failure) {
+            return result;
+        }
+        variables.registers[2] = result.value;
+    }
+
+    BowlValue pairs[2 * SORTED_MAP_SEQUENCE];
+    BowlValue children[SORTED_MAP_SEQUENCE + 1];
+    const BowlValue source = arguments.registers[0];
+    const u64 source_size = size - 1;
+
+    memcpy(&pairs[0], sorted_pairs(source), 2 * index * sizeof(BowlValue));
+    pairs[2 * index] = arguments.registers[1];
+    pairs[2 * index + 1] = arguments.registers[2];
+    memcpy(&pairs[2 * (index + 1)], &sorted_pairs(source)[2 * index], 2 * (source_size - index) * sizeof(BowlValue));
+
+    if (branch) {
+        memcpy(&children[0], sorted_children(source), index * sizeof(BowlValue));
+        children[index] = halves.registers[0];
+        children[index + 1] = halves.registers[1];
+        memcpy(&children[index + 2], &sorted_children(source)[index + 1], (source_size - index) * sizeof(BowlValue));
+    }
+
+    if (size <= SORTED_MAP_MAXIMUM) {
+        sorted_fill(variables.registers[0], pairs, children);
+        *split = false;
+        result.value = variables.registers[0];
+    } else {
+        // the node overflows => pass the pair in the middle up to the parent
+        sorted_fill(variables.registers[0], &pairs[0], &children[0]);
+        sorted_fill(variables.registers[1], &pairs[2 * (left_size + 1)], &children[left_size + 1]);
+
+        const BowlValue halves_of_parent[2] = { variables.registers[0], variables.registers[1] };
+        sorted_fill(variables.registers[2], &pairs[2 * left_size], halves_of_parent);
+        *split = true;
+        result.value = variables.registers[2];
+    }
+
+    return result;
+}
+
+static BowlResult sorted_node_put(BowlStack stack, BowlValue node, BowlValue key, BowlValue value, bool *added, bool *split) {
+    // if the node overflows, the result is a branch with a single pair whose children are the two halves
+    BowlStackFrame arguments = BOWL_ALLOCATE_STACK_FRAME(stack, node, key, value);
+    BowlStackFrame variables = BOWL_ALLOCATE_STACK_FRAME(&arguments, NULL, NULL, NULL);
+    bool found;
+    const u64 index = sorted_search(node, key, &found);
+    BowlResult result = {
+        .failure = false,
+        .value = node
+    };
+
+    *split = false;
+
+    if (found) {
+        if (sorted_pairs(node)[2 * index + 1] == value) {
+            return result;
+        }
+
+        return sorted_replace(&variables, node, 2 * index + 1, value, node->map.length);
+    }
+
+    if (!sorted_is_branch(node)) {
+        *added = true;
+        return sorted_insert(&variables, node, index, key, value, NULL, NULL, split);
+    }
+
+    bool child_split;
+    result = sorted_node_put(&variables, sorted_children(node)[index], key, value, added, &child_split);
+
+    if (result.failure || result.value == sorted_children(arguments.registers[0])[index]) {
+        return result;
+    }
+
+    if (!child_split) {
+        node = arguments.registers[0];
+        return sorted_replace(&variables, node, 2 * sorted_size(node) + index, result.value, node->map.length + (*added ? 1 : 0));
+    }
+
+    // absorb the pair which was passed up by the child
+    variables.registers[0] = result.value;
+    const BowlValue middle = variables.registers[0];
+
+    return sorted_insert(
+        &variables,
+        arguments.registers[0],
+        index,
+        sorted_pairs(middle)[0],
+        sorted_pairs(middle)[1],
+        sorted_children(middle)[0],
+        sorted_children(middle)[1],
+        split
+    );
+}
+
+static BowlResult sorted_rebalance(BowlStack stack, BowlValue node, u64 index, BowlValue child, bool replace, BowlValue key, BowlValue value) {
+    // replaces the child at the index (and optionally the pair at the index) and repairs the child if it underflows
+    BowlStackFrame arguments = BOWL_ALLOCATE_STACK_FRAME(stack, node, child, NULL);
+    BowlStackFrame pair = BOWL_ALLOCATE_STACK_FRAME(&arguments, key, value, NULL);
+    BowlStackFrame variables = BOWL_ALLOCATE_STACK_FRAME(&pair, NULL, NULL, NULL);
+    const u64 size = sorted_size(node);
+    const bool underflow = sorted_size(child) < SORTED_MAP_MINIMUM;
+    // the separator is the pair between the child and its sibling
+    const u64 separator = index > 0 ? index - 1 : index;
+    const BowlValue sibling = sorted_children(node)[index > 0 ? index - 1 : index + 1];
+    const u64 combined = sorted_size(child) + 1 + sorted_size(sibling);
+    const bool branch = sorted_is_branch(child);
+    const u64 left_size = combined / 2;
+    BowlResult result;
+
+    // allocate all nodes in advance since the pairs are collected in memory the garbage collector does not know of
+    if (!underflow) {
+        result = sorted_allocate(&variables, size, true);
+        if (result.failure) {
+            return result;
+        }
+        variables.registers[0] = result.value;
+    } else if (combined <= SORTED_MAP_MAXIMUM) {
+        result = sorted_allocate(&variables, combined, branch);
+        if (result.failure) {
+            return result;
+        }
+        variables.registers[1] = result.value;
+
+        if (size > 1) {
+            result = sorted_allocate(&variables, size - 1, true);
+            if (result.failure) {
+                return result;
+            }
+            variables.registers[0] = result.value;
+        }
+    } else {
+        result = sorted_allocate(&variables, left_size, branch);
+        if (result.failure) {
+            return result;
+        }
+        variables.registers[1] = result.value;
+
+        result = sorted_allocate(&variables, combined - left_size - 1, branch);
+        if (result.failure) {
+            return result;
+        }
+        variables.registers[2] = result.value;
+
+        result = sorted_allocate(&variables, size, true);
+        if (result.failure) {
+            return result;
+        }
+        variables.registers[0] = result.value;
+    }
+
+    BowlValue pairs[2 * SORTED_MAP_SEQUENCE];
+    BowlValue children[SORTED_MAP_SEQUENCE + 1];
+    const BowlValue source = arguments.registers[0];
+
+    memcpy(pairs, sorted_pairs(source), 2 * size * sizeof(BowlValue));
+    memcpy(children, sorted_children(source), (size + 1) * sizeof(BowlValue));
+    children[index] = arguments.registers[1];
+
+    if (replace) {
+        pairs[2 * index] = pair.registers[0];
+        pairs[2 * index + 1] = pair.registers[1];
+    }
+
+    if (!underflow) {
+        sorted_fill(variables.registers[0], pairs, children);
+        result.value = variables.registers[0];
+        return result;
+    }
+
+    // concatenate both children and the separator
+    BowlValue sequence_pairs[2 * SORTED_MAP_SEQUENCE];
+    BowlValue sequence_children[SORTED_MAP_SEQUENCE + 1];
+    const BowlValue left = children[separator];
+    const BowlValue right = children[separator + 1];
+    const u64 left_length = sorted_size(left);
+    const u64 right_length = sorted_size(right);
+
+    memcpy(&sequence_pairs[0], sorted_pairs(left), 2 * left_length * sizeof(BowlValue));
+    sequence_pairs[2 * left_length] = pairs[2 * separator];
+    sequence_pairs[2 * left_length + 1] = pairs[2 * separator + 1];
+    memcpy(&sequence_pairs[2 * (left_length + 1)], sorted_pairs(right), 2 * right_length * sizeof(BowlValue));
+
+    if (branch) {
+        memcpy(&sequence_children[0], sorted_children(left), (left_length + 1) * sizeof(BowlValue));
+        memcpy(&sequence_children[left_length + 1], sorted_children(right), (right_length + 1) * sizeof(BowlValue));
+    }
+
+    if (combined <= SORTED_MAP_MAXIMUM) {
+        // merge both children into one node
+        sorted_fill(variables.registers[1], sequence_pairs, sequence_children);
+
+        if (size == 1) {
+            // the root lost its last pair => the tree shrinks
+            result.value = variables.registers[1];
+            return result;
+        }
+
+        children[separator] = variables.registers[1];
+        memmove(&pairs[2 * separator], &pairs[2 * (separator + 1)], 2 * (size - separator - 1) * sizeof(BowlValue));
+        memmove(&children[separator + 1], &children[separator + 2], (size - separator - 1) * sizeof(BowlValue));
+    } else {
+        // distribute the pairs evenly among both children
+        sorted_fill(variables.registers[1], &sequence_pairs[0], &sequence_children[0]);
+        sorted_fill(variables.registers[2], &sequence_pairs[2 * (left_size + 1)], &sequence_children[left_size + 1]);
+
+        children[separator] = variables.registers[1];
+        children[separator + 1] = variables.registers[2];
+        pairs[2 * separator] = sequence_pairs[2 * left_size];
+        pairs[2 * separator + 1] = sequence_pairs[2 * left_size + 1];
+    }
+
+    sorted_fill(variables.registers[0], pairs, children);
+    result.value = variables.registers[0];
+
+    return result;
+}
+
+static BowlResult sorted_node_delete(BowlStack stack, BowlValue node, BowlValue key, bool *removed) {
+    // the resulting node may underflow, which has to be repaired by the parent
+    BowlStackFrame arguments = BOWL_ALLOCATE_STACK_FRAME(stack, node, key, NULL);
+    BowlStackFrame variables = BOWL_ALLOCATE_STACK_FRAME(&arguments, NULL, NULL, NULL);
+    bool found;
+    const u64 index = sorted_search(node, key, &found);
+    BowlResult result = {
+        .failure = false,
+        .value = node
+    };
+
+    if (!sorted_is_branch(node)) {
+        if (!found) {
+            return result;
+        }
+
+        result = sorted_allocate(&variables, sorted_size(node) - 1, false);
+
+        if (!result.failure) {
+            const BowlValue *const source = sorted_pairs(arguments.registers[0]);
+            BowlValue *const destination = sorted_pairs(result.value);
+            const u64 size = sorted_size(result.value);
+
+            memcpy(&destination[0], &source[0], 2 * index * sizeof(BowlValue));
+            memcpy(&destination[2 * index], &source[2 * (index + 1)], 2 * (size - index) * sizeof(BowlValue));
+            result.value->map.length = size;
+            *removed = true;
+        }
+
+        return result;
+    }
+
+    if (found) {
+        // replace the pair by its predecessor, which is removed from the child instead
+        BowlValue predecessor = sorted_children(node)[index];
+
+        while (sorted_is_branch(predecessor)) {
+            predecessor = sorted_children(predecessor)[sorted_size(predecessor)];
+        }
+
+        variables.registers[1] = sorted_pairs(predecessor)[2 * (sorted_size(predecessor) - 1)];
+        variables.registers[2] = sorted_pairs(predecessor)[2 * (sorted_size(predecessor) - 1) + 1];
+    }
+
+    result = sorted_node_delete(&variables, sorted_children(node)[index], found ? variables.registers[1] : key, removed);
+
+    if (result.failure) {
+        return result;
+    } else if (!*removed) {
+        result.value = arguments.registers[0];
+        return result;
+    }
+
+    return sorted_rebalance(&variables, arguments.registers[0], index, result.value, found, variables.registers[1], variables.registers[2]);
+}
+
+static BowlSortedMapCursor sorted_cursor(BowlValue *map, BowlValue *from, BowlValue *end, BowlValue *prefix) {
+    BowlSortedMapCursor cursor = {
+        .map = map,
+        .end = end,
+        .prefix = prefix,
+        .epoch = gc_collections(),
+        .depth = 0
+    };
+
+    BowlValue node = *map;
+
+    if (from == NULL) {
+        cursor.nodes[0] = node;
+        cursor.positions[0] = 0;
+        cursor.depth = 1;
+        return cursor;
+    }
+
+    // descend to the first key which is not less than the lower bound
+    while (true) {
+        bool found;
+        const u64 index = sorted_search(node, *from, &found);
+
+        cursor.nodes[cursor.depth] = node;
+
+        if (!sorted_is_branch(node)) {
+            cursor.positions[cursor.depth++] = index;
+            break;
+        }
+
+        // the odd positions of a branch refer to its pairs, the even positions to its children
+        cursor.positions[cursor.depth++] = 2 * index + 1;
+
+        if (found) {
+            break;
+        }
+
+        node = sorted_children(node)[index];
+    }
+
+    return cursor;
+}
+
+BowlResult bowl_sorted_map(BowlStack stack) {
+    return sorted_allocate(stack, 0, false);
+}
+
+BowlValue bowl_sorted_map_get_or_else(BowlValue map, BowlValue key, BowlValue otherwise) {
+    BowlValue node = map;
+
+    while (true) {
+        bool found;
+        const u64 index = sorted_search(node, key, &found);
+
+        if (found) {
+            return sorted_pairs(node)[2 * index + 1];
+        } else if (!sorted_is_branch(node)) {
+            return otherwise;
+        }
+
+        node = sorted_children(node)[index];
+    }
+}
+
+BowlResult bowl_sorted_map_put(BowlStack stack, BowlValue map, BowlValue key, BowlValue value) {
+    if (!sorted_is_orderable(key)) {
+        BowlResult result = bowl_format_exception(stack, "the sorted map does not support keys of type '%s' in function '%s'", bowl_value_type(key), __FUNCTION__);
+        result.failure = true;
+        return result;
+    }
+
+    // if the root splits, the branch that holds the pair in the middle becomes the new root
+    bool added = false;
+    bool split;
+    return sorted_node_put(stack, map, key, value, &added, &split);
+}
+
+BowlResult bowl_sorted_map_delete(BowlStack stack, BowlValue map, BowlValue key) {
+    bool removed = false;
+    return sorted_node_delete(stack, map, key, &removed);
+}
+
+bool bowl_sorted_map_at(BowlValue map, u64 index, BowlValue *key, BowlValue *value) {
+    BowlValue node = map;
+
+    if (index >= map->map.length) {
+        return false;
+    }
+
+    while (sorted_is_branch(node)) {
+        const BowlValue *const children = sorted_children(node);
+        const u64 size = sorted_size(node);
+        u64 i = 0;
+
+        // skip all children (and the pairs between them) that precede the index
+        while (index >= children[i]->map.length) {
+            index -= children[i]->map.length;
+
+            if (index == 0 && i < size) {
+                *key = sorted_pairs(node)[2 * i];
+                *value = sorted_pairs(node)[2 * i + 1];
+                return true;
+            }
+
+            --index;
+            ++i;
+        }
+
+        node = children[i];
+    }
+
+    *key = sorted_pairs(node)[2 * index];
+    *value = sorted_pairs(node)[2 * index + 1];
+
+    return true;
+}
+
+BowlSortedMapCursor bowl_sorted_map_cursor(BowlValue *map) {
+    return sorted_cursor(map, NULL, NULL, NULL);
+}
+
+BowlSortedMapCursor bowl_sorted_map_range(BowlValue *map, BowlValue *from, BowlValue *to) {
+    return sorted_cursor(map, from, to, NULL);
+}
+
+BowlSortedMapCursor bowl_sorted_map_prefix(BowlValue *map, BowlValue *prefix) {
+    return sorted_cursor(map, prefix, NULL, prefix);
+}
+
+bool bowl_sorted_map_cursor_next(BowlSortedMapCursor *cursor, BowlValue *key, BowlValue *value) {
+    if (cursor->epoch != gc_collections() && cursor->depth > 0) {
+        // the nodes were relocated but their layout is the same => follow the positions again
+        cursor->nodes[0] = *cursor->map;
+
+        for (u64 i = 1; i < cursor->depth; ++i) {
+            // the position of the parent was advanced as soon as the child was entered
+            cursor->nodes[i] = sorted_children(cursor->nodes[i - 1])[(cursor->positions[i - 1] - 1) / 2];
+        }
+
+        cursor->epoch = gc_collections();
+    }
+
+    while (cursor->depth > 0) {
+        const BowlValue node = cursor->nodes[cursor->depth - 1];
+        const u64 position = cursor->positions[cursor->depth - 1];
+        const u64 size = sorted_size(node);
+        u64 index;
+
+        if (!sorted_is_branch(node)) {
+            if (position >= size) {
+                --cursor->depth;
+                continue;
+            }
+
+            index = position;
+        } else if (position > 2 * size) {
+            --cursor->depth;
+            continue;
+        } else if (position % 2 == 0) {
+            cursor->positions[cursor->depth - 1] = position + 1;
+            cursor->nodes[cursor->depth] = sorted_children(node)[position / 2];
+            cursor->positions[cursor->depth] = 0;
+            ++cursor->depth;
+            continue;
+        } else {
+            index = (position - 1) / 2;
+        }
+
+        cursor->positions[cursor->depth - 1] = position + 1;
+        *key = sorted_pairs(node)[2 * index];
+        *value = sorted_pairs(node)[2 * index + 1];
+
+        if ((cursor->end != NULL && bowl_value_compare(*key, *cursor->end) >= 0)
+            || (cursor->prefix != NULL && !sorted_starts_with(*key, *cursor->prefix))) {
+            // the keys are sorted => all remaining keys are out of range as well
+            cursor->depth = 0;
+            return false;
+        }
+
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,160 @@
+#ifndef SORTED_H
+#define SORTED_H
+
+#include "../common/utility.h"
+#include <bowl/bowl.h>
+#include <bowl/api.h>
+#include "gc.h"
+#include "text.h"
+
+/*
+ * Sorted maps are persistent B-trees. Every node of the tree is a value of type
+ * 'BowlSortedMapValue' which reuses the fields of 'BowlMapValue' as follows:
+ *
+ * - 'length' is the number of key-value pairs which are stored in the subtree of the node.
+ * - 'capacity' holds the number of key-value pairs of the node itself. The highest bit is set
+ *   if the node is a branch (i.e., if it has children).
+ * - 'buckets' contains the key-value pairs of the node (as consecutive key and value entries) in
+ *   ascending order of their keys, followed by the children of the node if it is a branch.
+ *
+ * Every node but the root holds between 'SORTED_MAP_MINIMUM' and 'SORTED_MAP_MAXIMUM' pairs.
+ * A branch with 'n' pairs has 'n + 1' children. The keys are ordered by 'bowl_value_compare'.
+ */
+
+#define SORTED_MAP_MAXIMUM 15
+#define SORTED_MAP_MINIMUM (SORTED_MAP_MAXIMUM / 2)
+#define SORTED_MAP_BRANCH ((u64) 1 << 63)
+#define SORTED_MAP_MAX_DEPTH 24
+
+typedef struct {
+    /** A reference to the sorted map which is iterated (this reference must be visible to the garbage collector). */
+    BowlValue *map;
+    /** A reference to the exclusive upper bound of the keys, or 'NULL' if there is no upper bound. */
+    BowlValue *end;
+    /** A reference to the prefix which all keys must start with, or 'NULL' if there is no prefix. */
+    BowlValue *prefix;
+    /** The number of garbage collections at the time the path of the cursor was computed. */
+    u64 epoch;
+    /** The nodes on the path from the root to the current node. */
+    BowlValue nodes[SORTED_MAP_MAX_DEPTH];
+    /** The next position within each of the nodes. */
+    u64 positions[SORTED_MAP_MAX_DEPTH];
+    /** The number of nodes on the path (zero if the iteration is finished). */
+    u64 depth;
+} BowlSortedMapCursor;
+
+/**
+ * Returns the number of value slots which are used by the provided sorted map node.
+ * @param node The sorted map node.
+ * @return The number of slots in the 'buckets' field of the node.
+ */
+u64 sorted_map_node_slots(BowlValue node);
+
+/**
+ * Compares two values according to the order of the keys of sorted maps.
+ *
+ * Values of different types are ordered by their type. Numbers and booleans are ordered by
+ * their value (where 'NaN' is larger than all other numbers), strings and symbols by their
+ * codepoints, and lists and vectors lexicographically by their elements.
+ * @param a The first value.
+ * @param b The second value.
+ * @return A negative number if 'a' is less than 'b', zero if both are equal, or a positive
+ * number otherwise.
+ */
+int bowl_value_compare(BowlValue a, BowlValue b);
+
+/**
+ * Creates a new empty sorted map.
+ * @param stack The stack of the current environment.
+ * @return Either the sorted map or an exception.
+ */
+BowlResult bowl_sorted_map(BowlStack stack);
+
+/**
+ * Returns the value which is associated with the provided key in O(log n).
+ * @param map The sorted map.
+ * @param key The key.
+ * @param otherwise The value which is returned if the map does not contain the key.
+ * @return Either the associated value or the provided default value.
+ */
+BowlValue bowl_sorted_map_get_or_else(BowlValue map, BowlValue key, BowlValue otherwise);
+
+/**
+ * Creates a new sorted map which additionally associates the key with the value.
+ *
+ * Only values that can be ordered (i.e., numbers, booleans, strings, symbols, as well as lists
+ * and vectors of such values) are accepted as keys.
+ * @param stack The stack of the current environment.
+ * @param map The sorted map.
+ * @param key The key.
+ * @param value The value.
+ * @return Either the new sorted map or an exception.
+ */
+BowlResult bowl_sorted_map_put(BowlStack stack, BowlValue map, BowlValue key, BowlValue value);
+
+/**
+ * Creates a new sorted map which does not contain the provided key.
+ * @param stack The stack of the current environment.
+ * @param map The sorted map.
+ * @param key The key which should be removed.
+ * @return Either the new sorted map or an exception.
+ */
+BowlResult bowl_sorted_map_delete(BowlStack stack, BowlValue map, BowlValue key);
+
+/**
+ * Looks up the key-value pair at the provided position in the order of the keys in O(log n).
+ * @param map The sorted map.
+ * @param index The position of the pair.
+ * @param key The location where the key should be stored.
+ * @param value The location where the value should be stored.
+ * @return Either 'true' if the position is within the bounds of the map, or 'false' otherwise.
+ */
+bool bowl_sorted_map_at(BowlValue map, u64 index, BowlValue *key, BowlValue *value);
+
+/**
+ * Creates a cursor over all key-value pairs of a sorted map in ascending order of their keys.
+ *
+ * The cursor does not allocate and stays valid if the garbage collector runs during the
+ * iteration. For this, the map is referenced by the location 'map', which must be part of the
+ * stack of the caller (e.g., one of its registers).
+ * @param map The location of the sorted map.
+ * @return The cursor.
+ */
+BowlSortedMapCursor bowl_sorted_map_cursor(BowlValue *map);
+
+/**
+ * Creates a cursor over all key-value pairs whose keys are within the provided range.
+ *
+ * Just like the map itself, the bounds are referenced by locations which must be visible to
+ * the garbage collector.
+ * @param map The location of the sorted map.
+ * @param from The location of the inclusive lower bound, or 'NULL' if there is no lower bound.
+ * @param to The location of the exclusive upper bound, or 'NULL' if there is no upper bound.
+ * @return The cursor.
+ */
+BowlSortedMapCursor bowl_sorted_map_range(BowlValue *map, BowlValue *from, BowlValue *to);
+
+/**
+ * Creates a cursor over all key-value pairs whose keys start with the provided prefix.
+ *
+ * Strings and symbols start with a prefix of the same type if their first codepoints are equal
+ * to the ones of the prefix. Keys of any other type only match a prefix that is equal to them.
+ * @param map The location of the sorted map.
+ * @param prefix The location of the prefix.
+ * @return The cursor.
+ */
+BowlSortedMapCursor bowl_sorted_map_prefix(BowlValue *map, BowlValue *prefix);
+
+/**
+ * Advances the cursor to the next key-value pair.
+ *
+ * The key and the value are not visible to the garbage collector. Therefore, they must be
+ * stored in the stack of the caller before any further allocation.
+ * @param cursor The cursor.
+ * @param key The location where the next key should be stored.
+ * @param value The location where the next value should be stored.
+ * @return Either 'true' if another key-value pair was found, or 'false' otherwise.
+ */
+bool bowl_sorted_map_cursor_next(BowlSortedMapCursor *cursor, BowlValue *key, BowlValue *value);
+
+#endif
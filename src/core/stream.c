@@ -0,0 +1,266 @@
+#include "stream.h"
+#include "core.h"
+#include <errno.h>
+#include <fcntl.h>
+
+#if defined(OS_UNIX)
+    #include <unistd.h>
+#elif defined(OS_WINDOWS)
+    #include <io.h>
+#endif
+
+// the number of bytes which are read at once (the tests use tiny chunks to cover their boundaries)
+#if !defined(STREAM_CHUNK_SIZE)
+    #define STREAM_CHUNK_SIZE ((u64) 64 * 1024)
+#endif
+
+typedef struct {
+    /** The string which identifies the stream on the callstack. */
+    BowlValue name;
+    int descriptor;
+    /** Whether the end of the source was reached. */
+    bool end;
+    /** The bytes which were read but not tokenized yet (e.g., the beginning of a token which continues in the next chunk). */
+    u8 *bytes;
+    u64 length;
+    u64 capacity;
+    /** The position of the first byte within the source. */
+    u64 line;
+    u64 column;
+} Stream;
+
+// all streams which are currently open
+static Stream **stream_list = NULL;
+static u64 stream_list_size = 0;
+static u64 stream_list_capacity = 0;
+
+static Stream *stream_find(BowlValue name) {
+    for (u64 i = 0; i < stream_list_size; ++i) {
+        if (stream_list[i]->name == name) {
+            return stream_list[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void stream_close(Stream *stream) {
+    for (u64 i = 0; i < stream_list_size; ++i) {
+        if (stream_list[i] == stream) {
+            memmove(&stream_list[i], &stream_list[i + 1], (stream_list_size - (i + 1)) * sizeof(Stream *));
+            --stream_list_size;
+            break;
+        }
+    }
+
+    close(stream->descriptor);
+    free(stream->bytes);
+    free(stream);
+}
+
+static BowlValue stream_read(BowlStack stack, Stream *stream) {
+    // a token which does not fit into the buffer requires a larger one
+    if (stream->length == stream->capacity) {
+        const u64 capacity = MAX(stream->capacity * 2, STREAM_CHUNK_SIZE);
+        u8 *const bytes = realloc(stream->bytes, capacity);
+
+        if (bytes == NULL) {
+            return bowl_exception_out_of_heap;
+        }
+
+        stream->bytes = bytes;
+        stream->capacity = capacity;
+    }
+
+    i64 count;
+
+    do {
+        count = read(stream->descriptor, &stream->bytes[stream->length], stream->capacity - stream->length);
+    } while (count < 0 && errno == EINTR);
+
+    if (count < 0) {
+        return bowl_format_exception(stack, "failed to read from '%s' (%s)", bowl_text_borrow(stream->name, NULL), strerror(errno)).exception;
+    }
+
+    stream->length += count;
+    stream->end = count == 0;
+
+    return NULL;
+}
+
+static u64 stream_complete_length(const u8 *bytes, u64 length) {
+    // finds the end of the last complete UTF-8 sequence, since a sequence may be split between two chunks
+    u64 start = length;
+
+    while (start > 0 && length - start < 3 && (bytes[start - 1] & 0xC0) == 0x80) {
+        --start;
+    }
+
+    if (start > 0) {
+        const u8 lead = bytes[start - 1];
+        const u64 expected = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+
+        if (expected > length - (start - 1)) {
+            return start - 1;
+        }
+    }
+
+    return length;
+}
+
+static BowlValue stream_continue(BowlStack stack);
+
+static BowlResult stream_next(BowlStack stack, Stream *stream, BowlValue rest) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, stream->name, rest, NULL);
+    BowlResult result;
+
+    result.exception = stream_read(&frame, stream);
+
+    if (result.exception != NULL) {
+        result.failure = true;
+        return result;
+    }
+
+    // the scanner relies on valid UTF-8, whereas an incomplete sequence at the end is completed by the next chunk
+    const u64 length = stream->end ? stream->length : stream_complete_length(stream->bytes, stream->length);
+    u64 count;
+    u32 maximum;
+    const u32 state = unicode_utf8_measure(stream->bytes, length, &count, &maximum);
+
+    if (state != UNICODE_UTF8_STATE_ACCEPT) {
+        result.failure = true;
+        result.exception = state == UNICODE_UTF8_STATE_REJECT ? bowl_exception_malformed_utf8 : bowl_exception_incomplete_utf8;
+        return result;
+    }
+
+    if (!stream->end) {
+        // the tokens are followed by the continuation of the stream
+        result = bowl_list(&frame, frame.registers[0], frame.registers[1]);
+
+        if (result.failure) {
+            return result;
+        }
+
+        frame.registers[1] = result.value;
+        result = bowl_function(&frame, NULL, stream_continue);
+
+        if (result.failure) {
+            return result;
+        }
+
+        result = bowl_list(&frame, result.value, frame.registers[1]);
+
+        if (result.failure) {
+            return result;
+        }
+
+        frame.registers[1] = result.value;
+    }
+
+    BowlScanner scanner = scanner_from_utf8(stream->bytes, length);
+    scanner.partial = !stream->end;
+    scanner.line = stream->line;
+    scanner.column = stream->column;
+
+    result = bowl_tokens_scanner(&frame, &scanner, frame.registers[1]);
+
+    if (result.failure) {
+        return result;
+    }
+
+    if (stream->end) {
+        stream_close(stream);
+    } else {
+        // keep the bytes of the last token, which is scanned again together with the next chunk
+        memmove(&stream->bytes[0], &stream->bytes[scanner.offset], stream->length - scanner.offset);
+        stream->length -= scanner.offset;
+        stream->line = scanner.line;
+        stream->column = scanner.column;
+    }
+
+    return result;
+}
+
+static BowlValue stream_continue(BowlStack stack) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+    const BowlValue callstack = *frame.callstack;
+    Stream *const stream = callstack == NULL ? NULL : stream_find(callstack->list.head);
+
+    if (stream == NULL) {
+        return bowl_format_exception(&frame, "the callstack does not continue with a token stream in function '%s'", __FUNCTION__).exception;
+    }
+
+    BowlValue tokens;
+    BOWL_TRY(&tokens, stream_next(&frame, stream, callstack->list.tail));
+    *frame.callstack = tokens;
+
+    return NULL;
+}
+
+BowlResult bowl_tokens_stream(BowlStack stack, int descriptor, const char *name) {
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+    BowlResult result = bowl_string_utf8(&frame, (u8 *) name, strlen(name));
+
+    if (result.failure) {
+        close(descriptor);
+        return result;
+    }
+
+    frame.registers[0] = result.value;
+    Stream *const stream = malloc(sizeof(Stream));
+
+    if (stream_list_size == stream_list_capacity) {
+        const u64 capacity = MAX(stream_list_capacity * 2, 4);
+        Stream **const list = realloc(stream_list, capacity * sizeof(Stream *));
+
+        if (list != NULL) {
+            stream_list = list;
+            stream_list_capacity = capacity;
+        }
+    }
+
+    if (stream == NULL || stream_list_size == stream_list_capacity) {
+        free(stream);
+        close(descriptor);
+        result.failure = true;
+        result.exception = bowl_exception_out_of_heap;
+        return result;
+    }
+
+    stream->name = frame.registers[0];
+    stream->descriptor = descriptor;
+    stream->end = false;
+    stream->bytes = NULL;
+    stream->length = 0;
+    stream->capacity = 0;
+    stream->line = 1;
+    stream->column = 1;
+    stream_list[stream_list_size++] = stream;
+
+    return stream_next(&frame, stream, NULL);
+}
+
+BowlResult bowl_tokens_file(BowlStack stack, const char *path) {
+    const int descriptor = open(path, O_RDONLY);
+
+    if (descriptor < 0) {
+        BowlResult result = bowl_format_exception(stack, "failed to open file '%s' (%s)", path, strerror(errno));
+        result.failure = true;
+        return result;
+    }
+
+    return bowl_tokens_stream(stack, descriptor, path);
+}
+
+void stream_collect(void) {
+    for (u64 i = 0; i < stream_list_size; ++i) {
+        Stream *const stream = stream_list[i];
+        stream->name = gc_forward(stream->name);
+
+        if (stream->name == NULL) {
+            // the continuation was dropped from the callstack before the end of the source
+            stream_close(stream);
+            --i;
+        }
+    }
+}
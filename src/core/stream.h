@@ -0,0 +1,47 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "../common/utility.h"
+#include <bowl/bowl.h>
+#include <bowl/api.h>
+
+/*
+ * A token stream tokenizes UTF-8 encoded source code which is read from a file descriptor chunk
+ * by chunk, such that the source never has to be held in memory as a whole.
+ *
+ * The tokens of a chunk are followed by two more elements: a native function which continues the
+ * stream and a string which identifies the stream (its name). As soon as the interpreter reaches
+ * the function on the callstack, the function replaces the string with the tokens of the next
+ * chunk (followed by the function and the string again, unless the source is exhausted). Thus,
+ * the callstack only ever holds the tokens of a single chunk.
+ *
+ * The stream owns the file descriptor. It is closed as soon as the end of the source is reached
+ * or the string is no longer reachable.
+ */
+
+/**
+ * Creates a token stream which reads from the provided file descriptor.
+ * @param stack The stack of the current environment.
+ * @param descriptor The file descriptor, which is closed by the stream.
+ * @param name The name of the source, which is used in error messages.
+ * @return Either the tokens of the first chunk (followed by the continuation of the stream) or
+ * an exception.
+ */
+BowlResult bowl_tokens_stream(BowlStack stack, int descriptor, const char *name);
+
+/**
+ * Opens a file and creates a token stream which reads from it (see 'bowl_tokens_stream').
+ * @param stack The stack of the current environment.
+ * @param path The path of the file.
+ * @return Either the tokens of the first chunk (followed by the continuation of the stream) or
+ * an exception.
+ */
+BowlResult bowl_tokens_file(BowlStack stack, const char *path);
+
+/**
+ * Updates the token streams after all reachable values were relocated by the garbage collector
+ * and closes all streams whose continuation is no longer reachable.
+ */
+void stream_collect(void);
+
+#endif
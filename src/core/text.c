@@ -0,0 +1,618 @@
+#include "text.h"
+
+u64 text_width_of(u32 codepoint) {
+    if (codepoint < 0x100) {
+        return 1;
+    } else if (codepoint < 0x10000) {
+        return 2;
+    } else {
+        return 4;
+    }
+}
+
+u64 text_width(const u8 *bytes, u64 width, u64 length) {
+    u32 maximum = 0;
+
+    switch (width) {
+        case 1:
+            return 1;
+
+        case 2:
+            for (u64 i = 0; i < length; ++i) {
+                maximum |= ((const u16 *) bytes)[i];
+            }
+            break;
+
+        default:
+            for (u64 i = 0; i < length; ++i) {
+                maximum |= ((const u32 *) bytes)[i];
+            }
+            break;
+    }
+
+    // the bitwise or is not the maximum, but it has the same highest bit
+    return text_width_of(maximum);
+}
+
+void text_copy(u8 *target, u64 target_width, const u8 *source, u64 source_width, u64 length) {
+    if (target_width == source_width) {
+        memcpy(target, source, length * target_width);
+        return;
+    }
+
+    for (u64 i = 0; i < length; ++i) {
+        TEXT_PUT(target, target_width, i, TEXT_AT(source, source_width, i));
+    }
+}
+
+int text_compare(const u8 *a, u64 a_width, u64 a_length, const u8 *b, u64 b_width, u64 b_length) {
+    const u64 length = MIN(a_length, b_length);
+
+    if (a_width == 1 && b_width == 1) {
+        // bytes are ordered just like their codepoints
+        const int order = memcmp(a, b, length);
+
+        if (order != 0) {
+            return order < 0 ? -1 : 1;
+        }
+    } else if (a_width != b_width || memcmp(a, b, length * a_width) != 0) {
+        for (u64 i = 0; i < length; ++i) {
+            const u32 x = TEXT_AT(a, a_width, i);
+            const u32 y = TEXT_AT(b, b_width, i);
+
+            if (x != y) {
+                return x < y ? -1 : 1;
+            }
+        }
+    }
+
+    return a_length == b_length ? 0 : (a_length < b_length ? -1 : 1);
+}
+
+static inline TextSlice *text_slice(BowlValue text) {
+    return (TextSlice *) &text->string.bytes[0];
+}
+
+static inline TextConcat *text_concat(BowlValue text) {
+    return (TextConcat *) &text->string.bytes[0];
+}
+
+static inline TextExternal *text_external(BowlValue text) {
+    return (TextExternal *) &text->string.bytes[0];
+}
+
+static inline const u8 *text_codepoints(BowlValue text) {
+    // the codepoints of a flat or an external string
+    return (text->string.width & TEXT_EXTERNAL) ? text_external(text)->bytes : &text->string.bytes[0];
+}
+
+bool text_is_flat(BowlValue text) {
+    return (text->string.width & (TEXT_SLICE | TEXT_CONCAT | TEXT_EXTERNAL)) == 0;
+}
+
+u64 text_storage_size(BowlValue text) {
+    if (text->string.width & TEXT_SLICE) {
+        return sizeof(TextSlice);
+    } else if (text->string.width & TEXT_CONCAT) {
+        return sizeof(TextConcat);
+    } else if (text->string.width & TEXT_EXTERNAL) {
+        return sizeof(TextExternal);
+    } else {
+        return text->string.length * text->string.width;
+    }
+}
+
+BowlValue *text_references(BowlValue text, u64 *length) {
+    if (text->string.width & TEXT_SLICE) {
+        *length = 1;
+        return &text_slice(text)->parent;
+    } else if (text->string.width & TEXT_CONCAT) {
+        *length = 2;
+        return &text_concat(text)->left;
+    } else {
+        *length = 0;
+        return NULL;
+    }
+}
+
+static u64 text_height(BowlValue text) {
+    // a flattened concatenation is a leaf
+    if ((text->string.width & TEXT_CONCAT) && text_concat(text)->right != NULL) {
+        return text_concat(text)->height;
+    } else {
+        return 0;
+    }
+}
+
+TextReader text_reader(BowlValue text, u64 start) {
+    TextReader reader = {
+        .size = 0,
+        .skip = 0
+    };
+
+    if (start >= text->string.length) {
+        return reader;
+    }
+
+    // descend to the leaf which contains the first codepoint, remembering the right parts on the way
+    while (text->string.width & TEXT_CONCAT) {
+        const TextConcat *const concat = text_concat(text);
+
+        if (concat->right == NULL) {
+            text = concat->left;
+        } else if (start < concat->left->string.length) {
+            reader.pending[reader.size++] = concat->right;
+            text = concat->left;
+        } else {
+            start -= concat->left->string.length;
+            text = concat->right;
+        }
+    }
+
+    reader.pending[reader.size++] = text;
+    reader.skip = start;
+
+    return reader;
+}
+
+bool text_reader_next(TextReader *reader, const u8 **bytes, u64 *width, u64 *length) {
+    while (reader->size > 0) {
+        BowlValue text = reader->pending[--reader->size];
+
+        while (text->string.width & TEXT_CONCAT) {
+            const TextConcat *const concat = text_concat(text);
+
+            if (concat->right != NULL) {
+                reader->pending[reader->size++] = concat->right;
+            }
+
+            text = concat->left;
+        }
+
+        const u64 skip = reader->skip;
+        reader->skip = 0;
+
+        if (text->string.length <= skip) {
+            continue;
+        }
+
+        *width = text->string.width & TEXT_WIDTH_MASK;
+        *length = text->string.length - skip;
+
+        if (text->string.width & TEXT_SLICE) {
+            const TextSlice *const slice = text_slice(text);
+            *bytes = &text_codepoints(slice->parent)[(slice->offset + skip) * *width];
+        } else {
+            *bytes = &text_codepoints(text)[skip * *width];
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+int text_compare_values(BowlValue a, BowlValue b, u64 length) {
+    if (text_is_flat(a) && text_is_flat(b)) {
+        return text_compare(a->string.bytes, a->string.width, length, b->string.bytes, b->string.width, length);
+    }
+
+    TextReader a_reader = text_reader(a, 0);
+    TextReader b_reader = text_reader(b, 0);
+    const u8 *a_bytes = NULL, *b_bytes = NULL;
+    u64 a_width = 1, b_width = 1;
+    u64 a_length = 0, b_length = 0;
+
+    // compare the runs of both texts piece by piece
+    while (length > 0) {
+        if (a_length == 0) {
+            text_reader_next(&a_reader, &a_bytes, &a_width, &a_length);
+        }
+
+        if (b_length == 0) {
+            text_reader_next(&b_reader, &b_bytes, &b_width, &b_length);
+        }
+
+        const u64 n = MIN(length, MIN(a_length, b_length));
+        const int order = text_compare(a_bytes, a_width, n, b_bytes, b_width, n);
+
+        if (order != 0) {
+            return order;
+        }
+
+        a_bytes += n * a_width;
+        b_bytes += n * b_width;
+        a_length -= n;
+        b_length -= n;
+        length -= n;
+    }
+
+    return 0;
+}
+
+#define TEXT_HASH_BLOCK 256
+
+static u64 text_hash_block(const u8 *bytes, u64 width, u64 length, u64 hash) {
+    // every block is hashed in its smallest width
+    const u64 block_width = width == 1 ? 1 : text_width(bytes, width, length);
+    u8 buffer[TEXT_HASH_BLOCK * sizeof(u16)];
+
+    if (block_width != width) {
+        text_copy(buffer, block_width, bytes, width, length);
+        bytes = buffer;
+    }
+
+    // the chained hash of the previous blocks seeds the next one
+    return hash_bytes(bytes, length * block_width, hash);
+}
+
+u64 text_hash(BowlValue text, u64 seed) {
+    u64 hash = seed;
+
+    if (text_is_flat(text) || (text->string.width & TEXT_EXTERNAL)) {
+        const u8 *const bytes = text_codepoints(text);
+
+        for (u64 i = 0, length = text->string.length, width = text->string.width & TEXT_WIDTH_MASK; i < length; i += TEXT_HASH_BLOCK) {
+            hash = text_hash_block(&bytes[i * width], width, MIN(TEXT_HASH_BLOCK, length - i), hash);
+        }
+
+        return hash;
+    }
+
+    // gather the codepoints of every block from the runs of the text
+    TextReader reader = text_reader(text, 0);
+    u32 block[TEXT_HASH_BLOCK];
+    u64 filled = 0;
+    const u8 *bytes;
+    u64 width, length;
+
+    while (text_reader_next(&reader, &bytes, &width, &length)) {
+        while (length > 0) {
+            const u64 n = MIN(length, TEXT_HASH_BLOCK - filled);
+            text_copy((u8 *) &block[filled], sizeof(u32), bytes, width, n);
+            filled += n;
+            bytes += n * width;
+            length -= n;
+
+            if (filled == TEXT_HASH_BLOCK) {
+                hash = text_hash_block((const u8 *) block, sizeof(u32), filled, hash);
+                filled = 0;
+            }
+        }
+    }
+
+    if (filled > 0) {
+        hash = text_hash_block((const u8 *) block, sizeof(u32), filled, hash);
+    }
+
+    return hash;
+}
+
+static u64 text_range_width(BowlValue text, u64 start, u64 length) {
+    // the smallest width of the codepoints in the range
+    TextReader reader = text_reader(text, start);
+    const u8 *bytes;
+    u64 width, run;
+    u64 result = 1;
+
+    while (length > 0 && text_reader_next(&reader, &bytes, &width, &run)) {
+        run = MIN(run, length);
+        result = MAX(result, text_width(bytes, width, run));
+        length -= run;
+    }
+
+    return result;
+}
+
+static void text_gather(BowlValue text, u64 start, u64 length, u8 *target, u64 target_width) {
+    TextReader reader = text_reader(text, start);
+    const u8 *bytes;
+    u64 width, run;
+
+    while (length > 0 && text_reader_next(&reader, &bytes, &width, &run)) {
+        run = MIN(run, length);
+        text_copy(target, target_width, bytes, width, run);
+        target += run * target_width;
+        length -= run;
+    }
+}
+
+static BowlResult text_flat(BowlStack stack, BowlValue a, u64 start, u64 a_length, BowlValue b) {
+    // creates a flat string from a range of 'a' followed by all of 'b' (if it is not 'NULL')
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, a, b, NULL);
+    const u64 b_length = b == NULL ? 0 : b->string.length;
+    const u64 width = MAX(text_range_width(a, start, a_length), b == NULL ? 1 : text_range_width(b, 0, b_length));
+
+    BowlResult result = gc_allocate(&frame, BowlStringValue, (a_length + b_length) * width);
+
+    if (!result.failure) {
+        result.value->string.length = a_length + b_length;
+        result.value->string.width = width;
+        text_gather(frame.registers[0], start, a_length, &result.value->string.bytes[0], width);
+
+        if (frame.registers[1] != NULL) {
+            text_gather(frame.registers[1], 0, b_length, &result.value->string.bytes[a_length * width], width);
+        }
+    }
+
+    return result;
+}
+
+static BowlResult text_node(BowlStack stack, BowlValue left, BowlValue right) {
+    const u64 length = left->string.length + right->string.length;
+    const u64 height = MAX(text_height(left), text_height(right)) + 1;
+
+    if (length <= TEXT_FLAT_LIMIT || height > TEXT_MAX_HEIGHT) {
+        // short strings are cheaper to copy than to share
+        return text_flat(stack, left, 0, left->string.length, right);
+    }
+
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, left, right, NULL);
+    BowlResult result = gc_allocate(&frame, BowlStringValue, sizeof(TextConcat));
+
+    if (!result.failure) {
+        left = frame.registers[0];
+        right = frame.registers[1];
+
+        result.value->string.length = length;
+        result.value->string.width = TEXT_CONCAT | MAX(left->string.width & TEXT_WIDTH_MASK, right->string.width & TEXT_WIDTH_MASK);
+        text_concat(result.value)->left = left;
+        text_concat(result.value)->right = right;
+        text_concat(result.value)->height = height;
+    }
+
+    return result;
+}
+
+static BowlResult text_join_right(BowlStack stack, BowlValue left, BowlValue right) {
+    // the left tree is higher => descend along its right spine (just like the join of two AVL trees)
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, left, right, NULL);
+    const BowlValue middle = text_concat(left)->right;
+    BowlResult result;
+
+    if (text_height(middle) <= text_height(right) + 1) {
+        if (MAX(text_height(middle), text_height(right)) <= text_height(text_concat(left)->left) || text_height(middle) == 0) {
+            result = text_node(&frame, middle, right);
+
+            if (result.failure) {
+                return result;
+            }
+
+            return text_node(&frame, text_concat(frame.registers[0])->left, result.value);
+        }
+
+        // the middle tree is too high => distribute its parts among both sides
+        result = text_node(&frame, text_concat(middle)->right, right);
+
+        if (result.failure) {
+            return result;
+        }
+
+        frame.registers[1] = result.value;
+        left = frame.registers[0];
+        result = text_node(&frame, text_concat(left)->left, text_concat(text_concat(left)->right)->left);
+
+        if (result.failure) {
+            return result;
+        }
+
+        return text_node(&frame, result.value, frame.registers[1]);
+    }
+
+    result = text_join_right(&frame, middle, right);
+
+    if (result.failure) {
+        return result;
+    }
+
+    frame.registers[2] = result.value;
+
+    if (text_height(result.value) <= text_height(text_concat(frame.registers[0])->left) + 1) {
+        return text_node(&frame, text_concat(frame.registers[0])->left, result.value);
+    }
+
+    // the joined tree is too high => rotate to the left
+    result = text_node(&frame, text_concat(frame.registers[0])->left, text_concat(result.value)->left);
+
+    if (result.failure) {
+        return result;
+    }
+
+    return text_node(&frame, result.value, text_concat(frame.registers[2])->right);
+}
+
+static BowlResult text_join_left(BowlStack stack, BowlValue left, BowlValue right) {
+    // the right tree is higher => descend along its left spine
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, left, right, NULL);
+    const BowlValue middle = text_concat(right)->left;
+    BowlResult result;
+
+    if (text_height(middle) <= text_height(left) + 1) {
+        if (MAX(text_height(middle), text_height(left)) <= text_height(text_concat(right)->right) || text_height(middle) == 0) {
+            result = text_node(&frame, left, middle);
+
+            if (result.failure) {
+                return result;
+            }
+
+            return text_node(&frame, result.value, text_concat(frame.registers[1])->right);
+        }
+
+        // the middle tree is too high => distribute its parts among both sides
+        result = text_node(&frame, left, text_concat(middle)->left);
+
+        if (result.failure) {
+            return result;
+        }
+
+        frame.registers[0] = result.value;
+        right = frame.registers[1];
+        result = text_node(&frame, text_concat(text_concat(right)->left)->right, text_concat(right)->right);
+
+        if (result.failure) {
+            return result;
+        }
+
+        return text_node(&frame, frame.registers[0], result.value);
+    }
+
+    result = text_join_left(&frame, left, middle);
+
+    if (result.failure) {
+        return result;
+    }
+
+    frame.registers[2] = result.value;
+
+    if (text_height(result.value) <= text_height(text_concat(frame.registers[1])->right) + 1) {
+        return text_node(&frame, result.value, text_concat(frame.registers[1])->right);
+    }
+
+    // the joined tree is too high => rotate to the right
+    result = text_node(&frame, text_concat(result.value)->right, text_concat(frame.registers[1])->right);
+
+    if (result.failure) {
+        return result;
+    }
+
+    return text_node(&frame, text_concat(frame.registers[2])->left, result.value);
+}
+
+static BowlResult text_join(BowlStack stack, BowlValue left, BowlValue right) {
+    const u64 left_height = text_height(left);
+    const u64 right_height = text_height(right);
+
+    if (left->string.length == 0 || right->string.length == 0) {
+        return (BowlResult) {
+            .failure = false,
+            .value = left->string.length == 0 ? right : left
+        };
+    } else if (left_height > right_height + 1) {
+        return text_join_right(stack, left, right);
+    } else if (right_height > left_height + 1) {
+        return text_join_left(stack, left, right);
+    } else {
+        return text_node(stack, left, right);
+    }
+}
+
+BowlResult bowl_string_concat(BowlStack stack, BowlValue a, BowlValue b) {
+    return text_join(stack, a, b);
+}
+
+BowlResult bowl_string_slice(BowlStack stack, BowlValue string, u64 start, u64 length) {
+    if (start > string->string.length || length > string->string.length - start) {
+        BowlResult result = bowl_format_exception(stack, "the range from %" PRIu64 " to %" PRIu64 " exceeds the string of length %" PRIu64, start, start + length, string->string.length);
+        result.failure = true;
+        return result;
+    } else if (start == 0 && length == string->string.length) {
+        return (BowlResult) {
+            .failure = false,
+            .value = string
+        };
+    } else if (length <= TEXT_FLAT_LIMIT) {
+        // short strings are cheaper to copy than to share
+        return text_flat(stack, string, start, length, NULL);
+    }
+
+    if (string->string.width & TEXT_SLICE) {
+        // slices always refer to flat strings
+        start += text_slice(string)->offset;
+        string = text_slice(string)->parent;
+    }
+
+    if (string->string.width & TEXT_CONCAT) {
+        const TextConcat *const concat = text_concat(string);
+        const u64 left_length = concat->left->string.length;
+
+        if (concat->right == NULL) {
+            return bowl_string_slice(stack, concat->left, start, length);
+        } else if (start + length <= left_length) {
+            return bowl_string_slice(stack, concat->left, start, length);
+        } else if (start >= left_length) {
+            return bowl_string_slice(stack, concat->right, start - left_length, length);
+        }
+
+        // the range covers parts of both sides
+        BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, string, NULL, NULL);
+        BowlResult result = bowl_string_slice(&frame, concat->left, start, left_length - start);
+
+        if (result.failure) {
+            return result;
+        }
+
+        frame.registers[1] = result.value;
+        result = bowl_string_slice(&frame, text_concat(frame.registers[0])->right, 0, start + length - left_length);
+
+        if (result.failure) {
+            return result;
+        }
+
+        return text_join(&frame, frame.registers[1], result.value);
+    }
+
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, string, NULL, NULL);
+    BowlResult result = gc_allocate(&frame, BowlStringValue, sizeof(TextSlice));
+
+    if (!result.failure) {
+        string = frame.registers[0];
+        result.value->string.length = length;
+        result.value->string.width = TEXT_SLICE | (string->string.width & TEXT_WIDTH_MASK);
+        text_slice(result.value)->parent = string;
+        text_slice(result.value)->offset = start;
+    }
+
+    return result;
+}
+
+BowlResult bowl_string_flatten(BowlStack stack, BowlValue string) {
+    if (text_is_flat(string)) {
+        return (BowlResult) {
+            .failure = false,
+            .value = string
+        };
+    } else if ((string->string.width & TEXT_CONCAT) && text_concat(string)->right == NULL) {
+        // the concatenation was already flattened
+        return (BowlResult) {
+            .failure = false,
+            .value = text_concat(string)->left
+        };
+    } else if ((string->string.width & TEXT_SLICE) && text_slice(string)->offset == 0 && text_slice(string)->parent->string.length == string->string.length && text_is_flat(text_slice(string)->parent)) {
+        // the slice was already flattened
+        return (BowlResult) {
+            .failure = false,
+            .value = text_slice(string)->parent
+        };
+    }
+
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, string, NULL, NULL);
+    BowlResult result = text_flat(&frame, string, 0, string->string.length, NULL);
+
+    if (!result.failure && !(frame.registers[0]->string.width & TEXT_EXTERNAL)) {
+        // remember the flat copy such that the string is not flattened again
+        string = frame.registers[0];
+
+        if (string->string.width & TEXT_CONCAT) {
+            text_concat(string)->left = result.value;
+            text_concat(string)->right = NULL;
+        } else {
+            string->string.width = TEXT_SLICE | result.value->string.width;
+            text_slice(string)->parent = result.value;
+            text_slice(string)->offset = 0;
+        }
+    }
+
+    return result;
+}
+
+u32 bowl_text_at(BowlValue text, u64 index) {
+    const u8 *bytes;
+    u64 width, length;
+    TextReader reader = text_reader(text, index);
+    text_reader_next(&reader, &bytes, &width, &length);
+    return TEXT_AT(bytes, width, 0);
+}
+
+void bowl_text_read(BowlValue text, u64 start, u64 length, u32 *codepoints) {
+    text_gather(text, start, length, (u8 *) codepoints, sizeof(u32));
+}
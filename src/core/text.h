@@ -0,0 +1,252 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+#include "../common/utility.h"
+#include <bowl/bowl.h>
+#include <bowl/api.h>
+#include "gc.h"
+
+#if !defined(BOWL_STATIC_ASCII_STRING) || !defined(BOWL_STATIC_ASCII_SYMBOL)
+    #error "the bowl-api headers do not provide the compact string layout (see the README)"
+#endif
+
+/*
+ * Strings and symbols store their codepoints in the most compact of three widths, which is
+ * chosen once at construction:
+ *
+ * - one byte per codepoint if all codepoints are less than 0x100 (Latin-1),
+ * - two bytes per codepoint if all codepoints are less than 0x10000 (UCS-2),
+ * - four bytes per codepoint otherwise (UCS-4).
+ *
+ * The 'width' field holds the number of bytes per codepoint and 'bytes' the codepoints in the
+ * native byte order. The width is always the smallest possible one. Thus, two flat strings (or
+ * two symbols) are equal if and only if their widths and their bytes are equal.
+ *
+ * Besides flat strings, there are three kinds of strings which do not store their codepoints
+ * themselves (symbols are always flat):
+ *
+ * - A slice ('TEXT_SLICE' is set in 'width') is a view of 'length' codepoints of a flat or an
+ *   external parent string, starting at an offset. Its 'bytes' hold a 'TextSlice' and the lower
+ *   bits of its width are equal to the width of the parent (which is not necessarily the
+ *   smallest one).
+ * - A concatenation ('TEXT_CONCAT' is set in 'width') joins two strings of any kind. Its 'bytes'
+ *   hold a 'TextConcat' and the lower bits of its width are the largest width of both parts.
+ *   Concatenations form a height-balanced tree (a rope). Once the concatenation is flattened,
+ *   its left part is replaced by the flat string and its right part by 'NULL'. Likewise, a
+ *   flattened slice refers to its flat copy.
+ * - An external string ('TEXT_EXTERNAL' is set in 'width') stores its codepoints outside of the
+ *   heap, e.g., in a file which is mapped into memory (see 'external.h'). Its 'bytes' hold a
+ *   'TextExternal' and the lower bits of its width are the width of the codepoints.
+ *
+ * The 'length' field is always the total number of codepoints. Native modules which require the
+ * codepoints in a contiguous array must call 'bowl_string_flatten' first.
+ */
+
+#define TEXT_SLICE ((u64) 1 << 8)
+#define TEXT_CONCAT ((u64) 1 << 9)
+#define TEXT_EXTERNAL ((u64) 1 << 10)
+#define TEXT_WIDTH_MASK ((u64) 0xFF)
+#define TEXT_FLAT_LIMIT 64
+#define TEXT_MAX_HEIGHT 128
+
+#define TEXT_AT(bytes, width, index) \
+    ((width) == 1 ? (u32) ((const u8 *) (bytes))[index] : \
+     (width) == 2 ? (u32) ((const u16 *) (bytes))[index] : \
+                    ((const u32 *) (bytes))[index])
+
+#define TEXT_PUT(bytes, width, index, codepoint) \
+    do { \
+        if ((width) == 1) { \
+            ((u8 *) (bytes))[index] = (u8) (codepoint); \
+        } else if ((width) == 2) { \
+            ((u16 *) (bytes))[index] = (u16) (codepoint); \
+        } else { \
+            ((u32 *) (bytes))[index] = (u32) (codepoint); \
+        } \
+    } while (0)
+
+typedef struct {
+    /** The flat string which contains the codepoints. */
+    BowlValue parent;
+    /** The index of the first codepoint within the parent. */
+    u64 offset;
+} TextSlice;
+
+typedef struct {
+    /** The first part of the string (or the flat copy of the whole string once it was flattened). */
+    BowlValue left;
+    /** The second part of the string (or 'NULL' once it was flattened). */
+    BowlValue right;
+    /** The height of the tree. */
+    u64 height;
+} TextConcat;
+
+typedef struct {
+    /** The codepoints, which are neither moved nor released by the garbage collector. */
+    const u8 *bytes;
+    /** The number of bytes of the region which contains the codepoints. */
+    u64 size;
+} TextExternal;
+
+typedef struct {
+    /** The nodes which still have to be read (the next one is on top). */
+    BowlValue pending[TEXT_MAX_HEIGHT + 1];
+    /** The number of pending nodes. */
+    u64 size;
+    /** The number of codepoints which are skipped at the beginning of the next run. */
+    u64 skip;
+} TextReader;
+
+/**
+ * Returns the smallest width which is able to store the provided codepoint.
+ * @param codepoint The codepoint.
+ * @return Either 1, 2, or 4.
+ */
+u64 text_width_of(u32 codepoint);
+
+/**
+ * Returns the smallest width which is able to store all of the provided codepoints.
+ * @param bytes The codepoints.
+ * @param width The width in which the codepoints are stored.
+ * @param length The number of codepoints.
+ * @return Either 1, 2, or 4.
+ */
+u64 text_width(const u8 *bytes, u64 width, u64 length);
+
+/**
+ * Copies codepoints from one width into another. The target width must be able to store all
+ * of the codepoints.
+ * @param target The location where the codepoints should be stored.
+ * @param target_width The width of the target.
+ * @param source The codepoints which should be copied.
+ * @param source_width The width of the source.
+ * @param length The number of codepoints.
+ */
+void text_copy(u8 *target, u64 target_width, const u8 *source, u64 source_width, u64 length);
+
+/**
+ * Compares two sequences of codepoints lexicographically.
+ * @param a The first sequence.
+ * @param a_width The width of the first sequence.
+ * @param a_length The number of codepoints in the first sequence.
+ * @param b The second sequence.
+ * @param b_width The width of the second sequence.
+ * @param b_length The number of codepoints in the second sequence.
+ * @return A negative number if 'a' is less than 'b', zero if both are equal, or a positive
+ * number otherwise.
+ */
+int text_compare(const u8 *a, u64 a_width, u64 a_length, const u8 *b, u64 b_width, u64 b_length);
+
+/**
+ * Returns whether the string (or symbol) stores its codepoints itself.
+ * @param text The string or the symbol.
+ * @return Either 'true' if the text is flat, or 'false' if it is a slice, a concatenation, or an
+ * external string.
+ */
+bool text_is_flat(BowlValue text);
+
+/**
+ * Returns the number of bytes which are used by the 'bytes' field of the provided text.
+ * @param text The string or the symbol.
+ * @return The number of bytes.
+ */
+u64 text_storage_size(BowlValue text);
+
+/**
+ * Returns the fields of the provided text which contain references to other values.
+ * @param text The string or the symbol.
+ * @param length The location where the number of references should be stored.
+ * @return The first of the references.
+ */
+BowlValue *text_references(BowlValue text, u64 *length);
+
+/**
+ * Creates a reader over the codepoints of a text of any kind.
+ *
+ * The reader holds raw references into the text. Therefore, it must not be used any longer
+ * as soon as the garbage collector may have been run.
+ * @param text The string or the symbol.
+ * @param start The index of the first codepoint which should be read.
+ * @return The reader.
+ */
+TextReader text_reader(BowlValue text, u64 start);
+
+/**
+ * Advances the reader to the next run of contiguous codepoints.
+ * @param reader The reader.
+ * @param bytes The location where the first codepoint of the run should be stored.
+ * @param width The location where the width of the run should be stored.
+ * @param length The location where the number of codepoints of the run should be stored.
+ * @return Either 'true' if there is another run, or 'false' otherwise.
+ */
+bool text_reader_next(TextReader *reader, const u8 **bytes, u64 *width, u64 *length);
+
+/**
+ * Compares the first codepoints of two texts of any kind without flattening them.
+ * @param a The first text.
+ * @param b The second text.
+ * @param length The number of codepoints which should be compared (at most the length of both texts).
+ * @return A negative number if the codepoints of 'a' are less than the ones of 'b', zero if they
+ * are equal, or a positive number otherwise.
+ */
+int text_compare_values(BowlValue a, BowlValue b, u64 length);
+
+/**
+ * Hashes the codepoints of a text of any kind without flattening it.
+ *
+ * The codepoints are hashed in blocks of a fixed number of codepoints, each of which in its
+ * smallest width. Thus, the hash neither depends on the kind of the text nor on its width.
+ * @param text The string.
+ * @param seed The seed of the hash.
+ * @return The hash of the codepoints.
+ */
+u64 text_hash(BowlValue text, u64 seed);
+
+/**
+ * Concatenates two strings in O(log n) without copying their codepoints (unless the result is short).
+ * @param stack The stack of the current environment.
+ * @param a The first string.
+ * @param b The second string.
+ * @return Either the concatenated string or an exception.
+ */
+BowlResult bowl_string_concat(BowlStack stack, BowlValue a, BowlValue b);
+
+/**
+ * Creates a substring in O(log n) without copying its codepoints (unless the result is short).
+ * @param stack The stack of the current environment.
+ * @param string The string.
+ * @param start The index of the first codepoint of the substring.
+ * @param length The number of codepoints of the substring.
+ * @return Either the substring or an exception if the range exceeds the string.
+ */
+BowlResult bowl_string_slice(BowlStack stack, BowlValue string, u64 start, u64 length);
+
+/**
+ * Returns a flat string (which stores all of its codepoints contiguously) equal to the provided string.
+ *
+ * Slices and concatenations remember their flat copy, i.e., they are only flattened once. External
+ * strings are copied every time, since the slices which refer to them require their codepoints.
+ * @param stack The stack of the current environment.
+ * @param string The string.
+ * @return Either the flat string or an exception.
+ */
+BowlResult bowl_string_flatten(BowlStack stack, BowlValue string);
+
+/**
+ * Returns the codepoint at the provided index of a string or a symbol.
+ * @param text The string or the symbol (of any kind).
+ * @param index The index, which must be less than the length of the text.
+ * @return The codepoint.
+ */
+u32 bowl_text_at(BowlValue text, u64 index);
+
+/**
+ * Copies a range of codepoints of a string or a symbol into a buffer of 32-bit codepoints.
+ * @param text The string or the symbol (of any kind).
+ * @param start The index of the first codepoint.
+ * @param length The number of codepoints, which must not exceed the length of the text.
+ * @param codepoints The location where the codepoints should be stored.
+ */
+void bowl_text_read(BowlValue text, u64 start, u64 length, u32 *codepoints);
+
+#endif
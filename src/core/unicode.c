@@ -1,5 +1,10 @@
 #include "unicode.h"
 
+#if defined(__x86_64__) && defined(__GNUC__)
+    #include <immintrin.h>
+    #define UNICODE_X86
+#endif
+
 /**
  * This source is based on the flexible and economical UTF-8 decoder from Björn Höhrmann.
  * Copyright (c) 2008-2010 Bjoern Hoehrmann <bjoern@hoehrmann.de>
@@ -71,25 +76,237 @@ u64 unicode_utf8_encode(u32 codepoint, u8 *bytes) {
 }
 
 u64 unicode_utf8_count(u8 *bytes, u64 length) {
-    u32 state = UNICODE_UTF8_STATE_ACCEPT;
-    u32 codepoint;
-    u64 result = 0;
-
-    for (u64 index = 0; index < length; ++index) {
-        if (unicode_utf8_decode(&state, &codepoint, bytes[index]) == UNICODE_UTF8_STATE_ACCEPT) {
-            ++result;
-        } else if (state == UNICODE_UTF8_STATE_ACCEPT) {
-            return (u64) -1;
-        }
-    }
+    u64 result;
+    u32 maximum;
+    const u32 state = unicode_utf8_measure(bytes, length, &result, &maximum);
 
-    if (state != UNICODE_UTF8_STATE_ACCEPT) {
+    if (state == UNICODE_UTF8_STATE_REJECT) {
+        return (u64) -1;
+    } else if (state != UNICODE_UTF8_STATE_ACCEPT) {
         return (u64) -2;
     }
 
     return result;
 }
 
+static u64 unicode_ascii_scalar(const u8 *bytes, u64 length) {
+    u64 offset = 0;
+
+    // eight bytes at a time
+    for (; offset + sizeof(u64) <= length; offset += sizeof(u64)) {
+        u64 word;
+        memcpy(&word, &bytes[offset], sizeof(u64));
+
+        if (word & 0x8080808080808080ull) {
+            break;
+        }
+    }
+
+    while (offset < length && bytes[offset] < 0x80) {
+        ++offset;
+    }
+
+    return offset;
+}
+
+#ifdef UNICODE_X86
+static u64 unicode_ascii_sse2(const u8 *bytes, u64 length) {
+    u64 offset = 0;
+
+    for (; offset + 16 <= length; offset += 16) {
+        const int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) &bytes[offset]));
+
+        if (mask != 0) {
+            return offset + __builtin_ctz((unsigned) mask);
+        }
+    }
+
+    return offset + unicode_ascii_scalar(&bytes[offset], length - offset);
+}
+
+__attribute__((target("avx2")))
+static u64 unicode_ascii_avx2(const u8 *bytes, u64 length) {
+    u64 offset = 0;
+
+    for (; offset + 32 <= length; offset += 32) {
+        const int mask = _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *) &bytes[offset]));
+
+        if (mask != 0) {
+            return offset + __builtin_ctz((unsigned) mask);
+        }
+    }
+
+    return offset + unicode_ascii_sse2(&bytes[offset], length - offset);
+}
+#endif
+
+static u64 unicode_ascii_dispatch(const u8 *bytes, u64 length);
+
+/** Returns the number of leading ASCII bytes (the implementation is chosen on the first call). */
+static u64 (*unicode_ascii)(const u8 *bytes, u64 length) = unicode_ascii_dispatch;
+
+static u64 unicode_ascii_dispatch(const u8 *bytes, u64 length) {
+#ifdef UNICODE_X86
+    __builtin_cpu_init();
+    unicode_ascii = __builtin_cpu_supports("avx2") ? unicode_ascii_avx2 : unicode_ascii_sse2;
+#else
+    unicode_ascii = unicode_ascii_scalar;
+#endif
+    return unicode_ascii(bytes, length);
+}
+
+static void unicode_widen(u8 *target, u64 width, const u8 *source, u64 length) {
+    // copies ASCII bytes into codepoints of the provided width
+    u64 i = 0;
+
+    if (width == 1) {
+        memcpy(target, source, length);
+        return;
+    }
+
+#ifdef UNICODE_X86
+    for (; i + 16 <= length; i += 16) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i bytes = _mm_loadu_si128((const __m128i *) &source[i]);
+        const __m128i low = _mm_unpacklo_epi8(bytes, zero);
+        const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+
+        if (width == 2) {
+            _mm_storeu_si128((__m128i *) &target[i * 2], low);
+            _mm_storeu_si128((__m128i *) &target[i * 2 + 16], high);
+        } else {
+            _mm_storeu_si128((__m128i *) &target[i * 4], _mm_unpacklo_epi16(low, zero));
+            _mm_storeu_si128((__m128i *) &target[i * 4 + 16], _mm_unpackhi_epi16(low, zero));
+            _mm_storeu_si128((__m128i *) &target[i * 4 + 32], _mm_unpacklo_epi16(high, zero));
+            _mm_storeu_si128((__m128i *) &target[i * 4 + 48], _mm_unpackhi_epi16(high, zero));
+        }
+    }
+#endif
+
+    for (; i < length; ++i) {
+        TEXT_PUT(target, width, i, source[i]);
+    }
+}
+
+u64 unicode_utf8_encode_text(const u8 *bytes, u64 width, u64 length, u8 *target) {
+    u8 *const start = target;
+    u64 i = 0;
+
+    while (i < length) {
+#ifdef UNICODE_X86
+        // sixteen ASCII codepoints at a time, narrowed into bytes
+        if (i + 16 <= length) {
+            const __m128i *const source = (const __m128i *) &bytes[i * width];
+            __m128i packed;
+            bool ascii;
+
+            if (width == 1) {
+                packed = _mm_loadu_si128(source);
+                ascii = _mm_movemask_epi8(packed) == 0;
+            } else if (width == 2) {
+                const __m128i low = _mm_loadu_si128(&source[0]);
+                const __m128i high = _mm_loadu_si128(&source[1]);
+                const __m128i mask = _mm_set1_epi16((short) 0xFF80);
+                ascii = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(_mm_or_si128(low, high), mask), _mm_setzero_si128())) == 0xFFFF;
+                packed = _mm_packus_epi16(low, high);
+            } else {
+                const __m128i a = _mm_loadu_si128(&source[0]);
+                const __m128i b = _mm_loadu_si128(&source[1]);
+                const __m128i c = _mm_loadu_si128(&source[2]);
+                const __m128i d = _mm_loadu_si128(&source[3]);
+                const __m128i mask = _mm_set1_epi32((int) 0xFFFFFF80);
+                const __m128i any = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+                ascii = _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(any, mask), _mm_setzero_si128())) == 0xFFFF;
+                packed = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+            }
+
+            if (ascii) {
+                _mm_storeu_si128((__m128i *) target, packed);
+                target += 16;
+                i += 16;
+                continue;
+            }
+        }
+
+        // the block contains other codepoints => encode it one by one
+        const u64 end = MIN(length, i + 16);
+#else
+        const u64 end = length;
+#endif
+
+        for (; i < end; ++i) {
+            const u32 codepoint = TEXT_AT(bytes, width, i);
+
+            if (codepoint < 0x80) {
+                *target++ = (u8) codepoint;
+            } else {
+                const u64 written = unicode_utf8_encode(codepoint, target);
+                // the unicode replacement character was written
+                target += written == 0 ? 3 : written;
+            }
+        }
+    }
+
+    return (u64) (target - start);
+}
+
+u32 unicode_utf8_measure(const u8 *bytes, u64 length, u64 *count, u32 *maximum) {
+    u32 state = UNICODE_UTF8_STATE_ACCEPT;
+    u32 codepoint = 0;
+    u64 i = 0;
+
+    *count = 0;
+    *maximum = 0;
+
+    while (i < length) {
+        if (state == UNICODE_UTF8_STATE_ACCEPT && bytes[i] < 0x80) {
+            // ASCII runs neither need to be decoded nor affect the width (single bytes between other codepoints are not worth a scan)
+            const u64 run = i + 1 < length && bytes[i + 1] < 0x80 ? unicode_ascii(&bytes[i], length - i) : 1;
+            *count += run;
+            i += run;
+            continue;
+        }
+
+        if (unicode_utf8_decode(&state, &codepoint, bytes[i++]) == UNICODE_UTF8_STATE_ACCEPT) {
+            *maximum |= codepoint;
+            ++*count;
+        } else if (state == UNICODE_UTF8_STATE_REJECT) {
+            break;
+        }
+    }
+
+    return state;
+}
+
+void unicode_utf8_decode_text(const u8 *bytes, u64 length, u8 *target, u64 width) {
+    u32 state = UNICODE_UTF8_STATE_ACCEPT;
+    u32 codepoint = 0;
+    u64 i = 0;
+    u64 p = 0;
+
+    while (i < length) {
+        if (state == UNICODE_UTF8_STATE_ACCEPT && bytes[i] < 0x80) {
+            if (i + 1 < length && bytes[i + 1] < 0x80) {
+                const u64 run = unicode_ascii(&bytes[i], length - i);
+                unicode_widen(&target[p * width], width, &bytes[i], run);
+                p += run;
+                i += run;
+            } else {
+                TEXT_PUT(target, width, p, bytes[i]);
+                ++p;
+                ++i;
+            }
+
+            continue;
+        }
+
+        if (unicode_utf8_decode(&state, &codepoint, bytes[i++]) == UNICODE_UTF8_STATE_ACCEPT) {
+            TEXT_PUT(target, width, p, codepoint);
+            ++p;
+        }
+    }
+}
+
 bool unicode_is_space(u32 codepoint) {
     switch (codepoint) {
         case 0x0009:
@@ -133,7 +350,7 @@ static inline u8 unicode_interpret_hex_digit(u32 codepoint) {
     }
 }
 
-u64 unicode_escape_sequence(u32 *codepoints, u64 length, u32 *codepoint) {
+u64 unicode_text_escape_sequence(const u8 *bytes, u64 width, u64 length, u32 *codepoint) {
     u64 offset = 0;
 
     if (offset >= length) {
@@ -141,8 +358,8 @@ u64 unicode_escape_sequence(u32 *codepoints, u64 length, u32 *codepoint) {
         return offset;
     }
 
-    if (codepoints[offset] != '\\') {
-        *codepoint = codepoints[offset];
+    if (TEXT_AT(bytes, width, offset) != '\\') {
+        *codepoint = TEXT_AT(bytes, width, offset);
         return offset + 1;
     }
 
@@ -151,9 +368,9 @@ u64 unicode_escape_sequence(u32 *codepoints, u64 length, u32 *codepoint) {
         return offset;
     }
 
-    if (codepoints[offset] != 'u' && codepoints[offset] != 'U') {
+    if (TEXT_AT(bytes, width, offset) != 'u' && TEXT_AT(bytes, width, offset) != 'U') {
         // ASCII escape sequence
-        switch (codepoints[offset]) {
+        switch (TEXT_AT(bytes, width, offset)) {
             case 't': *codepoint = '\t'; break;
             case 'f': *codepoint = '\f'; break;
             case 'v': *codepoint = '\v'; break;
@@ -161,7 +378,7 @@ u64 unicode_escape_sequence(u32 *codepoints, u64 length, u32 *codepoint) {
             case 'r': *codepoint = '\r'; break;
             case 'n': *codepoint = '\n'; break;
             case 'a': *codepoint = '\a'; break;
-            default: *codepoint = codepoints[offset]; break;
+            default: *codepoint = TEXT_AT(bytes, width, offset); break;
         }
 
         return offset + 1;
@@ -169,7 +386,7 @@ u64 unicode_escape_sequence(u32 *codepoints, u64 length, u32 *codepoint) {
 
     if (offset + 1 >= length) {
         // there are no more codepoints => just return the 'u' or 'U'
-        *codepoint = codepoints[offset];
+        *codepoint = TEXT_AT(bytes, width, offset);
         return offset + 1;
     }
 
@@ -190,7 +407,7 @@ u64 unicode_escape_sequence(u32 *codepoints, u64 length, u32 *codepoint) {
         }
 
         // get the higher 4 bits
-        const u8 higher = unicode_interpret_hex_digit(codepoints[offset++]);
+        const u8 higher = unicode_interpret_hex_digit(TEXT_AT(bytes, width, offset++));
 
         if (offset >= length) {
             *codepoint = UNICODE_REPLACEMENT_CHARACTER;
@@ -198,7 +415,7 @@ u64 unicode_escape_sequence(u32 *codepoints, u64 length, u32 *codepoint) {
         }
 
         // get the lower 4 bits
-        const u8 lower = unicode_interpret_hex_digit(codepoints[offset++]);
+        const u8 lower = unicode_interpret_hex_digit(TEXT_AT(bytes, width, offset++));
     
         // illegal hex digits
         if (higher == 0xFF || lower == 0xFF) {
@@ -215,6 +432,10 @@ u64 unicode_escape_sequence(u32 *codepoints, u64 length, u32 *codepoint) {
     return offset;
 }
 
+u64 unicode_escape_sequence(u32 *codepoints, u64 length, u32 *codepoint) {
+    return unicode_text_escape_sequence((const u8 *) codepoints, sizeof(u32), length, codepoint);
+}
+
 u64 unicode_utf8_escape_sequence(u8 *bytes, u64 length, u32 *codepoint) {
     u32 state = UNICODE_UTF8_STATE_ACCEPT;
     u8 *const start = bytes;
@@ -2,5 +2,51 @@
 #define CORE_UNICODE_H
 
 #include <bowl/unicode.h>
+#include "text.h"
+
+/**
+ * Reads the next codepoint, which may be given by an escape sequence, just like
+ * 'unicode_escape_sequence'. In contrast to the latter, the codepoints may be stored in any
+ * width (see 'text.h').
+ * @param bytes The codepoints.
+ * @param width The width of the codepoints.
+ * @param length The number of codepoints.
+ * @param codepoint The location where the codepoint should be stored.
+ * @return The number of codepoints which were read.
+ */
+u64 unicode_text_escape_sequence(const u8 *bytes, u64 width, u64 length, u32 *codepoint);
+
+/**
+ * Validates UTF-8 encoded bytes and measures the codepoints they encode. ASCII runs are skipped
+ * 16 or 32 bytes at a time, depending on the instruction set of the processor.
+ * @param bytes The bytes.
+ * @param length The number of bytes.
+ * @param count The location where the number of codepoints should be stored.
+ * @param maximum The location where the bitwise disjunction of all codepoints should be stored.
+ * @return Either 'UNICODE_UTF8_STATE_ACCEPT' if the bytes are valid, 'UNICODE_UTF8_STATE_REJECT'
+ * if they are malformed, or any other state if the last codepoint is incomplete.
+ */
+u32 unicode_utf8_measure(const u8 *bytes, u64 length, u64 *count, u32 *maximum);
+
+/**
+ * Decodes UTF-8 encoded bytes, which were validated by 'unicode_utf8_measure' before.
+ * @param bytes The bytes.
+ * @param length The number of bytes.
+ * @param target The location where the codepoints should be stored.
+ * @param width The width in which the codepoints should be stored (see 'text.h').
+ */
+void unicode_utf8_decode_text(const u8 *bytes, u64 length, u8 *target, u64 width);
+
+/**
+ * Encodes codepoints as UTF-8. Runs of ASCII codepoints are narrowed 16 codepoints at a time.
+ * Invalid codepoints are replaced by the unicode replacement character.
+ * @param bytes The codepoints.
+ * @param width The width of the codepoints (see 'text.h').
+ * @param length The number of codepoints.
+ * @param target The location where the bytes should be stored, which must provide room for
+ * four bytes per codepoint.
+ * @return The number of bytes which were written.
+ */
+u64 unicode_utf8_encode_text(const u8 *bytes, u64 width, u64 length, u8 *target);
 
 #endif
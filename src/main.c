@@ -12,6 +12,34 @@ const char *bowl_settings_kernel_path =
 
 u64 bowl_settings_verbosity = 0;
 
+static const char *const handle_sandbox_return = 
+    "drop " // the datastack is not needed, just drop it
+    "dup list:empty equals " // check if the exception is not 'NULL' (the empty list)
+    "\\\"drop\\\" tokens " // if the exception is null drop the saved exception value and do nothing
+    "\\\"trigger\\\" tokens " // if the exception is not null rethrow it
+    "boolean:choose " // choose the correct continuation
+    // there are 26 tokens between the 'lift' and 'continue' (excluding 'lift', including 'continue')
+    "lift rot rot list:empty swap list:push swap list:pop rot list:push rot " // pop the continuation and save the datastack and dictionary for later use
+    "swap dup list:length 26 number:subtract 26 list:slice list:concat " // prepare the new callstack
+    "swap list:pop swap list:pop swap drop rot continue " // prepare the continuation and execute it
+    // overwrite the dictionary
+    "lift rot rot drop list:pop rot swap dup list:length 14 number:subtract 14 list:slice swap continue"
+;
+
+static const char *const bootloader = 
+    "\"../bowl-io/io.so\" library drop\n" // load the io-library
+    // prepend code that deletes the entire rest of the callstack 
+    "lift swap \"lift swap drop list:empty swap continue\" tokens swap list:concat\n"
+    // prepare the sandbox call
+    // the symbol 'boot:tokens' is replaced by the (precompiled) tokens of the boot file
+    "rot rot dup \"run %s\" tokens list:empty list:push boot:tokens list:push swap list:push\n"
+    // prepend the sandbox call to the callstack and continue the execution
+    "swap rot swap list:concat swap rot swap continue"
+;
+
+// the capacity of the buffer which holds the bootloader
+#define BOOTLOADER_CAPACITY (4096 + sizeof(bootloader) - 1 + sizeof(handle_sandbox_return))
+
 static CommandLineFlag commands[] = {
     {
         .name = "version",
@@ -36,6 +64,52 @@ static CommandLineFlag commands[] = {
         .number_of_arguments = 1,
         .function = command_execute
     }, 
+    {
+        .name = "file",
+        .synonyms = { "f" },
+        .description = 
+            "Executes a new machine instance by tokenizing the provided\n"
+            "file, using the result as the callstack. The file is read\n"
+            "and tokenized chunk by chunk while it is executed.",
+        .number_of_arguments = 1,
+        .function = command_file
+    },
+    {
+        .name = "compile",
+        .synonyms = { "c" },
+        .description = 
+            "Tokenizes the provided file and writes the tokens into a\n"
+            "precompiled file next to it (its path followed by 'c'),\n"
+            "which is used instead of the source as long as neither\n"
+            "the source nor the virtual machine changes. The boot file\n"
+            "is precompiled automatically.",
+        .number_of_arguments = 1,
+        .function = command_compile
+    },
+    {
+        .name = "embed",
+        .synonyms = { "em" },
+        .description = 
+            "Tokenizes the boot file together with the bootloader and\n"
+            "writes them into the provided file as C source, which\n"
+            "defines all tokens statically. A virtual machine which is\n"
+            "built with this file (see the target 'embedded' of the\n"
+            "makefile) starts without reading the boot file, unless\n"
+            "the flag 'boot' is used.",
+        .number_of_arguments = 1,
+        .function = command_embed
+    },
+    {
+        .name = "image",
+        .synonyms = { "i" },
+        .description = 
+            "Restores the dictionary, the datastack and the callstack\n"
+            "from the provided image instead of booting. The program\n"
+            "is executed in front of the restored callstack. Images\n"
+            "are written by the function 'image:dump'.",
+        .number_of_arguments = 1,
+        .function = command_image
+    },
     {
         .name = "verbose",
         .synonyms = { "vl" },
@@ -83,38 +157,50 @@ bool command_help(char *arguments[]) {
 }
 
 bool command_execute(char *arguments[]) {
-    static const char *const handle_sandbox_return = 
-        "drop " // the datastack is not needed, just drop it
-        "dup list:empty equals " // check if the exception is not 'NULL' (the empty list)
-        "\\\"drop\\\" tokens " // if the exception is null drop the saved exception value and do nothing
-        "\\\"trigger\\\" tokens " // if the exception is not null rethrow it
-        "boolean:choose " // choose the correct continuation
-        // there are 26 tokens between the 'lift' and 'continue' (excluding 'lift', including 'continue')
-        "lift rot rot list:empty swap list:push swap list:pop rot list:push rot " // pop the continuation and save the datastack and dictionary for later use
-        "swap dup list:length 26 number:subtract 26 list:slice list:concat " // prepare the new callstack
-        "swap list:pop swap list:pop swap drop rot continue " // prepare the continuation and execute it
-        // overwrite the dictionary
-        "lift rot rot drop list:pop rot swap dup list:length 14 number:subtract 14 list:slice swap continue"
-    ;
-
-    static const char *const bootloader = 
-        "\"../bowl-io/io.so\" library drop\n" // load the io-library
-        // prepend code that deletes the entire rest of the callstack 
-        "lift swap \"lift swap drop list:empty swap continue\" tokens swap list:concat\n"
-        // prepare the sandbox call
-        "rot rot dup \"run %s\" tokens list:empty list:push \"%s\" io:read tokens list:push swap list:push\n"
-        // prepend the sandbox call to the callstack and continue the execution
-        "swap rot swap list:concat swap rot swap continue"
-    ;
-
     // TODO: 1) escape user code (such that it is safe to use it inside a string) 2) set it as the new callstack
     char *const user_code = arguments[0];
+
+    // an image is booted already
+    if (bowl_settings_image_path != NULL) {
+        execute(user_code);
+        return true;
+    }
     
-    char buffer[4096 + sizeof(bootloader) - 1 + sizeof(handle_sandbox_return)];
-    sprintf(buffer, bootloader, handle_sandbox_return, bowl_settings_boot_path);
+    // the boot program may be embedded into the virtual machine already
+    if (bowl_embedded_boot != NULL) {
+        execute_embedded();
+        return true;
+    }
+
+    char buffer[BOOTLOADER_CAPACITY];
+    sprintf(buffer, bootloader, handle_sandbox_return);
+
+    execute_boot(buffer);
+
+    return true;
+}
 
-    execute(buffer);
+bool command_file(char *arguments[]) {
+    execute_file(arguments[0]);
+    return true;
+}
+
+bool command_compile(char *arguments[]) {
+    compile_file(arguments[0]);
+    return true;
+}
+
+bool command_embed(char *arguments[]) {
+    char buffer[BOOTLOADER_CAPACITY];
+    sprintf(buffer, bootloader, handle_sandbox_return);
+
+    embed_boot(buffer, arguments[0]);
+
+    return true;
+}
 
+bool command_image(char *arguments[]) {
+    bowl_settings_image_path = arguments[0];
     return true;
 }
 
@@ -130,6 +216,8 @@ bool command_kernel(char *arguments[]) {
 
 bool command_boot(char *arguments[]) {
     bowl_settings_boot_path = arguments[0];
+    // the boot file is tokenized when it is executed instead
+    bowl_embedded_boot = NULL;
     return true;
 }
 
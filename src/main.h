@@ -5,14 +5,20 @@
 #include "common/cli.h"
 #include "core/module.h"
 
-#define BOWL_VM_VERSION "0.0.1-alpha"
-
 int main(int argc, char *argv[]);
 
 bool command_help(char *arguments[]);
 
 bool command_execute(char *arguments[]);
 
+bool command_file(char *arguments[]);
+
+bool command_compile(char *arguments[]);
+
+bool command_embed(char *arguments[]);
+
+bool command_image(char *arguments[]);
+
 bool command_version(char *arguments[]);
 
 bool command_kernel(char *arguments[]);
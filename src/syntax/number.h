@@ -0,0 +1,74 @@
+#ifndef NUMBER_H
+#define NUMBER_H
+
+#include "../common/utility.h"
+
+// the maximum number of bytes which are written by 'number_format' (e.g., '-0.0000022250738585072014')
+#define NUMBER_FORMAT_LENGTH 32
+
+typedef struct {
+    /** The first (at most) 19 significant digits. */
+    u64 mantissa;
+    /** The number of significant digits in the mantissa. */
+    u64 digits;
+    /** The power of ten by which the mantissa is multiplied. */
+    i64 exponent;
+    /** Whether any of the omitted digits is not zero. */
+    bool truncated;
+} NumberDecimal;
+
+/**
+ * Appends a digit to a decimal number, which keeps the first 19 significant digits only.
+ * @param decimal The decimal number.
+ * @param digit The digit.
+ * @param fraction Whether the digit follows the decimal point.
+ */
+static inline void number_decimal_digit(NumberDecimal *decimal, u32 digit, bool fraction) {
+    if (decimal->digits < 19) {
+        decimal->mantissa = decimal->mantissa * 10 + digit;
+        // leading zeros are not significant
+        decimal->digits += decimal->mantissa != 0;
+        decimal->exponent -= fraction;
+    } else {
+        // the digit does not fit into the mantissa any longer
+        decimal->exponent += !fraction;
+        decimal->truncated |= digit != 0;
+    }
+}
+
+/**
+ * Converts a decimal number into the nearest double (ties are rounded to even), using the
+ * algorithm of Eisel and Lemire.
+ * @param mantissa The decimal significand, which must be exact (i.e., at most 19 digits).
+ * @param exponent The power of ten by which the significand is multiplied.
+ * @param negative Whether the number is negative.
+ * @return The double.
+ */
+double number_from_decimal(u64 mantissa, i64 exponent, bool negative);
+
+/**
+ * Converts a decimal number which was read from a literal into the nearest double. If omitted
+ * digits decide how the number is rounded, the literal is converted by the C library instead
+ * (which is exact for any number of digits).
+ * @param decimal The decimal number.
+ * @param negative Whether the number is negative.
+ * @param literal The codepoints of the whole literal (see 'text.h').
+ * @param width The width of the codepoints.
+ * @param length The number of codepoints.
+ * @return The double.
+ */
+double number_from_literal(const NumberDecimal *decimal, bool negative, const u8 *literal, u64 width, u64 length);
+
+/**
+ * Writes the shortest decimal which is converted back into the same double, using the algorithm
+ * of Giulietti ("Schubfach"). Integers below 2^53 are written as they are, other numbers in fixed
+ * notation if their decimal point is not too far away from their digits (e.g., '0.001' or
+ * '123.45') and in scientific notation otherwise (e.g., '1e21' or '1.5e-7'). Numbers which are
+ * not finite are written as 'inf', '-inf' and 'nan'.
+ * @param value The double.
+ * @param buffer The buffer, which must have room for at least 'NUMBER_FORMAT_LENGTH' bytes.
+ * @return The number of bytes written (no null terminator is written).
+ */
+u64 number_format(double value, char *buffer);
+
+#endif
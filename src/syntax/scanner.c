@@ -1,18 +1,67 @@
 #include "scanner.h"
+#include "../core/text.h"
+#include "number.h"
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+// an ASCII whitespace
+#define SCANNER_SPACE 1
+// the first byte of a sequence which may encode a whitespace that is not ASCII
+#define SCANNER_WIDE_SPACE 2
+// a byte which interrupts the contents of a string literal
+#define SCANNER_STRING 4
+
+// the classes of the bytes of UTF-8 encoded sources
+static const u8 scanner_classes[256] = {
+    ['\t'] = SCANNER_SPACE,
+    ['\n'] = SCANNER_SPACE | SCANNER_STRING,
+    ['\v'] = SCANNER_SPACE,
+    ['\f'] = SCANNER_SPACE,
+    ['\r'] = SCANNER_SPACE,
+    [' '] = SCANNER_SPACE,
+    ['"'] = SCANNER_STRING,
+    ['\\'] = SCANNER_STRING,
+    [0xC2] = SCANNER_WIDE_SPACE, // U+0085 and U+00A0
+    [0xE1] = SCANNER_WIDE_SPACE, // U+1680
+    [0xE2] = SCANNER_WIDE_SPACE, // U+2000 to U+200A, U+202F, and U+205F
+    [0xE3] = SCANNER_WIDE_SPACE  // U+3000
+};
+
+static inline u64 scanner_length(BowlScanner *scanner) {
+    return scanner->string == NULL ? scanner->length : (*scanner->string)->string.length;
+}
 
 static inline bool scanner_at_end(BowlScanner *scanner) {
-    return scanner->offset >= (*scanner->string)->string.length;
+    return scanner->offset >= scanner_length(scanner);
 }
 
 static inline u32 scanner_current(BowlScanner *scanner) {
-    return (*scanner->string)->string.codepoints[scanner->offset];
+    if (scanner->string == NULL) {
+        // the scanner only looks for ASCII characters, which are encoded by a single byte
+        return scanner->bytes[scanner->offset];
+    }
+
+    const BowlValue string = *scanner->string;
+    return TEXT_AT(string->string.bytes, string->string.width, scanner->offset);
 }
 
-static inline bool scanner_equals(u32 *codepoints, u64 codepoints_length, char *string) {
+static inline const u8 *scanner_source(BowlScanner *scanner, u64 *width) {
+    if (scanner->string == NULL) {
+        *width = 1;
+        return scanner->bytes;
+    }
+
+    *width = (*scanner->string)->string.width;
+    return (*scanner->string)->string.bytes;
+}
+
+static inline bool scanner_equals(const u8 *bytes, u64 width, u64 codepoints_length, char *string) {
     u64 index = 0;
 
     while (*string && index < codepoints_length) {
-        if (codepoints[index++] != *string++) {
+        if (TEXT_AT(bytes, width, index++) != (u8) *string++) {
             return false;
         }
     }
@@ -25,13 +74,182 @@ static inline void scanner_advance_offset(BowlScanner *scanner) {
         if (scanner_current(scanner) == '\n') {
             ++scanner->line;
             scanner->column = 1;
-        } else {
+        } else if (scanner->string != NULL || (scanner_current(scanner) & 0xC0) != 0x80) {
+            // continuation bytes do not start a new codepoint
             ++scanner->column;
         }
         ++scanner->offset;
     }
 } 
 
+static inline u64 scanner_sequence_length(u8 byte) {
+    return byte < 0x80 ? 1 : byte < 0xE0 ? 2 : byte < 0xF0 ? 3 : 4;
+}
+
+static inline u64 scanner_wide_space(BowlScanner *scanner) {
+    // returns the number of bytes of the whitespace at the current offset (or zero if there is none)
+    u32 state = UNICODE_UTF8_STATE_ACCEPT;
+    u32 codepoint = 0;
+    const u64 read = unicode_utf8_decode_codepoint((u8 *) &scanner->bytes[scanner->offset], scanner->length - scanner->offset, &state, &codepoint);
+    return state == UNICODE_UTF8_STATE_ACCEPT && unicode_is_space(codepoint) ? read : 0;
+}
+
+static inline u64 scanner_find_symbol_end(const u8 *bytes, u64 offset, u64 length) {
+    // finds the first byte which is either an ASCII whitespace or control character, or which is not ASCII at all
+    #if defined(__SSE2__)
+        const __m128i space = _mm_set1_epi8(' ');
+
+        for (; offset + 16 <= length; offset += 16) {
+            const __m128i chunk = _mm_loadu_si128((const __m128i *) &bytes[offset]);
+            const __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(chunk, space), chunk);
+            const int mask = _mm_movemask_epi8(_mm_or_si128(control, chunk));
+
+            if (mask != 0) {
+                return offset + __builtin_ctz((unsigned) mask);
+            }
+        }
+    #endif
+
+    while (offset < length && bytes[offset] > ' ' && bytes[offset] < 0x80) {
+        ++offset;
+    }
+
+    return offset;
+}
+
+static inline u64 scanner_find_string_end(const u8 *bytes, u64 offset, u64 length) {
+    // finds the first quote, backslash, or newline, or the first byte which is not ASCII
+    #if defined(__SSE2__)
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i newline = _mm_set1_epi8('\n');
+
+        for (; offset + 16 <= length; offset += 16) {
+            const __m128i chunk = _mm_loadu_si128((const __m128i *) &bytes[offset]);
+            const __m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_or_si128(_mm_cmpeq_epi8(chunk, backslash), _mm_cmpeq_epi8(chunk, newline)));
+            const int mask = _mm_movemask_epi8(_mm_or_si128(special, chunk));
+
+            if (mask != 0) {
+                return offset + __builtin_ctz((unsigned) mask);
+            }
+        }
+    #endif
+
+    while (offset < length && !(scanner_classes[bytes[offset]] & SCANNER_STRING) && bytes[offset] < 0x80) {
+        ++offset;
+    }
+
+    return offset;
+}
+
+static inline void scanner_skip_spaces_utf8(BowlScanner *scanner) {
+    while (scanner->offset < scanner->length) {
+        const u8 byte = scanner->bytes[scanner->offset];
+        u64 read = 1;
+
+        if (scanner_classes[byte] & SCANNER_SPACE) {
+            if (byte == '\n') {
+                ++scanner->line;
+                scanner->column = 0;
+            }
+        } else if (!(scanner_classes[byte] & SCANNER_WIDE_SPACE) || (read = scanner_wide_space(scanner)) == 0) {
+            return;
+        }
+
+        scanner->offset += read;
+        ++scanner->column;
+    }
+}
+
+static inline void scanner_advance_symbol_utf8(BowlScanner *scanner) {
+    scanner->token.type = BowlSymbolToken;
+    scanner->token.column = scanner->column;
+    scanner->token.line = scanner->line;
+    scanner->token.symbol.start = scanner->offset;
+
+    while (true) {
+        // skip the ASCII characters at once
+        const u64 end = scanner_find_symbol_end(scanner->bytes, scanner->offset, scanner->length);
+        scanner->column += end - scanner->offset;
+        scanner->offset = end;
+
+        if (end >= scanner->length) {
+            break;
+        }
+
+        const u8 byte = scanner->bytes[end];
+
+        if ((scanner_classes[byte] & SCANNER_SPACE) || ((scanner_classes[byte] & SCANNER_WIDE_SPACE) && scanner_wide_space(scanner) > 0)) {
+            break;
+        }
+
+        // either an ASCII control character or a codepoint which is not ASCII
+        scanner->offset += scanner_sequence_length(byte);
+        ++scanner->column;
+    }
+
+    scanner->token.symbol.length = scanner->offset - scanner->token.symbol.start;
+}
+
+static inline void scanner_advance_string_utf8(BowlScanner *scanner) {
+    scanner->token.type = BowlStringToken;
+    scanner->token.column = scanner->column;
+    scanner->token.line = scanner->line;
+
+    // the opening quote
+    ++scanner->offset;
+    ++scanner->column;
+    scanner->token.string.start = scanner->offset;
+    scanner->token.string.escaped = false;
+
+    while (true) {
+        // skip the ordinary ASCII characters at once
+        const u64 end = scanner_find_string_end(scanner->bytes, scanner->offset, scanner->length);
+        scanner->column += end - scanner->offset;
+        scanner->offset = end;
+
+        if (end >= scanner->length) {
+            scanner->token.type = BowlErrorToken;
+            scanner->token.column = scanner->column;
+            scanner->token.line = scanner->line;
+            scanner->token.error.message = "illegal end of string literal";
+            return;
+        }
+
+        u8 byte = scanner->bytes[end];
+
+        if (byte == '"') {
+            break;
+        } else if (byte == '\\') {
+            // the escaped codepoint (which may be a quote) belongs to the string literal
+            scanner->token.string.escaped = true;
+            ++scanner->offset;
+            ++scanner->column;
+
+            if (scanner->offset >= scanner->length) {
+                continue;
+            }
+
+            byte = scanner->bytes[scanner->offset];
+        }
+
+        if (byte == '\n') {
+            ++scanner->line;
+            scanner->column = 1;
+        } else {
+            ++scanner->column;
+        }
+
+        scanner->offset += scanner_sequence_length(byte);
+    }
+
+    scanner->token.string.length = scanner->offset - scanner->token.string.start;
+
+    // the closing quote
+    ++scanner->offset;
+    ++scanner->column;
+}
+
 static inline void scanner_skip_spaces(BowlScanner *scanner) {
     // in case the end-of-source is hit this loop terminates since the codepoint is set to 0 (which is not a space)
     while (!scanner_at_end(scanner) && unicode_is_space(scanner_current(scanner))) { 
@@ -65,6 +283,7 @@ static inline void scanner_advance_string(BowlScanner *scanner) {
 
     scanner_advance_offset(scanner);
     scanner->token.string.start = scanner->offset;
+    scanner->token.string.escaped = false;
     
     register bool escaped = false;
     while (!scanner_at_end(scanner) && (scanner_current(scanner) != '"' || escaped)) {
@@ -72,6 +291,7 @@ static inline void scanner_advance_string(BowlScanner *scanner) {
             escaped = false;
         } else if (scanner_current(scanner) == '\\') {
             escaped = true;
+            scanner->token.string.escaped = true;
         }
 
         scanner_advance_offset(scanner);
@@ -90,116 +310,115 @@ static inline void scanner_advance_string(BowlScanner *scanner) {
     scanner_advance_offset(scanner);
 }
 
+static inline bool scanner_is_digit(u32 codepoint) {
+    return codepoint - '0' < 10;
+}
+
+static inline void scanner_number_error(BowlScanner *scanner, u64 offset) {
+    // number literals consist of ASCII characters only, i.e., every character is a single column
+    scanner->column += offset - scanner->offset;
+    scanner->offset = offset;
+    scanner->token.type = BowlErrorToken;
+    scanner->token.column = scanner->column;
+    scanner->token.line = scanner->line;
+    scanner->token.error.message = "illegal number literal";
+}
+
 static inline void scanner_advance_number(BowlScanner *scanner) {
     scanner->token.type = BowlNumberToken;
     scanner->token.column = scanner->column;
     scanner->token.line = scanner->line;
 
+    u64 width;
+    const u8 *const source = scanner_source(scanner, &width);
+    const u64 length = scanner_length(scanner);
+    const u64 start = scanner->offset;
+    u64 offset = start;
+
+    // the digits are accumulated in an integer, the decimal point and the exponent only move the power of ten
+    NumberDecimal decimal = {
+        .mantissa = 0,
+        .digits = 0,
+        .exponent = 0,
+        .truncated = false
+    };
+
     bool negative = false;
 
-    if (scanner_current(scanner) == '-') {
+    if (TEXT_AT(source, width, offset) == '-') {
         negative = true;
-        scanner_advance_offset(scanner);
-    } else if (scanner_current(scanner) == '+') {
-        scanner_advance_offset(scanner);
+        ++offset;
+    } else if (TEXT_AT(source, width, offset) == '+') {
+        ++offset;
     }
 
-    if (scanner_at_end(scanner) || scanner_current(scanner) < '0' || scanner_current(scanner) > '9') {
-        scanner->token.type = BowlErrorToken;
-        scanner->token.column = scanner->column;
-        scanner->token.line = scanner->line;
-        scanner->token.error.message = "illegal number literal";
+    if (offset >= length || !scanner_is_digit(TEXT_AT(source, width, offset))) {
+        scanner_number_error(scanner, offset);
+        return;
     }
 
-    double result = 0;
     do {
-        result *= 10;
-        result += scanner_current(scanner) - '0';
-        scanner_advance_offset(scanner);
-    } while (!scanner_at_end(scanner) && scanner_current(scanner) >= '0' && scanner_current(scanner) <= '9');
+        number_decimal_digit(&decimal, TEXT_AT(source, width, offset) - '0', false);
+        ++offset;
+    } while (offset < length && scanner_is_digit(TEXT_AT(source, width, offset)));
 
-    if (!scanner_at_end(scanner) && scanner_current(scanner) == '.') {
-        scanner_advance_offset(scanner);
+    if (offset < length && TEXT_AT(source, width, offset) == '.') {
+        ++offset;
 
-        if (scanner_at_end(scanner) || scanner_current(scanner) < '0' || scanner_current(scanner) > '9') {
-            scanner->token.type = BowlErrorToken;
-            scanner->token.column = scanner->column;
-            scanner->token.line = scanner->line;
-            scanner->token.error.message = "illegal number literal";
+        if (offset >= length || !scanner_is_digit(TEXT_AT(source, width, offset))) {
+            scanner_number_error(scanner, offset);
             return;
         }
 
-        double fraction = 0;
-        double magnitude = 1;
         do {
-            fraction *= 10;
-            magnitude *= 10;
-            fraction += scanner_current(scanner) - '0';
-            scanner_advance_offset(scanner);
-        } while (!scanner_at_end(scanner) && scanner_current(scanner) >= '0' && scanner_current(scanner) <= '9');
-
-        result += fraction / magnitude;
+            number_decimal_digit(&decimal, TEXT_AT(source, width, offset) - '0', true);
+            ++offset;
+        } while (offset < length && scanner_is_digit(TEXT_AT(source, width, offset)));
     }
 
-    if (!scanner_at_end(scanner) && (scanner_current(scanner) == 'e' || scanner_current(scanner) == 'E')) {
-        scanner_advance_offset(scanner);
+    if (offset < length && (TEXT_AT(source, width, offset) == 'e' || TEXT_AT(source, width, offset) == 'E')) {
+        ++offset;
 
-        if (scanner_at_end(scanner)) {
-            scanner->token.type = BowlErrorToken;
-            scanner->token.column = scanner->column;
-            scanner->token.line = scanner->line;
-            scanner->token.error.message = "illegal number literal";
+        if (offset >= length) {
+            scanner_number_error(scanner, offset);
             return;
         }
 
         bool exponent_negative = false;
-        if (scanner_current(scanner) == '-') {
+
+        if (TEXT_AT(source, width, offset) == '-') {
             exponent_negative = true;
-            scanner_advance_offset(scanner);
-        } else if (scanner_current(scanner) == '+') {
-            scanner_advance_offset(scanner);
+            ++offset;
+        } else if (TEXT_AT(source, width, offset) == '+') {
+            ++offset;
         }
 
-        if (scanner_at_end(scanner) || scanner_current(scanner) < '0' || scanner_current(scanner) > '9') {
-            scanner->token.type = BowlErrorToken;
-            scanner->token.column = scanner->column;
-            scanner->token.line = scanner->line;
-            scanner->token.error.message = "illegal number literal";
+        if (offset >= length || !scanner_is_digit(TEXT_AT(source, width, offset))) {
+            scanner_number_error(scanner, offset);
             return;
         }
 
-        double exponent = 0;
-        do {
-            exponent *= 10;
-            exponent += scanner_current(scanner) - '0';
-            scanner_advance_offset(scanner);
-        } while (!scanner_at_end(scanner) && scanner_current(scanner) >= '0' && scanner_current(scanner) <= '9');
-
-        if (exponent_negative) {
-            exponent = -exponent;
-        }
+        i64 exponent = 0;
 
-        result += pow(10, exponent);
+        do {
+            // any exponent beyond this limit overflows or underflows anyway
+            if (exponent < 100000) {
+                exponent = exponent * 10 + (TEXT_AT(source, width, offset) - '0');
+            }
+            ++offset;
+        } while (offset < length && scanner_is_digit(TEXT_AT(source, width, offset)));
+
+        decimal.exponent += exponent_negative ? -exponent : exponent;
     }
 
-    if (negative) {
-        result = -result;        
-    }
+    const double value = number_from_literal(&decimal, negative, &source[start * width], width, offset - start);
 
-    scanner->token.number.value = result;
+    scanner->column += offset - scanner->offset;
+    scanner->offset = offset;
+    scanner->token.number.value = value;
 }
 
-static void scanner_advance(BowlScanner *scanner) {
-    scanner_skip_spaces(scanner);
-    scanner->token_available = true;
-
-    if (scanner_at_end(scanner)) {
-        scanner->token.column = scanner->column;
-        scanner->token.line = scanner->line;
-        scanner->token.type = BowlEndOfStreamToken;
-        return;
-    }
-
+static void scanner_advance_token(BowlScanner *scanner) {
     if (scanner_current(scanner) >= '0' && scanner_current(scanner) <= '9') {
         scanner_advance_number(scanner);
         return;
@@ -217,25 +436,74 @@ static void scanner_advance(BowlScanner *scanner) {
     }
     
     if (scanner_current(scanner) == '"') {
-        scanner_advance_string(scanner);
+        if (scanner->string == NULL) {
+            scanner_advance_string_utf8(scanner);
+        } else {
+            scanner_advance_string(scanner);
+        }
         return;
     }
 
-    scanner_advance_symbol(scanner);
+    if (scanner->string == NULL) {
+        scanner_advance_symbol_utf8(scanner);
+    } else {
+        scanner_advance_symbol(scanner);
+    }
+
     if (scanner->token.type == BowlSymbolToken) {
-        if (scanner_equals(&(*scanner->string)->string.codepoints[scanner->token.symbol.start], scanner->token.symbol.length, "true")) {
+        u64 width;
+        const u8 *const symbol = &scanner_source(scanner, &width)[scanner->token.symbol.start * width];
+
+        if (scanner_equals(symbol, width, scanner->token.symbol.length, "true")) {
             scanner->token.type = BowlBooleanToken;
             scanner->token.boolean.value = true;
-        } else if (scanner_equals(&(*scanner->string)->string.codepoints[scanner->token.symbol.start], scanner->token.symbol.length, "false")) {
+        } else if (scanner_equals(symbol, width, scanner->token.symbol.length, "false")) {
             scanner->token.type = BowlBooleanToken;
             scanner->token.boolean.value = false;
         }
     }
 }
 
+static void scanner_advance(BowlScanner *scanner) {
+    if (scanner->string == NULL) {
+        scanner_skip_spaces_utf8(scanner);
+    } else {
+        scanner_skip_spaces(scanner);
+    }
+
+    scanner->token_available = true;
+
+    if (scanner_at_end(scanner) || scanner->offset >= scanner->limit) {
+        scanner->token.column = scanner->column;
+        scanner->token.line = scanner->line;
+        scanner->token.type = BowlEndOfStreamToken;
+        return;
+    }
+
+    const u64 offset = scanner->offset;
+    const u64 line = scanner->line;
+    const u64 column = scanner->column;
+
+    scanner_advance_token(scanner);
+
+    if (scanner->partial && scanner->offset >= scanner->length) {
+        // the token may continue in the next chunk of the source => stop in front of it, such that it is scanned again
+        scanner->offset = offset;
+        scanner->line = line;
+        scanner->column = column;
+        scanner->token.line = line;
+        scanner->token.column = column;
+        scanner->token.type = BowlEndOfStreamToken;
+    }
+}
+
 BowlScanner scanner_from(BowlValue *string) {
     BowlScanner scanner = {
         .string = string,
+        .bytes = NULL,
+        .length = 0,
+        .partial = false,
+        .limit = UINT64_MAX,
         .offset = 0,
         .line = 1,
         .column = 1,
@@ -255,6 +523,49 @@ BowlScanner scanner_from(BowlValue *string) {
     return scanner;
 }
 
+BowlScanner scanner_from_utf8(const u8 *bytes, u64 length) {
+    BowlScanner scanner = {
+        .string = NULL,
+        .bytes = bytes,
+        .length = length,
+        .partial = false,
+        .limit = UINT64_MAX,
+        .offset = 0,
+        .line = 1,
+        .column = 1,
+        .token_available = false,
+        .token = {
+            .type = BowlErrorToken,
+            .line = 1,
+            .column = 1
+        }
+    };
+
+    if (length == 0) {
+        scanner.token.type = BowlEndOfStreamToken;
+        scanner.token_available = true;
+    }
+
+    return scanner;
+}
+
+bool scanner_skip_string(BowlScanner *scanner) {
+    bool escaped = false;
+
+    while (!scanner_at_end(scanner) && (scanner_current(scanner) != '"' || escaped)) {
+        escaped = !escaped && scanner_current(scanner) == '\\';
+        scanner_advance_offset(scanner);
+    }
+
+    if (scanner_at_end(scanner)) {
+        return false;
+    }
+
+    // the closing quote
+    scanner_advance_offset(scanner);
+    return true;
+}
+
 bool scanner_has_next(BowlScanner *scanner) {
     if (!scanner->token_available) {
         scanner_advance(scanner);
@@ -34,6 +34,8 @@ typedef struct {
         struct {
             u64 start;
             u64 length;
+            /** Whether the string literal contains escape sequences. */
+            bool escaped;
         } string;
 
         struct {
@@ -43,8 +45,16 @@ typedef struct {
 } BowlToken;
 
 typedef struct {
-    /** A reference to the underlying source of this scanner (this reference may be managed by the garbage collector). */
+    /** A reference to the underlying source of this scanner (this reference may be managed by the garbage collector), or 'NULL' if the source is given by 'bytes'. */
     BowlValue *string;
+    /** The UTF-8 encoded source of this scanner (if there is no 'string'), in which case offsets are counted in bytes. */
+    const u8 *bytes;
+    /** The number of bytes of the source. */
+    u64 length;
+    /** Whether the bytes are only a chunk of the source, in which case a token which reaches the end of the chunk is not scanned. */
+    bool partial;
+    /** The scanner stops in front of the first token which starts at or after this offset. */
+    u64 limit;
     /** The current offset in the source. */
     u64 offset;
     /** The current line number. */
@@ -57,6 +67,27 @@ typedef struct {
 
 BowlScanner scanner_from(BowlValue *string);
 
+/**
+ * Creates a scanner which runs over UTF-8 encoded bytes instead of a string. The starts and
+ * lengths of the tokens refer to the bytes, whereas lines and columns still count codepoints.
+ *
+ * If the bytes are only a chunk of a larger source, 'partial' should be set afterwards. The
+ * scanner then stops in front of the last token of the chunk, since it may continue in the next one.
+ * @param bytes The bytes, which must be valid UTF-8 (see 'unicode_utf8_measure').
+ * @param length The number of bytes.
+ * @return The scanner.
+ */
+BowlScanner scanner_from_utf8(const u8 *bytes, u64 length);
+
+/**
+ * Advances the scanner behind the end of a string literal, as if the scanner had been stopped
+ * inside of the string literal.
+ * @param scanner The scanner.
+ * @return Either 'true' if the string literal is closed, or 'false' if the end of the source
+ * was reached.
+ */
+bool scanner_skip_string(BowlScanner *scanner);
+
 bool scanner_has_next(BowlScanner *scanner);
 
 BowlTokenType scanner_next(BowlScanner *scanner);
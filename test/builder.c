@@ -0,0 +1,83 @@
+#include "test.h"
+
+// the largest number of distinct keys of a map
+#define BUILDER_KEYS 3000
+
+// the reference model of the map which is built
+static bool builder_present[BUILDER_KEYS];
+static double builder_values[BUILDER_KEYS];
+
+static void builder_random(BowlStack stack, u64 keys, bool initial) {
+    // the first register holds the pairs of the builder, the second one the map which is built by puts
+    BowlMapBuilder builder;
+    memset(builder_present, 0, sizeof(builder_present));
+    stack->registers[1] = TEST_VALUE(bowl_map(stack, 0));
+
+    if (initial) {
+        // the initial map already holds every other key
+        for (u64 i = 0; i < keys; i += 2) {
+            stack->registers[2] = TEST_VALUE(bowl_number(stack, (double) i));
+            stack->registers[1] = TEST_VALUE(bowl_map_put(stack, stack->registers[1], stack->registers[2], stack->registers[2]));
+            builder_present[i] = true;
+            builder_values[i] = (double) i;
+        }
+    }
+
+    TEST_ASSERT(bowl_map_builder_begin(stack, &builder, &stack->registers[0], initial ? stack->registers[1] : NULL, keys) == NULL);
+
+    // some keys are put more than once, in which case the last value wins
+    for (u64 i = 0; i < 2 * keys; ++i) {
+        const u64 key = (u64) rand() % keys;
+        const double number = rand();
+        BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+        frame.registers[0] = TEST_VALUE(bowl_number(&frame, (double) key));
+        frame.registers[1] = TEST_VALUE(bowl_number(&frame, number));
+
+        if (i == keys) {
+            // the pairs of the builder are managed by the garbage collector
+            TEST_ASSERT(bowl_collect_garbage(&frame) == NULL);
+        }
+
+        TEST_ASSERT(bowl_map_builder_put(&frame, &builder, frame.registers[0], frame.registers[1]) == NULL);
+        stack->registers[1] = TEST_VALUE(bowl_map_put(&frame, stack->registers[1], frame.registers[0], frame.registers[1]));
+        builder_present[key] = true;
+        builder_values[key] = number;
+    }
+
+    stack->registers[0] = TEST_VALUE(bowl_map_builder_freeze(stack, &builder));
+    TEST_ASSERT(bowl_value_equals(stack->registers[0], stack->registers[1]));
+    TEST_ASSERT(bowl_value_hash(stack->registers[0]) == bowl_value_hash(stack->registers[1]));
+
+    u64 length = 0;
+
+    for (u64 i = 0; i < keys; ++i) {
+        stack->registers[2] = TEST_VALUE(bowl_number(stack, (double) i));
+        const BowlValue value = bowl_map_get_or_else(stack->registers[0], stack->registers[2], NULL);
+        TEST_ASSERT(builder_present[i] ? value != NULL && value->number.value == builder_values[i] : value == NULL);
+        length += builder_present[i];
+    }
+
+    TEST_ASSERT(stack->registers[0]->map.length == length);
+
+    // the frozen map is an ordinary map, thus its pairs can be deleted again
+    for (u64 i = 0; i < keys; ++i) {
+        stack->registers[2] = TEST_VALUE(bowl_number(stack, (double) i));
+        stack->registers[0] = TEST_VALUE(bowl_map_delete(stack, stack->registers[0], stack->registers[2]));
+        length -= builder_present[i];
+        TEST_ASSERT(stack->registers[0]->map.length == length);
+    }
+}
+
+int main(void) {
+    BowlValue roots[3];
+    BowlStackFrame frame;
+    test_frame(&frame, roots);
+    srand(27);
+
+    for (u64 keys = 1; keys <= BUILDER_KEYS; keys = keys * 3 + 1) {
+        builder_random(&frame, keys, false);
+        builder_random(&frame, keys, true);
+    }
+
+    return EXIT_SUCCESS;
+}
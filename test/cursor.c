@@ -0,0 +1,54 @@
+#include "test.h"
+
+// the largest number of pairs of a map
+#define CURSOR_PAIRS 5000
+
+static bool cursor_seen[CURSOR_PAIRS];
+
+static void cursor_check(BowlStack stack, u64 pairs) {
+    // the first register holds the map, whose keys and values are the numbers below 'pairs'
+    stack->registers[0] = TEST_VALUE(bowl_map(stack, 0));
+
+    for (u64 i = 0; i < pairs; ++i) {
+        stack->registers[1] = TEST_VALUE(bowl_number(stack, (double) i));
+        stack->registers[0] = TEST_VALUE(bowl_map_put(stack, stack->registers[0], stack->registers[1], stack->registers[1]));
+    }
+
+    memset(cursor_seen, 0, sizeof(cursor_seen));
+    const u64 collections = gc_collections();
+    BowlMapCursor cursor = bowl_map_cursor(&stack->registers[0]);
+    BowlValue key, value;
+    u64 count = 0;
+
+    while (bowl_map_cursor_next(&cursor, &key, &value)) {
+        const u64 i = (u64) key->number.value;
+        TEST_ASSERT(i < pairs && key == value && !cursor_seen[i]);
+        cursor_seen[i] = true;
+        ++count;
+
+        // a new version of the map does not affect the one which is iterated
+        if (count % 11 == 0) {
+            stack->registers[1] = TEST_VALUE(bowl_map_delete(stack, stack->registers[0], key));
+        }
+
+        // the cursor continues at the same pair after the map was moved by the garbage collector
+        if (count % 7 == 0) {
+            TEST_ASSERT(bowl_collect_garbage(stack) == NULL);
+        }
+    }
+
+    TEST_ASSERT(count == pairs);
+    TEST_ASSERT(pairs < 7 || gc_collections() - collections >= pairs / 7);
+}
+
+int main(void) {
+    BowlValue roots[3];
+    BowlStackFrame frame;
+    test_frame(&frame, roots);
+
+    for (u64 pairs = 0; pairs <= CURSOR_PAIRS; pairs = pairs * 2 + 1) {
+        cursor_check(&frame, pairs);
+    }
+
+    return EXIT_SUCCESS;
+}
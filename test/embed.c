@@ -0,0 +1,40 @@
+#include "test.h"
+#include "../src/core/embed.h"
+
+// the path of the source which is written by the test
+#define EMBED_PATH "build/test/embed.c"
+
+int main(void) {
+    BowlValue roots[3];
+    BowlStackFrame frame;
+    test_frame(&frame, roots);
+
+    u8 bytes[6 + 2 * TEXT_FLAT_LIMIT];
+    memcpy(bytes, "\xe6\x97\xa5\xe6\x9c\xac", 6);
+    memset(&bytes[6], 'a', TEXT_FLAT_LIMIT);
+    memset(&bytes[6 + TEXT_FLAT_LIMIT], 'b', TEXT_FLAT_LIMIT);
+
+    // a slice keeps the width of its parent, but it is written in the smallest width of its codepoints
+    frame.registers[0] = TEST_VALUE(bowl_string_utf8(&frame, bytes, 6 + TEXT_FLAT_LIMIT));
+    frame.registers[0] = TEST_VALUE(bowl_string_slice(&frame, frame.registers[0], 2, TEXT_FLAT_LIMIT));
+    frame.registers[1] = TEST_VALUE(bowl_string_utf8(&frame, &bytes[6 + TEXT_FLAT_LIMIT], TEXT_FLAT_LIMIT));
+    frame.registers[0] = TEST_VALUE(bowl_string_concat(&frame, frame.registers[0], frame.registers[1]));
+    TEST_ASSERT(frame.registers[0]->string.width & TEXT_CONCAT);
+    frame.registers[0] = TEST_VALUE(bowl_list(&frame, frame.registers[0], NULL));
+
+    TEST_ASSERT(embed_write(&frame, frame.registers[0], EMBED_PATH) == NULL);
+
+    FILE *const file = fopen(EMBED_PATH, "rb");
+    char source[8192];
+    TEST_ASSERT(file != NULL);
+
+    const u64 size = fread(source, 1, sizeof(source) - 1, file);
+    source[size] = '\0';
+    fclose(file);
+
+    char expected[256];
+    sprintf(expected, ".length = %d, .width = 1, .bytes =\n    \"%.*s\"\n    \"%.*s\"\n} } };", 2 * TEXT_FLAT_LIMIT, TEXT_FLAT_LIMIT, (char *) &bytes[6], TEXT_FLAT_LIMIT, (char *) &bytes[6 + TEXT_FLAT_LIMIT]);
+    TEST_ASSERT(strstr(source, expected) != NULL);
+
+    return EXIT_SUCCESS;
+}
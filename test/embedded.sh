@@ -0,0 +1,20 @@
+#!/bin/sh
+# embeds each boot program in 'test/embedded' using the target 'embedded' of the makefile and checks
+# that the embedded tokens are equal to the tokens of the boot program
+set -e
+
+directory=build/test/embedded
+sources=$(find src -type f -iname '*.c' ! -path src/main.c)
+
+rm -rf "$directory"
+mkdir -p "$directory"
+
+for boot in test/embedded/*.bowl; do
+    name=$(basename "$boot" .bowl)
+
+    # the boot file is copied, such that its precompiled tokens are not written into the tree
+    cp "$boot" "$directory/$name.bowl"
+    ${MAKE:-make} --no-print-directory embedded COMPILER="$COMPILER" INCLUDE="$INCLUDE" OUTPUT="$directory/bowl" BOOT="$directory/$name.bowl" EMBEDDED="$directory/$name.c" > /dev/null
+    "$COMPILER" -o "$directory/check" -std=c11 test/embedded/check.c "$directory/$name.c" $sources -DBOWL_EMBEDDED_BOOT -I"$INCLUDE" -lm -ldl -lpthread
+    "$directory/check" "$directory/$name.bowl"
+done
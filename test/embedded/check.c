@@ -0,0 +1,80 @@
+#include "../test.h"
+#include "../../src/core/embed.h"
+
+/*
+ * Checks the embedded boot program of a virtual machine which was built by the target 'embedded'
+ * of the makefile: the boot file, which is passed as the only argument, is tokenized again and
+ * its tokens must be equal to the ones which were embedded in place of the symbol 'boot:tokens'.
+ */
+
+static u8 *check_read(const char *path, u64 *size) {
+    FILE *const file = fopen(path, "rb");
+    TEST_ASSERT(file != NULL);
+
+    u8 *bytes = NULL;
+    u64 capacity = 0;
+    *size = 0;
+
+    for (u64 count = 1; count > 0; *size += count) {
+        if (*size == capacity) {
+            capacity = MAX(capacity * 2, 4096);
+            bytes = realloc(bytes, capacity);
+            TEST_ASSERT(bytes != NULL);
+        }
+
+        count = fread(&bytes[*size], 1, capacity - *size, file);
+    }
+
+    fclose(file);
+    return bytes;
+}
+
+int main(int argument_count, char *arguments[]) {
+    BowlValue roots[3];
+    BowlStackFrame frame;
+    test_frame(&frame, roots);
+
+    TEST_ASSERT(argument_count == 2);
+    TEST_ASSERT(embed_intern() == NULL);
+
+    u64 size;
+    u8 *const source = check_read(arguments[1], &size);
+    frame.registers[0] = TEST_VALUE(bowl_tokens_utf8(&frame, source, size));
+    free(source);
+
+    // the tokens of the boot loader are never lists, except for the tokens of the boot file
+    u64 found = 0;
+    u64 length = 0;
+
+    for (BowlValue list = bowl_embedded_boot; list != NULL; list = list->list.tail) {
+        const BowlValue value = list->list.head;
+
+        TEST_ASSERT(list->type == BowlListValue);
+        TEST_ASSERT(list->list.length == bowl_embedded_boot->list.length - length++);
+
+        if (value == NULL || value->type == BowlListValue) {
+            TEST_ASSERT(bowl_value_equals(value, frame.registers[0]));
+            TEST_ASSERT(bowl_value_hash(value) == bowl_value_hash(frame.registers[0]));
+            ++found;
+        }
+    }
+
+    TEST_ASSERT(found == 1);
+
+    // the symbols of the boot file are the interned ones
+    for (BowlValue list = frame.registers[0]; list != NULL; list = list->list.tail) {
+        const BowlValue value = list->list.head;
+
+        if (value->type == BowlSymbolValue) {
+            bool embedded = false;
+
+            for (BowlValue *symbol = bowl_embedded_symbols; *symbol != NULL && !embedded; ++symbol) {
+                embedded = *symbol == value;
+            }
+
+            TEST_ASSERT(embedded);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,47 @@
+#include "test.h"
+#include "../src/core/external.h"
+
+// the file which is read by the native function (relative to the root of the repository)
+#define EXTERNAL_PATH "test/embedded/boot.bowl"
+
+int main(void) {
+    BowlValue roots[3];
+    BowlStackFrame frame;
+    test_frame(&frame, roots);
+
+    FILE *const file = fopen(EXTERNAL_PATH, "rb");
+    TEST_ASSERT(file != NULL);
+
+    char contents[4096];
+    const u64 size = fread(contents, 1, sizeof(contents), file);
+    fclose(file);
+    TEST_ASSERT(size > 0 && size < sizeof(contents));
+
+    // the native function replaces the path with the contents of the file
+    frame.registers[0] = TEST_VALUE(bowl_string_utf8(&frame, (u8 *) EXTERNAL_PATH, sizeof(EXTERNAL_PATH) - 1));
+    *frame.datastack = TEST_VALUE(bowl_list(&frame, frame.registers[0], NULL));
+    TEST_ASSERT(bowl_string_file_function(&frame) == NULL);
+    TEST_ASSERT(*frame.datastack != NULL && (*frame.datastack)->list.tail == NULL);
+
+    frame.registers[1] = TEST_VALUE(bowl_string_utf8(&frame, (u8 *) contents, size));
+    TEST_ASSERT(bowl_value_equals((*frame.datastack)->list.head, frame.registers[1]));
+
+    // the string survives a collection, which relocates it while its codepoints stay in place
+    frame.registers[0] = (*frame.datastack)->list.head;
+    TEST_ASSERT(bowl_collect_garbage(&frame) == NULL);
+    TEST_ASSERT(bowl_value_equals(frame.registers[0], frame.registers[1]));
+
+    // a missing file or an argument of another type is an exception
+    frame.registers[0] = TEST_VALUE(bowl_string_utf8(&frame, (u8 *) "test/missing", 12));
+    *frame.datastack = TEST_VALUE(bowl_list(&frame, frame.registers[0], NULL));
+    TEST_ASSERT(bowl_string_file_function(&frame) != NULL);
+
+    frame.registers[0] = TEST_VALUE(bowl_number(&frame, 42));
+    *frame.datastack = TEST_VALUE(bowl_list(&frame, frame.registers[0], NULL));
+    TEST_ASSERT(bowl_string_file_function(&frame) != NULL);
+
+    *frame.datastack = NULL;
+    TEST_ASSERT(bowl_string_file_function(&frame) != NULL);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,34 @@
+#include "test.h"
+
+// the number of values which stay alive during the test (about 16 MB of list cells and numbers)
+#define HEAP_VALUES 200000
+
+int main(void) {
+    BowlValue roots[3];
+    BowlStackFrame frame;
+    test_frame(&frame, roots);
+
+    const u64 collections = gc_collections();
+
+    // half of the values become garbage right away, so each collection frees some memory while the
+    // values which stay alive slowly fill up the heap
+    for (u64 i = 0; i < HEAP_VALUES; ++i) {
+        frame.registers[0] = TEST_VALUE(bowl_number(&frame, (double) i));
+        frame.registers[2] = TEST_VALUE(bowl_list(&frame, frame.registers[0], NULL));
+        frame.registers[1] = TEST_VALUE(bowl_list(&frame, frame.registers[0], frame.registers[1]));
+    }
+
+    // the heap grows as soon as it is more than half full after a collection, such that the number of
+    // collections is logarithmic (instead of collecting an almost full heap over and over again)
+    TEST_ASSERT(gc_collections() - collections < 64);
+
+    u64 expected = HEAP_VALUES;
+    for (BowlValue node = frame.registers[1]; node != NULL; node = node->list.tail) {
+        TEST_ASSERT(node->list.head->type == BowlNumberValue);
+        TEST_ASSERT(node->list.head->number.value == (double) --expected);
+    }
+
+    TEST_ASSERT(expected == 0);
+
+    return EXIT_SUCCESS;
+}
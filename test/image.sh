@@ -0,0 +1,15 @@
+#!/bin/sh
+# writes an image of a dictionary with the functions of a native library and restores it in another
+# process, since an image must be restored before any value is hashed
+set -e
+
+directory=build/test/image
+sources=$(find src -type f -iname '*.c' ! -path src/main.c)
+
+rm -rf "$directory"
+mkdir -p "$directory"
+
+"$COMPILER" -o "$directory/library.so" -std=c11 -shared -fPIC test/image/library.c -I"$INCLUDE"
+"$COMPILER" -o "$directory/check" -std=c11 test/image/check.c $sources -I"$INCLUDE" -lm -ldl -lpthread -Wl,--dynamic-list=export.list
+"$directory/check" write "$directory/library.so" "$directory/test.image"
+"$directory/check" load "$directory/test.image"
@@ -0,0 +1,75 @@
+#include "../test.h"
+#include "../../src/core/image.h"
+
+/*
+ * Writes an image of a dictionary which contains the functions of a native library ('check write
+ * <library> <image>') and restores it in another process ('check load <image>'), since an image can
+ * only be restored before any value is hashed.
+ */
+
+static void check_write(BowlStack stack, const char *library, const char *path) {
+    *stack->dictionary = TEST_VALUE(bowl_map(stack, 16));
+    stack->registers[1] = TEST_VALUE(bowl_library(stack, (char *) library));
+    TEST_ASSERT(bowl_register_function(stack, "image:dump", "Writes an image.", NULL, bowl_image_dump) == NULL);
+
+    // the hash of a native function is its address, thus it cannot be the key of a map in an image
+    stack->registers[0] = TEST_VALUE(bowl_symbol_utf8(stack, (u8 *) "image:dump", 10));
+    stack->registers[0] = bowl_dictionary_get_or_else(*stack->dictionary, stack->registers[0], NULL);
+    TEST_ASSERT(stack->registers[0] != NULL);
+    stack->registers[2] = TEST_VALUE(bowl_map(stack, 0));
+    stack->registers[2] = TEST_VALUE(bowl_map_put(stack, stack->registers[2], stack->registers[0]->list.head, stack->registers[0]));
+    stack->registers[2] = TEST_VALUE(bowl_list(stack, stack->registers[2], NULL));
+    *stack->datastack = TEST_VALUE(bowl_list(stack, stack->registers[2], NULL));
+    TEST_ASSERT(image_write(stack, path) != NULL);
+
+    // the same native function is fine as a value
+    stack->registers[2] = TEST_VALUE(bowl_symbol_utf8(stack, (u8 *) "key", 3));
+    stack->registers[2] = TEST_VALUE(bowl_map_put(stack, *stack->dictionary, stack->registers[2], stack->registers[0]->list.head));
+    *stack->datastack = TEST_VALUE(bowl_list(stack, stack->registers[2], NULL));
+    TEST_ASSERT(image_write(stack, path) == NULL);
+}
+
+static void check_load(BowlStack stack, const char *path) {
+    TEST_ASSERT(image_load(stack, path) == NULL);
+    TEST_ASSERT(bowl_collect_garbage(stack) == NULL);
+
+    // every symbol of the dictionary must be the interned one, including the functions of the library
+    MapIterator iterator = map_iterator(*stack->dictionary);
+    BowlValue key, value;
+    u64 length = 0;
+
+    while (map_iterator_next(&iterator, &key, &value)) {
+        const char *const name = bowl_text_borrow(key, NULL);
+        TEST_ASSERT(name != NULL);
+        TEST_ASSERT(TEST_VALUE(bowl_symbol_utf8(stack, (u8 *) name, strlen(name))) == key);
+        ++length;
+    }
+
+    TEST_ASSERT(length == 2);
+
+    stack->registers[0] = TEST_VALUE(bowl_symbol_utf8(stack, (u8 *) "image:answer", 12));
+    stack->registers[0] = bowl_dictionary_get_or_else(*stack->dictionary, stack->registers[0], NULL);
+    TEST_ASSERT(stack->registers[0] != NULL);
+    TEST_ASSERT(stack->registers[0]->list.head->function.function(stack) == NULL);
+    TEST_ASSERT((*stack->datastack)->list.head->number.value == 42);
+
+    // the map on the datastack was written with the restored dictionary
+    stack->registers[1] = TEST_VALUE(bowl_symbol_utf8(stack, (u8 *) "key", 3));
+    stack->registers[1] = bowl_map_get_or_else((*stack->datastack)->list.tail->list.head, stack->registers[1], NULL);
+    TEST_ASSERT(stack->registers[1] != NULL && stack->registers[1]->type == BowlNativeValue);
+}
+
+int main(int argument_count, char *arguments[]) {
+    BowlValue roots[3];
+    BowlStackFrame frame;
+    test_frame(&frame, roots);
+
+    if (argument_count == 4 && strcmp(arguments[1], "write") == 0) {
+        check_write(&frame, arguments[2], arguments[3]);
+    } else {
+        TEST_ASSERT(argument_count == 3 && strcmp(arguments[1], "load") == 0);
+        check_load(&frame, arguments[2]);
+    }
+
+    return EXIT_SUCCESS;
+}
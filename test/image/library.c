@@ -0,0 +1,35 @@
+#include <bowl/api.h>
+#include <bowl/module.h>
+
+/*
+ * A native library for the image test, whose functions are registered once when the image is
+ * written and once more while the image is restored.
+ */
+
+BowlValue image_library_answer(BowlStack stack) {
+    BowlResult result = bowl_number(stack, 42);
+
+    if (result.failure) {
+        return result.exception;
+    }
+
+    result = bowl_list(stack, result.value, *stack->datastack);
+
+    if (result.failure) {
+        return result.exception;
+    }
+
+    *stack->datastack = result.value;
+
+    return NULL;
+}
+
+BowlValue bowl_module_initialize(BowlStack stack, BowlValue library) {
+    return bowl_register_function(stack, "image:answer", "Pushes the answer.", library, image_library_answer);
+}
+
+BowlValue bowl_module_finalize(BowlStack stack, BowlValue library) {
+    (void) stack;
+    (void) library;
+    return NULL;
+}
@@ -0,0 +1,160 @@
+#include "test.h"
+#include "../src/core/json.h"
+
+// the number of random documents
+#define JSON_DOCUMENTS 2000
+
+static void json_valid(BowlStack stack, const char *document, const char *expected) {
+    // a valid document is read and written back in its canonical form
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+    frame.registers[0] = TEST_VALUE(bowl_json_parse(&frame, (const u8 *) document, strlen(document)));
+
+    u8 *bytes;
+    u64 length;
+    TEST_ASSERT(bowl_json_emit(&frame, frame.registers[0], &bytes, &length) == NULL);
+    TEST_ASSERT(length == strlen(expected) && memcmp(bytes, expected, length) == 0);
+    free(bytes);
+}
+
+static void json_invalid(BowlStack stack, const char *document, u64 length) {
+    TEST_ASSERT(bowl_json_parse(stack, (const u8 *) document, length).failure);
+}
+
+#define JSON_INVALID(stack, document) json_invalid((stack), (document), sizeof(document) - 1)
+
+static BowlValue json_value(BowlStack stack, u64 depth) {
+    // values which are read back as they were written (i.e., no vectors, sorted maps or symbols)
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+
+    switch (rand() % (depth > 3 ? 4 : 6)) {
+        case 0:
+            return NULL;
+        case 1:
+            return TEST_VALUE(bowl_boolean(&frame, rand() % 2 == 0));
+        case 2:
+            // integers and fractions which are exact in binary
+            return TEST_VALUE(bowl_number(&frame, (rand() % 2000000 - 1000000) / (double) (1 << (rand() % 8))));
+        case 3: {
+            u32 codepoints[20];
+            const u64 length = (u64) rand() % 20;
+
+            for (u64 i = 0; i < length; ++i) {
+                const int kind = rand() % 8;
+                codepoints[i] = kind < 5 ? (u32) (' ' + rand() % 95) : kind == 5 ? (u32) (rand() % 0x20) : kind == 6 ? (u32) (0x100 + rand() % 0x2000) : (u32) (0x1f600 + rand() % 50);
+            }
+
+            return TEST_VALUE(bowl_string(&frame, codepoints, length));
+        }
+        case 4: {
+            const u64 length = (u64) rand() % 6;
+
+            for (u64 i = 0; i < length; ++i) {
+                frame.registers[1] = json_value(&frame, depth + 1);
+                frame.registers[0] = TEST_VALUE(bowl_list(&frame, frame.registers[1], frame.registers[0]));
+            }
+
+            return frame.registers[0];
+        }
+        default: {
+            const u64 length = (u64) rand() % 6;
+            frame.registers[0] = TEST_VALUE(bowl_map(&frame, length));
+
+            for (u64 i = 0; i < length; ++i) {
+                char key[8];
+                const int size = snprintf(key, sizeof(key), "k%d", rand() % 10);
+                frame.registers[1] = TEST_VALUE(bowl_string_utf8(&frame, (u8 *) key, (u64) size));
+                frame.registers[2] = json_value(&frame, depth + 1);
+                frame.registers[0] = TEST_VALUE(bowl_map_put(&frame, frame.registers[0], frame.registers[1], frame.registers[2]));
+            }
+
+            return frame.registers[0];
+        }
+    }
+}
+
+int main(void) {
+    BowlValue roots[3];
+    BowlStackFrame frame;
+    test_frame(&frame, roots);
+    srand(48);
+
+    json_valid(&frame, "0", "0");
+    json_valid(&frame, " -0 ", "-0");
+    json_valid(&frame, "1.5e3", "1500");
+    json_valid(&frame, "-12.25", "-12.25");
+    json_valid(&frame, "2.5E-1", "0.25");
+    json_valid(&frame, "true", "true");
+    json_valid(&frame, "false", "false");
+    json_valid(&frame, "null", "null");
+    json_valid(&frame, "[]", "null");
+    json_valid(&frame, "{}", "{}");
+    json_valid(&frame, "[1,2,[3,[]],{\"a\":null}]", "[1,2,[3,null],{\"a\":null}]");
+    json_valid(&frame, "\"\"", "\"\"");
+    json_valid(&frame, "\"a\\\"b\\\\c\\/d\\b\\f\\n\\r\\t\"", "\"a\\\"b\\\\c/d\\b\\f\\n\\r\\t\"");
+    json_valid(&frame, "\"\\u0041\\u00e9\\u20AC\\ud83d\\ude00\\u0001\"", "\"A\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\\u0001\"");
+    json_valid(&frame, "\"h\xc3\xa9llo w\xf0\x9f\x98\x80rld\"", "\"h\xc3\xa9llo w\xf0\x9f\x98\x80rld\"");
+    json_valid(&frame, " { \"k\" : [ 1 , 2 ] , \"k\" : 3 } ", "{\"k\":3}");
+    json_valid(&frame, "[\"a long string that crosses the sixteen byte boundary \\\" with an escape\"]",
+        "[\"a long string that crosses the sixteen byte boundary \\\" with an escape\"]");
+
+    JSON_INVALID(&frame, "");
+    JSON_INVALID(&frame, "   ");
+    JSON_INVALID(&frame, "[");
+    JSON_INVALID(&frame, "]");
+    JSON_INVALID(&frame, "[1,]");
+    JSON_INVALID(&frame, "[,1]");
+    JSON_INVALID(&frame, "[1 2]");
+    JSON_INVALID(&frame, "{\"a\"}");
+    JSON_INVALID(&frame, "{\"a\":1,}");
+    JSON_INVALID(&frame, "{1:2}");
+    JSON_INVALID(&frame, "{\"a\":}");
+    JSON_INVALID(&frame, "01");
+    JSON_INVALID(&frame, "1.");
+    JSON_INVALID(&frame, ".5");
+    JSON_INVALID(&frame, "-");
+    JSON_INVALID(&frame, "1e+");
+    JSON_INVALID(&frame, "+1");
+    JSON_INVALID(&frame, "truex");
+    JSON_INVALID(&frame, "nul");
+    JSON_INVALID(&frame, "1\"a\"");
+    JSON_INVALID(&frame, "\"abc");
+    JSON_INVALID(&frame, "\"a\nb\"");
+    JSON_INVALID(&frame, "\"\\x\"");
+    JSON_INVALID(&frame, "\"\\u12\"");
+    JSON_INVALID(&frame, "\"\\ud800\"");
+    JSON_INVALID(&frame, "\"\\udc00\"");
+    JSON_INVALID(&frame, "\"\\ud800\\u0041\"");
+    JSON_INVALID(&frame, "1 2");
+    JSON_INVALID(&frame, "[1]]");
+    JSON_INVALID(&frame, "\"\xff\"");
+    JSON_INVALID(&frame, "\"\xc3\"");
+    JSON_INVALID(&frame, "[\"a\"\"b\"]");
+    JSON_INVALID(&frame, "NaN");
+    JSON_INVALID(&frame, "\"a\\");
+
+    // the documents which are written are read back as the same values
+    for (u64 i = 0; i < JSON_DOCUMENTS; ++i) {
+        frame.registers[0] = json_value(&frame, 0);
+
+        u8 *bytes;
+        u64 length;
+        TEST_ASSERT(bowl_json_emit(&frame, frame.registers[0], &bytes, &length) == NULL);
+        frame.registers[1] = TEST_VALUE(bowl_json_parse(&frame, bytes, length));
+        TEST_ASSERT(bowl_value_equals(frame.registers[0], frame.registers[1]));
+        free(bytes);
+    }
+
+    // numbers which are not finite, exceptions and maps with other keys cannot be written
+    u8 *bytes;
+    u64 length;
+    frame.registers[0] = TEST_VALUE(bowl_number(&frame, 1.0 / 0.0));
+    TEST_ASSERT(bowl_json_emit(&frame, frame.registers[0], &bytes, &length) != NULL);
+    frame.registers[0] = TEST_VALUE(bowl_exception(&frame, NULL, NULL));
+    TEST_ASSERT(bowl_json_emit(&frame, frame.registers[0], &bytes, &length) != NULL);
+    frame.registers[0] = TEST_VALUE(bowl_map(&frame, 1));
+    frame.registers[1] = TEST_VALUE(bowl_number(&frame, 1));
+    frame.registers[0] = TEST_VALUE(bowl_map_put(&frame, frame.registers[0], frame.registers[1], frame.registers[1]));
+    TEST_ASSERT(bowl_json_emit(&frame, frame.registers[0], &bytes, &length) != NULL);
+
+    return EXIT_SUCCESS;
+}
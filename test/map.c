@@ -0,0 +1,173 @@
+#include "test.h"
+
+// the number of random operations per map
+#define MAP_OPERATIONS 40000
+// the largest number of distinct keys of a map
+#define MAP_KEYS 4096
+
+// the reference model of the map which is tested
+static bool map_present[MAP_KEYS];
+static double map_values[MAP_KEYS];
+
+static void map_check(BowlStack stack, u64 keys, u64 length) {
+    // the map in the first register must contain exactly the pairs of the model
+    TEST_ASSERT(stack->registers[0]->map.length == length);
+
+    for (u64 i = 0; i < keys; ++i) {
+        stack->registers[1] = TEST_VALUE(bowl_number(stack, (double) i));
+        const BowlValue value = bowl_map_get_or_else(stack->registers[0], stack->registers[1], NULL);
+        TEST_ASSERT(map_present[i] ? value != NULL && value->number.value == map_values[i] : value == NULL);
+    }
+
+    MapIterator iterator = map_iterator(stack->registers[0]);
+    BowlValue key, value;
+    u64 count = 0;
+
+    while (map_iterator_next(&iterator, &key, &value)) {
+        const u64 i = (u64) key->number.value;
+        TEST_ASSERT(i < keys && map_present[i] && map_values[i] == value->number.value);
+        ++count;
+    }
+
+    TEST_ASSERT(count == length);
+}
+
+static void map_random(BowlStack stack, u64 keys) {
+    memset(map_present, 0, sizeof(map_present));
+    stack->registers[0] = TEST_VALUE(bowl_map(stack, 0));
+    u64 length = 0;
+
+    for (u64 i = 0; i < MAP_OPERATIONS; ++i) {
+        const u64 key = (u64) rand() % keys;
+        stack->registers[1] = TEST_VALUE(bowl_number(stack, (double) key));
+
+        // two puts for each delete, such that the map keeps growing until it is full
+        if (rand() % 3 != 0) {
+            const double value = rand();
+            stack->registers[2] = TEST_VALUE(bowl_number(stack, value));
+            stack->registers[0] = TEST_VALUE(bowl_map_put(stack, stack->registers[0], stack->registers[1], stack->registers[2]));
+            length += !map_present[key];
+            map_present[key] = true;
+            map_values[key] = value;
+        } else {
+            stack->registers[0] = TEST_VALUE(bowl_map_delete(stack, stack->registers[0], stack->registers[1]));
+            length -= map_present[key];
+            map_present[key] = false;
+        }
+
+        TEST_ASSERT(stack->registers[0]->map.length == length);
+
+        if (i % (MAP_OPERATIONS / 8) == 0) {
+            map_check(stack, keys, length);
+        }
+    }
+
+    map_check(stack, keys, length);
+}
+
+static void map_persistent(BowlStack stack) {
+    // neither a put nor a delete changes the map which it was applied to
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+    frame.registers[0] = TEST_VALUE(bowl_map(&frame, 0));
+
+    for (u64 i = 0; i < 1000; ++i) {
+        frame.registers[1] = TEST_VALUE(bowl_number(&frame, (double) i));
+        frame.registers[0] = TEST_VALUE(bowl_map_put(&frame, frame.registers[0], frame.registers[1], frame.registers[1]));
+    }
+
+    frame.registers[1] = TEST_VALUE(bowl_number(&frame, 500));
+    frame.registers[2] = TEST_VALUE(bowl_map_put(&frame, frame.registers[0], frame.registers[1], NULL));
+    TEST_ASSERT(bowl_map_get_or_else(frame.registers[2], frame.registers[1], frame.registers[1]) == NULL);
+    TEST_ASSERT(bowl_map_get_or_else(frame.registers[0], frame.registers[1], NULL)->number.value == 500);
+
+    frame.registers[2] = TEST_VALUE(bowl_map_delete(&frame, frame.registers[0], frame.registers[1]));
+    TEST_ASSERT(frame.registers[2]->map.length == 999 && frame.registers[0]->map.length == 1000);
+    TEST_ASSERT(bowl_map_get_or_else(frame.registers[2], frame.registers[1], NULL) == NULL);
+    TEST_ASSERT(bowl_map_get_or_else(frame.registers[0], frame.registers[1], NULL) != NULL);
+
+    // the same pairs make equal maps with equal hashes, regardless of the order of the puts
+    frame.registers[1] = TEST_VALUE(bowl_map(&frame, 0));
+
+    for (u64 i = 1000; i-- > 0;) {
+        frame.registers[2] = TEST_VALUE(bowl_number(&frame, (double) i));
+        frame.registers[1] = TEST_VALUE(bowl_map_put(&frame, frame.registers[1], frame.registers[2], frame.registers[2]));
+    }
+
+    TEST_ASSERT(bowl_value_equals(frame.registers[0], frame.registers[1]));
+    TEST_ASSERT(bowl_value_hash(frame.registers[0]) == bowl_value_hash(frame.registers[1]));
+}
+
+static void map_merge(BowlStack stack) {
+    // the pairs of the second map take precedence
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+    frame.registers[0] = TEST_VALUE(bowl_map(&frame, 0));
+    frame.registers[1] = TEST_VALUE(bowl_map(&frame, 0));
+
+    for (u64 i = 0; i < 300; ++i) {
+        frame.registers[2] = TEST_VALUE(bowl_number(&frame, (double) i));
+        frame.registers[0] = TEST_VALUE(bowl_map_put(&frame, frame.registers[0], frame.registers[2], frame.registers[2]));
+        frame.registers[2] = TEST_VALUE(bowl_number(&frame, (double) (i + 200)));
+        frame.registers[1] = TEST_VALUE(bowl_map_put(&frame, frame.registers[1], frame.registers[2], NULL));
+    }
+
+    frame.registers[0] = TEST_VALUE(bowl_map_merge(&frame, frame.registers[0], frame.registers[1]));
+    TEST_ASSERT(frame.registers[0]->map.length == 500);
+    TEST_ASSERT(bowl_map_subset_of(frame.registers[0], frame.registers[1]));
+
+    MapIterator iterator = map_iterator(frame.registers[0]);
+    BowlValue key, value;
+
+    while (map_iterator_next(&iterator, &key, &value)) {
+        TEST_ASSERT(key->number.value < 200 ? value == key : value == NULL);
+    }
+}
+
+static void map_shrink(BowlStack stack) {
+    // a map which shrinks back to a few pairs is equal to a map which never held more of them
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+
+    for (u64 length = 0; length <= 20; ++length) {
+        frame.registers[0] = TEST_VALUE(bowl_map(&frame, 0));
+        frame.registers[1] = TEST_VALUE(bowl_map(&frame, 0));
+
+        for (u64 i = 0; i < 1000; ++i) {
+            frame.registers[2] = TEST_VALUE(bowl_number(&frame, (double) i));
+            frame.registers[0] = TEST_VALUE(bowl_map_put(&frame, frame.registers[0], frame.registers[2], frame.registers[2]));
+
+            if (i < length) {
+                frame.registers[1] = TEST_VALUE(bowl_map_put(&frame, frame.registers[1], frame.registers[2], frame.registers[2]));
+            }
+        }
+
+        for (u64 i = 1000; i-- > length;) {
+            frame.registers[2] = TEST_VALUE(bowl_number(&frame, (double) i));
+            frame.registers[0] = TEST_VALUE(bowl_map_delete(&frame, frame.registers[0], frame.registers[2]));
+        }
+
+        TEST_ASSERT(frame.registers[0]->map.length == length);
+        TEST_ASSERT(bowl_value_equals(frame.registers[0], frame.registers[1]));
+        TEST_ASSERT(bowl_value_hash(frame.registers[0]) == bowl_value_hash(frame.registers[1]));
+
+        for (u64 i = 0; i < length; ++i) {
+            frame.registers[2] = TEST_VALUE(bowl_number(&frame, (double) i));
+            TEST_ASSERT(bowl_map_get_or_else(frame.registers[0], frame.registers[2], NULL)->number.value == (double) i);
+        }
+    }
+}
+
+int main(void) {
+    BowlValue roots[3];
+    BowlStackFrame frame;
+    test_frame(&frame, roots);
+    srand(26);
+
+    // from maps which only ever hold a few pairs to maps whose tries are several levels deep
+    map_random(&frame, 8);
+    map_random(&frame, 64);
+    map_random(&frame, MAP_KEYS);
+    map_persistent(&frame);
+    map_merge(&frame);
+    map_shrink(&frame);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,67 @@
+#include "test.h"
+
+// the number of random sources
+#define PARALLEL_SOURCES 5000
+
+// the pieces of the sources, many of which contain newlines inside of string literals
+static const char *const parallel_pieces[] = {
+    " ", "\n", "\n\n", "\t", "\xc2\xa0", "\xe3\x80\x80",
+    "foo", "a\"b", "\xc3\xa9t\xc3\xa9", "\xf0\x9f\x98\x80", "\"str\"", "\"a \\\"q\\\" b\"", "\"\xc3\xa9\\n\"", "\"multi\nline\"",
+    "\"x\n\n\ny\"", "\"esc\\\nnl\"", "\"\\\\\"", "12", "-3", "+4.5", "1e3", "2.5E-2", "true", "false", "12\"s\n\"", "\"a\"\"b\"",
+    // the last pieces are malformed
+    "\"", "1.", "1e", "\\"
+};
+
+static void parallel_check(BowlStack stack, BowlScanner *scanner, u64 threads) {
+    // the first register holds the tokens (or the exception) of the sequential tokenizer
+    const BowlResult result = bowl_tokens_parallel(stack, scanner, threads);
+    const BowlValue expected = stack->registers[0];
+
+    if (expected != NULL && expected->type == BowlExceptionValue) {
+        TEST_ASSERT(result.failure && bowl_value_equals(result.exception->exception.message, expected->exception.message));
+    } else {
+        TEST_ASSERT(!result.failure && bowl_value_equals(result.value, expected));
+    }
+}
+
+int main(void) {
+    BowlValue roots[3];
+    BowlStackFrame frame;
+    test_frame(&frame, roots);
+    srand(43);
+
+    static char source[1 << 16];
+    const u64 count = sizeof(parallel_pieces) / sizeof(parallel_pieces[0]);
+
+    // tokenizing a source on several threads must be the same as tokenizing it sequentially
+    for (u64 i = 0; i < PARALLEL_SOURCES; ++i) {
+        const u64 pieces = (u64) rand() % 200;
+        const bool valid = rand() % 3 != 0;
+        u64 length = 0;
+
+        for (u64 j = 0; j < pieces; ++j) {
+            const char *const piece = parallel_pieces[rand() % (valid ? count - 4 : count)];
+
+            if (rand() % 2 == 0) {
+                source[length++] = rand() % 3 == 0 ? '\n' : ' ';
+            }
+
+            memcpy(&source[length], piece, strlen(piece));
+            length += strlen(piece);
+        }
+
+        const BowlResult expected = bowl_tokens_utf8(&frame, (u8 *) source, length);
+        frame.registers[0] = expected.failure ? expected.exception : expected.value;
+
+        const u64 threads = 2 + (u64) rand() % 7;
+        BowlScanner bytes = scanner_from_utf8((u8 *) source, length);
+        parallel_check(&frame, &bytes, threads);
+
+        // the same source as a string, whose codepoints may be wider than a byte
+        frame.registers[1] = TEST_VALUE(bowl_string_utf8(&frame, (u8 *) source, length));
+        BowlScanner codepoints = scanner_from(&frame.registers[1]);
+        parallel_check(&frame, &codepoints, threads);
+    }
+
+    return EXIT_SUCCESS;
+}
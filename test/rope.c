@@ -0,0 +1,141 @@
+#include "test.h"
+
+// the number of strings which are concatenated, sliced and flattened at random
+#define ROPE_STRINGS 32
+// the number of random operations
+#define ROPE_OPERATIONS 10000
+// the largest length of a string
+#define ROPE_LENGTH 100000
+
+// the codepoints of each string, which are the reference model of the test
+static u32 *rope_model[ROPE_STRINGS];
+static u64 rope_length[ROPE_STRINGS];
+
+static u32 rope_codepoint(void) {
+    // mostly ASCII, such that all widths occur in concatenations
+    const int kind = rand() % 10;
+    return kind < 7 ? (u32) ('a' + rand() % 26) : kind < 9 ? (u32) (0x100 + rand() % 0x1000) : (u32) (0x10000 + rand() % 0x1000);
+}
+
+static void rope_replace(u64 index, const u32 *codepoints, u64 length) {
+    u32 *const model = malloc(MAX(length, 1) * sizeof(u32));
+    TEST_ASSERT(model != NULL);
+    memcpy(model, codepoints, length * sizeof(u32));
+    free(rope_model[index]);
+    rope_model[index] = model;
+    rope_length[index] = length;
+}
+
+static void rope_check(BowlStack stack, u64 index) {
+    // a string must equal a flat copy of its codepoints, including its hash and its order
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, stack->registers[0]->vector.elements[index], NULL, NULL);
+    const u64 length = rope_length[index];
+    TEST_ASSERT(frame.registers[0]->string.length == length);
+
+    u32 *const codepoints = malloc(MAX(length, 1) * sizeof(u32));
+    TEST_ASSERT(codepoints != NULL);
+    bowl_text_read(frame.registers[0], 0, length, codepoints);
+    TEST_ASSERT(memcmp(codepoints, rope_model[index], length * sizeof(u32)) == 0);
+    free(codepoints);
+
+    if (length > 0) {
+        const u64 position = (u64) rand() % length;
+        TEST_ASSERT(bowl_text_at(frame.registers[0], position) == rope_model[index][position]);
+    }
+
+    frame.registers[1] = TEST_VALUE(bowl_string(&frame, rope_model[index], length));
+    TEST_ASSERT(text_is_flat(frame.registers[1]));
+    TEST_ASSERT(bowl_value_hash(frame.registers[0]) == bowl_value_hash(frame.registers[1]));
+    TEST_ASSERT(bowl_value_equals(frame.registers[0], frame.registers[1]) && bowl_value_equals(frame.registers[1], frame.registers[0]));
+    TEST_ASSERT(bowl_value_compare(frame.registers[0], frame.registers[1]) == 0);
+}
+
+int main(void) {
+    BowlValue roots[3];
+    BowlStackFrame frame;
+    test_frame(&frame, roots);
+    srand(36);
+
+    // the strings are the elements of the vector in the first register
+    frame.registers[0] = TEST_VALUE(bowl_vector(&frame, NULL, ROPE_STRINGS));
+
+    for (u64 i = 0; i < ROPE_STRINGS; ++i) {
+        u32 codepoints[100];
+        const u64 length = (u64) rand() % 100;
+
+        for (u64 j = 0; j < length; ++j) {
+            codepoints[j] = rope_codepoint();
+        }
+
+        rope_replace(i, codepoints, length);
+        const BowlValue string = TEST_VALUE(bowl_string(&frame, codepoints, length));
+        frame.registers[0]->vector.elements[i] = string;
+    }
+
+    for (u64 step = 0; step < ROPE_OPERATIONS; ++step) {
+        const int operation = rand() % 5;
+        const u64 a = (u64) rand() % ROPE_STRINGS;
+        const u64 b = (u64) rand() % ROPE_STRINGS;
+        const u64 target = (u64) rand() % ROPE_STRINGS;
+        BowlValue *const strings = frame.registers[0]->vector.elements;
+
+        if (operation <= 1) {
+            if (rope_length[a] + rope_length[b] > ROPE_LENGTH) {
+                continue;
+            }
+
+            frame.registers[1] = TEST_VALUE(bowl_string_concat(&frame, strings[a], strings[b]));
+            u32 *const codepoints = malloc(MAX(rope_length[a] + rope_length[b], 1) * sizeof(u32));
+            TEST_ASSERT(codepoints != NULL);
+            memcpy(codepoints, rope_model[a], rope_length[a] * sizeof(u32));
+            memcpy(&codepoints[rope_length[a]], rope_model[b], rope_length[b] * sizeof(u32));
+            rope_replace(target, codepoints, rope_length[a] + rope_length[b]);
+            free(codepoints);
+        } else if (operation <= 3) {
+            const u64 start = (u64) rand() % (rope_length[a] + 1);
+            const u64 length = (u64) rand() % (rope_length[a] - start + 1);
+            frame.registers[1] = TEST_VALUE(bowl_string_slice(&frame, strings[a], start, length));
+            rope_replace(target, &rope_model[a][start], length);
+        } else {
+            // flat strings are stored in their smallest width
+            frame.registers[1] = TEST_VALUE(bowl_string_flatten(&frame, strings[a]));
+            TEST_ASSERT(text_is_flat(frame.registers[1]));
+            TEST_ASSERT(frame.registers[1]->string.width == text_width(frame.registers[1]->string.bytes, frame.registers[1]->string.width, frame.registers[1]->string.length));
+            rope_replace(target, rope_model[a], rope_length[a]);
+        }
+
+        frame.registers[0]->vector.elements[target] = frame.registers[1];
+
+        if (step % 97 == 0) {
+            for (u64 i = 0; i < ROPE_STRINGS; ++i) {
+                rope_check(&frame, i);
+            }
+        }
+
+        if (step % 1000 == 0) {
+            TEST_ASSERT(bowl_collect_garbage(&frame) == NULL);
+        }
+    }
+
+    for (u64 i = 0; i < ROPE_STRINGS; ++i) {
+        rope_check(&frame, i);
+        free(rope_model[i]);
+    }
+
+    // a slice must be within its string
+    TEST_ASSERT(bowl_string_slice(&frame, frame.registers[0]->vector.elements[0], rope_length[0], 1).failure);
+
+    // appending one piece at a time stays balanced enough to be tokenized
+    frame.registers[1] = TEST_VALUE(bowl_string_utf8(&frame, (u8 *) "", 0));
+
+    for (u64 i = 0; i < 100000; ++i) {
+        frame.registers[2] = TEST_VALUE(bowl_string_utf8(&frame, (u8 *) "x1 ", 3));
+        frame.registers[1] = TEST_VALUE(bowl_string_concat(&frame, frame.registers[1], frame.registers[2]));
+    }
+
+    TEST_ASSERT(frame.registers[1]->string.length == 300000);
+    frame.registers[2] = TEST_VALUE(bowl_tokens(&frame, frame.registers[1]));
+    TEST_ASSERT(bowl_value_length(frame.registers[2]) == 100000);
+
+    return EXIT_SUCCESS;
+}
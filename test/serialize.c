@@ -0,0 +1,202 @@
+#include "test.h"
+#include "../src/core/serialize.h"
+#include <math.h>
+
+// the number of random values
+#define SERIALIZE_VALUES 1000
+
+static BowlValue serialize_text(BowlStack stack, BowlValueType type) {
+    // texts of all widths, some of which are slices
+    u32 codepoints[40];
+    const u64 length = (u64) rand() % 40;
+    const int kind = rand() % 3;
+
+    for (u64 i = 0; i < length; ++i) {
+        codepoints[i] = kind == 0 ? (u32) ('a' + rand() % 26) : kind == 1 ? (u32) (0x100 + rand() % 0x500) : (u32) (0x1f600 + rand() % 50);
+    }
+
+    if (type == BowlSymbolValue) {
+        return TEST_VALUE(bowl_symbol(stack, codepoints, length));
+    }
+
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+    frame.registers[0] = TEST_VALUE(bowl_string(&frame, codepoints, length));
+
+    if (length > 4 && rand() % 3 == 0) {
+        return TEST_VALUE(bowl_string_slice(&frame, frame.registers[0], 1, length - 2));
+    }
+
+    return frame.registers[0];
+}
+
+static BowlValue serialize_value(BowlStack stack, u64 depth) {
+    static const double numbers[] = { 0, -0.0, 1, -1, 1e300, -5e-324, 0.1, 123456789012345.0, 9007199254740993.0, INFINITY, -INFINITY, -9007199254740992.0, 4e18 };
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+
+    switch (rand() % (depth > 4 ? 5 : 12)) {
+        case 0:
+            return NULL;
+        case 1:
+            return TEST_VALUE(bowl_number(&frame, numbers[rand() % (sizeof(numbers) / sizeof(numbers[0]))]));
+        case 2:
+            return TEST_VALUE(bowl_boolean(&frame, rand() % 2 == 0));
+        case 3:
+            return serialize_text(&frame, BowlSymbolValue);
+        case 4:
+            return serialize_text(&frame, BowlStringValue);
+        case 5:
+        case 6: {
+            const u64 length = (u64) rand() % 6;
+
+            for (u64 i = 0; i < length; ++i) {
+                frame.registers[1] = serialize_value(&frame, depth + 1);
+                frame.registers[0] = TEST_VALUE(bowl_list(&frame, frame.registers[1], frame.registers[0]));
+            }
+
+            if (frame.registers[0] == NULL || rand() % 2 == 0) {
+                return frame.registers[0];
+            }
+
+            // two lists which share their tail, followed by the tail itself
+            frame.registers[1] = TEST_VALUE(bowl_list(&frame, frame.registers[0]->list.head, frame.registers[0]->list.tail));
+            frame.registers[2] = TEST_VALUE(bowl_vector(&frame, NULL, 3));
+            frame.registers[2]->vector.elements[0] = frame.registers[0];
+            frame.registers[2]->vector.elements[1] = frame.registers[1];
+            frame.registers[2]->vector.elements[2] = frame.registers[0]->list.tail;
+            return frame.registers[2];
+        }
+        case 7: {
+            const u64 length = (u64) rand() % 5;
+            frame.registers[0] = TEST_VALUE(bowl_vector(&frame, NULL, length));
+
+            for (u64 i = 0; i < length; ++i) {
+                const BowlValue element = serialize_value(&frame, depth + 1);
+                frame.registers[0]->vector.elements[i] = element;
+            }
+
+            if (length > 1) {
+                frame.registers[0]->vector.elements[length - 1] = frame.registers[0]->vector.elements[0];
+            }
+
+            return frame.registers[0];
+        }
+        case 8: {
+            const u64 length = (u64) rand() % 20;
+            frame.registers[0] = TEST_VALUE(bowl_map(&frame, length));
+
+            for (u64 i = 0; i < length; ++i) {
+                frame.registers[1] = serialize_text(&frame, rand() % 2 == 0 ? BowlSymbolValue : BowlStringValue);
+                frame.registers[2] = serialize_value(&frame, depth + 1);
+                frame.registers[0] = TEST_VALUE(bowl_map_put(&frame, frame.registers[0], frame.registers[1], frame.registers[2]));
+            }
+
+            return frame.registers[0];
+        }
+        case 9: {
+            const u64 length = (u64) rand() % 40;
+            frame.registers[0] = TEST_VALUE(bowl_sorted_map(&frame));
+
+            for (u64 i = 0; i < length; ++i) {
+                frame.registers[1] = TEST_VALUE(bowl_number(&frame, rand() % 100));
+                frame.registers[2] = serialize_value(&frame, depth + 1);
+                frame.registers[0] = TEST_VALUE(bowl_sorted_map_put(&frame, frame.registers[0], frame.registers[1], frame.registers[2]));
+            }
+
+            return frame.registers[0];
+        }
+        case 10:
+            frame.registers[0] = serialize_text(&frame, BowlStringValue);
+            frame.registers[1] = rand() % 2 == 0 ? bowl_exception_out_of_heap : NULL;
+            return TEST_VALUE(bowl_exception(&frame, frame.registers[1], frame.registers[0]));
+        default:
+            frame.registers[0] = serialize_text(&frame, BowlStringValue);
+            frame.registers[1] = serialize_text(&frame, BowlStringValue);
+            return TEST_VALUE(bowl_string_concat(&frame, frame.registers[0], frame.registers[1]));
+    }
+}
+
+static void serialize_check_sharing(BowlValue value) {
+    // the lists which shared their tail before they were serialized still share it
+    if (value == NULL) {
+        return;
+    }
+
+    if (value->type == BowlVectorValue) {
+        const BowlValue *const elements = value->vector.elements;
+
+        if (value->vector.length == 3 && elements[0] != NULL && elements[0]->type == BowlListValue
+            && elements[1] != NULL && elements[1]->type == BowlListValue) {
+            TEST_ASSERT(elements[0]->list.tail == elements[1]->list.tail && elements[0]->list.tail == elements[2]);
+        }
+
+        for (u64 i = 0; i < value->vector.length; ++i) {
+            serialize_check_sharing(elements[i]);
+        }
+    } else if (value->type == BowlListValue) {
+        for (; value != NULL; value = value->list.tail) {
+            serialize_check_sharing(value->list.head);
+        }
+    }
+}
+
+int main(void) {
+    BowlValue roots[3];
+    BowlStackFrame frame;
+    test_frame(&frame, roots);
+    srand(47);
+
+    for (u64 i = 0; i < SERIALIZE_VALUES; ++i) {
+        frame.registers[0] = serialize_value(&frame, 0);
+
+        u8 *bytes;
+        u64 length;
+        TEST_ASSERT(bowl_value_serialize(&frame, frame.registers[0], &bytes, &length) == NULL);
+        frame.registers[1] = TEST_VALUE(bowl_value_deserialize(&frame, bytes, length, NULL));
+        TEST_ASSERT(bowl_value_equals(frame.registers[0], frame.registers[1]));
+        serialize_check_sharing(frame.registers[1]);
+
+        // the buffer is read in place, even if it is not aligned
+        u8 *const copy = malloc(length + 1);
+        TEST_ASSERT(copy != NULL);
+        memcpy(copy + 1, bytes, length);
+        frame.registers[1] = TEST_VALUE(bowl_value_deserialize(&frame, copy + 1, length, NULL));
+        TEST_ASSERT(bowl_value_equals(frame.registers[0], frame.registers[1]));
+
+        // nothing behind a value is read from a stream
+        FILE *const stream = tmpfile();
+        TEST_ASSERT(stream != NULL);
+        TEST_ASSERT(bowl_value_serialize_stream(&frame, frame.registers[0], stream) == NULL);
+        TEST_ASSERT(fflush(stream) == 0);
+        TEST_ASSERT(bowl_value_serialize_descriptor(&frame, frame.registers[0], fileno(stream)) == NULL);
+        rewind(stream);
+
+        for (u64 j = 0; j < 2; ++j) {
+            frame.registers[1] = TEST_VALUE(bowl_value_deserialize_stream(&frame, stream));
+            TEST_ASSERT(bowl_value_equals(frame.registers[0], frame.registers[1]));
+        }
+
+        fclose(stream);
+
+        // truncated values are rejected, and corrupted ones must not be read out of bounds
+        for (u64 cut = 0; cut < length; cut += 1 + length / 16) {
+            TEST_ASSERT(bowl_value_deserialize(&frame, bytes, cut, NULL).failure);
+        }
+
+        for (u64 j = 0; j < 8 && length > SERIALIZE_MAGIC_LENGTH; ++j) {
+            memcpy(copy, bytes, length);
+            copy[SERIALIZE_MAGIC_LENGTH + (u64) rand() % (length - SERIALIZE_MAGIC_LENGTH)] ^= (u8) (1 << (rand() % 8));
+            bowl_value_deserialize(&frame, copy, length, NULL);
+        }
+
+        free(copy);
+        free(bytes);
+    }
+
+    // native functions cannot be serialized
+    frame.registers[0] = TEST_VALUE(bowl_function(&frame, NULL, NULL));
+    u8 *bytes;
+    u64 length;
+    TEST_ASSERT(bowl_value_serialize(&frame, frame.registers[0], &bytes, &length) != NULL);
+
+    return EXIT_SUCCESS;
+}
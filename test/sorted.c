@@ -0,0 +1,200 @@
+#include "test.h"
+
+// the number of random operations
+#define SORTED_OPERATIONS 40000
+// the number of distinct keys
+#define SORTED_KEYS 2000
+
+// the reference model of the sorted map which is tested
+static bool sorted_present[SORTED_KEYS];
+static double sorted_values[SORTED_KEYS];
+
+static u64 sorted_check_node(BowlValue node, bool root) {
+    // checks the invariants of the B-tree and returns its depth
+    const u64 pairs = node->map.capacity & ~SORTED_MAP_BRANCH;
+    u64 length = pairs;
+    u64 depth = 0;
+
+    TEST_ASSERT(pairs <= SORTED_MAP_MAXIMUM && (root || pairs >= SORTED_MAP_MINIMUM));
+
+    for (u64 i = 1; i < pairs; ++i) {
+        TEST_ASSERT(bowl_value_compare(node->map.buckets[2 * (i - 1)], node->map.buckets[2 * i]) < 0);
+    }
+
+    if (node->map.capacity & SORTED_MAP_BRANCH) {
+        for (u64 i = 0; i <= pairs; ++i) {
+            const BowlValue child = node->map.buckets[2 * pairs + i];
+            const u64 child_depth = sorted_check_node(child, false);
+            TEST_ASSERT(i == 0 || child_depth == depth);
+            depth = child_depth;
+            length += child->map.length;
+        }
+    }
+
+    TEST_ASSERT(length == node->map.length);
+    return depth + 1;
+}
+
+static void sorted_random(BowlStack stack) {
+    stack->registers[0] = TEST_VALUE(bowl_sorted_map(stack));
+    u64 length = 0;
+
+    for (u64 i = 0; i < SORTED_OPERATIONS; ++i) {
+        const u64 key = (u64) rand() % SORTED_KEYS;
+        stack->registers[1] = TEST_VALUE(bowl_number(stack, (double) key));
+
+        if (rand() % 3 != 0) {
+            const double value = rand();
+            stack->registers[2] = TEST_VALUE(bowl_number(stack, value));
+            stack->registers[0] = TEST_VALUE(bowl_sorted_map_put(stack, stack->registers[0], stack->registers[1], stack->registers[2]));
+            length += !sorted_present[key];
+            sorted_present[key] = true;
+            sorted_values[key] = value;
+        } else {
+            stack->registers[0] = TEST_VALUE(bowl_sorted_map_delete(stack, stack->registers[0], stack->registers[1]));
+            length -= sorted_present[key];
+            sorted_present[key] = false;
+        }
+
+        TEST_ASSERT(stack->registers[0]->map.length == length);
+
+        if (i % (SORTED_OPERATIONS / 8) == 0) {
+            sorted_check_node(stack->registers[0], true);
+
+            for (u64 j = 0; j < SORTED_KEYS; ++j) {
+                stack->registers[1] = TEST_VALUE(bowl_number(stack, (double) j));
+                const BowlValue value = bowl_sorted_map_get_or_else(stack->registers[0], stack->registers[1], NULL);
+                TEST_ASSERT(sorted_present[j] ? value != NULL && value->number.value == sorted_values[j] : value == NULL);
+            }
+        }
+    }
+
+    sorted_check_node(stack->registers[0], true);
+
+    // the positions follow the order of the keys
+    BowlValue key, value;
+    u64 index = 0;
+
+    for (u64 i = 0; i < SORTED_KEYS; ++i) {
+        if (sorted_present[i]) {
+            TEST_ASSERT(bowl_sorted_map_at(stack->registers[0], index++, &key, &value));
+            TEST_ASSERT(key->number.value == (double) i && value->number.value == sorted_values[i]);
+        }
+    }
+
+    TEST_ASSERT(!bowl_sorted_map_at(stack->registers[0], index, &key, &value));
+}
+
+static void sorted_cursor(BowlStack stack) {
+    // all keys are visited in ascending order, even if the garbage collector runs in between
+    BowlSortedMapCursor cursor = bowl_sorted_map_cursor(&stack->registers[0]);
+    BowlValue key, value;
+    u64 count = 0;
+    double previous = -1;
+
+    while (bowl_sorted_map_cursor_next(&cursor, &key, &value)) {
+        const u64 i = (u64) key->number.value;
+        TEST_ASSERT(key->number.value > previous && sorted_present[i] && value->number.value == sorted_values[i]);
+        previous = key->number.value;
+        ++count;
+
+        if (count % 5 == 0) {
+            TEST_ASSERT(bowl_collect_garbage(stack) == NULL);
+        }
+    }
+
+    TEST_ASSERT(count == stack->registers[0]->map.length);
+}
+
+static void sorted_range(BowlStack stack) {
+    // the bounds are fractions every other time, such that they are not keys of the map
+    for (u64 i = 0; i < 100; ++i) {
+        double from = rand() % SORTED_KEYS + (i % 2) * 0.5;
+        double to = rand() % SORTED_KEYS;
+
+        if (from > to) {
+            const double swap = from;
+            from = to;
+            to = swap;
+        }
+
+        BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+        frame.registers[0] = TEST_VALUE(bowl_number(&frame, from));
+        frame.registers[1] = TEST_VALUE(bowl_number(&frame, to));
+
+        BowlSortedMapCursor cursor = bowl_sorted_map_range(&stack->registers[0], &frame.registers[0], &frame.registers[1]);
+        BowlValue key, value;
+        u64 count = 0, expected = 0;
+
+        for (u64 j = 0; j < SORTED_KEYS; ++j) {
+            expected += sorted_present[j] && j >= from && j < to;
+        }
+
+        while (bowl_sorted_map_cursor_next(&cursor, &key, &value)) {
+            TEST_ASSERT(key->number.value >= from && key->number.value < to);
+            ++count;
+
+            if (count % 3 == 0) {
+                TEST_ASSERT(bowl_collect_garbage(&frame) == NULL);
+            }
+        }
+
+        TEST_ASSERT(count == expected);
+    }
+}
+
+static void sorted_prefix(BowlStack stack) {
+    static const char *const words[] = { "list:push", "list:pop", "map:put", "list:concat", "lis", "list:", "map:get", "listx", "list:pop:all" };
+    static const char *const expected[] = { "list:", "list:concat", "list:pop", "list:pop:all", "list:push" };
+    BowlStackFrame frame = BOWL_ALLOCATE_STACK_FRAME(stack, NULL, NULL, NULL);
+    frame.registers[0] = TEST_VALUE(bowl_sorted_map(&frame));
+
+    for (u64 i = 0; i < sizeof(words) / sizeof(words[0]); ++i) {
+        frame.registers[1] = TEST_VALUE(bowl_symbol_utf8(&frame, (u8 *) words[i], strlen(words[i])));
+        frame.registers[0] = TEST_VALUE(bowl_sorted_map_put(&frame, frame.registers[0], frame.registers[1], NULL));
+    }
+
+    // the keys are told apart by their hashes, which do not change when the keys are moved
+    u64 hashes[sizeof(expected) / sizeof(expected[0])];
+
+    for (u64 i = 0; i < sizeof(expected) / sizeof(expected[0]); ++i) {
+        frame.registers[1] = TEST_VALUE(bowl_symbol_utf8(&frame, (u8 *) expected[i], strlen(expected[i])));
+        hashes[i] = bowl_value_hash(frame.registers[1]);
+    }
+
+    frame.registers[1] = TEST_VALUE(bowl_symbol_utf8(&frame, (u8 *) "list:", 5));
+    BowlSortedMapCursor cursor = bowl_sorted_map_prefix(&frame.registers[0], &frame.registers[1]);
+    BowlValue key, value;
+    u64 count = 0;
+
+    while (bowl_sorted_map_cursor_next(&cursor, &key, &value)) {
+        TEST_ASSERT(count < sizeof(expected) / sizeof(expected[0]));
+        TEST_ASSERT(key->symbol.length == strlen(expected[count]) && bowl_value_hash(key) == hashes[count]);
+        ++count;
+        TEST_ASSERT(bowl_collect_garbage(&frame) == NULL);
+    }
+
+    TEST_ASSERT(count == sizeof(expected) / sizeof(expected[0]));
+}
+
+int main(void) {
+    BowlValue roots[3];
+    BowlStackFrame frame;
+    test_frame(&frame, roots);
+    srand(31);
+
+    sorted_random(&frame);
+    sorted_cursor(&frame);
+    sorted_range(&frame);
+    sorted_prefix(&frame);
+
+    // deleting every key leaves an empty leaf behind
+    for (u64 i = 0; i < SORTED_KEYS; ++i) {
+        frame.registers[1] = TEST_VALUE(bowl_number(&frame, (double) i));
+        frame.registers[0] = TEST_VALUE(bowl_sorted_map_delete(&frame, frame.registers[0], frame.registers[1]));
+    }
+
+    TEST_ASSERT(frame.registers[0]->map.length == 0 && frame.registers[0]->map.capacity == 0);
+
+    return EXIT_SUCCESS;
+}
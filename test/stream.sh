@@ -0,0 +1,15 @@
+#!/bin/sh
+# streams random programs with chunks of a few bytes, such that every token is split somewhere, and
+# with the default chunk size
+set -e
+
+directory=build/test/stream
+sources=$(find src -type f -iname '*.c' ! -path src/main.c)
+
+rm -rf "$directory"
+mkdir -p "$directory"
+
+for size in 1 3 7 65536; do
+    "$COMPILER" -o "$directory/check" -std=c11 test/stream/check.c $sources -DSTREAM_CHUNK_SIZE=$size -I"$INCLUDE" -lm -ldl -lpthread
+    "$directory/check" "$directory/source.bowl"
+done
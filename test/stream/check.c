@@ -0,0 +1,116 @@
+#include "../test.h"
+#include "../../src/core/stream.h"
+
+/*
+ * Streams random programs from a file (whose path is the only argument) through a minimal
+ * interpreter and compares the result with the tokens of the whole program. The virtual machine is
+ * compiled with tiny chunks by 'test/stream.sh', such that tokens, escape sequences and UTF-8
+ * sequences are split at every possible position.
+ */
+
+// the number of random programs
+#define CHECK_PROGRAMS 3000
+
+// the pieces of the programs, including separators, malformed literals and codepoints of all widths
+static const char *const check_pieces[] = {
+    " ", "  ", "\n", "\t", "\xc2\xa0", "\xe3\x80\x80", "\xe2\x80\x83", "\xc2\x85",
+    "foo", "bar-baz", "\xc3\xa9t\xc3\xa9", "\xe6\x97\xa5\xe6\x9c\xac", "\xf0\x9f\x98\x80", "\xc2\xa9x", "\xe2\x82\xac",
+    "\"str\"", "\"a \\\"q\\\" b\"", "\"\xc3\xa9\\n\"", "\"\\u0041\"", "\"multi\nline\"", "\"", "\\", "\x01",
+    "12", "-3", "+4.5", "1e3", "2.5E-2", "true", "false", "truex", "-", "+", "1.", "1e", "-x",
+    "\"long string literal with plenty of ascii characters inside\"",
+    "averyveryverylongsymbolnamewithmorethansixteenbytes", "\"\xe2\x80\x83 wide \xf0\x9f\x98\x80\""
+};
+
+static BowlValue check_run(BowlStack stack, const char *path) {
+    // pushes every token onto the datastack and calls the continuations of the stream
+    BowlResult result = bowl_tokens_file(stack, path);
+
+    if (result.failure) {
+        return result.exception;
+    }
+
+    *stack->callstack = result.value;
+    *stack->datastack = NULL;
+
+    while (*stack->callstack != NULL) {
+        const BowlValue head = (*stack->callstack)->list.head;
+        *stack->callstack = (*stack->callstack)->list.tail;
+
+        if (head->type == BowlNativeValue) {
+            const BowlValue exception = head->function.function(stack);
+
+            if (exception != NULL) {
+                return exception;
+            }
+        } else {
+            *stack->datastack = TEST_VALUE(bowl_list(stack, head, *stack->datastack));
+        }
+
+        // the stream must survive garbage collections between the steps of the interpreter
+        if (rand() % 16 == 0) {
+            TEST_ASSERT(bowl_collect_garbage(stack) == NULL);
+        }
+    }
+
+    return NULL;
+}
+
+int main(int argument_count, char *arguments[]) {
+    BowlValue roots[3];
+    BowlStackFrame frame;
+    test_frame(&frame, roots);
+    srand(41);
+
+    TEST_ASSERT(argument_count == 2);
+    char program[8192];
+
+    for (u64 i = 0; i < CHECK_PROGRAMS; ++i) {
+        const u64 pieces = (u64) rand() % 60;
+        const u64 count = sizeof(check_pieces) / sizeof(check_pieces[0]);
+        const bool valid = rand() % 4 != 0;
+        u64 length = 0;
+
+        for (u64 j = 0; j < pieces; ++j) {
+            // valid programs consist of separators, symbols, strings and numbers only
+            const char *piece = check_pieces[valid ? rand() % 15 + (rand() % 2 == 0 ? 0 : 23) : rand() % count];
+
+            if (valid && (piece[0] == '-' || piece[0] == '+') && piece[1] == '\0') {
+                piece = "x";
+            }
+
+            if (valid || rand() % 3 == 0) {
+                program[length++] = ' ';
+            }
+
+            memcpy(&program[length], piece, strlen(piece));
+            length += strlen(piece);
+        }
+
+        // the program may end within a UTF-8 sequence
+        if (rand() % 5 == 0 && length > 0) {
+            length -= rand() % 2;
+        }
+
+        FILE *const file = fopen(arguments[1], "wb");
+        TEST_ASSERT(file != NULL && fwrite(program, 1, length, file) == length && fclose(file) == 0);
+
+        const BowlResult expected = bowl_tokens_utf8(&frame, (u8 *) program, length);
+        frame.registers[0] = expected.failure ? expected.exception : expected.value;
+        const BowlValue exception = check_run(&frame, arguments[1]);
+
+        TEST_ASSERT((exception != NULL) == expected.failure);
+
+        if (!expected.failure) {
+            frame.registers[1] = TEST_VALUE(bowl_list_reverse(&frame, *frame.datastack));
+            TEST_ASSERT(bowl_value_equals(frame.registers[0], frame.registers[1]));
+        } else if (frame.registers[0] != bowl_exception_malformed_utf8 && frame.registers[0] != bowl_exception_incomplete_utf8) {
+            // an invalid UTF-8 sequence is only found once its chunk is read
+            TEST_ASSERT(bowl_value_equals(exception->exception.message, frame.registers[0]->exception.message));
+        }
+
+        *frame.callstack = *frame.datastack = NULL;
+        frame.registers[0] = frame.registers[1] = NULL;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,58 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include "../src/core/core.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Each test is a program of its own, which is linked against all sources of the virtual machine
+ * except for its entry point (see the 'test' target of the makefile). A test either returns
+ * successfully or stops at the first assertion which does not hold.
+ */
+
+// the settings are usually defined by the entry point of the virtual machine
+const char *bowl_settings_boot_path = "boot.bowl";
+const char *bowl_settings_kernel_path = "kernel.so";
+u64 bowl_settings_verbosity = 0;
+
+#define TEST_ASSERT(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: assertion failed: %s\n", __FILE__, __LINE__, #condition); \
+            exit(EXIT_FAILURE); \
+        } \
+    } while (0)
+
+#define TEST_VALUE(expression) test_value((expression), __FILE__, __LINE__)
+
+/**
+ * Returns the value of a result or stops the test if the result is an exception.
+ * @param result The result.
+ * @param file The file of the test.
+ * @param line The line of the test.
+ * @return The value of the result.
+ */
+static inline BowlValue test_value(BowlResult result, const char *file, int line) {
+    if (result.failure) {
+        fprintf(stderr, "%s:%d: unexpected exception\n", file, line);
+        exit(EXIT_FAILURE);
+    }
+
+    return result.value;
+}
+
+/**
+ * Creates an empty stack frame whose dictionary, callstack and datastack are the given roots.
+ * @param frame The frame which is initialized.
+ * @param roots The three roots of the frame.
+ */
+static inline void test_frame(BowlStackFrame *frame, BowlValue roots[3]) {
+    *frame = BOWL_EMPTY_STACK_FRAME(NULL);
+    roots[0] = roots[1] = roots[2] = NULL;
+    frame->dictionary = &roots[0];
+    frame->callstack = &roots[1];
+    frame->datastack = &roots[2];
+}
+
+#endif
@@ -0,0 +1,55 @@
+#include "test.h"
+
+// the number of random programs
+#define TOKENS_PROGRAMS 20000
+
+// the pieces of the programs, including separators, malformed literals and codepoints of all widths
+static const char *const tokens_pieces[] = {
+    " ", "  ", "\n", "\t", "\xc2\xa0", "\xe3\x80\x80", "\xe2\x80\x83", "\xc2\x85",
+    "foo", "bar-baz", "\xc3\xa9t\xc3\xa9", "\xe6\x97\xa5\xe6\x9c\xac", "\xf0\x9f\x98\x80", "\xc2\xa9x", "\xe2\x82\xac",
+    "\"str\"", "\"a \\\"q\\\" b\"", "\"\xc3\xa9\\n\"", "\"\\u0041\"", "\"multi\nline\"", "\"", "\\", "\x01",
+    "12", "-3", "+4.5", "1e3", "2.5E-2", "true", "false", "truex", "-", "+", "1.", "1e", "-x",
+    "\"long string literal with plenty of ascii characters inside\"",
+    "averyveryverylongsymbolnamewithmorethansixteenbytes", "\"\xe2\x80\x83 wide \xf0\x9f\x98\x80\""
+};
+
+int main(void) {
+    BowlValue roots[3];
+    BowlStackFrame frame;
+    test_frame(&frame, roots);
+    srand(40);
+
+    char program[4096];
+    u64 failures = 0;
+
+    // tokenizing the bytes must be the same as decoding them into a string and tokenizing the string
+    for (u64 i = 0; i < TOKENS_PROGRAMS; ++i) {
+        const u64 pieces = (u64) rand() % 30;
+        u64 length = 0;
+
+        for (u64 j = 0; j < pieces; ++j) {
+            const char *const piece = tokens_pieces[rand() % (sizeof(tokens_pieces) / sizeof(tokens_pieces[0]))];
+
+            if (rand() % 3 == 0) {
+                program[length++] = ' ';
+            }
+
+            memcpy(&program[length], piece, strlen(piece));
+            length += strlen(piece);
+        }
+
+        frame.registers[0] = TEST_VALUE(bowl_string_utf8(&frame, (u8 *) program, length));
+        const BowlResult expected = bowl_tokens(&frame, frame.registers[0]);
+        frame.registers[1] = expected.failure ? expected.exception->exception.message : expected.value;
+        const BowlResult actual = bowl_tokens_utf8(&frame, (u8 *) program, length);
+
+        TEST_ASSERT(actual.failure == expected.failure);
+        TEST_ASSERT(bowl_value_equals(actual.failure ? actual.exception->exception.message : actual.value, frame.registers[1]));
+        failures += expected.failure;
+    }
+
+    // both valid and malformed programs occur
+    TEST_ASSERT(failures > TOKENS_PROGRAMS / 10 && failures < TOKENS_PROGRAMS - TOKENS_PROGRAMS / 10);
+
+    return EXIT_SUCCESS;
+}